@@ -5,10 +5,10 @@
 #include "queue.h"
 #include "tasks_conf.h"
 #include <string.h>
-#include "dsp/fir.h"
 #include "q15/q15.h"
-#include "dsp/decim.h"
 #include "dsp/mwin.h"
+#include "defs/defs.h"
+#include "fir_decim.h"
 #include "hires_timer.h"
 #include "osc.h"
 #include "oscs.h"
@@ -18,6 +18,26 @@
 //! Размер очереди.
 #define AIN_QUEUE_SIZE 4
 
+//! Сбор статистики обработки данных АЦП.
+#ifndef AIN_STATS
+#define AIN_STATS 1
+#endif
+
+/**
+ * Подсчёт тактов этапов обработки
+ * счётчиком DWT, включаемым при инициализации.
+ * Добавляет чтения счётчика в обработку каждого
+ * кадра, поэтому включается только для замеров.
+ */
+#ifndef AIN_STATS_CYCLES
+#define AIN_STATS_CYCLES 0
+#endif
+
+#if AIN_STATS == 0
+#undef AIN_STATS_CYCLES
+#define AIN_STATS_CYCLES 0
+#endif
+
 //! Разрешение АЦП, бит.
 #define ADC_BITS 12
 
@@ -31,9 +51,27 @@
 #define AIN_UNIT_BUF_SIZE ((AIN_UNIT_LEN) + 1)
 
 
+/**
+ * Число буферов отдельных кадров.
+ * Кроме кадров в очереди один кадр может
+ * обрабатываться задачей.
+ */
+#define AIN_QUEUE_FRAMES ((AIN_QUEUE_SIZE) + 1)
+
+//! Тип данных команды.
+typedef enum _Ain_Queue_Type {
+    AIN_QUEUE_FRAME = 0, //!< Кадр в буфере кадров.
+    AIN_QUEUE_BLOCK = 1 //!< Блок буфера ПДП.
+} ain_queue_type_t;
+
 //! Команда.
 typedef struct _Ain_Queue_Data {
-    uint16_t adc_data[AIN_CHANNELS_COUNT];
+    uint8_t type; //!< Тип данных (ain_queue_type_t).
+    uint8_t index; //!< Номер буфера кадра или блока буфера ПДП.
+    uint32_t frame; //!< Младшие разряды номера первого кадра данных.
+#if AIN_STATS == 1
+    uint32_t time; //!< Время прерывания АЦП, мкс.
+#endif
 } ain_queue_data_t;
 
 // Значения по-умолчанию параметров каналов.
@@ -56,20 +94,108 @@ typedef struct _Ain_Queue_Data {
 //! Число кэффициентов КИХ-фильтра.
 #define AIN_FIR_N (AIN_FIR_P + 1)
 
-static q15_t fir_coefs[AIN_FIR_N] = {
+// Коэффициенты КИХ-фильтров для децимации в заданное число раз.
+// Окно Хэмминга, срез чуть ниже частоты Найквиста после децимации.
+//! Децимация в 8 раз.
+static const q15_t fir_coefs_r8[AIN_FIR_N] = {
 		 -72,  -74,  -66,    8,  218,  620, 1226, 1990,
 		2809, 3546, 4058, 4242, 4058, 3546, 2809, 1990,
 		1226,  620,  218,    8,  -66,  -74, -72
 };
 
-//! Коэффициент децимации АЦП.
-#define AIN_ADC_DECIM_SCALE AIN_OVERSAMPLE_RATE
+//! Децимация в 6 раз.
+static const q15_t fir_coefs_r6[AIN_FIR_N] = {
+		 -41,  -91, -177, -264, -246,   21,  654, 1665,
+		2921, 4162, 5075, 5410, 5075, 4162, 2921, 1665,
+		 654,   21, -246, -264, -177,  -91, -41
+};
+
+//! Децимация в 4 раза.
+static const q15_t fir_coefs_r4[AIN_FIR_N] = {
+		  57,  102,  118,  -16, -382, -822, -862,   48,
+		2100, 4819, 7170, 8104, 7170, 4819, 2100,   48,
+		-862, -822, -382,  -16,  118,  102, 57
+};
+
+//! Децимация в 3 раза.
+static const q15_t fir_coefs_r3[AIN_FIR_N] = {
+		 -69,  -85,   13,  280,  436,  -42,-1123,-1623,
+		  74, 4240, 8849,10868, 8849, 4240,   74,-1623,
+		-1123,  -42,  436,  280,   13,  -85, -69
+};
 
-//! Размер окна для вычисления действующего значения.
-#define AIN_MWIN_EFF_SIZE AIN_EFF_SAMPLES
+//! Децимация в 2 раза.
+static const q15_t fir_coefs_r2[AIN_FIR_N] = {
+		 -75,   13,  177,  -31, -519,   62, 1263,  -96,
+		-2928,  122,10255,16282,10255,  122,-2928,  -96,
+		1263,   62, -519,  -31,  177,   13, -75
+};
+
+//! Тип профиля частот дискретизации.
+typedef struct _Ain_Rate {
+    uint16_t sample_freq; //!< Частота семплирования, Гц.
+    uint8_t power_freq; //!< Частота сети, Гц.
+    uint8_t oversample_rate; //!< Кратность оверсемплинга.
+    const q15_t* fir_coefs; //!< Коэффициенты КИХ-фильтра децимации.
+} ain_rate_t;
+
+/**
+ * Профили частот дискретизации.
+ * Частота оверсемплинга должна делить
+ * частоту счёта таймера АЦП нацело,
+ * число точек за период - не более AIN_PERIOD_SAMPLES_MAX.
+ */
+static const ain_rate_t ain_rates[] = {
+    // 50 Гц.
+    { 800, 50, 8, fir_coefs_r8},
+    {1600, 50, 8, fir_coefs_r8},
+    {3200, 50, 4, fir_coefs_r4},
+    {6400, 50, 2, fir_coefs_r2},
+    // 60 Гц.
+    { 960, 60, 8, fir_coefs_r8},
+    {1920, 60, 6, fir_coefs_r6},
+    {3840, 60, 3, fir_coefs_r3},
+    {7680, 60, 3, fir_coefs_r3},
+};
+
+//! Число профилей частот дискретизации.
+#define AIN_RATES_COUNT (sizeof(ain_rates) / sizeof(ain_rates[0]))
+
+//! Максимальный размер окна для вычисления действующего значения.
+#define AIN_MWIN_EFF_SIZE_MAX AIN_PERIOD_SAMPLES_MAX
 //! Корень из размера окна действующего значения.
 //#define AIN_MWIN_EFF_SIZE_SQRT 0x2D414
 
+/**
+ * Обработка всех разрешённых каналов за один проход
+ * по кадру с хранением состояний фильтров и окон
+ * действующих значений в чередующихся массивах.
+ * Иначе каждый канал обрабатывается отдельно.
+ */
+#ifndef AIN_SOA
+#define AIN_SOA 1
+#endif
+
+//! Вычисление действующего значения на каждом отсчёте.
+#define AIN_EFF_CALC_SAMPLE 0
+//! Вычисление действующего значения при чтении.
+#define AIN_EFF_CALC_LAZY 1
+//! Вычисление действующего значения раз в период сети.
+#define AIN_EFF_CALC_PERIOD 2
+
+/**
+ * Способ вычисления действующего значения.
+ * Сумма окна обновляется на каждом отсчёте,
+ * нормирование и корень вычисляются
+ * согласно выбранному способу.
+ */
+#ifndef AIN_EFF_CALC
+#define AIN_EFF_CALC AIN_EFF_CALC_LAZY
+#endif
+
+//! Нормирование суммы окна умножением на обратную величину вместо деления.
+#define AIN_EFF_RECIP 1
+
 //! Тип канала аналоговых входов.
 typedef struct _Ain_Channel {
     ain_channel_type_t type; //!< Тип канала.
@@ -80,16 +206,45 @@ typedef struct _Ain_Channel {
     iq15_t real_k; //!< Коэффициент преобразования в реальную величину.
     char name[AIN_NAME_BUF_SIZE]; //!< Имя.
     char unit[AIN_UNIT_BUF_SIZE]; //!< Единица измерения.
-    q15_t fir_data[AIN_FIR_N]; //!< Данные КИХ-фильтра.
-    fir_t fir; //!< КИХ-фильтр.
-    //decim_t decim; //!< Дециматор.
-    q15_t inst_value; //!< Мгновенное значение.
-    q15_t eff_win_data[AIN_MWIN_EFF_SIZE]; //!< Данные скользящего окна действующего значения.
+    const uint16_t* adc_buffer; //!< Данные канала в буфере ПДП АЦП.
+    size_t adc_stride; //!< Шаг данных канала в буфере ПДП АЦП.
+#if AIN_SOA == 1
+    size_t slot; //!< Индекс в чередующихся массивах.
+#else
+    q15_t fir_data[FIR_DECIM_DATA_SIZE(AIN_FIR_N)]; //!< Данные КИХ-фильтра.
+    fir_decim_t fir; //!< Децимирующий КИХ-фильтр.
+    q15_t eff_win_data[AIN_MWIN_EFF_SIZE_MAX]; //!< Данные скользящего окна действующего значения.
     mwin_t eff_win; //!< Скользящее окно для вычисления действующего значения.
+#endif
+    q15_t inst_value; //!< Мгновенное значение.
+#if AIN_EFF_CALC == AIN_EFF_CALC_LAZY
+    volatile uint32_t eff_cache; //!< Номер окна (старшие 16 бит) и вычисленное по нему действующее значение.
+#else
     q15_t eff_value; //!< Действующее значение.
+#endif
     bool enabled; //!< Разрешение канала.
 } ain_channel_t;
 
+//! Привязка счётчика кадров АЦП к часам.
+typedef struct _Ain_Time_Anchor {
+    time_t sec; //!< Время начала секунды.
+    uint64_t frame; //!< Номер кадра АЦП в начале секунды.
+    uint32_t freq; //!< Частота кадров АЦП, Гц.
+} ain_time_anchor_t;
+
+#if AIN_SOA == 1
+//! Тип данных разрешённых каналов в чередующихся массивах.
+typedef struct _Ain_Soa {
+    size_t active[AIN_CHANNELS_COUNT]; //!< Номера разрешённых каналов.
+    size_t active_count; //!< Число разрешённых каналов.
+    q15_t fir_data[FIR_DECIM_DATA_SIZE(AIN_FIR_N)][AIN_CHANNELS_COUNT]; //!< Линии задержки КИХ-фильтров.
+    size_t fir_index; //!< Индекс записи в линии задержки.
+    q15_t eff_win_data[AIN_MWIN_EFF_SIZE_MAX][AIN_CHANNELS_COUNT]; //!< Окна действующих значений.
+    iq15_t eff_win_sum[AIN_CHANNELS_COUNT]; //!< Суммы окон действующих значений.
+    size_t eff_win_index; //!< Индекс записи в окна действующих значений.
+} ain_soa_t;
+#endif
+
 
 //! Тип аналоговых входов.
 typedef struct _Ain {
@@ -101,10 +256,38 @@ typedef struct _Ain {
     ain_queue_data_t queue_storage[AIN_QUEUE_SIZE]; //!< Данные очереди.
     StaticQueue_t queue_buffer; //!< Буфер очереди.
     QueueHandle_t queue_handle; //!< Идентификатор очереди.
+    uint16_t queue_frames[AIN_QUEUE_FRAMES][AIN_CHANNELS_COUNT]; //!< Буферы отдельных кадров.
+    size_t queue_frame_index; //!< Индекс буфера следующего кадра.
+    // Частоты.
+    const ain_rate_t* rate; //!< Профиль частот дискретизации.
+    size_t eff_win_size; //!< Размер окна действующего значения.
+#if AIN_EFF_RECIP == 1
+    uint32_t eff_win_size_recip; //!< Обратная величина размера окна действующего значения.
+#endif
+    ain_set_adc_freq_callback_t set_adc_freq; //!< Каллбэк установки частоты АЦП.
+#if AIN_STATS == 1
+    // Статистика.
+    ain_stats_t stats; //!< Статистика обработки.
+    uint32_t isr_time; //!< Время прерывания АЦП обрабатываемых данных, мкс.
+#endif
+    // Шкала времени.
+    volatile uint32_t isr_frame; //!< Число кадров АЦП, полученных в прерываниях.
+    uint64_t frame; //!< Номер очередного обрабатываемого кадра АЦП.
+    volatile uint64_t sample_frame; //!< Номер кадра АЦП последнего семпла.
+    ain_time_anchor_t anchors[2]; //!< Привязки к часам.
+    volatile size_t anchor_index; //!< Индекс действующей привязки.
     // Данные.
-    decim_t ch_decim; //!< Дециматор каналов.
+    size_t decim_count; //!< Число кадров АЦП с последнего децимированного значения.
+#if AIN_EFF_CALC == AIN_EFF_CALC_LAZY
+    volatile uint16_t eff_seq; //!< Номер текущего состояния окон действующих значений.
+#elif AIN_EFF_CALC == AIN_EFF_CALC_PERIOD
+    size_t eff_count; //!< Число отсчётов с последнего вычисления действующих значений.
+#endif
     ain_channel_t channels[AIN_CHANNELS_COUNT]; //!< Данные каналов.
-    q15_t* fir_coefs; //!< Коэффициенты КИХ-фильтра.
+#if AIN_SOA == 1
+    ain_soa_t soa; //!< Данные разрешённых каналов.
+#endif
+    const q15_t* fir_coefs; //!< Коэффициенты КИХ-фильтра.
     bool enabled; //!< Разрешение каналов.
 } ain_t;
 
@@ -114,6 +297,203 @@ static ain_t ain;
 
 static void ain_adc_task_proc(void*);
 
+#if AIN_SOA == 1
+/**
+ * Сбрасывает данные канала в чередующихся массивах.
+ * @param slot Индекс канала в массивах.
+ */
+static void ain_soa_reset_slot(size_t slot)
+{
+    ain_soa_t* soa = &ain.soa;
+
+    size_t i;
+    for(i = 0; i < FIR_DECIM_DATA_SIZE(AIN_FIR_N); i ++){
+        soa->fir_data[i][slot] = 0;
+    }
+    for(i = 0; i < AIN_MWIN_EFF_SIZE_MAX; i ++){
+        soa->eff_win_data[i][slot] = 0;
+    }
+    soa->eff_win_sum[slot] = 0;
+}
+
+/**
+ * Составляет список разрешённых каналов.
+ */
+static void ain_soa_update_active(void)
+{
+    ain_soa_t* soa = &ain.soa;
+    ain_channel_t* channel = NULL;
+
+    soa->active_count = 0;
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        channel = &ain.channels[i];
+
+        if(!channel->enabled) continue;
+
+        channel->slot = soa->active_count;
+        soa->active[soa->active_count ++] = i;
+
+        ain_soa_reset_slot(channel->slot);
+    }
+}
+#endif
+
+/**
+ * Ищет профиль частот дискретизации.
+ * @param sample_freq Частота семплирования.
+ * @param power_freq Частота сети.
+ * @return Профиль, либо NULL.
+ */
+static const ain_rate_t* ain_find_rate(uint32_t sample_freq, uint32_t power_freq)
+{
+    size_t i;
+    for(i = 0; i < AIN_RATES_COUNT; i ++){
+        if(ain_rates[i].sample_freq == sample_freq &&
+           ain_rates[i].power_freq == power_freq) return &ain_rates[i];
+    }
+    return NULL;
+}
+
+/**
+ * Применяет профиль частот дискретизации
+ * к фильтрам и окнам каналов.
+ * @param rate Профиль.
+ */
+static void ain_apply_rate(const ain_rate_t* rate)
+{
+    ain.rate = rate;
+    ain.fir_coefs = rate->fir_coefs;
+    ain.eff_win_size = rate->sample_freq / rate->power_freq;
+#if AIN_EFF_RECIP == 1
+    // 2^32 / N с округлением вверх.
+    ain.eff_win_size_recip = (uint32_t)((0x100000000ULL + ain.eff_win_size - 1) / ain.eff_win_size);
+#endif
+
+#if AIN_SOA == 0
+    ain_channel_t* channel = NULL;
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        channel = &ain.channels[i];
+
+        fir_decim_init(&channel->fir, ain.fir_coefs, channel->fir_data, AIN_FIR_N);
+        mwin_init(&channel->eff_win, channel->eff_win_data, ain.eff_win_size);
+    }
+#endif
+}
+
+#if AIN_STATS == 1
+//! Начальное значение контрольной суммы.
+#define AIN_STATS_FNV_BASIS 0x811c9dc5
+//! Множитель контрольной суммы.
+#define AIN_STATS_FNV_PRIME 0x01000193
+
+/**
+ * Получает время таймера высокого разрешения.
+ * @return Время, мкс.
+ */
+static uint32_t ain_stats_time(void)
+{
+    struct timeval tv;
+
+    hires_timer_value(&tv);
+
+    return (uint32_t)tv.tv_sec * 1000000 + (uint32_t)tv.tv_usec;
+}
+
+#if AIN_STATS_CYCLES == 1
+/**
+ * Получает значение счётчика тактов.
+ * @return Число тактов.
+ */
+ALWAYS_INLINE static uint32_t ain_stats_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * Учитывает число тактов этапа обработки.
+ * @param sum Суммарное число тактов.
+ * @param max Максимальное число тактов, либо NULL.
+ * @param cycles Начальное значение счётчика тактов.
+ * @return Конечное значение счётчика тактов.
+ */
+ALWAYS_INLINE static uint32_t ain_stats_put_cycles(uint64_t* sum, uint32_t* max, uint32_t cycles)
+{
+    uint32_t end = ain_stats_cycles();
+    uint32_t dt = end - cycles;
+
+    *sum += dt;
+    if(max && dt > *max) *max = dt;
+
+    return end;
+}
+#endif
+
+/**
+ * Учитывает время обработки в гистограмме.
+ * @param hist Гистограмма.
+ * @param max Максимальное время.
+ * @param time Время, мкс.
+ */
+static void ain_stats_put_time(uint32_t* hist, uint32_t* max, uint32_t time)
+{
+    if(time > *max) *max = time;
+
+    size_t index = 0;
+    while(time != 0 && index < AIN_STATS_HIST_SIZE - 1){
+        time >>= 1;
+        index ++;
+    }
+
+    hist[index] ++;
+}
+
+/**
+ * Добавляет мгновенные значения разрешённых
+ * каналов в контрольную сумму (FNV-1a).
+ */
+static void ain_stats_put_checksum(void)
+{
+    uint32_t checksum = ain.stats.checksum;
+    ain_channel_t* channel = NULL;
+    uint16_t value;
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        channel = &ain.channels[i];
+
+        if(!channel->enabled) continue;
+
+        value = (uint16_t)channel->inst_value;
+
+        checksum = (checksum ^ (value & 0xff)) * AIN_STATS_FNV_PRIME;
+        checksum = (checksum ^ (value >> 8)) * AIN_STATS_FNV_PRIME;
+    }
+
+    ain.stats.checksum = checksum;
+}
+
+/**
+ * Учитывает помещение данных в очередь из прерывания.
+ * @param sent Флаг успешного помещения.
+ * @param frames Число кадров АЦП.
+ */
+static void ain_stats_put_queue_isr(bool sent, size_t frames)
+{
+    if(!sent){
+        ain.stats.dropped_frames += frames;
+        return;
+    }
+
+    uint32_t waiting = (uint32_t)uxQueueMessagesWaitingFromISR(ain.queue_handle);
+
+    if(waiting > ain.stats.queue_max) ain.stats.queue_max = waiting;
+}
+#endif
+
 static err_t ain_init_task(void)
 {
     ain.task_handle = xTaskCreateStatic(ain_adc_task_proc, "ain_task",
@@ -161,15 +541,167 @@ err_t ain_init(void)
     err = ain_init_task();
     if(err != E_NO_ERROR) return err;
 
-    ain.fir_coefs = fir_coefs;
+    ain.decim_count = 0;
 
-    decim_init(&ain.ch_decim, AIN_ADC_DECIM_SCALE);
+#if AIN_STATS == 1
+    ain.stats.queue_size = AIN_QUEUE_SIZE;
+    ain.stats.checksum = AIN_STATS_FNV_BASIS;
+#endif
+
+    ain_apply_rate(ain_find_rate(AIN_SAMPLE_FREQ_DEFAULT, AIN_POWER_FREQ_DEFAULT));
 
     ain_init_channels();
 
     return E_NO_ERROR;
 }
 
+void ain_set_adc_freq_callback(ain_set_adc_freq_callback_t callback)
+{
+    ain.set_adc_freq = callback;
+}
+
+err_t ain_set_rate(uint32_t sample_freq, uint32_t power_freq)
+{
+    const ain_rate_t* rate = ain_find_rate(sample_freq, power_freq);
+
+    if(rate == NULL) return E_INVALID_VALUE;
+
+    if(rate != ain.rate){
+        ain_apply_rate(rate);
+
+        if(ain.set_adc_freq) ain.set_adc_freq(ain_oversample_freq());
+    }
+
+    ain_reset();
+
+    return E_NO_ERROR;
+}
+
+uint32_t ain_sample_freq(void)
+{
+    return ain.rate->sample_freq;
+}
+
+uint32_t ain_power_freq(void)
+{
+    return ain.rate->power_freq;
+}
+
+uint32_t ain_oversample_freq(void)
+{
+    return (uint32_t)ain.rate->sample_freq * ain.rate->oversample_rate;
+}
+
+size_t ain_oversample_rate(void)
+{
+    return ain.rate->oversample_rate;
+}
+
+size_t ain_period_samples(void)
+{
+    return ain.eff_win_size;
+}
+
+uint64_t ain_samples_time_us(uint32_t samples)
+{
+    uint32_t freq = ain.rate->sample_freq;
+
+    return ((uint64_t)samples * 1000000 + freq / 2) / freq;
+}
+
+uint64_t ain_sample_frame(void)
+{
+    uint64_t frame;
+
+    // Чтение 64 бит не атомарно - повторим
+    // при изменении значения во время чтения.
+    do {
+        frame = ain.sample_frame;
+    } while(frame != ain.sample_frame);
+
+    return frame;
+}
+
+void ain_time_anchor_isr(time_t sec, size_t dma_frame, size_t dma_frames)
+{
+    if(dma_frames == 0) return;
+
+    ain_time_anchor_t* prev = &ain.anchors[ain.anchor_index];
+    size_t index = ain.anchor_index ^ 0x1;
+    ain_time_anchor_t* anchor = &ain.anchors[index];
+
+    uint32_t isr_frame = ain.isr_frame;
+
+    // Кадры, записанные ПДП после последнего прерывания.
+    size_t frames = (dma_frame + dma_frames - isr_frame % dma_frames) % dma_frames;
+
+    uint32_t frame = isr_frame + (uint32_t)frames;
+
+    anchor->sec = sec;
+    anchor->frame = prev->frame + (uint32_t)(frame - (uint32_t)prev->frame);
+    anchor->freq = ain_oversample_freq();
+
+    ain.anchor_index = index;
+}
+
+/**
+ * Получает действующую привязку к часам.
+ * До первой привязки время отсчитывается
+ * от текущего времени и последнего семпла.
+ * @param anchor Привязка.
+ */
+static void ain_time_anchor(ain_time_anchor_t* anchor)
+{
+    size_t index;
+
+    do {
+        index = ain.anchor_index;
+        memcpy(anchor, &ain.anchors[index], sizeof(ain_time_anchor_t));
+    } while(index != ain.anchor_index);
+
+    if(anchor->freq != 0) return;
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    anchor->freq = ain_oversample_freq();
+    anchor->sec = tv.tv_sec;
+    anchor->frame = ain_sample_frame() - ((uint64_t)tv.tv_usec * anchor->freq) / 1000000;
+}
+
+uint64_t ain_frame_time_us(uint64_t frame)
+{
+    ain_time_anchor_t anchor;
+
+    ain_time_anchor(&anchor);
+
+    int64_t freq = (int64_t)anchor.freq;
+    int64_t usec = (int64_t)(frame - anchor.frame) * 1000000 + freq / 2;
+    int64_t offset = usec / freq;
+
+    // Округление половин вверх и для кадров до привязки,
+    // чтобы время кадра не зависело от действующей привязки.
+    if(usec < 0 && (usec % freq) != 0) offset --;
+
+    return (uint64_t)anchor.sec * 1000000 + (uint64_t)offset;
+}
+
+void ain_frame_time(uint64_t frame, struct timeval* tv)
+{
+    uint64_t usec = ain_frame_time_us(frame);
+
+    tv->tv_sec = (time_t)(usec / 1000000);
+    tv->tv_usec = (suseconds_t)(usec % 1000000);
+}
+
+void ain_samples_time(uint32_t samples, struct timeval* tv)
+{
+    uint64_t usec = ain_samples_time_us(samples);
+
+    tv->tv_sec = (time_t)(usec / 1000000);
+    tv->tv_usec = (suseconds_t)(usec % 1000000);
+}
+
 void ain_set_enabled(bool enabled)
 {
 	ain.enabled = enabled;
@@ -182,7 +714,14 @@ bool ain_enabled(void)
 
 void ain_reset(void)
 {
-	decim_reset(&ain.ch_decim);
+	ain.decim_count = 0;
+#if AIN_EFF_CALC == AIN_EFF_CALC_PERIOD
+	ain.eff_count = 0;
+#endif
+#if AIN_SOA == 1
+	ain.soa.fir_index = 0;
+	ain.soa.eff_win_index = 0;
+#endif
 	ain_reset_channels();
 }
 
@@ -199,9 +738,12 @@ err_t ain_init_channel(size_t n, ain_channel_type_t type, ain_channel_eff_type_t
     channel->adc_gain = inst_gain;
     channel->eff_gain = eff_gain;
 
-    fir_init(&channel->fir, ain.fir_coefs, channel->fir_data, AIN_FIR_N);
-    //decim_init(&channel->decim, AIN_ADC_DECIM_SCALE);
-    mwin_init(&channel->eff_win, channel->eff_win_data, AIN_MWIN_EFF_SIZE);
+#if AIN_SOA == 1
+    if(channel->enabled) ain_soa_reset_slot(channel->slot);
+#else
+    fir_decim_init(&channel->fir, ain.fir_coefs, channel->fir_data, AIN_FIR_N);
+    mwin_init(&channel->eff_win, channel->eff_win_data, ain.eff_win_size);
+#endif
 
     channel->inst_value = 0;
 
@@ -293,11 +835,16 @@ const char* ain_channel_unit(size_t n)
 err_t ain_channel_set_enabled(size_t n, bool enabled)
 {
 	if(n >= AIN_CHANNELS_COUNT) return E_OUT_OF_RANGE;
+	if(ain.enabled) return E_STATE;
 
 	ain_channel_t* channel = &ain.channels[n];
 
 	channel->enabled = enabled;
 
+#if AIN_SOA == 1
+	ain_soa_update_active();
+#endif
+
     return E_NO_ERROR;
 }
 
@@ -316,16 +863,30 @@ err_t ain_channel_reset(size_t n)
 
 	ain_channel_t* channel = &ain.channels[n];
 
-	fir_reset(&channel->fir);
+#if AIN_SOA == 1
+	if(channel->enabled) ain_soa_reset_slot(channel->slot);
+#else
+	fir_decim_reset(&channel->fir);
 	mwin_reset(&channel->eff_win);
+#endif
 
 	channel->inst_value = 0;
+#if AIN_EFF_CALC == AIN_EFF_CALC_LAZY
+	// Сделаем кэшированное значение недействительным.
+	channel->eff_cache = (uint32_t)(uint16_t)(ain.eff_seq - 1) << 16;
+#else
 	channel->eff_value = 0;
+#endif
 
 	return E_NO_ERROR;
 }
 
-static void ain_channel_calc_eff(ain_channel_t* channel)
+/**
+ * Получает значение для окна действующего значения.
+ * @param channel Канал.
+ * @return Значение.
+ */
+ALWAYS_INLINE static q15_t ain_channel_eff_win_value(ain_channel_t* channel)
 {
     // Мгновенное значение.
     q15_t value = channel->inst_value;
@@ -336,14 +897,66 @@ static void ain_channel_calc_eff(ain_channel_t* channel)
     // Иначе вычислим модуль для синусоидального значения.
     if(channel->type == AIN_AC) value = q15_abs(value);
 
-    // Добавим значение в окно.
-    mwin_put(&channel->eff_win, value);
+    return value;
+}
+
+/**
+ * Получает сумму окна действующего значения канала.
+ * @param channel Канал.
+ * @return Сумма значений окна.
+ */
+ALWAYS_INLINE static iq15_t ain_channel_eff_sum(ain_channel_t* channel)
+{
+    if(!channel->enabled) return 0;
+
+#if AIN_SOA == 1
+    return ain.soa.eff_win_sum[channel->slot];
+#else
+    return mwin_sum(&channel->eff_win);
+#endif
+}
 
-    // Сумма значений окна.
-    iq15_t sum = mwin_sum(&channel->eff_win);
-    size_t count = mwin_size(&channel->eff_win);
+#if AIN_EFF_RECIP == 1
+/**
+ * Делит сумму окна на его размер
+ * с округлением к нулю.
+ * Умножение на 2^32 / N с округлением вверх
+ * для сумм окна по модулю не более N * 2^15
+ * совпадает с делением.
+ * @param sum Сумма значений окна.
+ * @return Среднее значение.
+ */
+ALWAYS_INLINE static iq15_t ain_eff_norm(iq15_t sum)
+{
+    uint32_t recip = ain.eff_win_size_recip;
+
+    if(sum < 0){
+        return -(iq15_t)(((uint64_t)(uint32_t)(-sum) * recip) >> 32);
+    }
+    return (iq15_t)(((uint64_t)(uint32_t)sum * recip) >> 32);
+}
+#else
+/**
+ * Делит сумму окна на его размер
+ * с округлением к нулю.
+ * @param sum Сумма значений окна.
+ * @return Среднее значение.
+ */
+ALWAYS_INLINE static iq15_t ain_eff_norm(iq15_t sum)
+{
+    return iq15_idiv(sum, (int32_t)ain.eff_win_size);
+}
+#endif
 
-    q15_t eff_value = iq15_sat(iq15_idiv(sum, (int32_t)count));
+/**
+ * Вычисляет действующее значение по сумме окна.
+ * @param channel Канал.
+ * @param sum Сумма значений окна.
+ * @return Действующее значение.
+ */
+static q15_t ain_channel_calc_eff_value(ain_channel_t* channel, iq15_t sum)
+{
+    q15_t eff_value = iq15_sat(ain_eff_norm(sum));
 
     // Для среднеквадратичного вычислим квадратный корень.
     if(channel->eff_type == AIN_RMS){
@@ -368,8 +981,43 @@ static void ain_channel_calc_eff(ain_channel_t* channel)
     // Умножим на коэффициент.
     eff_value = iq15_sat(iq15_mul(eff_value, channel->eff_gain));
 
-    // Сохраним действующее значение.
-    channel->eff_value = eff_value;
+    return eff_value;
+}
+
+/**
+ * Обновляет действующие значения каналов
+ * после сдвига окон действующих значений.
+ */
+static void ain_update_eff_values(void)
+{
+#if AIN_EFF_CALC == AIN_EFF_CALC_LAZY
+    // Значения вычисляются при чтении.
+    ain.eff_seq ++;
+#else
+#if AIN_EFF_CALC == AIN_EFF_CALC_PERIOD
+    // Раз в период сети.
+    if(++ ain.eff_count < ain.eff_win_size) return;
+    ain.eff_count = 0;
+#endif
+
+    ain_channel_t* channel = NULL;
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        channel = &ain.channels[i];
+
+        if(!channel->enabled) continue;
+
+        channel->eff_value = ain_channel_calc_eff_value(channel, ain_channel_eff_sum(channel));
+    }
+#endif
+}
+
+#if AIN_SOA == 0
+static void ain_channel_calc_eff(ain_channel_t* channel)
+{
+    // Добавим значение в окно.
+    mwin_put(&channel->eff_win, ain_channel_eff_win_value(channel));
 }
 
 /**
@@ -387,28 +1035,24 @@ static void ain_process_channel_inst_data(size_t n)
     q15_t sample = 0;
 
     // Получим отфильтрованные данные.
-    sample = fir_calc(&channel->fir);
-    //sample = decim_data(&channel->decim);
+    sample = fir_decim_calc(&channel->fir);
 
     // Сохраним мгновенное значение.
     channel->inst_value = sample;
 
-    // Вычислим среднедействующее значение.
+    // Обновим окно действующего значения.
     ain_channel_calc_eff(channel);
 }
+#endif
 
 /**
- * Обрабатывает даныне АЦП канала.
- * @param n Номер канала.
- * @param adc_data Данные АЦП.
+ * Преобразует значение АЦП канала в формат Q15.
+ * @param channel Канал.
+ * @param adc_data Значение АЦП.
+ * @return Значение.
  */
-static void ain_process_channel_adc_data(size_t n, uint16_t adc_data)
+ALWAYS_INLINE static q15_t ain_channel_adc_to_q15(ain_channel_t* channel, uint16_t adc_data)
 {
-    ain_channel_t* channel = &ain.channels[n];
-
-    // Если канал запрещён - ничего не делаем.
-    if(!channel->enabled) return;
-
     // Значение выборки АЦП.
     q15_t sample = 0;
 
@@ -429,87 +1073,517 @@ static void ain_process_channel_adc_data(size_t n, uint16_t adc_data)
     // Умножим на мгновенный кэффициент пропорциональности.
     sample = q15_mul(sample, channel->adc_gain);
 
-    // Поместим в фильтр.
-    fir_put(&channel->fir, sample);
-    // Децимируем.
-    //decim_put(&channel->decim, sample);
+    return sample;
 }
 
+#if AIN_SOA == 0
 /**
- * Обрабатывает данные АЦП каналов.
+ * Обрабатывает даныне АЦП канала.
+ * Число значений не должно превышать
+ * коэффициент децимации.
+ * @param n Номер канала.
  * @param adc_data Данные АЦП.
+ * @param stride Шаг между значениями.
+ * @param count Число значений.
  */
-static void ain_process_adc_data(uint16_t* adc_data)
+static void ain_process_channel_adc_data(size_t n, const uint16_t* adc_data, size_t stride, size_t count)
 {
-    /*struct timeval tv_prev, tv_cur;
-    uint32_t usec = 0;
+    ain_channel_t* channel = &ain.channels[n];
 
-    hires_timer_value(&tv_prev);*/
+    // Если канал запрещён - ничего не делаем.
+    if(!channel->enabled) return;
 
-    if(!ain.enabled) return;
+    q15_t samples[AIN_OVERSAMPLE_RATE_MAX];
+
+    size_t i;
+    for(i = 0; i < count; i ++){
+        samples[i] = ain_channel_adc_to_q15(channel, *adc_data);
+        adc_data += stride;
+    }
+
+    // Поместим в фильтр.
+    fir_decim_put(&channel->fir, samples, count);
+}
+#else
+/**
+ * Помещает кадры данных АЦП разрешённых каналов
+ * в линии задержки КИХ-фильтров.
+ * Число кадров не должно превышать
+ * коэффициент децимации.
+ * @param adc_data Указатели на первые значения каналов.
+ * @param stride Шаги между значениями каналов.
+ * @param count Число кадров.
+ */
+static void ain_soa_put_adc_data(const uint16_t** adc_data, const size_t* stride, size_t count)
+{
+    ain_soa_t* soa = &ain.soa;
+    ain_channel_t* channel = NULL;
+    const uint16_t* data = NULL;
+    size_t active_count = soa->active_count;
+    size_t index = soa->fir_index;
+    size_t frame, k, n;
+    q15_t sample;
+
+    for(frame = 0; frame < count; frame ++){
+        q15_t* line = soa->fir_data[index];
+        q15_t* line_copy = soa->fir_data[index + AIN_FIR_N];
+
+        for(k = 0; k < active_count; k ++){
+            n = soa->active[k];
+            data = adc_data[n];
+
+            if(data == NULL) continue;
+
+            channel = &ain.channels[n];
 
+            sample = ain_channel_adc_to_q15(channel, data[frame * stride[n]]);
+
+            line[k] = sample;
+            line_copy[k] = sample;
+        }
+
+        if(++ index >= AIN_FIR_N) index = 0;
+    }
+
+    soa->fir_index = index;
+}
+
+/**
+ * Вычисляет очередные мгновенные и действующие
+ * значения разрешённых каналов.
+ */
+static void ain_soa_calc_inst_data(void)
+{
+    ain_soa_t* soa = &ain.soa;
+    ain_channel_t* channel = NULL;
+    size_t active_count = soa->active_count;
+    const q15_t* coefs = ain.fir_coefs;
+    // Окно от самого старого отсчёта к самому новому.
+    q15_t (*x)[AIN_CHANNELS_COUNT] = &soa->fir_data[soa->fir_index];
+    int32_t acc[AIN_CHANNELS_COUNT];
+    size_t k, i;
+    int32_t c;
+
+    for(k = 0; k < active_count; k ++){
+        acc[k] = 0;
+    }
+
+    // Симметричные пары отсчётов
+    // умножаются на общий коэффициент.
+    for(i = 0; i < AIN_FIR_N / 2; i ++){
+        const q15_t* a = x[i];
+        const q15_t* b = x[AIN_FIR_N - 1 - i];
+
+        c = coefs[i];
+
+        for(k = 0; k < active_count; k ++){
+            acc[k] += c * ((int32_t)a[k] + (int32_t)b[k]);
+        }
+    }
+    // Средний коэффициент фильтра нечётного порядка.
+    if(AIN_FIR_N & 0x1){
+        const q15_t* a = x[AIN_FIR_N / 2];
+
+        c = coefs[AIN_FIR_N / 2];
+
+        for(k = 0; k < active_count; k ++){
+            acc[k] += c * a[k];
+        }
+    }
+
+    q15_t* win = soa->eff_win_data[soa->eff_win_index];
+    q15_t value;
+
+    for(k = 0; k < active_count; k ++){
+        channel = &ain.channels[soa->active[k]];
+
+        // Сохраним мгновенное значение.
+        channel->inst_value = iq15_sat(acc[k] >> Q15_FRACT_BITS);
+
+        // Обновим окно действующего значения.
+        value = ain_channel_eff_win_value(channel);
+
+        soa->eff_win_sum[k] += (iq15_t)value - (iq15_t)win[k];
+        win[k] = value;
+    }
+
+    if(++ soa->eff_win_index >= ain.eff_win_size) soa->eff_win_index = 0;
+}
+#endif
+
+/**
+ * Вычисляет и записывает очередные значения каналов.
+ */
+static void ain_process_inst_data(void)
+{
+#if AIN_STATS == 1
+    uint32_t time = ain_stats_time();
+#endif
+#if AIN_STATS_CYCLES == 1
+    uint32_t cycles = ain_stats_cycles();
+#endif
+
+#if AIN_SOA == 1
+    // Вычислим значения каналов.
+    ain_soa_calc_inst_data();
+#else
     size_t i;
 
+    // Вычислим значения каналов.
     for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
-        ain_process_channel_adc_data(i, adc_data[i]);
+        ain_process_channel_inst_data(i);
     }
+#endif
+
+    // Обновим действующие значения.
+    ain_update_eff_values();
+
+#if AIN_STATS_CYCLES == 1
+    ain_stats_put_cycles(&ain.stats.calc_cycles, &ain.stats.calc_cycles_max, cycles);
+#endif
+
+#if AIN_STATS == 1
+    ain_stats_put_checksum();
+
+    uint32_t oscs_time = ain_stats_time();
+
+    uint32_t latency = oscs_time - ain.isr_time;
+    if(latency > ain.stats.latency_max) ain.stats.latency_max = latency;
+
+    ain.stats.calc_time += oscs_time - time;
+#endif
+#if AIN_STATS_CYCLES == 1
+    cycles = ain_stats_cycles();
+#endif
+
+    // Записать осциллограмму.
+    oscs_append();
+
+#if AIN_STATS_CYCLES == 1
+    cycles = ain_stats_put_cycles(&ain.stats.oscs_cycles, NULL, cycles);
+#endif
+#if AIN_STATS == 1
+    uint32_t trends_time = ain_stats_time();
 
-    // Децимируем значения каналов.
-    decim_put(&ain.ch_decim, 0);
+    ain.stats.oscs_time += trends_time - oscs_time;
+#endif
+#if AIN_STATS_CYCLES == 1
+    cycles = ain_stats_cycles();
+#endif
+
+    // Записать тренды.
+    trends_append();
+
+#if AIN_STATS_CYCLES == 1
+    ain_stats_put_cycles(&ain.stats.trends_cycles, NULL, cycles);
+#endif
+#if AIN_STATS == 1
+    uint32_t end_time = ain_stats_time();
+
+    ain.stats.trends_time += end_time - trends_time;
+
+    ain.stats.samples ++;
+    ain_stats_put_time(ain.stats.sample_time_hist, &ain.stats.sample_time_max, end_time - time);
+#endif
+}
+
+/**
+ * Обрабатывает кадры данных АЦП каналов.
+ * Фильтр вычисляется только для
+ * сохраняемых после децимации значений.
+ * @param adc_data Указатели на первые значения каналов, изменяются.
+ * @param stride Шаги между значениями каналов.
+ * @param count Число кадров.
+ */
+static void ain_process_adc_frames(const uint16_t** adc_data, const size_t* stride, size_t count)
+{
+    size_t decim_scale = ain.rate->oversample_rate;
+    size_t n, i;
+
+    while(count > 0){
+        // Число кадров до очередного значения.
+        n = decim_scale - ain.decim_count;
+        if(n > count) n = count;
+
+#if AIN_STATS_CYCLES == 1
+        uint32_t cycles = ain_stats_cycles();
+#endif
+
+#if AIN_SOA == 1
+        ain_soa_put_adc_data(adc_data, stride, n);
+#endif
 
-    // Если пропустили достаточно данных.
-    if(decim_ready(&ain.ch_decim)){
-        // Вычислим значения каналов.
         for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
-            ain_process_channel_inst_data(i);
+            if(adc_data[i] == NULL) continue;
+
+#if AIN_SOA == 0
+            ain_process_channel_adc_data(i, adc_data[i], stride[i], n);
+#endif
+
+            adc_data[i] += n * stride[i];
         }
 
-        // Записать осциллограмму.
-        oscs_append();
-        // Записать тренды.
-        trends_append();
+#if AIN_STATS_CYCLES == 1
+        ain_stats_put_cycles(&ain.stats.put_cycles, &ain.stats.put_cycles_max, cycles);
+#endif
+
+        count -= n;
+        ain.decim_count += n;
+        ain.frame += n;
+
+        // Если пропустили достаточно данных.
+        if(ain.decim_count >= decim_scale){
+            ain.decim_count = 0;
+            ain.sample_frame = ain.frame - 1;
+
+            ain_process_inst_data();
+        }
     }
+}
 
-    /*hires_timer_value(&tv_cur);
+/**
+ * Обрабатывает данные АЦП каналов.
+ * @param adc_data Данные АЦП.
+ */
+static void ain_process_adc_data(uint16_t* adc_data)
+{
+    if(!ain.enabled) return;
 
-    timersub(&tv_cur, &tv_prev, &tv_cur);
+    const uint16_t* data[AIN_CHANNELS_COUNT];
+    size_t stride[AIN_CHANNELS_COUNT];
 
-    usec = tv_cur.tv_usec;
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        data[i] = &adc_data[i];
+        stride[i] = 1;
+    }
+
+    ain_process_adc_frames(data, stride, 1);
+}
 
-    *adc_data = usec;
+/**
+ * Обрабатывает блок данных АЦП из буфера ПДП.
+ * @param block Номер блока.
+ */
+static void ain_process_adc_block(size_t block)
+{
+    if(!ain.enabled) return;
+
+    const uint16_t* data[AIN_CHANNELS_COUNT];
+    size_t stride[AIN_CHANNELS_COUNT];
+    ain_channel_t* channel = NULL;
+
+    size_t frame = block * AIN_ADC_BLOCK_FRAMES;
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        channel = &ain.channels[i];
 
-    __NOP();*/
+        stride[i] = channel->adc_stride;
+
+        if(channel->adc_buffer){
+            data[i] = &channel->adc_buffer[frame * channel->adc_stride];
+        }else{
+            data[i] = NULL;
+        }
+    }
+
+    ain_process_adc_frames(data, stride, AIN_ADC_BLOCK_FRAMES);
 }
 
+#if AIN_STATS == 1
+/**
+ * Учитывает время обработки кадров АЦП.
+ * @param frames Число кадров.
+ * @param time Время начала обработки, мкс.
+ */
+static void ain_stats_put_frames(size_t frames, uint32_t time)
+{
+    uint32_t dt = ain_stats_time() - time;
+
+    ain.stats.frames += frames;
+    ain.stats.frames_time += dt;
+
+    ain_stats_put_time(ain.stats.frame_time_hist, &ain.stats.frame_time_max, dt / frames);
+}
+#endif
+
 static void ain_adc_task_proc(void* arg)
 {
     (void) arg;
 
     static ain_queue_data_t queue_data;
 
+#if AIN_STATS == 1
+    uint32_t time;
+#endif
+
     for(;;){
         if(xQueueReceive(ain.queue_handle, &queue_data, portMAX_DELAY) == pdTRUE){
+#if AIN_STATS == 1
+            ain.isr_time = queue_data.time;
+            time = ain_stats_time();
+#endif
+            // Номер первого кадра с учётом пропущенных данных.
+            ain.frame += (uint32_t)(queue_data.frame - (uint32_t)ain.frame);
+
             // Process ADC data.
-            ain_process_adc_data(queue_data.adc_data);
+            if(queue_data.type == AIN_QUEUE_FRAME){
+                ain_process_adc_data(ain.queue_frames[queue_data.index]);
+            }else{
+                ain_process_adc_block(queue_data.index);
+            }
+#if AIN_STATS == 1
+            if(ain.enabled){
+                ain_stats_put_frames((queue_data.type == AIN_QUEUE_FRAME) ? 1 : AIN_ADC_BLOCK_FRAMES, time);
+            }
+#endif
         }
     }
 }
 
 err_t ain_process_adc_data_isr(uint16_t* adc_data, BaseType_t* pxHigherPriorityTaskWoken)
 {
+    uint32_t frame = ain.isr_frame;
+    ain.isr_frame = frame + 1;
+
 	if(!ain.enabled) return E_NO_ERROR;
 
     ain_queue_data_t queue_data;
+    bool sent = false;
+
+    // Буфер кадра занимается, только если
+    // команда поместится в очередь.
+    if(xQueueIsQueueFullFromISR(ain.queue_handle) == pdFALSE){
+        size_t index = ain.queue_frame_index;
+
+        memcpy(ain.queue_frames[index], adc_data, sizeof(uint16_t) * AIN_CHANNELS_COUNT);
 
-    memcpy(queue_data.adc_data, adc_data, sizeof(uint16_t) * AIN_CHANNELS_COUNT);
+        queue_data.type = AIN_QUEUE_FRAME;
+        queue_data.index = (uint8_t)index;
+        queue_data.frame = frame;
+#if AIN_STATS == 1
+        queue_data.time = ain_stats_time();
+#endif
 
-    if(xQueueSendToBackFromISR(ain.queue_handle, &queue_data, pxHigherPriorityTaskWoken) != pdTRUE){
-        return E_OUT_OF_MEMORY;
+        sent = xQueueSendToBackFromISR(ain.queue_handle, &queue_data, pxHigherPriorityTaskWoken) == pdTRUE;
+
+        if(sent){
+            if(++ index >= AIN_QUEUE_FRAMES) index = 0;
+            ain.queue_frame_index = index;
+        }
     }
 
+#if AIN_STATS == 1
+    ain_stats_put_queue_isr(sent, 1);
+#endif
+
+    if(!sent) return E_OUT_OF_MEMORY;
+
     return E_NO_ERROR;
 }
 
+err_t ain_replay_adc_data(const uint16_t* adc_data, size_t count)
+{
+    if(adc_data == NULL) return E_NULL_POINTER;
+    if(!ain.enabled) return E_STATE;
+    if(count == 0) return E_NO_ERROR;
+
+    const uint16_t* data[AIN_CHANNELS_COUNT];
+    size_t stride[AIN_CHANNELS_COUNT];
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        data[i] = &adc_data[i];
+        stride[i] = AIN_CHANNELS_COUNT;
+    }
+
+#if AIN_STATS == 1
+    uint32_t time = ain_stats_time();
+    ain.isr_time = time;
+#endif
+
+    ain_process_adc_frames(data, stride, count);
+
+#if AIN_STATS == 1
+    ain_stats_put_frames(count, time);
+#endif
+
+    return E_NO_ERROR;
+}
+
+err_t ain_channel_set_adc_buffer(size_t n, const uint16_t* data, size_t stride)
+{
+    if(n >= AIN_CHANNELS_COUNT) return E_OUT_OF_RANGE;
+    if(data == NULL) return E_NULL_POINTER;
+    if(stride == 0) return E_INVALID_VALUE;
+
+    ain_channel_t* channel = &ain.channels[n];
+
+    channel->adc_buffer = data;
+    channel->adc_stride = stride;
+
+    return E_NO_ERROR;
+}
+
+err_t ain_process_adc_block_isr(size_t block, BaseType_t* pxHigherPriorityTaskWoken)
+{
+    if(block >= AIN_ADC_BLOCKS) return E_OUT_OF_RANGE;
+
+    uint32_t frame = ain.isr_frame;
+    ain.isr_frame = frame + AIN_ADC_BLOCK_FRAMES;
+
+    if(!ain.enabled) return E_NO_ERROR;
+
+    ain_queue_data_t queue_data;
+
+    queue_data.type = AIN_QUEUE_BLOCK;
+    queue_data.index = (uint8_t)block;
+    queue_data.frame = frame;
+#if AIN_STATS == 1
+    queue_data.time = ain_stats_time();
+#endif
+
+    bool sent = xQueueSendToBackFromISR(ain.queue_handle, &queue_data, pxHigherPriorityTaskWoken) == pdTRUE;
+
+#if AIN_STATS == 1
+    ain_stats_put_queue_isr(sent, AIN_ADC_BLOCK_FRAMES);
+#endif
+
+    if(!sent) return E_OUT_OF_MEMORY;
+
+    return E_NO_ERROR;
+}
+
+void ain_stats(ain_stats_t* stats)
+{
+    if(stats == NULL) return;
+
+#if AIN_STATS == 1
+    taskENTER_CRITICAL();
+    memcpy(stats, &ain.stats, sizeof(ain_stats_t));
+    taskEXIT_CRITICAL();
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        if(ain.channels[i].enabled) stats->active_channels ++;
+    }
+#else
+    memset(stats, 0x0, sizeof(ain_stats_t));
+#endif
+}
+
+void ain_stats_reset(void)
+{
+#if AIN_STATS == 1
+    taskENTER_CRITICAL();
+    memset(&ain.stats, 0x0, sizeof(ain_stats_t));
+    ain.stats.queue_size = AIN_QUEUE_SIZE;
+    ain.stats.checksum = AIN_STATS_FNV_BASIS;
+    taskEXIT_CRITICAL();
+#endif
+}
+
 q15_t ain_value_inst(size_t n)
 {
     if(n >= AIN_CHANNELS_COUNT) return 0;
@@ -519,13 +1593,47 @@ q15_t ain_value_inst(size_t n)
     return channel->inst_value;
 }
 
+const q15_t* ain_value_inst_ptr(size_t n)
+{
+    if(n >= AIN_CHANNELS_COUNT) return NULL;
+
+    ain_channel_t* channel = &ain.channels[n];
+
+    return &channel->inst_value;
+}
+
 q15_t ain_value(size_t n)
 {
     if(n >= AIN_CHANNELS_COUNT) return 0;
 
     ain_channel_t* channel = &ain.channels[n];
 
+#if AIN_EFF_CALC == AIN_EFF_CALC_LAZY
+    uint16_t seq = ain.eff_seq;
+    uint32_t cache = channel->eff_cache;
+
+    // Окно не сдвигалось с последнего вычисления.
+    if((uint16_t)(cache >> 16) == seq) return (q15_t)(cache & 0xffff);
+
+    // Номер и сумма окна читаются вместе, иначе
+    // сумма старого окна попадёт в кэш под новым номером.
+    taskENTER_CRITICAL();
+    seq = ain.eff_seq;
+    iq15_t eff_sum = ain_channel_eff_sum(channel);
+    taskEXIT_CRITICAL();
+
+    q15_t eff_value = ain_channel_calc_eff_value(channel, eff_sum);
+
+    // Значение и номер окна записываются одной операцией,
+    // поэтому чтение из разных задач не требует блокировки.
+    // Запись устаревшего значения другой задачей
+    // лишь приведёт к повторному вычислению.
+    channel->eff_cache = ((uint32_t)seq << 16) | (uint16_t)eff_value;
+
+    return eff_value;
+#else
     return channel->eff_value;
+#endif
 }
 
 iq15_t ain_q15_to_real(size_t n, q15_t value)
@@ -10,32 +10,38 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <sys/time.h>
 #include "q15/q15.h"
 
 
 //! Число аналоговых входов.
+#ifndef AIN_CHANNELS_COUNT
 #define AIN_CHANNELS_COUNT 5
+#endif
 
-//! Частота оверсемплинга.
-#define AIN_OVERSAMPLE_FREQ 12800
+//! Частота семплирования по-умолчанию.
+#define AIN_SAMPLE_FREQ_DEFAULT 1600
 
-//! Частота семплирования.
-#define AIN_SAMPLE_FREQ 1600
+//! Частота сети по-умолчанию.
+#define AIN_POWER_FREQ_DEFAULT 50
 
-//! Период семплирования в мкс.
-#define AIN_SAMPLE_PERIOD_US (1000000 / (AIN_SAMPLE_FREQ))
+//! Максимальная частота семплирования.
+#define AIN_SAMPLE_FREQ_MAX 7680
 
-//! Кратность оверсемплинга.
-#define AIN_OVERSAMPLE_RATE ((AIN_OVERSAMPLE_FREQ) / (AIN_SAMPLE_FREQ))
+//! Максимальная кратность оверсемплинга.
+#define AIN_OVERSAMPLE_RATE_MAX 8
 
-//! Частота сети.
-#define AIN_POWER_FREQ 50
+//! Максимальное число точек за период.
+#define AIN_PERIOD_SAMPLES_MAX 128
 
-//! Число точек за период.
-#define AIN_PERIOD_SAMPLES ((AIN_SAMPLE_FREQ) / (AIN_POWER_FREQ))
+//! Число блоков в буфере ПДП АЦП.
+#define AIN_ADC_BLOCKS 2
 
-//! Число точек вычисления действующих значений.
-#define AIN_EFF_SAMPLES AIN_PERIOD_SAMPLES
+//! Число кадров АЦП в блоке.
+#define AIN_ADC_BLOCK_FRAMES 8
+
+//! Число интервалов гистограмм времени обработки.
+#define AIN_STATS_HIST_SIZE 16
 
 //! Максимальная длина имени канала.
 #define AIN_NAME_LEN 16
@@ -67,6 +73,39 @@ typedef enum _Ain_Channel_Eff_Type {
     AIN_RMS = 1 //!< RMS.
 } ain_channel_eff_type_t;
 
+/**
+ * Статистика обработки данных АЦП.
+ * Интервал гистограммы 0 содержит времена менее 1 мкс,
+ * интервал i - времена [2^(i-1), 2^i) мкс,
+ * последний интервал - все большие времена.
+ * Число тактов подсчитывается только при сборке
+ * с AIN_STATS_CYCLES = 1, иначе оно нулевое.
+ */
+typedef struct _Ain_Stats {
+    uint32_t frames; //!< Число обработанных кадров АЦП.
+    uint32_t samples; //!< Число вычисленных после децимации значений.
+    uint32_t dropped_frames; //!< Число потерянных при переполнении очереди кадров АЦП.
+    uint32_t queue_size; //!< Размер очереди.
+    uint32_t queue_max; //!< Максимальное заполнение очереди.
+    uint32_t frame_time_max; //!< Максимальное время обработки кадра, мкс.
+    uint32_t sample_time_max; //!< Максимальное время обработки значения, мкс.
+    uint32_t latency_max; //!< Максимальная задержка от прерывания АЦП до записи осциллограмм, мкс.
+    uint64_t frames_time; //!< Суммарное время обработки кадров, мкс.
+    uint64_t calc_time; //!< Суммарное время вычисления значений каналов, мкс.
+    uint64_t oscs_time; //!< Суммарное время записи осциллограмм, мкс.
+    uint64_t trends_time; //!< Суммарное время записи трендов, мкс.
+    uint32_t checksum; //!< Контрольная сумма мгновенных значений разрешённых каналов.
+    uint64_t put_cycles; //!< Суммарное число тактов помещения кадров в КИХ-фильтры.
+    uint64_t calc_cycles; //!< Суммарное число тактов вычисления значений каналов.
+    uint64_t oscs_cycles; //!< Суммарное число тактов записи осциллограмм.
+    uint64_t trends_cycles; //!< Суммарное число тактов записи трендов.
+    uint32_t put_cycles_max; //!< Максимальное число тактов помещения кадров в КИХ-фильтры.
+    uint32_t calc_cycles_max; //!< Максимальное число тактов вычисления значений каналов.
+    uint32_t active_channels; //!< Число разрешённых каналов.
+    uint32_t frame_time_hist[AIN_STATS_HIST_SIZE]; //!< Гистограмма времени обработки кадра.
+    uint32_t sample_time_hist[AIN_STATS_HIST_SIZE]; //!< Гистограмма времени обработки значения.
+} ain_stats_t;
+
 
 /**
  * Инициализирует аналоговые входа.
@@ -91,6 +130,106 @@ extern bool ain_enabled(void);
  */
 extern void ain_reset(void);
 
+/**
+ * Каллбэк установки частоты оверсемплинга АЦП.
+ * @param freq Частота, Гц.
+ */
+typedef void (*ain_set_adc_freq_callback_t)(uint32_t freq);
+
+/**
+ * Устанавливает каллбэк установки частоты оверсемплинга АЦП.
+ * @param callback Каллбэк.
+ */
+extern void ain_set_adc_freq_callback(ain_set_adc_freq_callback_t callback);
+
+/**
+ * Устанавливает частоты дискретизации.
+ * Допустимы только сочетания из таблицы
+ * профилей частот аналоговых входов.
+ * Сбрасывает аналоговые входа.
+ * @param sample_freq Частота семплирования, Гц.
+ * @param power_freq Частота сети, Гц.
+ * @return Код ошибки.
+ */
+extern err_t ain_set_rate(uint32_t sample_freq, uint32_t power_freq);
+
+/**
+ * Получает частоту семплирования.
+ * @return Частота семплирования, Гц.
+ */
+extern uint32_t ain_sample_freq(void);
+
+/**
+ * Получает частоту сети.
+ * @return Частота сети, Гц.
+ */
+extern uint32_t ain_power_freq(void);
+
+/**
+ * Получает частоту оверсемплинга.
+ * @return Частота оверсемплинга, Гц.
+ */
+extern uint32_t ain_oversample_freq(void);
+
+/**
+ * Получает кратность оверсемплинга.
+ * @return Кратность оверсемплинга.
+ */
+extern size_t ain_oversample_rate(void);
+
+/**
+ * Получает число точек за период сети.
+ * @return Число точек за период.
+ */
+extern size_t ain_period_samples(void);
+
+/**
+ * Получает время заданного числа семплов
+ * с округлением до микросекунды.
+ * @param samples Число семплов.
+ * @param tv Время.
+ */
+extern void ain_samples_time(uint32_t samples, struct timeval* tv);
+
+/**
+ * Получает время заданного числа семплов в мкс
+ * с округлением до микросекунды.
+ * @param samples Число семплов.
+ * @return Время, мкс.
+ */
+extern uint64_t ain_samples_time_us(uint32_t samples);
+
+/**
+ * Получает номер кадра АЦП, по которому вычислен последний семпл.
+ * Кадры АЦП нумеруются монотонно с запуска ПДП и служат
+ * общей шкалой времени семплов, срабатываний и буферов.
+ * @return Номер кадра АЦП.
+ */
+extern uint64_t ain_sample_frame(void);
+
+/**
+ * Привязывает счётчик кадров АЦП к началу секунды часов.
+ * Вызывается из прерывания секунды RTC.
+ * @param sec Время начала секунды.
+ * @param dma_frame Номер кадра, записываемого ПДП в буфер АЦП.
+ * @param dma_frames Число кадров в буфере ПДП АЦП.
+ */
+extern void ain_time_anchor_isr(time_t sec, size_t dma_frame, size_t dma_frames);
+
+/**
+ * Получает время кадра АЦП по последней привязке к часам.
+ * @param frame Номер кадра АЦП.
+ * @return Время, мкс.
+ */
+extern uint64_t ain_frame_time_us(uint64_t frame);
+
+/**
+ * Получает время кадра АЦП по последней привязке к часам.
+ * @param frame Номер кадра АЦП.
+ * @param tv Время.
+ */
+extern void ain_frame_time(uint64_t frame, struct timeval* tv);
+
 /**
  * Инициализирует канал АЦП.
  * @param n Номер канала.
@@ -152,9 +291,11 @@ extern const char* ain_channel_unit(size_t n);
 
 /**
  * Устанавливает разрешение измерения канала.
+ * Изменяет список каналов, обрабатываемых задачей,
+ * поэтому допустимо только при запрещённых входах.
  * @param n Номер канала.
  * @param enabled Разрешение канала.
- * @return Код ошибки.
+ * @return Код ошибки, E_STATE если входа разрешены.
  */
 extern err_t ain_channel_set_enabled(size_t n, bool enabled);
 
@@ -176,12 +317,57 @@ extern err_t ain_channel_reset(size_t n);
  * Помещает в очередь для обработки
  * данные от АЦП в количестве
  * AIN_CHANNELS_COUNT каналов.
+ * Кадр копируется в кольцевой буфер кадров,
+ * в очередь помещается только его номер.
  * @param adc_data Указатель на данные.
  * @param pxHigherPriorityTaskWoken Флаг необходимости переключения задачи.
  * @return Код ошибки.
  */
 extern err_t ain_process_adc_data_isr(uint16_t* adc_data, BaseType_t* pxHigherPriorityTaskWoken);
 
+/**
+ * Обрабатывает кадры данных АЦП в контексте
+ * вызывающей задачи, минуя очередь.
+ * Предназначено для воспроизведения записанных
+ * или синтезированных данных при остановленном АЦП.
+ * @param adc_data Кадры по AIN_CHANNELS_COUNT значений.
+ * @param count Число кадров.
+ * @return Код ошибки.
+ */
+extern err_t ain_replay_adc_data(const uint16_t* adc_data, size_t count);
+
+/**
+ * Устанавливает расположение данных канала
+ * в буфере ПДП АЦП для блочной обработки.
+ * Буфер состоит из AIN_ADC_BLOCKS блоков
+ * по AIN_ADC_BLOCK_FRAMES кадров.
+ * @param n Номер канала.
+ * @param data Указатель на первое значение канала в буфере.
+ * @param stride Шаг между значениями канала соседних кадров.
+ * @return Код ошибки.
+ */
+extern err_t ain_channel_set_adc_buffer(size_t n, const uint16_t* data, size_t stride);
+
+/**
+ * Помещает в очередь для обработки
+ * блок данных АЦП из буфера ПДП.
+ * @param block Номер блока.
+ * @param pxHigherPriorityTaskWoken Флаг необходимости переключения задачи.
+ * @return Код ошибки.
+ */
+extern err_t ain_process_adc_block_isr(size_t block, BaseType_t* pxHigherPriorityTaskWoken);
+
+/**
+ * Получает статистику обработки данных АЦП.
+ * @param stats Статистика.
+ */
+extern void ain_stats(ain_stats_t* stats);
+
+/**
+ * Сбрасывает статистику обработки данных АЦП.
+ */
+extern void ain_stats_reset(void);
+
 /**
  * Получает мгновенное значение аналогового входа.
  * @param n Номер канала.
@@ -189,6 +375,14 @@ extern err_t ain_process_adc_data_isr(uint16_t* adc_data, BaseType_t* pxHigherPr
  */
 extern q15_t ain_value_inst(size_t n);
 
+/**
+ * Получает указатель на мгновенное значение аналогового входа.
+ * Значение обновляется задачей аналоговых входов.
+ * @param n Номер канала.
+ * @return Указатель на значение, либо NULL.
+ */
+extern const q15_t* ain_value_inst_ptr(size_t n);
+
 /**
  * Получает действующее значение аналогового входа.
  * @param n Номер канала.
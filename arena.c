@@ -0,0 +1,43 @@
+#include "arena.h"
+
+//! Структура общей памяти.
+typedef struct _Arena {
+    osc_value_t data[ARENA_SAMPLES]; //!< Данные.
+    size_t used; //!< Число выделенных семплов.
+} arena_t;
+
+//! Общая память.
+static arena_t arena;
+
+
+void arena_reset(void)
+{
+    arena.used = 0;
+}
+
+err_t arena_alloc(size_t size, osc_value_t** data)
+{
+    if(data == NULL) return E_NULL_POINTER;
+    if(size == 0) return E_INVALID_VALUE;
+    if(size > ARENA_SAMPLES - arena.used) return E_OUT_OF_MEMORY;
+
+    *data = &arena.data[arena.used];
+    arena.used += size;
+
+    return E_NO_ERROR;
+}
+
+size_t arena_size(void)
+{
+    return ARENA_SAMPLES;
+}
+
+size_t arena_used(void)
+{
+    return arena.used;
+}
+
+size_t arena_avail(void)
+{
+    return ARENA_SAMPLES - arena.used;
+}
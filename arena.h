@@ -0,0 +1,47 @@
+/**
+ * @file arena.h Общая память семплов осциллограмм и трендов.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include "osc.h"
+#include "errors/errors.h"
+#include <stddef.h>
+
+//! Число семплов общей памяти.
+#define ARENA_SAMPLES 12288
+
+/**
+ * Освобождает всю память.
+ * Ранее выделенная память не должна больше использоваться.
+ */
+extern void arena_reset(void);
+
+/**
+ * Выделяет память семплов.
+ * @param size Число семплов.
+ * @param data Выделенная память.
+ * @return Код ошибки: E_OUT_OF_MEMORY - превышен размер общей памяти.
+ */
+extern err_t arena_alloc(size_t size, osc_value_t** data);
+
+/**
+ * Получает размер общей памяти.
+ * @return Число семплов.
+ */
+extern size_t arena_size(void);
+
+/**
+ * Получает размер выделенной памяти.
+ * @return Число семплов.
+ */
+extern size_t arena_used(void);
+
+/**
+ * Получает размер свободной памяти.
+ * @return Число семплов.
+ */
+extern size_t arena_avail(void);
+
+#endif /* ARENA_H_ */
@@ -9,6 +9,48 @@
 //! Буфер.
 //static char ctrdbuf[COMTRADE_BUF_SIZE];
 
+//! Множитель 32 битных целых данных - значение iq15.
+#define COMTRADE_DAT32_A_STR "0.000030517578125"
+
+//! Имена типов данных.
+static const char* comtrade_dat_type_names[] = {
+    COMTRADE_DAT_FILE_TYPE, "BINARY32", "FLOAT32"
+};
+
+//! Заголовки секций файла CFF.
+#define COMTRADE_CFF_CFG "--- file type: CFG ---\r\n"
+#define COMTRADE_CFF_INF "--- file type: INF ---\r\n"
+#define COMTRADE_CFF_HDR "--- file type: HDR ---\r\n"
+#define COMTRADE_CFF_DAT "--- file type: DAT "
+#define COMTRADE_CFF_DAT_END " ---\r\n"
+
+
+/**
+ * Получает год версии стандарта.
+ * Единый файл CFF и 32 битные данные
+ * введены в версии 2013 года.
+ * @param comtrade Комтрейд.
+ * @return Год версии стандарта.
+ */
+static unsigned int comtrade_standard_year(comtrade_t* comtrade)
+{
+    if(comtrade->cff || comtrade->dat_type != COMTRADE_DAT_BINARY) return COMTRADE_STANDARD_YEAR_2013;
+
+    return COMTRADE_STANDARD_YEAR;
+}
+
+/**
+ * Получает размер значения аналогового канала в файле данных.
+ * @param comtrade Комтрейд.
+ * @return Размер значения.
+ */
+static size_t comtrade_dat_analog_size(comtrade_t* comtrade)
+{
+    if(comtrade->dat_type == COMTRADE_DAT_BINARY) return sizeof(int16_t);
+
+    return sizeof(int32_t);
+}
+
 
 
 static err_t comtrade_cfg_write_station_line(FIL* f, comtrade_t* comtrade)
@@ -18,7 +60,7 @@ static err_t comtrade_cfg_write_station_line(FIL* f, comtrade_t* comtrade)
     const char* station_name = comtrade->station_name ? comtrade->station_name : nullstr;
     const char* rec_dev_id = comtrade->rec_dev_id ? comtrade->rec_dev_id : nullstr;
 
-    f_printf(f, "%s,%s,%u\r\n", station_name, rec_dev_id, COMTRADE_STANDARD_YEAR);
+    f_printf(f, "%s,%s,%u\r\n", station_name, rec_dev_id, comtrade_standard_year(comtrade));
     if(f_error(f)) return E_IO_ERROR;
 
     return E_NO_ERROR;
@@ -58,20 +100,35 @@ static err_t comtrade_cfg_write_analog_channel_line(FIL* f, comtrade_t* comtrade
     f_printf(f, "%u,%s,%s,%s,%s,", index + 1, ch_id, ph, ccbm, uu);
     if(f_error(f)) return E_IO_ERROR;
 
-    if(iq15_tostr(ctrdbuf, COMTRADE_BUF_SIZE, channel.a) > 0){
-        f_puts(ctrdbuf, f);
+    switch(comtrade->dat_type){
+    default:
+    case COMTRADE_DAT_BINARY:
+        if(iq15_tostr(ctrdbuf, COMTRADE_BUF_SIZE, channel.a) > 0){
+            f_puts(ctrdbuf, f);
+            if(f_error(f)) return E_IO_ERROR;
+        }
+
+        f_puts(",", f);
         if(f_error(f)) return E_IO_ERROR;
-    }
 
-    f_puts(",", f);
-    if(f_error(f)) return E_IO_ERROR;
+        if(iq15_tostr(ctrdbuf, COMTRADE_BUF_SIZE, channel.b) > 0){
+            f_puts(ctrdbuf, f);
+            if(f_error(f)) return E_IO_ERROR;
+        }
 
-    if(iq15_tostr(ctrdbuf, COMTRADE_BUF_SIZE, channel.b) > 0){
-        f_puts(ctrdbuf, f);
-        if(f_error(f)) return E_IO_ERROR;
+        f_printf(f, ",%u,%d,%d,", channel.skew, channel.min, channel.max);
+        break;
+    // Значения в единицах измерения канала,
+    // масштаб канала не ограничивает точность.
+    case COMTRADE_DAT_BINARY32:
+        f_printf(f, "%s,0,%u,%ld,%ld,", COMTRADE_DAT32_A_STR, channel.skew,
+                 COMTRADE_DAT32_MIN, COMTRADE_DAT32_MAX);
+        break;
+    case COMTRADE_DAT_FLOAT32:
+        f_printf(f, "1,0,%u,%ld,%ld,", channel.skew,
+                 COMTRADE_DAT32_MIN / Q15_BASE, COMTRADE_DAT32_MAX / Q15_BASE);
+        break;
     }
-
-    f_printf(f, ",%u,%d,%d,", channel.skew, channel.min, channel.max);
     if(f_error(f)) return E_IO_ERROR;
 
     if(iq15_tostr(ctrdbuf, COMTRADE_BUF_SIZE, channel.primary) > 0){
@@ -168,7 +225,17 @@ static err_t comtrade_cfg_write_rate_line(FIL* f, comtrade_t* comtrade, size_t i
         if(f_error(f)) return E_IO_ERROR;
     }
 
-    f_printf(f, ",%u\r\n", rate.endsamp);
+    if(comtrade->endsamp_fixed){
+        f_putc(',', f);
+        if(f_error(f)) return E_IO_ERROR;
+
+        // Номер последнего семпла последней частоты обновляется на месте.
+        comtrade->endsamp_pos = f_tell(f);
+
+        f_printf(f, "%0" COMTRADE_ENDSAMP_WIDTH_STR "u\r\n", rate.endsamp);
+    }else{
+        f_printf(f, ",%u\r\n", rate.endsamp);
+    }
     if(f_error(f)) return E_IO_ERROR;
 
     return E_NO_ERROR;
@@ -232,10 +299,30 @@ static err_t comtrade_cfg_write_datetimes(FIL* f, comtrade_t* comtrade)
 }
 
 static err_t comtrade_cfg_write_dat_file_type(FIL* f, comtrade_t* comtrade)
+{
+    if((size_t)comtrade->dat_type >= sizeof(comtrade_dat_type_names) / sizeof(comtrade_dat_type_names[0])){
+        return E_INVALID_VALUE;
+    }
+
+    f_printf(f, "%s\r\n", comtrade_dat_type_names[comtrade->dat_type]);
+    if(f_error(f)) return E_IO_ERROR;
+
+    return E_NO_ERROR;
+}
+
+/**
+ * Записывает строки кодов часового пояса и качества времени версии 2013.
+ * Время записывается в местном поясе без поправок,
+ * источник времени не отслеживается.
+ * @param f Файл.
+ * @param comtrade Комтрейд.
+ * @return Код ошибки.
+ */
+static err_t comtrade_cfg_write_time_codes(FIL* f, comtrade_t* comtrade)
 {
     (void) comtrade;
 
-    f_printf(f, "%s\r\n", COMTRADE_DAT_FILE_TYPE);
+    f_puts("0,0\r\n0,0\r\n", f);
     if(f_error(f)) return E_IO_ERROR;
 
     return E_NO_ERROR;
@@ -243,7 +330,11 @@ static err_t comtrade_cfg_write_dat_file_type(FIL* f, comtrade_t* comtrade)
 
 static err_t comtrade_cfg_write_timemult(FIL* f, comtrade_t* comtrade)
 {
-    f_printf(f, "%u\r\n", comtrade->timemult);
+    if(comtrade->timemult_frac != 0){
+        f_printf(f, "%u.%03u\r\n", comtrade->timemult, comtrade->timemult_frac);
+    }else{
+        f_printf(f, "%u\r\n", comtrade->timemult);
+    }
     if(f_error(f)) return E_IO_ERROR;
 
     return E_NO_ERROR;
@@ -279,12 +370,95 @@ err_t comtrade_write_cfg(FIL* f, comtrade_t* comtrade)
     err = comtrade_cfg_write_timemult(f, comtrade);
     if(err != E_NO_ERROR) return err;
 
+    if(comtrade_standard_year(comtrade) == COMTRADE_STANDARD_YEAR_2013){
+        err = comtrade_cfg_write_time_codes(f, comtrade);
+        if(err != E_NO_ERROR) return err;
+    }
+
     return err;
 }
 
+err_t comtrade_write_cff_head(FIL* f, comtrade_t* comtrade, uint32_t samples)
+{
+    if(f == NULL || comtrade == NULL) return E_NULL_POINTER;
+    if(!comtrade->cff) return E_STATE;
+
+    err_t err = E_NO_ERROR;
+
+    f_puts(COMTRADE_CFF_CFG, f);
+    if(f_error(f)) return E_IO_ERROR;
+
+    err = comtrade_write_cfg(f, comtrade);
+    if(err != E_NO_ERROR) return err;
+
+    f_puts(COMTRADE_CFF_INF COMTRADE_CFF_HDR, f);
+    if(f_error(f)) return E_IO_ERROR;
+
+    if(comtrade->write_hdr){
+        err = comtrade->write_hdr(comtrade, f);
+        if(err != E_NO_ERROR) return err;
+    }
+
+    // Тип данных проверен при записи конфигурации.
+    f_printf(f, COMTRADE_CFF_DAT "%s: ", comtrade_dat_type_names[comtrade->dat_type]);
+    if(f_error(f)) return E_IO_ERROR;
+
+    unsigned long dat_size = (unsigned long)comtrade_dat_record_size(comtrade) * samples;
+
+    // Размер секции обновляется на месте вместе с номером последнего семпла.
+    comtrade->dat_size_pos = f_tell(f);
+
+    if(comtrade->endsamp_fixed){
+        f_printf(f, "%0" COMTRADE_DAT_SIZE_WIDTH_STR "lu" COMTRADE_CFF_DAT_END, dat_size);
+    }else{
+        f_printf(f, "%lu" COMTRADE_CFF_DAT_END, dat_size);
+    }
+    if(f_error(f)) return E_IO_ERROR;
+
+    comtrade->dat_pos = f_tell(f);
+
+#if FF_USE_FASTSEEK
+    // Начало файла длиннее пробной записи при резервировании,
+    // данные не поместятся в зарезервированное место - файл должен расти.
+    if(f->cltbl && comtrade->dat_pos + dat_size > f_size(f)) f->cltbl = NULL;
+#endif
+
+    return E_NO_ERROR;
+}
+
+err_t comtrade_update_cfg_endsamp(FIL* f, comtrade_t* comtrade, uint32_t endsamp)
+{
+    if(f == NULL || comtrade == NULL) return E_NULL_POINTER;
+    if(!comtrade->endsamp_fixed || comtrade->endsamp_pos == 0) return E_STATE;
+    if(comtrade->cff && comtrade->dat_size_pos == 0) return E_STATE;
+
+    FSIZE_t pos = f_tell(f);
+
+    FRESULT fres = f_lseek(f, comtrade->endsamp_pos);
+    if(fres != FR_OK) return E_IO_ERROR;
+
+    f_printf(f, "%0" COMTRADE_ENDSAMP_WIDTH_STR "u", endsamp);
+    if(f_error(f)) return E_IO_ERROR;
+
+    if(comtrade->cff){
+        fres = f_lseek(f, comtrade->dat_size_pos);
+        if(fres != FR_OK) return E_IO_ERROR;
+
+        f_printf(f, "%0" COMTRADE_DAT_SIZE_WIDTH_STR "lu",
+                 (unsigned long)comtrade_dat_record_size(comtrade) * endsamp);
+        if(f_error(f)) return E_IO_ERROR;
+    }
+
+    fres = f_lseek(f, pos);
+    if(fres != FR_OK) return E_IO_ERROR;
+
+    return E_NO_ERROR;
+}
+
 err_t comtrade_append_dat(FIL* f, comtrade_t* comtrade, uint32_t sample_index, uint32_t timestamp)
 {
     if(f == NULL || comtrade == NULL) return E_NULL_POINTER;
+    if(comtrade->dat_type != COMTRADE_DAT_BINARY) return E_INVALID_VALUE;
     if(comtrade->analog_channels != 0 && comtrade->get_analog_channel_value == NULL) return E_NULL_POINTER;
     if(comtrade->digital_channels != 0 && comtrade->get_digital_channel_value == NULL) return E_NULL_POINTER;
 
@@ -341,13 +515,288 @@ err_t comtrade_append_dat(FIL* f, comtrade_t* comtrade, uint32_t sample_index, u
     return E_NO_ERROR;
 }
 
+err_t comtrade_append_dat_records(FIL* f, comtrade_t* comtrade, const void* records, size_t count)
+{
+    if(f == NULL || comtrade == NULL) return E_NULL_POINTER;
+    if(records == NULL && count != 0) return E_NULL_POINTER;
+    if(comtrade->dat_type != COMTRADE_DAT_BINARY) return E_INVALID_VALUE;
+
+    UINT written;
+    FRESULT fres = FR_OK;
+
+    UINT size = (UINT)(comtrade_dat_record_size(comtrade) * count);
+
+    if(size == 0) return E_NO_ERROR;
+
+    fres = f_write(f, records, size, &written);
+    if(fres != FR_OK || written != size) return E_IO_ERROR;
+
+    return E_NO_ERROR;
+}
+
+/**
+ * Записывает данные буфера в файл.
+ * Размер следующей записи в файл дополняет
+ * текущий сектор файла до границы.
+ * @param stream Поток.
+ * @return Код ошибки.
+ */
+static err_t comtrade_dat_stream_write(comtrade_dat_stream_t* stream)
+{
+    if(stream->pos == 0) return E_NO_ERROR;
+
+    UINT written;
+    FRESULT fres = f_write(stream->f, stream->buf, (UINT)stream->pos, &written);
+    if(fres != FR_OK || written != stream->pos) return E_IO_ERROR;
+
+    stream->pos = 0;
+    stream->limit = stream->size - (size_t)(f_tell(stream->f) % COMTRADE_DAT_SECTOR_SIZE);
+
+    return E_NO_ERROR;
+}
+
+/**
+ * Добавляет в буфер 16 битное значение.
+ * Все поля записи DAT файла кратны 16 битам,
+ * поэтому значения не разрываются между записями в файл.
+ * @param stream Поток.
+ * @param value Значение.
+ * @return Код ошибки.
+ */
+ALWAYS_INLINE static err_t comtrade_dat_stream_put(comtrade_dat_stream_t* stream, uint16_t value)
+{
+    if(stream->pos + sizeof(uint16_t) > stream->limit){
+        err_t err = comtrade_dat_stream_write(stream);
+        if(err != E_NO_ERROR) return err;
+    }
+
+    memcpy(&stream->buf[stream->pos], &value, sizeof(uint16_t));
+    stream->pos += sizeof(uint16_t);
+
+    return E_NO_ERROR;
+}
+
+/**
+ * Добавляет в буфер 32 битное значение.
+ * @param stream Поток.
+ * @param value Значение.
+ * @return Код ошибки.
+ */
+ALWAYS_INLINE static err_t comtrade_dat_stream_put32(comtrade_dat_stream_t* stream, uint32_t value)
+{
+    err_t err = comtrade_dat_stream_put(stream, (uint16_t)(value & 0xffff));
+    if(err != E_NO_ERROR) return err;
+
+    return comtrade_dat_stream_put(stream, (uint16_t)(value >> 16));
+}
+
+/**
+ * Получает представление значения iq15
+ * в формате IEEE 754 одинарной точности.
+ * @param value Значение.
+ * @return Биты числа с плавающей запятой.
+ */
+ALWAYS_INLINE static uint32_t comtrade_float32_bits(iq15_t value)
+{
+    float f = (float)value / Q15_BASE;
+    uint32_t bits;
+
+    memcpy(&bits, &f, sizeof(uint32_t));
+
+    return bits;
+}
+
+/**
+ * Кодирует запись семпла в буфер.
+ * @param stream Поток.
+ * @param comtrade Комтрейд.
+ * @param sample_index Номер семпла.
+ * @param timestamp Отметка времени.
+ * @return Код ошибки.
+ */
+static err_t comtrade_dat_stream_put_record(comtrade_dat_stream_t* stream, comtrade_t* comtrade, uint32_t sample_index, uint32_t timestamp)
+{
+    err_t err = E_NO_ERROR;
+
+    err = comtrade_dat_stream_put32(stream, sample_index + 1);
+    if(err != E_NO_ERROR) return err;
+
+    err = comtrade_dat_stream_put32(stream, timestamp);
+    if(err != E_NO_ERROR) return err;
+
+    // analog channels.
+    size_t i;
+    switch(comtrade->dat_type){
+    default:
+    case COMTRADE_DAT_BINARY:
+        for(i = 0; i < comtrade->analog_channels; i ++){
+            err = comtrade_dat_stream_put(stream, (uint16_t)comtrade->get_analog_channel_value(comtrade, i, sample_index));
+            if(err != E_NO_ERROR) return err;
+        }
+        break;
+    case COMTRADE_DAT_BINARY32:
+        for(i = 0; i < comtrade->analog_channels; i ++){
+            err = comtrade_dat_stream_put32(stream, (uint32_t)comtrade->get_analog_channel_real_value(comtrade, i, sample_index));
+            if(err != E_NO_ERROR) return err;
+        }
+        break;
+    case COMTRADE_DAT_FLOAT32:
+        for(i = 0; i < comtrade->analog_channels; i ++){
+            err = comtrade_dat_stream_put32(stream, comtrade_float32_bits(comtrade->get_analog_channel_real_value(comtrade, i, sample_index)));
+            if(err != E_NO_ERROR) return err;
+        }
+        break;
+    }
+
+    // digital channels.
+    uint16_t value = 0;
+    size_t bit = 0;
+    for(i = 0; i < comtrade->digital_channels; i ++){
+        if(comtrade->get_digital_channel_value(comtrade, i, sample_index)){
+            value |= (1 << bit);
+        }
+
+        bit ++;
+
+        if(bit == (sizeof(uint16_t) * 8)){
+            err = comtrade_dat_stream_put(stream, value);
+            if(err != E_NO_ERROR) return err;
+
+            bit = 0;
+            value = 0;
+        }
+    }
+
+    if(bit != 0){
+        err = comtrade_dat_stream_put(stream, value);
+        if(err != E_NO_ERROR) return err;
+    }
+
+    return E_NO_ERROR;
+}
+
+err_t comtrade_dat_stream_init(comtrade_dat_stream_t* stream, FIL* f, void* buf, size_t buf_size)
+{
+    if(stream == NULL || f == NULL) return E_NULL_POINTER;
+    if(buf == NULL) return E_NULL_POINTER;
+    if(buf_size == 0 || (buf_size % COMTRADE_DAT_SECTOR_SIZE) != 0) return E_INVALID_VALUE;
+
+    stream->f = f;
+    stream->buf = (uint8_t*)buf;
+    stream->size = buf_size;
+    // Первая запись дополняет текущий сектор файла.
+    stream->limit = buf_size - (size_t)(f_tell(f) % COMTRADE_DAT_SECTOR_SIZE);
+    stream->pos = 0;
+
+    return E_NO_ERROR;
+}
+
+err_t comtrade_dat_stream_append(comtrade_dat_stream_t* stream, comtrade_t* comtrade,
+                                 uint32_t sample_index, uint32_t timestamp, size_t count)
+{
+    if(stream == NULL || comtrade == NULL) return E_NULL_POINTER;
+    if(comtrade->analog_channels != 0){
+        if(comtrade->dat_type == COMTRADE_DAT_BINARY){
+            if(comtrade->get_analog_channel_value == NULL) return E_NULL_POINTER;
+        }else{
+            if(comtrade->get_analog_channel_real_value == NULL) return E_NULL_POINTER;
+        }
+    }
+    if(comtrade->digital_channels != 0 && comtrade->get_digital_channel_value == NULL) return E_NULL_POINTER;
+
+    err_t err = E_NO_ERROR;
+
+    size_t i;
+    for(i = 0; i < count; i ++){
+        err = comtrade_dat_stream_put_record(stream, comtrade, sample_index + i, timestamp + i);
+        if(err != E_NO_ERROR) return err;
+    }
+
+    return E_NO_ERROR;
+}
+
+err_t comtrade_dat_stream_flush(comtrade_dat_stream_t* stream)
+{
+    if(stream == NULL) return E_NULL_POINTER;
+
+    return comtrade_dat_stream_write(stream);
+}
+
+err_t comtrade_append_dat_samples(FIL* f, comtrade_t* comtrade, void* buf, size_t buf_size,
+                                  uint32_t sample_index, uint32_t timestamp, size_t count)
+{
+    if(f == NULL || comtrade == NULL) return E_NULL_POINTER;
+
+    err_t err = E_NO_ERROR;
+
+    comtrade_dat_stream_t stream;
+
+    err = comtrade_dat_stream_init(&stream, f, buf, buf_size);
+    if(err != E_NO_ERROR) return err;
+
+    err = comtrade_dat_stream_append(&stream, comtrade, sample_index, timestamp, count);
+    if(err != E_NO_ERROR) return err;
+
+    return comtrade_dat_stream_flush(&stream);
+}
+
+err_t comtrade_dat_reserve(FIL* f, comtrade_t* comtrade, size_t samples, DWORD* clmt)
+{
+    if(f == NULL || comtrade == NULL || clmt == NULL) return E_NULL_POINTER;
+
+    FRESULT fres = FR_OK;
+
+    FSIZE_t size = (FSIZE_t)comtrade_dat_record_size(comtrade) * samples;
+
+    if(size == 0) return E_INVALID_VALUE;
+
+    if(f_size(f) == 0 && comtrade->cff){
+        // Размер начала файла CFF определяется пробной записью.
+        err_t err = comtrade_write_cff_head(f, comtrade, (uint32_t)samples);
+        if(err != E_NO_ERROR) return err;
+
+        fres = f_lseek(f, 0);
+        if(fres == FR_OK) fres = f_truncate(f);
+        if(fres != FR_OK) return E_IO_ERROR;
+    }
+
+    if(comtrade->cff) size += comtrade->dat_pos;
+
+    if(f_size(f) == 0){
+        fres = f_expand(f, size, 1);
+        if(fres == FR_DENIED) return E_OUT_OF_MEMORY;
+        if(fres != FR_OK) return E_IO_ERROR;
+
+        // Запишем цепочку кластеров в запись каталога,
+        // чтобы она не потерялась при ошибке до закрытия файла.
+        fres = f_sync(f);
+        if(fres != FR_OK) return E_IO_ERROR;
+    }
+
+    if(f_size(f) < size) return E_OUT_OF_RANGE;
+
+    FSIZE_t pos = f_tell(f);
+
+    clmt[0] = COMTRADE_DAT_CLMT_SIZE;
+    f->cltbl = clmt;
+
+    fres = f_lseek(f, CREATE_LINKMAP);
+    if(fres == FR_OK) fres = f_lseek(f, pos);
+    if(fres != FR_OK){
+        f->cltbl = NULL;
+        return (fres == FR_NOT_ENOUGH_CORE) ? E_OUT_OF_RANGE : E_IO_ERROR;
+    }
+
+    return E_NO_ERROR;
+}
+
 size_t comtrade_dat_record_size(comtrade_t* comtrade)
 {
     // Индекс и отметка времени.
     size_t index_size = sizeof(uint32_t) + sizeof(uint32_t);
 
     // Аналоговые каналы.
-    size_t analog_size = comtrade->analog_channels * sizeof(int16_t);
+    size_t analog_size = comtrade->analog_channels * comtrade_dat_analog_size(comtrade);
 
     // Цифровые каналы.
     // В 16 битных значениях.
@@ -18,6 +18,9 @@
 //! Год стандарта.
 #define COMTRADE_STANDARD_YEAR 1999
 
+//! Год стандарта с единым файлом CFF и 32 битными данными.
+#define COMTRADE_STANDARD_YEAR_2013 2013
+
 //! Тип файла данных.
 #define COMTRADE_DAT_FILE_TYPE "BINARY"
 
@@ -27,6 +30,25 @@
 //! Максимальное значение данных.
 #define COMTRADE_DAT_MAX (32767)
 
+//! Минимальное значение 32 битных данных.
+#define COMTRADE_DAT32_MIN (-2147483647L)
+
+//! Максимальное значение 32 битных данных.
+#define COMTRADE_DAT32_MAX (2147483647L)
+
+//! Размер сектора, которому кратен буфер записи DAT файла.
+#define COMTRADE_DAT_SECTOR_SIZE 512
+
+//! Размер таблицы связей кластеров непрерывного DAT файла:
+//! размер таблицы, фрагмент (длина и кластер) и завершающий ноль.
+#define COMTRADE_DAT_CLMT_SIZE 4
+
+//! Ширина номера последнего семпла, обновляемого на месте.
+#define COMTRADE_ENDSAMP_WIDTH_STR "10"
+
+//! Ширина размера секции DAT файла CFF, обновляемого на месте.
+#define COMTRADE_DAT_SIZE_WIDTH_STR "10"
+
 //! Несуществующее значние.
 #define COMTRADE_UNKNOWN_VALUE (-32768)
 
@@ -37,6 +59,14 @@
 #define COMTRADE_PS_SECONDARY 's'
 
 
+//! Тип данных DAT файла.
+typedef enum _Comtrade_Dat_Type {
+    COMTRADE_DAT_BINARY = 0, //!< 16 битные целые, значение канала a * x + b.
+    COMTRADE_DAT_BINARY32 = 1, //!< 32 битные целые в формате iq15 единиц измерения канала.
+    COMTRADE_DAT_FLOAT32 = 2 //!< 32 битные с плавающей запятой в единицах измерения канала.
+} comtrade_dat_type_t;
+
+
 //! Структура описания аналогового канала.
 typedef struct _Comtrade_Analog_Channel {
     const char* ch_id; //!< Идентификатор канала.
@@ -116,6 +146,16 @@ typedef void (*comtrade_get_sample_rate_t)(comtrade_t* comtrade, size_t index, c
  */
 typedef int16_t (*comtrade_get_analog_channel_value_t)(comtrade_t* comtrade, size_t index, size_t sample);
 
+/**
+ * Каллбэк получения значения аналогового канала
+ * в единицах измерения канала для 32 битных данных.
+ * @param comtrade Комтрейд.
+ * @param index Индекс канала.
+ * @param sample Номер семпла.
+ * @return Значение канала.
+ */
+typedef iq15_t (*comtrade_get_analog_channel_real_value_t)(comtrade_t* comtrade, size_t index, size_t sample);
+
 /**
  * Каллбэк получения значения цифрового канала.
  * @param comtrade Комтрейд.
@@ -125,13 +165,21 @@ typedef int16_t (*comtrade_get_analog_channel_value_t)(comtrade_t* comtrade, siz
  */
 typedef bool (*comtrade_get_digital_channel_value_t)(comtrade_t* comtrade, size_t index, size_t sample);
 
+/**
+ * Каллбэк записи секции HDR файла CFF.
+ * @param comtrade Комтрейд.
+ * @param f Файл.
+ * @return Код ошибки.
+ */
+typedef err_t (*comtrade_write_hdr_t)(comtrade_t* comtrade, FIL* f);
+
 
 //!< Структура COMTRADE.
 typedef struct _Comtrade {
     // Конфигурация COMTRADE.
     const char* station_name; //!< Имя станции.
     const char* rec_dev_id; //!< Идентификатор записывающего устройства.
-    //uint16_t rev_year; //!< Год версии стандарта - всегда 1999.
+    //uint16_t rev_year; //!< Год версии стандарта - 2013 для CFF и 32 битных данных, иначе 1999.
     size_t analog_channels; //!< Число аналоговых каналов.
     comtrade_get_analog_channel_t get_analog_channel; //!< Получение данных об аналоговом канале.
     size_t digital_channels; //!< Число цифровых каналов.
@@ -141,18 +189,36 @@ typedef struct _Comtrade {
     comtrade_get_sample_rate_t get_sample_rate; //!< Получение данных о частоте дискретизации.
     struct timeval data_time; //!< Время первых данных в файле.
     struct timeval trigger_time; //!< Время события.
-    // comtrade_file_type_t file_type; //!< Тип файла - всегда бинарный.
+    comtrade_dat_type_t dat_type; //!< Тип данных.
+    bool cff; //!< Запись единым файлом CFF.
     uint32_t timemult; //!< Множитель отметки времени, мкс.
+    uint32_t timemult_frac; //!< Дробная часть множителя отметки времени, нс.
     // Данные COMTRADE.
     comtrade_osc_data_t osc_data; //!< Данные осциллограммы.
     void* user_data; //!< Пользовательские данные.
     //comtrade_get_sample_timestamp_t get_sample_timestamp; //!< Получение отметки времени.
     comtrade_get_analog_channel_value_t get_analog_channel_value; //!< Получение значения аналогового канала.
     comtrade_get_digital_channel_value_t get_digital_channel_value; //!< Получение значения цифрового канала.
+    comtrade_get_analog_channel_real_value_t get_analog_channel_real_value; //!< Получение значения аналогового канала для 32 битных данных.
+    comtrade_write_hdr_t write_hdr; //!< Запись секции HDR файла CFF, может быть NULL.
+    bool endsamp_fixed; //!< Запись номера последнего семпла фиксированной ширины для обновления на месте.
     // Данные времени выполнения.
+    FSIZE_t endsamp_pos; //!< Позиция номера последнего семпла последней частоты в CFG файле.
+    FSIZE_t dat_size_pos; //!< Позиция размера секции DAT в файле CFF.
+    FSIZE_t dat_pos; //!< Позиция данных секции DAT в файле CFF.
 } comtrade_t;
 
 
+//! Поток записи DAT файла COMTRADE.
+typedef struct _Comtrade_Dat_Stream {
+    FIL* f; //!< Файл.
+    uint8_t* buf; //!< Буфер.
+    size_t size; //!< Размер буфера.
+    size_t limit; //!< Размер данных до следующей записи в файл.
+    size_t pos; //!< Позиция в буфере.
+} comtrade_dat_stream_t;
+
+
 /**
  * Записывает CFG файл COMTRADE.
  * @param f Файл (*.cfg).
@@ -161,14 +227,126 @@ typedef struct _Comtrade {
  */
 extern err_t comtrade_write_cfg(FIL* f, comtrade_t* comtrade);
 
+/**
+ * Записывает начало файла CFF COMTRADE: секции CFG, INF, HDR
+ * и заголовок секции DAT, после которого функциями записи
+ * DAT файла добавляются данные.
+ * @param f Файл (*.cff).
+ * @param comtrade Комтрейд.
+ * @param samples Число записей в секции DAT.
+ * @return Код ошибки.
+ */
+extern err_t comtrade_write_cff_head(FIL* f, comtrade_t* comtrade, uint32_t samples);
+
+/**
+ * Обновляет номер последнего семпла в записанном CFG файле COMTRADE,
+ * а в файле CFF - и размер секции DAT.
+ * Файл должен быть записан с флагом endsamp_fixed,
+ * длина файла и позиция в нём при обновлении не изменяются.
+ * @param f Файл (*.cfg или *.cff), открытый на запись.
+ * @param comtrade Комтрейд, которым записан файл.
+ * @param endsamp Номер последнего семпла.
+ * @return Код ошибки.
+ */
+extern err_t comtrade_update_cfg_endsamp(FIL* f, comtrade_t* comtrade, uint32_t endsamp);
+
 /**
  * Добавляет данные в DAT файл COMTRADE.
+ * Поддерживается только тип данных COMTRADE_DAT_BINARY.
  * @param f Файл (*.dat).
  * @param comtrade Комтрейд.
  * @return Код ошибки.
  */
 extern err_t comtrade_append_dat(FIL* f, comtrade_t* comtrade, uint32_t sample_index, uint32_t timestamp);
 
+/**
+ * Добавляет в DAT файл COMTRADE последовательные семплы
+ * через поток записи с буфером buf (см. comtrade_dat_stream_init()).
+ * Номер и отметка времени семпла увеличиваются на единицу.
+ * @param f Файл (*.dat).
+ * @param comtrade Комтрейд.
+ * @param buf Буфер.
+ * @param buf_size Размер буфера, кратный COMTRADE_DAT_SECTOR_SIZE.
+ * @param sample_index Номер первого семпла.
+ * @param timestamp Отметка времени первого семпла.
+ * @param count Число семплов.
+ * @return Код ошибки.
+ */
+extern err_t comtrade_append_dat_samples(FIL* f, comtrade_t* comtrade, void* buf, size_t buf_size,
+                                         uint32_t sample_index, uint32_t timestamp, size_t count);
+
+/**
+ * Инициализирует поток записи DAT файла COMTRADE.
+ * Записи кодируются в буфер, который записывается в файл
+ * целиком одним вызовом f_write по заполнению.
+ * Первая запись дополняет текущий сектор файла,
+ * последующие начинаются с границы сектора.
+ * Буфер принадлежит потоку до окончания записи.
+ * @param stream Поток.
+ * @param f Файл (*.dat), открытый на запись в позиции добавления.
+ * @param buf Буфер.
+ * @param buf_size Размер буфера, кратный COMTRADE_DAT_SECTOR_SIZE.
+ * @return Код ошибки.
+ */
+extern err_t comtrade_dat_stream_init(comtrade_dat_stream_t* stream, FIL* f, void* buf, size_t buf_size);
+
+/**
+ * Добавляет в поток последовательные семплы.
+ * Номер и отметка времени семпла увеличиваются на единицу.
+ * Данные, не заполнившие буфер, остаются в нём до
+ * следующего добавления или comtrade_dat_stream_flush().
+ * @param stream Поток.
+ * @param comtrade Комтрейд.
+ * @param sample_index Номер первого семпла.
+ * @param timestamp Отметка времени первого семпла.
+ * @param count Число семплов.
+ * @return Код ошибки.
+ */
+extern err_t comtrade_dat_stream_append(comtrade_dat_stream_t* stream, comtrade_t* comtrade,
+                                        uint32_t sample_index, uint32_t timestamp, size_t count);
+
+/**
+ * Записывает в файл данные буфера потока.
+ * Не синхронизирует файл.
+ * @param stream Поток.
+ * @return Код ошибки.
+ */
+extern err_t comtrade_dat_stream_flush(comtrade_dat_stream_t* stream);
+
+/**
+ * Добавляет в DAT файл COMTRADE готовые записи семплов.
+ * Записи должны иметь размер comtrade_dat_record_size(),
+ * поддерживается только тип данных COMTRADE_DAT_BINARY.
+ * @param f Файл (*.dat).
+ * @param comtrade Комтрейд.
+ * @param records Записи.
+ * @param count Число записей.
+ * @return Код ошибки.
+ */
+extern err_t comtrade_append_dat_records(FIL* f, comtrade_t* comtrade, const void* records, size_t count);
+
+/**
+ * Резервирует в DAT файле COMTRADE непрерывное место под записи.
+ * Пустой файл расширяется f_expand() до размера samples записей,
+ * непустой должен уже иметь не меньший размер.
+ * Для файла CFF к размеру добавляется начало файла,
+ * размер которого определяется пробной записью comtrade_write_cff_head(),
+ * после чего файл снова пуст и начало записывается с позиции 0.
+ * Затем для файла строится таблица связей кластеров,
+ * и запись и перемещение по файлу не читают FAT,
+ * но файл больше не может расти за зарезервированный размер.
+ * Неиспользованное место освобождается f_truncate() перед закрытием.
+ * @param f Файл (*.dat), открытый на запись.
+ * @param comtrade Комтрейд.
+ * @param samples Число записей.
+ * @param clmt Таблица связей кластеров размером COMTRADE_DAT_CLMT_SIZE,
+ * используемая до закрытия файла.
+ * @return Код ошибки: E_OUT_OF_MEMORY - нет непрерывного свободного места,
+ * E_OUT_OF_RANGE - файл меньше нужного размера или фрагментирован,
+ * в этих случаях файл пишется как обычно.
+ */
+extern err_t comtrade_dat_reserve(FIL* f, comtrade_t* comtrade, size_t samples, DWORD* clmt);
+
 /**
  * Получает размер записи данных в файле.
  * @param comtrade Комтрейд.
@@ -8,6 +8,7 @@
 #include "osc.h"
 #include "oscs.h"
 #include "trends.h"
+#include "arena.h"
 #include "trig.h"
 #include "logger.h"
 #include <sys/time.h>
@@ -23,11 +24,16 @@ static const char* config_ini = "config.ini";
 //! Размер одной линии ini-файла.
 #define INI_LINE_LEN 128
 
+//! Размер памяти трендов - остаток общей памяти после осциллограмм.
+#define CONF_ARENA_REST (-1)
+
 //! Тип конфигуратора.
 typedef struct _Conf {
     ini_t ini; //!< Парсер ini.
     char ini_line[INI_LINE_LEN]; //!< Линии ini.
     //FIL ini_file; //!< Файл.
+    bool oscs_mem; //!< Осциллограммам выделена память.
+    bool trends_mem; //!< Трендам выделена память.
 } conf_t;
 
 //! Конфигуратор.
@@ -155,6 +161,7 @@ static void conf_ini_store_str(char* dst, size_t size, const char* src)
 static err_t conf_ini_read_logger(ini_t* ini, FIL* f)
 {
     iq15_t time = 0;
+    uint32_t stats_period = 0;
     const char* str = NULL;
 
     char log_sect[CONF_INI_SECT_BUF_LEN];
@@ -167,6 +174,16 @@ static err_t conf_ini_read_logger(ini_t* ini, FIL* f)
     time = iq15_sat(time);
     logger_set_osc_time_ratio(time);
 
+    time = ini_valuef(ini, log_sect, "osc_ratio_max", 0);
+    if(f_error(f)) return E_IO_ERROR;
+
+    time = iq15_sat(time);
+    logger_set_osc_time_ratio_max(time);
+
+    stats_period = ini_valuei(ini, log_sect, "stats_period", 0);
+    if(f_error(f)) return E_IO_ERROR;
+    logger_set_stats_period(stats_period);
+
     str = ini_value(ini, log_sect, "station", NULL);
     if(f_error(f)) return E_IO_ERROR;
     logger_set_station_name(str);
@@ -178,6 +195,20 @@ static err_t conf_ini_read_logger(ini_t* ini, FIL* f)
     return E_NO_ERROR;
 }
 
+static err_t conf_ini_read_ain(ini_t* ini, FIL* f)
+{
+    uint32_t sample_freq;
+    uint32_t power_freq;
+
+    sample_freq = ini_valuei(ini, "ain", "sample_freq", AIN_SAMPLE_FREQ_DEFAULT);
+    if(f_error(f)) return E_IO_ERROR;
+
+    power_freq = ini_valuei(ini, "ain", "power_freq", AIN_POWER_FREQ_DEFAULT);
+    if(f_error(f)) return E_IO_ERROR;
+
+    return ain_set_rate(sample_freq, power_freq);
+}
+
 static err_t conf_ini_read_ains(ini_t* ini, FIL* f)
 {
     ain_channel_type_t type;
@@ -302,6 +333,46 @@ static err_t conf_ini_read_douts(ini_t* ini, FIL* f)
     return E_NO_ERROR;
 }
 
+static err_t conf_ini_read_arena(ini_t* ini, FIL* f)
+{
+    err_t err;
+    int osc_samples;
+    int trend_samples;
+
+    osc_samples = ini_valuei(ini, "osc", "samples", OSCS_SAMPLES);
+    if(f_error(f)) return E_IO_ERROR;
+
+    trend_samples = ini_valuei(ini, "trend", "samples", CONF_ARENA_REST);
+    if(f_error(f)) return E_IO_ERROR;
+
+    if(osc_samples < 0) return E_INVALID_VALUE;
+    if(trend_samples < 0 && trend_samples != CONF_ARENA_REST) return E_INVALID_VALUE;
+
+    // Проверка бюджета общей памяти.
+    if((size_t)osc_samples > arena_size()) return E_OUT_OF_MEMORY;
+    if(trend_samples == CONF_ARENA_REST) trend_samples = arena_size() - osc_samples;
+    if((size_t)trend_samples > arena_size() - osc_samples) return E_OUT_OF_MEMORY;
+
+    arena_reset();
+
+    // Без памяти запись осциллограмм или трендов запрещается
+    // при чтении их секций.
+    conf.oscs_mem = osc_samples != 0;
+    conf.trends_mem = trend_samples != 0;
+
+    if(conf.oscs_mem){
+        err = oscs_set_samples(osc_samples);
+        if(err != E_NO_ERROR) return err;
+    }
+
+    if(conf.trends_mem){
+        err = trends_set_samples(trend_samples);
+        if(err != E_NO_ERROR) return err;
+    }
+
+    return E_NO_ERROR;
+}
+
 static err_t conf_ini_read_oscs(ini_t* ini, FIL* f)
 {
     err_t err;
@@ -310,8 +381,22 @@ static err_t conf_ini_read_oscs(ini_t* ini, FIL* f)
     osc_src_type_t src_type;
     size_t src_channel;
     size_t rate;
+    size_t ch_rate;
+    osc_decim_t decim;
+    size_t slots;
+    iq15_t slot_time;
+    bool packed;
+    osc_layout_t layout;
+    bool cff;
+    comtrade_dat_type_t dat_type;
     bool enabled;
 
+    // Без памяти буферы не создать, осциллограммы не пишутся.
+    if(!conf.oscs_mem){
+        oscs_set_enabled(false);
+        return E_NO_ERROR;
+    }
+
     osc_t* osc = oscs_get_osc();
     size_t osc_channels = osc_channels_count(osc);
 
@@ -336,16 +421,58 @@ static err_t conf_ini_read_oscs(ini_t* ini, FIL* f)
         enabled = ini_valuei(ini, osc_sect, "enabled", 0);
         if(f_error(f)) return E_IO_ERROR;
 
+        ch_rate = ini_valuei(ini, osc_sect, "rate", 1);
+        if(f_error(f)) return E_IO_ERROR;
+
+        decim = ini_valuei(ini, osc_sect, "decim", OSC_DECIM_AVG);
+        if(f_error(f)) return E_IO_ERROR;
+
         osc_channel_init(osc, i, src, type, src_type, src_channel);
         osc_channel_set_enabled(osc, i, enabled);
+
+        err = osc_channel_set_rate(osc, i, ch_rate);
+        if(err != E_NO_ERROR) return err;
+
+        err = osc_channel_set_decim(osc, i, decim);
+        if(err != E_NO_ERROR) return err;
     }
 
     rate = ini_valuei(ini, "osc", "rate", 1);
     if(f_error(f)) return E_IO_ERROR;
 
+    slots = ini_valuei(ini, "osc", "slots", OSCS_BUFFERS);
+    if(f_error(f)) return E_IO_ERROR;
+
+    slot_time = ini_valuef(ini, "osc", "slot_time", 0);
+    if(f_error(f)) return E_IO_ERROR;
+
+    packed = ini_valuei(ini, "osc", "compress", 0);
+    if(f_error(f)) return E_IO_ERROR;
+
+    layout = ini_valuei(ini, "osc", "layout", OSC_LAYOUT_CHANNELS);
+    if(f_error(f)) return E_IO_ERROR;
+
+    err = osc_set_buffers_count(osc, slots);
+    if(err != E_NO_ERROR) return err;
+
+    osc_set_buffer_time(osc, slot_time);
+    osc_set_packed(osc, packed);
+    osc_set_layout(osc, layout);
+
     err = osc_init_channels(osc, rate);
     if(err != E_NO_ERROR) return err;
 
+    cff = ini_valuei(ini, "osc", "cff", 0);
+    if(f_error(f)) return E_IO_ERROR;
+
+    dat_type = ini_valuei(ini, "osc", "dat", COMTRADE_DAT_BINARY);
+    if(f_error(f)) return E_IO_ERROR;
+
+    oscs_set_cff(cff);
+
+    err = oscs_set_dat_type(dat_type);
+    if(err != E_NO_ERROR) return err;
+
     enabled = ini_valuei(ini, "osc", "enabled", 0);
     if(f_error(f)) return E_IO_ERROR;
 
@@ -362,11 +489,22 @@ static err_t conf_ini_read_trends(ini_t* ini, FIL* f)
     osc_src_type_t src_type;
     size_t src_channel;
     size_t rate;
+    size_t ch_rate;
+    osc_decim_t decim;
     size_t limit;
+    size_t sync_period;
     size_t outdate;
     size_t cleanup;
+    bool cff;
+    comtrade_dat_type_t dat_type;
     bool enabled;
 
+    // Без памяти буферы не создать, тренды не пишутся.
+    if(!conf.trends_mem){
+        trends_set_enabled(false);
+        return E_NO_ERROR;
+    }
+
     osc_t* osc = trends_get_osc();
     size_t osc_channels = osc_channels_count(osc);
 
@@ -391,8 +529,20 @@ static err_t conf_ini_read_trends(ini_t* ini, FIL* f)
         enabled = ini_valuei(ini, osc_sect, "enabled", 0);
         if(f_error(f)) return E_IO_ERROR;
 
+        ch_rate = ini_valuei(ini, osc_sect, "rate", 1);
+        if(f_error(f)) return E_IO_ERROR;
+
+        decim = ini_valuei(ini, osc_sect, "decim", OSC_DECIM_AVG);
+        if(f_error(f)) return E_IO_ERROR;
+
         osc_channel_init(osc, i, src, type, src_type, src_channel);
         osc_channel_set_enabled(osc, i, enabled);
+
+        err = osc_channel_set_rate(osc, i, ch_rate);
+        if(err != E_NO_ERROR) return err;
+
+        err = osc_channel_set_decim(osc, i, decim);
+        if(err != E_NO_ERROR) return err;
     }
 
     rate = ini_valuei(ini, "trend", "rate", 1);
@@ -404,12 +554,26 @@ static err_t conf_ini_read_trends(ini_t* ini, FIL* f)
     limit = ini_valuei(ini, "trend", "limit", 0);
     trends_set_limit(limit);
 
+    sync_period = ini_valuei(ini, "trend", "sync", 0);
+    trends_set_sync_period(sync_period);
+
     outdate = ini_valuei(ini, "trend", "outdate", 0);
     trends_set_outdate(outdate);
 
     cleanup = ini_valuei(ini, "trend", "cleanup", 60);
     trends_set_outdate_interval(cleanup);
 
+    cff = ini_valuei(ini, "trend", "cff", 0);
+    if(f_error(f)) return E_IO_ERROR;
+
+    dat_type = ini_valuei(ini, "trend", "dat", COMTRADE_DAT_BINARY);
+    if(f_error(f)) return E_IO_ERROR;
+
+    trends_set_cff(cff);
+
+    err = trends_set_dat_type(dat_type);
+    if(err != E_NO_ERROR) return err;
+
     enabled = ini_valuei(ini, "trend", "enabled", 0);
     if(f_error(f)) return E_IO_ERROR;
 
@@ -493,6 +657,9 @@ static err_t conf_read_ini_impl(FIL* f)
     err = conf_ini_read_logger(&conf.ini, f);
     if(err != E_NO_ERROR) return err;
 
+    err = conf_ini_read_ain(&conf.ini, f);
+    if(err != E_NO_ERROR) return err;
+
     err = conf_ini_read_ains(&conf.ini, f);
     if(err != E_NO_ERROR) return err;
 
@@ -502,6 +669,9 @@ static err_t conf_read_ini_impl(FIL* f)
     err = conf_ini_read_douts(&conf.ini, f);
     if(err != E_NO_ERROR) return err;
 
+    err = conf_ini_read_arena(&conf.ini, f);
+    if(err != E_NO_ERROR) return err;
+
     err = conf_ini_read_oscs(&conf.ini, f);
     if(err != E_NO_ERROR) return err;
 
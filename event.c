@@ -28,6 +28,13 @@
 //! Буфер записи.
 static char evbuf[EVENT_WRITE_BUF_SIZE];
 
+//! Размер буфера записи данных COMTRADE.
+#define EVENT_DAT_BUF_SIZE (COMTRADE_DAT_SECTOR_SIZE)
+//! Буфер записи данных COMTRADE.
+static uint8_t evdatbuf[EVENT_DAT_BUF_SIZE];
+//! Таблица связей кластеров файла данных COMTRADE.
+static DWORD evclmt[COMTRADE_DAT_CLMT_SIZE];
+
 /*
  * Данные CSV.
  */
@@ -50,6 +57,18 @@ static const char* csv_evdelim = ";";
 #define EVENT_CTRD_DEV_ID ""
 //! Год стандарта.
 #define EVENT_CTRD_YEAR 1999
+//! Размер идентификатора канала.
+#define EVENT_CTRD_CH_ID_LEN 32
+
+//! Данные семпла осциллограммы для записи COMTRADE.
+typedef struct _Event_Ctrd_Sample {
+    size_t buf; //!< Буфер.
+    size_t sample; //!< Номер прочитанного семпла.
+    osc_value_t analog[OSCS_CHANNELS]; //!< Значения аналоговых каналов.
+    uint32_t digital; //!< Упакованные значения цифровых каналов.
+    char ch_id[EVENT_CTRD_CH_ID_LEN]; //!< Идентификатор канала.
+    event_t* event; //!< Событие.
+} event_ctrd_sample_t;
 
 
 /*
@@ -240,17 +259,18 @@ static err_t event_csv_write_oscs_chs_datas(FIL* f, osc_t* osc, size_t buf)
 
     size_t max_samples = osc_buffer_samples_count(osc, buf);
 
+    struct timeval start_tv;
+    struct timeval offset_tv;
     struct timeval time_tv;
-    struct timeval period_tv;
 
-    osc_buffer_start_time(osc, buf, &time_tv);
-    osc_sample_period(osc, &period_tv);
+    osc_buffer_start_time(osc, buf, &start_tv);
 
     for(i = 0; i < max_samples; i ++){
+        osc_samples_time(osc, i, &offset_tv);
+        timeradd(&start_tv, &offset_tv, &time_tv);
+
         err = event_csv_write_oscs_chs_data(f, i, &time_tv, osc, buf);
         if(err != E_NO_ERROR) return err;
-
-        timeradd(&time_tv, &period_tv, &time_tv);
     }
 
     return E_NO_ERROR;
@@ -318,7 +338,7 @@ static err_t event_csv_write_file(FIL* f, struct tm* ev_tm, event_t* event, osc_
                                      csv_evdelim, trig_name);
     if(f_error(f)) return E_IO_ERROR;
 
-    f_printf(f, "Freq%s%u\n", csv_evdelim, AIN_SAMPLE_FREQ);
+    f_printf(f, "Freq%s%u\n", csv_evdelim, ain_sample_freq());
     if(f_error(f)) return E_IO_ERROR;
 
     f_printf(f, "Rate%s%u\n", csv_evdelim, osc_rate(osc));
@@ -366,6 +386,30 @@ static err_t event_csv_write(FIL* filevar, event_t* event)
     return err;
 }
 
+/**
+ * Получает идентификатор канала COMTRADE -
+ * имя канала с типом прореживания.
+ * Идентификатор с прореживанием собирается в общем буфере
+ * семпла и действителен до следующего вызова.
+ * @param comtrade Комтрейд.
+ * @param n Номер канала.
+ * @return Идентификатор канала.
+ */
+static const char* comtrade_channel_id(comtrade_t* comtrade, size_t n)
+{
+    osc_t* osc = (osc_t*)comtrade->osc_data;
+    event_ctrd_sample_t* smp = (event_ctrd_sample_t*)comtrade->user_data;
+
+    const char* name = osc_channel_name(osc, n);
+    const char* decim = osc_decim_name(osc_channel_decim(osc, n));
+
+    if(decim == NULL) return name;
+
+    snprintf(smp->ch_id, EVENT_CTRD_CH_ID_LEN, "%s_%s", name ? name : "", decim);
+
+    return smp->ch_id;
+}
+
 /**
  * Получает данные об аналоговом канале.
  * @param index Индекс аналогового канала.
@@ -378,7 +422,7 @@ static void comtrade_get_analog_channel(comtrade_t* comtrade, size_t index, comt
     size_t ch_index = osc_analog_channel_index(osc, index);
     if(ch_index == OSC_INDEX_INVALID) return;
 
-    channel->ch_id = osc_channel_name(osc, ch_index);
+    channel->ch_id = comtrade_channel_id(comtrade, ch_index);
     channel->ph = NULL;
     channel->ccbm = NULL;
     channel->uu = osc_channel_unit(osc, ch_index);
@@ -404,7 +448,7 @@ static void comtrade_get_digital_channel(comtrade_t* comtrade, size_t index, com
     size_t ch_index = osc_digital_channel_index(osc, index);
     if(ch_index == OSC_INDEX_INVALID) return;
 
-    channel->ch_id = osc_channel_name(osc, ch_index);
+    channel->ch_id = comtrade_channel_id(comtrade, ch_index);
     channel->ph = NULL;
     channel->ccbm = NULL;
     channel->y = false;
@@ -418,14 +462,37 @@ static void comtrade_get_digital_channel(comtrade_t* comtrade, size_t index, com
 static void comtrade_get_sample_rate(comtrade_t* comtrade, size_t index, comtrade_sample_rate_t* rate)
 {
     osc_t* osc = (osc_t*)comtrade->osc_data;
-    size_t buf = (size_t)comtrade->user_data;
+    event_ctrd_sample_t* smp = (event_ctrd_sample_t*)comtrade->user_data;
+    size_t buf = smp->buf;
 
     (void) index;
 
-    rate->samp = IQ15(AIN_SAMPLE_FREQ) / osc_rate(osc);
+    rate->samp = osc_sample_freq(osc);
     rate->endsamp = osc_buffer_samples_count(osc, buf);
 }
 
+/**
+ * Получает данные семпла осциллограммы.
+ * Значения всех каналов семпла читаются
+ * однократно при смене номера семпла.
+ * @param sample Номер семпла.
+ * @return Данные семпла, либо NULL.
+ */
+static event_ctrd_sample_t* comtrade_get_sample(comtrade_t* comtrade, size_t sample)
+{
+    osc_t* osc = (osc_t*)comtrade->osc_data;
+    event_ctrd_sample_t* smp = (event_ctrd_sample_t*)comtrade->user_data;
+
+    if(smp->buf == OSC_INDEX_INVALID) return NULL;
+
+    if(smp->sample != sample){
+        osc_buffer_sample_values(osc, smp->buf, sample, smp->analog, &smp->digital);
+        smp->sample = sample;
+    }
+
+    return smp;
+}
+
 /**
  * Получает значение аналогового канала.
  * @param index Индекс канала.
@@ -435,21 +502,37 @@ static void comtrade_get_sample_rate(comtrade_t* comtrade, size_t index, comtrad
 static int16_t comtrade_get_analog_channel_value(comtrade_t* comtrade, size_t index, size_t sample)
 {
     osc_t* osc = (osc_t*)comtrade->osc_data;
-    size_t buf = (size_t)comtrade->user_data;
 
-    if(buf == OSC_INDEX_INVALID) return COMTRADE_UNKNOWN_VALUE;
+    event_ctrd_sample_t* smp = comtrade_get_sample(comtrade, sample);
+    if(smp == NULL) return COMTRADE_UNKNOWN_VALUE;
 
-    size_t ch_index = osc_analog_channel_index(osc, index);
-    if(ch_index == OSC_INDEX_INVALID) return COMTRADE_UNKNOWN_VALUE;
+    if(index >= osc_analog_channels(osc)) return COMTRADE_UNKNOWN_VALUE;
 
-    osc_value_t value = osc_buffer_channel_value(osc, buf, ch_index,
-                            osc_buffer_sample_number_index(osc, buf, sample));
+    osc_value_t value = smp->analog[index];
 
     if(value == COMTRADE_UNKNOWN_VALUE) value = COMTRADE_DAT_MIN;
 
     return value;
 }
 
+/**
+ * Получает значение аналогового канала в единицах измерения канала.
+ * @param index Индекс канала.
+ * @param sample Номер семпла канала.
+ * @return Значение канала.
+ */
+static iq15_t comtrade_get_analog_channel_real_value(comtrade_t* comtrade, size_t index, size_t sample)
+{
+    osc_t* osc = (osc_t*)comtrade->osc_data;
+
+    size_t ch_index = osc_analog_channel_index(osc, index);
+    if(ch_index == OSC_INDEX_INVALID) return 0;
+
+    osc_value_t value = comtrade_get_analog_channel_value(comtrade, index, sample);
+
+    return iq15_mull(value, osc_channel_scale(osc, ch_index));
+}
+
 /**
  * Получает значение цифрового канала.
  * @param index Индекс канала.
@@ -459,17 +542,13 @@ static int16_t comtrade_get_analog_channel_value(comtrade_t* comtrade, size_t in
 static bool comtrade_get_digital_channel_value(comtrade_t* comtrade, size_t index, size_t sample)
 {
     osc_t* osc = (osc_t*)comtrade->osc_data;
-    size_t buf = (size_t)comtrade->user_data;
 
-    if(buf == OSC_INDEX_INVALID) return COMTRADE_UNKNOWN_VALUE;
+    event_ctrd_sample_t* smp = comtrade_get_sample(comtrade, sample);
+    if(smp == NULL) return COMTRADE_UNKNOWN_VALUE;
 
-    size_t ch_index = osc_digital_channel_index(osc, index);
-    if(ch_index == OSC_INDEX_INVALID) return COMTRADE_UNKNOWN_VALUE;
-
-    osc_value_t value = osc_buffer_channel_value(osc, buf, ch_index,
-                            osc_buffer_sample_number_index(osc, buf, sample));
+    if(index >= osc_digital_channels(osc) || index >= OSC_SAMPLE_DIGITAL_BITS) return COMTRADE_UNKNOWN_VALUE;
 
-    return value != 0;
+    return (smp->digital >> index) & 0x1;
 }
 
 /**
@@ -501,7 +580,138 @@ static err_t event_ctrd_write_cfg(FIL* filevar, event_t* event, comtrade_t* comt
     return err;
 }
 
-static err_t event_ctrd_write_dat(FIL* filevar, event_t* event, comtrade_t* comtrade)
+/**
+ * Записывает гистограмму времени обработки.
+ * @param f Файл.
+ * @param name Имя гистограммы.
+ * @param hist Гистограмма.
+ * @return Код ошибки.
+ */
+static err_t event_hdr_write_hist(FIL* f, const char* name, const uint32_t* hist)
+{
+    f_printf(f, "%s:", name);
+    if(f_error(f)) return E_IO_ERROR;
+
+    size_t i;
+    for(i = 0; i < AIN_STATS_HIST_SIZE; i ++){
+        f_printf(f, " %lu", (unsigned long)hist[i]);
+        if(f_error(f)) return E_IO_ERROR;
+    }
+
+    f_puts("\r\n", f);
+    if(f_error(f)) return E_IO_ERROR;
+
+    return E_NO_ERROR;
+}
+
+/**
+ * Записывает объединённые в событие срабатывания триггеров.
+ * @param f Файл.
+ * @param event Событие.
+ * @return Код ошибки.
+ */
+static err_t event_hdr_write_trigs(FIL* f, event_t* event)
+{
+    f_printf(f, "Triggers: %lu\r\n", (unsigned long)event->trigs_total);
+    if(f_error(f)) return E_IO_ERROR;
+
+    const event_trig_t* trig = NULL;
+    const char* trig_name = NULL;
+
+    size_t i;
+    for(i = 0; i < event->trigs_count; i ++){
+        trig = &event->trigs[i];
+
+        trig_name = trig_channel_name(trig->trig);
+        if(trig_name == NULL) trig_name = "";
+
+        f_printf(f, "Trigger %u: +%lu.%06lu s, %u, %s\r\n", (unsigned int)i,
+                    (unsigned long)(trig->offset / 1000000), (unsigned long)(trig->offset % 1000000),
+                    (unsigned int)trig->trig, trig_name);
+        if(f_error(f)) return E_IO_ERROR;
+    }
+
+    return E_NO_ERROR;
+}
+
+/**
+ * Записывает срабатывания триггеров и статистику
+ * обработки данных АЦП в заголовок COMTRADE.
+ * @param f Файл.
+ * @param event Событие.
+ * @return Код ошибки.
+ */
+static err_t event_hdr_write(FIL* f, event_t* event)
+{
+    err_t err = E_NO_ERROR;
+
+    err = event_hdr_write_trigs(f, event);
+
+    ain_stats_t stats;
+    ain_stats(&stats);
+
+    if(err == E_NO_ERROR){
+        f_printf(f, "Sample freq: %lu\r\n"
+                    "ADC frames: %lu\r\n"
+                    "Samples: %lu\r\n"
+                    "Dropped frames: %lu\r\n"
+                    "Queue max: %lu/%lu\r\n"
+                    "Frame time max, us: %lu\r\n"
+                    "Sample time max, us: %lu\r\n"
+                    "Latency max, us: %lu\r\n",
+                    (unsigned long)ain_sample_freq(),
+                    (unsigned long)stats.frames,
+                    (unsigned long)stats.samples,
+                    (unsigned long)stats.dropped_frames,
+                    (unsigned long)stats.queue_max, (unsigned long)stats.queue_size,
+                    (unsigned long)stats.frame_time_max,
+                    (unsigned long)stats.sample_time_max,
+                    (unsigned long)stats.latency_max);
+        if(f_error(f)) err = E_IO_ERROR;
+    }
+
+    if(err == E_NO_ERROR){
+        f_printf(f, "Frames time, ms: %lu\r\n"
+                    "Calc time, ms: %lu\r\n"
+                    "Oscs time, ms: %lu\r\n"
+                    "Trends time, ms: %lu\r\n"
+                    "Checksum: %08lX\r\n"
+                    "Active channels: %lu\r\n"
+                    "Put cycles per frame: %lu, max %lu\r\n"
+                    "Calc cycles per sample: %lu, max %lu\r\n"
+                    "Oscs cycles per sample: %lu\r\n"
+                    "Trends cycles per sample: %lu\r\n",
+                    (unsigned long)(stats.frames_time / 1000),
+                    (unsigned long)(stats.calc_time / 1000),
+                    (unsigned long)(stats.oscs_time / 1000),
+                    (unsigned long)(stats.trends_time / 1000),
+                    (unsigned long)stats.checksum,
+                    (unsigned long)stats.active_channels,
+                    (unsigned long)(stats.put_cycles / (stats.frames ? stats.frames : 1)),
+                    (unsigned long)stats.put_cycles_max,
+                    (unsigned long)(stats.calc_cycles / (stats.samples ? stats.samples : 1)),
+                    (unsigned long)stats.calc_cycles_max,
+                    (unsigned long)(stats.oscs_cycles / (stats.samples ? stats.samples : 1)),
+                    (unsigned long)(stats.trends_cycles / (stats.samples ? stats.samples : 1)));
+        if(f_error(f)) err = E_IO_ERROR;
+    }
+
+    if(err == E_NO_ERROR){
+        err = event_hdr_write_hist(f, "Frame time hist, log2 us", stats.frame_time_hist);
+    }
+    if(err == E_NO_ERROR){
+        err = event_hdr_write_hist(f, "Sample time hist, log2 us", stats.sample_time_hist);
+    }
+
+    return err;
+}
+
+/**
+ * Записывает файл заголовка COMTRADE.
+ * @param event Событие.
+ * @return Код ошибки.
+ */
+static err_t event_ctrd_write_hdr(FIL* filevar, event_t* event)
 {
     err_t err = E_NO_ERROR;
     FRESULT fr = FR_OK;
@@ -511,24 +721,129 @@ static err_t event_ctrd_write_dat(FIL* filevar, event_t* event, comtrade_t* comt
 
     if(ev_tm == NULL) return E_INVALID_VALUE;
 
-    snprintf(evbuf, EVENT_WRITE_BUF_SIZE, "event_%02d.%02d.%04d_%02d-%02d-%02d.dat",
+    snprintf(evbuf, EVENT_WRITE_BUF_SIZE, "event_%02d.%02d.%04d_%02d-%02d-%02d.hdr",
             ev_tm->tm_mday, ev_tm->tm_mon + 1, ev_tm->tm_year + 1900,
             ev_tm->tm_hour, ev_tm->tm_min, ev_tm->tm_sec);
 
     fr = f_open(f, evbuf, FA_WRITE | FA_CREATE_ALWAYS);
     if(fr != FR_OK) return E_IO_ERROR;
 
+    err = event_hdr_write(f, event);
+
+    f_close(f);
+
+    return err;
+}
+
+/**
+ * Записывает секцию HDR файла CFF.
+ * @param comtrade Комтрейд.
+ * @param f Файл.
+ * @return Код ошибки.
+ */
+static err_t comtrade_write_hdr(comtrade_t* comtrade, FIL* f)
+{
+    event_ctrd_sample_t* smp = (event_ctrd_sample_t*)comtrade->user_data;
+
+    return event_hdr_write(f, smp->event);
+}
+
+/**
+ * Записывает данные осциллограммы, размещённой записями COMTRADE,
+ * непосредственно из буфера.
+ * @param f Файл.
+ * @param comtrade Структура COMTRADE.
+ * @param osc Осциллограмма.
+ * @param buf Буфер осциллограммы.
+ * @return Код ошибки.
+ */
+static err_t event_ctrd_write_dat_records(FIL* f, comtrade_t* comtrade, osc_t* osc, size_t buf)
+{
+    err_t err = E_NO_ERROR;
+
+    if(osc_record_size(osc) * sizeof(osc_value_t) != comtrade_dat_record_size(comtrade)) return E_INVALID_VALUE;
+
+    osc_span_t spans[OSC_SPANS_MAX];
+    size_t spans_count = 0;
+
+    err = osc_buffer_records(osc, buf, spans, &spans_count);
+    if(err != E_NO_ERROR) return err;
+
+    size_t i;
+    for(i = 0; i < spans_count; i ++){
+        err = comtrade_append_dat_records(f, comtrade, spans[i].data, spans[i].count);
+        if(err != E_NO_ERROR) return err;
+    }
+
+    return E_NO_ERROR;
+}
+
+/**
+ * Записывает DAT файл COMTRADE,
+ * либо файл CFF целиком.
+ * @param event Событие.
+ * @param comtrade Структура COMTRADE.
+ * @return Код ошибки.
+ */
+static err_t event_ctrd_write_dat(FIL* filevar, event_t* event, comtrade_t* comtrade)
+{
+    err_t err = E_NO_ERROR;
+    FRESULT fr = FR_OK;
+    FIL* f = filevar;
+
+    struct tm* ev_tm = localtime(&event->time.tv_sec);
+
+    if(ev_tm == NULL) return E_INVALID_VALUE;
+
+    snprintf(evbuf, EVENT_WRITE_BUF_SIZE, "event_%02d.%02d.%04d_%02d-%02d-%02d.%s",
+            ev_tm->tm_mday, ev_tm->tm_mon + 1, ev_tm->tm_year + 1900,
+            ev_tm->tm_hour, ev_tm->tm_min, ev_tm->tm_sec,
+            comtrade->cff ? "cff" : "dat");
+
+    fr = f_open(f, evbuf, FA_WRITE | FA_CREATE_ALWAYS);
+    if(fr != FR_OK) return E_IO_ERROR;
+
     osc_t* osc = (osc_t*)comtrade->osc_data;
-    size_t buf = osc_current_buffer(osc);
+    event_ctrd_sample_t* smp = (event_ctrd_sample_t*)comtrade->user_data;
+    size_t buf = smp->buf;
 
     size_t samples_count = osc_buffer_samples_count(osc, buf);
-    size_t nsample;
-    for(nsample = 0; nsample < samples_count; nsample ++){
-        err = comtrade_append_dat(f, comtrade, nsample, nsample);
-        if(err != E_NO_ERROR) break;
+
+    // Размер файла известен заранее,
+    // без непрерывного места файл пишется как обычно.
+    err = comtrade_dat_reserve(f, comtrade, samples_count, evclmt);
+    if(err == E_IO_ERROR){
+        f_close(f);
+        return err;
     }
+    err = E_NO_ERROR;
 
-    f_close(f);
+    // Файл CFF содержит конфигурацию и заголовок перед данными.
+    if(comtrade->cff){
+        err = comtrade_write_cff_head(f, comtrade, samples_count);
+    }
+
+    if(err == E_NO_ERROR){
+        // Записи COMTRADE в памяти имеют 16 битные значения.
+        if(osc_layout(osc) == OSC_LAYOUT_RECORDS && comtrade->dat_type == COMTRADE_DAT_BINARY){
+            err = event_ctrd_write_dat_records(f, comtrade, osc, buf);
+        }else{
+            // Повторная запись читает семплы заново.
+            smp->sample = OSC_INDEX_INVALID;
+
+            err = comtrade_append_dat_samples(f, comtrade, evdatbuf, EVENT_DAT_BUF_SIZE,
+                                              0, 0, samples_count);
+        }
+    }
+
+    // Освободим неиспользованное зарезервированное место.
+    if(err == E_NO_ERROR){
+        fr = f_truncate(f);
+        if(fr != FR_OK) err = E_IO_ERROR;
+    }
+
+    fr = f_close(f);
+    if(err == E_NO_ERROR && fr != FR_OK) err = E_IO_ERROR;
 
     return err;
 }
@@ -546,11 +861,17 @@ err_t event_ctrd_write(FIL* filevar, event_t* event)
     osc_t* osc = oscs_get_osc();
     size_t buf = osc_current_buffer(osc);
 
+    event_ctrd_sample_t smp;
+    smp.buf = buf;
+    smp.sample = OSC_INDEX_INVALID;
+    smp.digital = 0;
+    smp.event = event;
+
     struct timeval time_tv;
-    struct timeval period_tv;
 
     osc_buffer_start_time(osc, buf, &time_tv);
-    osc_sample_period(osc, &period_tv);
+
+    uint64_t period_ns = osc_sample_period_ns(osc);
 
     comtrade.station_name = logger_station_name();
     comtrade.rec_dev_id = logger_dev_id();
@@ -558,7 +879,7 @@ err_t event_ctrd_write(FIL* filevar, event_t* event)
     comtrade.get_analog_channel = comtrade_get_analog_channel;
     comtrade.digital_channels = osc_digital_channels(osc);
     comtrade.get_digital_channel = comtrade_get_digital_channel;
-    comtrade.lf = IQ15(AIN_POWER_FREQ);
+    comtrade.lf = IQ15((int32_t)ain_power_freq());
     comtrade.nrates = 1;
     comtrade.get_sample_rate = comtrade_get_sample_rate;
 
@@ -568,19 +889,33 @@ err_t event_ctrd_write(FIL* filevar, event_t* event)
     comtrade.data_time.tv_sec = time_tv.tv_sec;
     comtrade.data_time.tv_usec = time_tv.tv_usec;
 
-    comtrade.timemult = period_tv.tv_sec * 1000000 + period_tv.tv_usec;
+    comtrade.timemult = (uint32_t)(period_ns / 1000);
+    comtrade.timemult_frac = (uint32_t)(period_ns % 1000);
 
     //comtrade.get_sample_timestamp = NULL;
     comtrade.get_analog_channel_value = comtrade_get_analog_channel_value;
     comtrade.get_digital_channel_value = comtrade_get_digital_channel_value;
+    comtrade.get_analog_channel_real_value = comtrade_get_analog_channel_real_value;
+    comtrade.write_hdr = comtrade_write_hdr;
+    comtrade.dat_type = oscs_dat_type();
+    comtrade.cff = oscs_cff();
 
     comtrade.osc_data = osc;
-    comtrade.user_data = (void*)buf;
+    comtrade.user_data = (void*)&smp;
 
     err = E_NO_ERROR;
 
     int retry = 0;
 
+    // Единый файл CFF.
+    if(comtrade.cff){
+        for(retry = 0; retry < EVENT_WRITE_RETRIES; retry ++){
+            err = event_ctrd_write_dat(filevar, event, &comtrade);
+            if(err == E_NO_ERROR) break;
+        }
+        return err;
+    }
+
     for(retry = 0; retry < EVENT_WRITE_RETRIES; retry ++){
         err = event_ctrd_write_cfg(filevar, event, &comtrade);
         if(err == E_NO_ERROR) break;
@@ -593,6 +928,12 @@ err_t event_ctrd_write(FIL* filevar, event_t* event)
     }
     if(err != E_NO_ERROR) return err;
 
+    for(retry = 0; retry < EVENT_WRITE_RETRIES; retry ++){
+        err = event_ctrd_write_hdr(filevar, event);
+        if(err == E_NO_ERROR) break;
+    }
+    if(err != E_NO_ERROR) return err;
+
     return E_NO_ERROR;
 }
 
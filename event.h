@@ -13,10 +13,23 @@
 #include "fatfs/ff.h"
 
 
+//! Максимальное число срабатываний триггеров в событии.
+#define EVENT_TRIGS_MAX 8
+
+//! Срабатывание триггера в событии.
+typedef struct _Event_Trig {
+    uint32_t offset; //!< Время от начала события, мкс.
+    size_t trig; //!< Номер триггера.
+} event_trig_t;
+
 //! Структура события.
 typedef struct _Event {
     struct timeval time; //!< Время события.
     size_t trig; //!< Номер триггера.
+    uint64_t frame; //!< Номер кадра АЦП события.
+    event_trig_t trigs[EVENT_TRIGS_MAX]; //!< Срабатывания, первое - само событие.
+    size_t trigs_count; //!< Число сохранённых срабатываний.
+    size_t trigs_total; //!< Общее число объединённых срабатываний.
 } event_t;
 
 /**
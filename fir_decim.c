@@ -0,0 +1,120 @@
+#include "fir_decim.h"
+#include "defs/defs.h"
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include <arm_math.h>
+//! Использовать двойное 16-битное умножение-накопление.
+#define FIR_DECIM_USE_SMLAD 1
+#else
+//! Использовать свёртку со сложенными симметричными коэффициентами.
+#define FIR_DECIM_USE_SMLAD 0
+#endif
+
+
+
+err_t fir_decim_init(fir_decim_t* fir, const q15_t* coefs, q15_t* data, size_t size)
+{
+    if(fir == NULL) return E_NULL_POINTER;
+    if(coefs == NULL) return E_NULL_POINTER;
+    if(data == NULL) return E_NULL_POINTER;
+    if(size == 0) return E_INVALID_VALUE;
+
+    fir->coefs = coefs;
+    fir->data = data;
+    fir->size = size;
+
+    fir_decim_reset(fir);
+
+    return E_NO_ERROR;
+}
+
+void fir_decim_reset(fir_decim_t* fir)
+{
+    fir->index = 0;
+
+    memset(fir->data, 0x0, FIR_DECIM_DATA_SIZE(fir->size) * sizeof(q15_t));
+}
+
+void fir_decim_put(fir_decim_t* fir, const q15_t* data, size_t count)
+{
+    q15_t* fir_data = fir->data;
+    size_t size = fir->size;
+    size_t index = fir->index;
+
+    while(count --){
+        q15_t value = *data ++;
+
+        fir_data[index] = value;
+        fir_data[index + size] = value;
+
+        if(++ index >= size) index = 0;
+    }
+
+    fir->index = index;
+}
+
+#if FIR_DECIM_USE_SMLAD == 1
+
+/**
+ * Читает пару соседних 16-битных значений.
+ * @param ptr Указатель на первое значение.
+ * @return Упакованная пара.
+ */
+ALWAYS_INLINE static uint32_t fir_decim_read_q15x2(const q15_t* ptr)
+{
+    uint32_t res;
+
+    memcpy(&res, ptr, sizeof(uint32_t));
+
+    return res;
+}
+
+q15_t fir_decim_calc(fir_decim_t* fir)
+{
+    // Окно от самого старого отсчёта к самому новому.
+    const q15_t* x = &fir->data[fir->index];
+    const q15_t* c = fir->coefs;
+    size_t size = fir->size;
+
+    int32_t acc = 0;
+
+    size_t i;
+    for(i = 0; i + 1 < size; i += 2){
+        acc = (int32_t)__SMLAD(fir_decim_read_q15x2(&x[i]), fir_decim_read_q15x2(&c[i]), (uint32_t)acc);
+    }
+    if(i < size){
+        acc += (int32_t)x[i] * c[i];
+    }
+
+    return iq15_sat(acc >> Q15_FRACT_BITS);
+}
+
+#else
+
+q15_t fir_decim_calc(fir_decim_t* fir)
+{
+    // Окно от самого старого отсчёта к самому новому.
+    const q15_t* x = &fir->data[fir->index];
+    const q15_t* c = fir->coefs;
+    size_t size = fir->size;
+    size_t half = size / 2;
+    size_t last = size - 1;
+
+    int32_t acc = 0;
+
+    // Симметричные пары отсчётов
+    // умножаются на общий коэффициент.
+    size_t i;
+    for(i = 0; i < half; i ++){
+        acc += (int32_t)c[i] * ((int32_t)x[i] + (int32_t)x[last - i]);
+    }
+    // Средний коэффициент фильтра нечётного порядка.
+    if(size & 0x1){
+        acc += (int32_t)c[half] * x[half];
+    }
+
+    return iq15_sat(acc >> Q15_FRACT_BITS);
+}
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * @file fir_decim.h Децимирующий КИХ-фильтр с симметричными коэффициентами.
+ */
+
+#ifndef FIR_DECIM_H_
+#define FIR_DECIM_H_
+
+#include "errors/errors.h"
+#include "q15/q15.h"
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Размер линии задержки для заданного числа коэффициентов.
+ * Каждый отсчёт хранится дважды, чтобы окно фильтра
+ * всегда было непрерывным и не требовало проверки границ.
+ */
+#define FIR_DECIM_DATA_SIZE(N) ((N) * 2)
+
+
+/**
+ * Тип децимирующего КИХ-фильтра.
+ * Линия задержки только накапливает отсчёты,
+ * свёртка вычисляется лишь для сохраняемых
+ * после децимации отсчётов.
+ */
+typedef struct _Fir_Decim {
+    const q15_t* coefs; //!< Коэффициенты.
+    q15_t* data; //!< Линия задержки размером FIR_DECIM_DATA_SIZE(size).
+    size_t size; //!< Число коэффициентов.
+    size_t index; //!< Индекс записи очередного отсчёта.
+} fir_decim_t;
+
+
+/**
+ * Инициализирует фильтр.
+ * Коэффициенты должны быть симметричными,
+ * сумма их модулей не должна превышать 65535.
+ * @param fir Фильтр.
+ * @param coefs Коэффициенты.
+ * @param data Линия задержки размером FIR_DECIM_DATA_SIZE(size).
+ * @param size Число коэффициентов.
+ * @return Код ошибки.
+ */
+extern err_t fir_decim_init(fir_decim_t* fir, const q15_t* coefs, q15_t* data, size_t size);
+
+/**
+ * Сбрасывает фильтр.
+ * @param fir Фильтр.
+ */
+extern void fir_decim_reset(fir_decim_t* fir);
+
+/**
+ * Помещает отсчёты в линию задержки.
+ * @param fir Фильтр.
+ * @param data Отсчёты.
+ * @param count Число отсчётов.
+ */
+extern void fir_decim_put(fir_decim_t* fir, const q15_t* data, size_t count);
+
+/**
+ * Вычисляет выходное значение фильтра
+ * по последним помещённым отсчётам.
+ * Результат совпадает с поотсчётной свёрткой
+ * с накоплением в 32 бита и одним сдвигом в конце.
+ * @param fir Фильтр.
+ * @return Значение.
+ */
+extern q15_t fir_decim_calc(fir_decim_t* fir);
+
+#endif /* FIR_DECIM_H_ */
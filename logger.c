@@ -14,6 +14,7 @@
 #include "storage.h"
 #include "oscs.h"
 #include "trends.h"
+#include "arena.h"
 #include "utils/utils.h"
 #include <stdio.h>
 #include <time.h>
@@ -83,13 +84,17 @@ typedef struct _Logger {
     char dev_id[LOGGER_DEV_ID_BUF_SIZE]; //!< Идентификатор устройства.
     logger_state_t state; //!< Состояние.
     q15_t osc_time_ratio; //!< Доля осциллограммы после события.
+    q15_t osc_time_ratio_max; //!< Предельная доля осциллограммы после события при продлении.
     // Конфиг.
     future_t conf_future; //!< Будущее.
     TickType_t conf_last_read; //!< Последнее чтение.
     logger_init_state_t init_state; //!< Состояние чтения.
     // Событие.
     bool has_event; //!< Защёлка цифрового выхода.
-    event_t event; //!< Событие.
+    event_t event; //!< Записываемое событие.
+    event_t events[OSCS_BUFFERS_MAX]; //!< Очередь событий, по одному на буфер осциллограмм.
+    size_t events_head; //!< Индекс первого события в очереди.
+    size_t events_count; //!< Число событий в очереди.
     TickType_t osc_wait_time; //!< Время ожидания осциллограммы.
     future_t event_future; //!< Будущее.
     TickType_t event_last_write; //!< Последняя запись.
@@ -97,6 +102,9 @@ typedef struct _Logger {
     // Останов.
     future_t halt_future; //!< Будущее.
     logger_halt_state_t halt_state; //!< Состояние останова.
+    // Статистика.
+    TickType_t stats_period; //!< Период вывода статистики.
+    TickType_t stats_last_print; //!< Последний вывод статистики.
 } logger_t;
 
 //! Логгер.
@@ -197,13 +205,127 @@ static void logger_update_douts(void)
     dout_set_type_state(DOUT_EVENT, st_event);
 }
 
+static void logger_events_reset(void)
+{
+    logger.events_head = 0;
+    logger.events_count = 0;
+}
+
+static void logger_events_pop(void)
+{
+    if(logger.events_count == 0) return;
+
+    logger.events_head ++;
+    if(logger.events_head >= OSCS_BUFFERS_MAX) logger.events_head = 0;
+
+    logger.events_count --;
+}
+
+static event_t* logger_events_last(void)
+{
+    size_t i = logger.events_head + logger.events_count - 1;
+    if(i >= OSCS_BUFFERS_MAX) i -= OSCS_BUFFERS_MAX;
+
+    return &logger.events[i];
+}
+
+static bool logger_retrig_enabled(void)
+{
+    return logger.osc_time_ratio_max > logger.osc_time_ratio;
+}
+
+static iq15_t logger_osc_time_after(void)
+{
+    return iq15_mull(oscs_time(), logger.osc_time_ratio);
+}
+
+static iq15_t logger_osc_time_after_max(void)
+{
+    return iq15_mull(oscs_time(), logger.osc_time_ratio_max);
+}
+
+static size_t logger_activated_trig(void)
+{
+    size_t trig_index = 0;
+
+    size_t i;
+    for(i = 0; i < TRIG_COUNT_MAX; i ++){
+        if(trig_channel_activated(i)) trig_index = i;
+    }
+
+    return trig_index;
+}
+
+static void logger_event_add_trig(event_t* event, uint64_t frame, size_t trig_index)
+{
+    event->trigs_total ++;
+
+    if(event->trigs_count >= EVENT_TRIGS_MAX) return;
+
+    event_trig_t* trig = &event->trigs[event->trigs_count ++];
+
+    trig->offset = (uint32_t)(ain_frame_time_us(frame) - ain_frame_time_us(event->frame));
+    trig->trig = trig_index;
+}
+
+static void logger_events_push(uint64_t frame)
+{
+    size_t trig_index;
+    iq15_t time_after;
+    event_t* event;
+
+    if(!oscs_enabled()) return;
+
+    trig_index = logger_activated_trig();
+    time_after = logger_osc_time_after();
+
+    // Срабатывание во время записи после предыдущего
+    // срабатывания продлевает запись и объединяется с ним.
+    if(logger_retrig_enabled() && logger.events_count != 0 &&
+            oscs_extend(time_after, logger_osc_time_after_max())){
+        logger_event_add_trig(logger_events_last(), frame, trig_index);
+        return;
+    }
+
+    // Займём буфер осциллограммы,
+    // предыстория события уже в нём.
+    if(oscs_capture(time_after) != E_NO_ERROR) return;
+
+    logger.events_count ++;
+
+    event = logger_events_last();
+
+    ain_frame_time(frame, &event->time);
+    event->trig = trig_index;
+    event->frame = frame;
+    event->trigs_count = 0;
+    event->trigs_total = 0;
+
+    logger_event_add_trig(event, frame, trig_index);
+}
+
+static void logger_events_extend(void)
+{
+    if(!oscs_enabled()) return;
+    if(!logger_retrig_enabled()) return;
+    if(logger.events_count == 0) return;
+
+    // Запись продлевается, пока триггеры активны.
+    oscs_extend(logger_osc_time_after(), logger_osc_time_after_max());
+}
+
 static void logger_check_trigs(void)
 {
-	if(trig_check(LOGGER_ITER_DELAY_F)){
-		if(logger.state == LOGGER_STATE_RUN){
-		    logger.has_event = true;
-		    logger_go_event();
-		}
+	bool activated = trig_check(LOGGER_ITER_DELAY_F);
+
+	if(logger.state != LOGGER_STATE_RUN && logger.state != LOGGER_STATE_EVENT) return;
+
+	if(activated){
+	    // Срабатывание по значениям последнего семпла.
+	    logger.has_event = true;
+	    logger_events_push(ain_sample_frame());
+	}else if(trig_active()){
+	    logger_events_extend();
 	}
 }
 
@@ -227,6 +349,9 @@ static void logger_state_noinit(void)
 	    //!< Сброс защёлки.
 	    logger.has_event = false;
 
+	    // Сброс очереди событий.
+	    logger_events_reset();
+
         // Примонтировать ФС.
         rootfs_mount(0);
 
@@ -268,6 +393,12 @@ static void logger_state_noinit(void)
 
                 printf("success!\r\n");
 
+                printf("arena oscs=%lu trends=%lu free=%lu/%lu\r\n",
+                       (unsigned long)oscs_samples(),
+                       (unsigned long)trends_samples(),
+                       (unsigned long)arena_avail(),
+                       (unsigned long)arena_size());
+
                 logger.conf_last_read = 0;
 
                 ain_set_enabled(true);
@@ -277,6 +408,13 @@ static void logger_state_noinit(void)
             }else{
                 printf("fail!\r\n");
 
+                // Не хватило общей памяти семплов.
+                if(err == E_OUT_OF_MEMORY){
+                    printf("out of memory, arena used=%lu/%lu\r\n",
+                           (unsigned long)arena_used(),
+                           (unsigned long)arena_size());
+                }
+
                 // Ошибка доступа к SD-карте.
                 if(err == E_IO_ERROR){
                     // Задержка попыток чтения.
@@ -324,41 +462,34 @@ static void logger_state_noinit(void)
 
 static void logger_state_run(void)
 {
+    // Запишем события в порядке срабатывания,
+    // как только завершится запись их осциллограмм.
+    if(logger.events_count != 0){
+        logger_go_event();
+    }
 }
 
 static void logger_state_event(void)
 {
-    size_t i;
     err_t err;
-    size_t trig_index;
-    iq15_t time_after;
 
     switch(logger.event_state){
     case LOGGER_EVENT_BEGIN:
 
-        if(!oscs_enabled()){
+        if(logger.events_count == 0){
             logger.event_state = LOGGER_EVENT_DONE;
             break;
         }
 
-        trig_index = 0;
-        for(i = 0; i < TRIG_COUNT_MAX; i ++){
-            if(trig_channel_activated(i)) trig_index = i;
-        }
-
-        gettimeofday(&logger.event.time, NULL);
-        logger.event.trig = trig_index;
-
-        time_after = oscs_time();
-        time_after = iq15_mull(time_after, logger.osc_time_ratio);
-
-        oscs_pause(time_after);
-
         logger.event_state = LOGGER_EVENT_WAIT_OSC;
         break;
 
     case LOGGER_EVENT_WAIT_OSC:
         if(oscs_paused()){
+            // Запись осциллограммы завершена - повторные срабатывания
+            // больше не объединяются с событием, копия полная.
+            logger.event = logger.events[logger.events_head];
+
             logger.event_state = LOGGER_EVENT_BEGIN_WRITE;
         }
         break;
@@ -386,6 +517,8 @@ static void logger_state_event(void)
 
                 oscs_resume();
 
+                logger_events_pop();
+
                 logger.event_last_write = 0;
 
                 logger.event_state = LOGGER_EVENT_DONE;
@@ -497,6 +630,45 @@ static void logger_process_state(void)
 	}
 }
 
+static void logger_print_stats(void)
+{
+    if(logger.stats_period == 0) return;
+
+    TickType_t cur_ticks = xTaskGetTickCount();
+
+    if((cur_ticks - logger.stats_last_print) < logger.stats_period) return;
+
+    logger.stats_last_print = cur_ticks;
+
+    ain_stats_t stats;
+    ain_stats(&stats);
+
+    uint32_t frames = (stats.frames != 0) ? stats.frames : 1;
+    uint32_t samples = (stats.samples != 0) ? stats.samples : 1;
+
+    // Строка вида "ключ=значение" для разбора на ПК.
+    printf("ain_stats channels=%lu frames=%lu samples=%lu dropped=%lu queue=%lu/%lu"
+           " frame_us_max=%lu sample_us_max=%lu latency_us_max=%lu"
+           " put_cyc=%lu put_cyc_max=%lu calc_cyc=%lu calc_cyc_max=%lu"
+           " oscs_cyc=%lu trends_cyc=%lu checksum=%08lx\r\n",
+           (unsigned long)stats.active_channels,
+           (unsigned long)stats.frames, (unsigned long)stats.samples,
+           (unsigned long)stats.dropped_frames,
+           (unsigned long)stats.queue_max, (unsigned long)stats.queue_size,
+           (unsigned long)stats.frame_time_max, (unsigned long)stats.sample_time_max,
+           (unsigned long)stats.latency_max,
+           (unsigned long)(stats.put_cycles / frames), (unsigned long)stats.put_cycles_max,
+           (unsigned long)(stats.calc_cycles / samples), (unsigned long)stats.calc_cycles_max,
+           (unsigned long)(stats.oscs_cycles / samples),
+           (unsigned long)(stats.trends_cycles / samples),
+           (unsigned long)stats.checksum);
+
+    printf("oscs_stats slots=%lu queued=%lu dropped=%lu\r\n",
+           (unsigned long)oscs_buffers_count(),
+           (unsigned long)logger.events_count,
+           (unsigned long)oscs_dropped());
+}
+
 static void logger_process_cmd(logger_cmd_t* cmd)
 {
 }
@@ -512,6 +684,7 @@ static void logger_task_proc(void* arg)
     	logger_check_trigs();
     	logger_process_state();
     	logger_update_douts();
+    	logger_print_stats();
 
     	if(xQueueReceive(logger.queue_handle, &cmd, LOGGER_ITER_DELAY) == pdTRUE){
     		logger_process_cmd(&cmd);
@@ -529,6 +702,16 @@ void logger_set_osc_time_ratio(q15_t time)
     logger.osc_time_ratio = time;
 }
 
+void logger_set_osc_time_ratio_max(q15_t time)
+{
+    logger.osc_time_ratio_max = time;
+}
+
+void logger_set_stats_period(uint32_t period)
+{
+    logger.stats_period = pdMS_TO_TICKS(period * 1000);
+}
+
 err_t logger_set_station_name(const char* name)
 {
     if(name == NULL) return E_NULL_POINTER;
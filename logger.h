@@ -47,6 +47,20 @@ extern logger_state_t logger_state(void);
  */
 extern void logger_set_osc_time_ratio(q15_t time);
 
+/**
+ * Устанавливает предельную долю времени осциллограммы после события
+ * при продлении записи активными и повторными срабатываниями триггеров.
+ * Продление запрещено, если доля не больше доли после события.
+ * @param time Предельная доля времени осциллограммы после события.
+ */
+extern void logger_set_osc_time_ratio_max(q15_t time);
+
+/**
+ * Устанавливает период вывода статистики обработки данных АЦП.
+ * @param period Период, с, 0 - не выводить.
+ */
+extern void logger_set_stats_period(uint32_t period);
+
 /**
  * Устанавливает имя станции.
  * @param name Имя станции.
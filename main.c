@@ -97,8 +97,30 @@ static struct timeval rtc_hires_tv = {0};
 #define ADC12_DMA_TRANSFERS (ADC12_SAMPLES_COUNT * sizeof(uint16_t) / sizeof(uint32_t))
 // Число передач ПДП АЦП3.
 #define ADC3_DMA_TRANSFERS (ADC3_SAMPLES_COUNT * sizeof(uint16_t) / sizeof(uint16_t))
+// Блочная обработка данных АЦП
+// (прерывания половины и конца буфера ПДП).
+#define ADC_BLOCK_MODE 1
+#if ADC_BLOCK_MODE == 1
+// Число кадров в буфере.
+#define ADC_BUFFER_FRAMES (AIN_ADC_BLOCKS * AIN_ADC_BLOCK_FRAMES)
+// Буфер данных АЦП1 и АЦП2.
+static uint16_t adc12_buffer[ADC_BUFFER_FRAMES][ADC12_SAMPLES_COUNT] __attribute__((aligned(4)));
+// Буфер данных АЦП3.
+static uint16_t adc3_buffer[ADC_BUFFER_FRAMES][ADC3_SAMPLES_COUNT];
+// Адрес буфера ПДП АЦП1 и АЦП2.
+#define ADC12_DMA_BUFFER (&adc12_buffer[0][0])
+// Адрес буфера ПДП АЦП3.
+#define ADC3_DMA_BUFFER (&adc3_buffer[0][0])
+#else
+// Число кадров в буфере.
+#define ADC_BUFFER_FRAMES 1
 // Буфер данных.
-static uint16_t adc_buffer[ADC_SAMPLES_COUNT];
+static uint16_t adc_buffer[ADC_SAMPLES_COUNT] __attribute__((aligned(4)));
+// Адрес буфера ПДП АЦП1 и АЦП2.
+#define ADC12_DMA_BUFFER (&adc_buffer[0])
+// Адрес буфера ПДП АЦП3.
+#define ADC3_DMA_BUFFER (&adc_buffer[ADC12_SAMPLES_COUNT])
+#endif
 // Калибровочные данные.
 static uint16_t adc_cal[ADC_SAMPLES_COUNT];
 // Канал DMA АЦП1 и АЦП2.
@@ -210,6 +232,28 @@ void DMA1_Channel5_IRQHandler(void)
 }
 
 // Прерывание ADC DMA.
+#if ADC_BLOCK_MODE == 1
+void DMA1_Channel1_IRQHandler(void)
+{
+    BaseType_t pxHigherPriorityTaskWoken = pdFALSE;
+
+    // Заполнена первая половина буфера.
+    if(DMA1->ISR & DMA_ISR_HTIF1){
+        DMA1->IFCR = DMA_IFCR_CHTIF1;
+
+        ain_process_adc_block_isr(0, &pxHigherPriorityTaskWoken);
+    }
+
+    // Заполнена вторая половина буфера.
+    if(DMA1->ISR & DMA_ISR_TCIF1){
+        DMA1->IFCR = DMA_IFCR_CTCIF1;
+
+        ain_process_adc_block_isr(1, &pxHigherPriorityTaskWoken);
+    }
+
+    portYIELD_FROM_ISR(pxHigherPriorityTaskWoken);
+}
+#else
 void DMA1_Channel1_IRQHandler(void)
 {
     if(DMA1->ISR & DMA_ISR_TCIF1){
@@ -225,6 +269,7 @@ void DMA1_Channel1_IRQHandler(void)
         }
     }
 }
+#endif
 
 void RTC_IRQHandler(void)
 {
@@ -244,6 +289,15 @@ static void init_hires_timer(void)
     hires_timer_start();
 }
 
+static void init_dwt(void)
+{
+    // Разрешение трассировки.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    // Сброс и включение счётчика тактов.
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
 /*
  * Функции обратного вызова.
  */
@@ -473,6 +527,16 @@ static suseconds_t rtc_get_usec(void)
 static void rtc_on_second(void)
 {
     hires_timer_value(&rtc_hires_tv);
+
+    // Номер кадра, записываемого ПДП АЦП.
+    size_t dma_frame = 0;
+
+    CRITICAL_ENTER();
+#if ADC_BLOCK_MODE == 1
+    dma_frame = (ADC12_DMA_TRANSFERS * ADC_BUFFER_FRAMES - ADC12_DMA_CH->CNDTR) / ADC12_DMA_TRANSFERS;
+#endif
+    ain_time_anchor_isr(time(NULL), dma_frame, ADC_BUFFER_FRAMES);
+    CRITICAL_EXIT();
 }
 
 void init_rtc(void)
@@ -519,8 +583,11 @@ DWORD get_fattime(void)
     return fattime_from_time(&t);
 }
 
-// 12800 Hz.
+// Частота тактирования таймера АЦП.
+#define ADC_TIM_CLK_FREQ 72000000
+// Частота счёта - 2880 кГц.
 #define ADC_TIM_PSC 25
+// 12800 Hz.
 #define ADC_TIM_PERIOD 225
 #define ADC_TIM_COMP_VAL 1
 
@@ -549,22 +616,39 @@ static void init_adc_tim(void)
     ADC_TIM->CR1 |= TIM_CR1_CEN;
 }
 
+/**
+ * Устанавливает частоту запуска АЦП.
+ * @param freq Частота, Гц.
+ */
+static void adc_tim_set_freq(uint32_t freq)
+{
+    if(freq == 0) return;
+
+    // Период.
+    ADC_TIM->ARR = (ADC_TIM_CLK_FREQ / ADC_TIM_PSC) / freq - 1;
+    // Обновление регистров.
+    ADC_TIM->EGR = TIM_EGR_UG;
+}
+
 static void init_adc_dma(void)
 {
     dma_channel_lock(ADC12_DMA_CH);
-    ADC12_DMA_CH->CMAR = (uint32_t)&adc_buffer[0];
+    ADC12_DMA_CH->CMAR = (uint32_t)ADC12_DMA_BUFFER;
     ADC12_DMA_CH->CPAR = (uint32_t)&ADC1->DR;
-    ADC12_DMA_CH->CNDTR = ADC12_DMA_TRANSFERS;
+    ADC12_DMA_CH->CNDTR = ADC12_DMA_TRANSFERS * ADC_BUFFER_FRAMES;
     ADC12_DMA_CH->CCR = DMA_CCR1_PL_1 | DMA_CCR1_MSIZE_1 | DMA_CCR1_PSIZE_1 |
             DMA_CCR1_MINC | DMA_CCR1_CIRC |
+#if ADC_BLOCK_MODE == 1
+            DMA_CCR1_HTIE |
+#endif
             DMA_CCR1_TCIE |
             DMA_CCR1_EN;
 
 
     dma_channel_lock(ADC3_DMA_CH);
-    ADC3_DMA_CH->CMAR = (uint32_t)&adc_buffer[ADC12_SAMPLES_COUNT];
+    ADC3_DMA_CH->CMAR = (uint32_t)ADC3_DMA_BUFFER;
     ADC3_DMA_CH->CPAR = (uint32_t)&ADC3->DR;
-    ADC3_DMA_CH->CNDTR = ADC3_DMA_TRANSFERS;
+    ADC3_DMA_CH->CNDTR = ADC3_DMA_TRANSFERS * ADC_BUFFER_FRAMES;
     ADC3_DMA_CH->CCR = DMA_CCR1_PL_1 | DMA_CCR1_MSIZE_0 | DMA_CCR1_PSIZE_0 |
             DMA_CCR1_MINC | DMA_CCR1_CIRC |
             DMA_CCR1_EN;
@@ -949,6 +1033,20 @@ static void init_rootfs(void)
 static void init_ain(void)
 {
     ain_init();
+
+    ain_set_adc_freq_callback(adc_tim_set_freq);
+
+#if ADC_BLOCK_MODE == 1
+    size_t i;
+    // АЦП1 и АЦП2.
+    for(i = 0; i < ADC12_SAMPLES_COUNT; i ++){
+        ain_channel_set_adc_buffer(i, &adc12_buffer[0][i], ADC12_SAMPLES_COUNT);
+    }
+    // АЦП3.
+    for(i = 0; i < ADC3_SAMPLES_COUNT; i ++){
+        ain_channel_set_adc_buffer(ADC12_SAMPLES_COUNT + i, &adc3_buffer[0][i], ADC3_SAMPLES_COUNT);
+    }
+#endif
 }
 
 static void init_osc(void)
@@ -1098,6 +1196,8 @@ int main(void)
     init_remap();
     init_periph_clock();
 
+    init_dwt();
+
     init_rtc();
     init_usart_buf();
 
@@ -101,9 +101,14 @@ static void osc_buffer_init(osc_buffer_t* buffer, osc_value_t* data, size_t size
     buffer->size = size;
     buffer->index = 0;
     buffer->count = 0;
-    buffer->end_time.tv_sec = 0;
-    buffer->end_time.tv_usec = 0;
+    buffer->end_frame = 0;
+    buffer->rate_index = 0;
     buffer->paused = false;
+    buffer->block_first = 0;
+    buffer->block_count = 0;
+    buffer->block_base = 0;
+    buffer->block_key = 0;
+    buffer->stream_head = 0;
 }
 
 //! Сбрасывает буфер.
@@ -111,9 +116,14 @@ static void osc_buffer_reset(osc_buffer_t* buffer)
 {
     buffer->index = 0;
     buffer->count = 0;
-    buffer->end_time.tv_sec = 0;
-    buffer->end_time.tv_usec = 0;
+    buffer->end_frame = 0;
+    buffer->rate_index = 0;
     buffer->paused = false;
+    buffer->block_first = 0;
+    buffer->block_count = 0;
+    buffer->block_base = 0;
+    buffer->block_key = 0;
+    buffer->stream_head = 0;
 }
 
 //! Инкрементирует индекс семплов буфера.
@@ -148,15 +158,23 @@ ALWAYS_INLINE static osc_value_t* osc_channel_buffer_data(osc_channel_t* channel
 }
 
 
-//! Инициализирует буферы осциллограмм.
-static err_t osc_init_buffers(osc_t* osc)
+/**
+ * Инициализирует буферы осциллограмм.
+ * @param osc Осциллограмма.
+ * @param reserve Размер данных в конце памяти, не отдаваемых буферам.
+ * @return Код ошибки.
+ */
+static err_t osc_init_buffers(osc_t* osc, size_t reserve)
 {
+    if(reserve >= osc->data_size) return E_OUT_OF_MEMORY;
+
     osc_buffer_t* buffer = NULL;
     osc_value_t* data = NULL;
-    size_t buf_size = osc->data_size / osc->buffers_count;
+    size_t data_size = osc->data_size - reserve;
+    size_t buf_size = data_size / osc->buffers_count;
 
     osc_pool_t buf_pool;
-    osc_pool_init(&buf_pool, osc->data, osc->data_size);
+    osc_pool_init(&buf_pool, osc->data, data_size);
 
     size_t i;
     for(i = 0; i < osc->buffers_count; i ++){
@@ -173,6 +191,197 @@ static err_t osc_init_buffers(osc_t* osc)
 
     return E_NO_ERROR;
 }
+/*
+ * Сжатие.
+ * Данные сжатого буфера - таблица смещений блоков размером pack_blocks,
+ * за которой следует кольцо блоков переменного размера (поток).
+ * Блок, не умещающийся до конца потока, пишется в его начало.
+ * При нехватке места вытесняются самые старые блоки
+ * так, чтобы буфер начинался с ключевого блока.
+ */
+//! Получает данные сжатого блока буфера.
+static osc_value_t* osc_pack_buffer_block(osc_t* osc, const osc_buffer_t* buffer, size_t block)
+{
+    size_t slot = buffer->block_first + block;
+
+    if(slot >= osc->pack_blocks) slot -= osc->pack_blocks;
+
+    return &buffer->data[osc->pack_blocks + (uint16_t)buffer->data[slot]];
+}
+
+//! Получает смещение первого блока буфера в потоке.
+ALWAYS_INLINE static size_t osc_pack_buffer_first_offset(const osc_buffer_t* buffer)
+{
+    return (uint16_t)buffer->data[buffer->block_first];
+}
+
+/**
+ * Вытесняет самый старый блок буфера
+ * и следующие за ним блоки до ключевого.
+ * @param osc Осциллограмма.
+ * @param buffer Буфер.
+ */
+static void osc_pack_buffer_evict(osc_t* osc, osc_buffer_t* buffer)
+{
+    do {
+        buffer->count -= osc_pack_block_samples(osc_pack_buffer_block(osc, buffer, 0));
+
+        if(++ buffer->block_first >= osc->pack_blocks) buffer->block_first = 0;
+
+        buffer->block_count --;
+        buffer->block_base ++;
+    } while(buffer->block_count != 0 &&
+            !osc_pack_block_key(osc_pack_buffer_block(osc, buffer, 0)));
+
+    if(buffer->block_count == 0){
+        buffer->block_first = 0;
+        buffer->stream_head = 0;
+    }
+}
+
+/**
+ * Получает смещение в потоке непрерывного
+ * свободного места для блока наибольшего размера.
+ * @param osc Осциллограмма.
+ * @param buffer Буфер.
+ * @return Смещение, либо OSC_INDEX_INVALID при нехватке места.
+ */
+static size_t osc_pack_buffer_space(osc_t* osc, osc_buffer_t* buffer)
+{
+    if(buffer->block_count == 0) return 0;
+    if(buffer->block_count >= osc->pack_blocks) return OSC_INDEX_INVALID;
+
+    size_t words = OSC_PACK_BLOCK_WORDS_MAX(osc->analog_channels, osc->digital_channels);
+    size_t first = osc_pack_buffer_first_offset(buffer);
+    size_t head = buffer->stream_head;
+
+    if(head > first){
+        // Свободно место после последнего блока и до первого.
+        if(osc->pack_stream - head >= words) return head;
+        if(first >= words) return 0;
+    }else{
+        // Кольцо блоков перешло через начало потока.
+        if(first - head >= words) return head;
+    }
+
+    return OSC_INDEX_INVALID;
+}
+
+/**
+ * Сжимает накопленные семплы в блок буфера.
+ * Место резервируется под блок наибольшего размера,
+ * чтобы сжимать данные однократно.
+ * @param osc Осциллограмма.
+ * @param buffer Буфер.
+ */
+static void osc_pack_buffer_put(osc_t* osc, osc_buffer_t* buffer)
+{
+    size_t count = osc->pack_put.count;
+    size_t offset;
+
+    while((offset = osc_pack_buffer_space(osc, buffer)) == OSC_INDEX_INVALID){
+        osc_pack_buffer_evict(osc, buffer);
+    }
+
+    // Распаковка буфера начинается с ключевого блока.
+    bool key = buffer->block_count == 0 || buffer->block_key >= OSC_PACK_KEY_BLOCKS;
+
+    size_t words = osc_pack_encode(&osc->pack, &osc->pack_put,
+                                   &buffer->data[osc->pack_blocks + offset], key);
+
+    size_t slot = buffer->block_first + buffer->block_count;
+    if(slot >= osc->pack_blocks) slot -= osc->pack_blocks;
+
+    buffer->data[slot] = (osc_value_t)offset;
+    buffer->block_count ++;
+    buffer->block_key = key ? 1 : (buffer->block_key + 1);
+    buffer->stream_head = offset + words;
+    buffer->count += count;
+}
+
+//! Добавляет семпл в накапливаемый блок и сжимает заполненный блок.
+ALWAYS_INLINE static void osc_pack_inc_put_index(osc_t* osc, osc_buffer_t* buffer)
+{
+    if(++ osc->pack_put.count >= OSC_PACK_BLOCK_SAMPLES){
+        osc_pack_buffer_put(osc, buffer);
+    }
+}
+
+//! Сжимает неполный накапливаемый блок.
+static void osc_pack_flush(osc_t* osc, osc_buffer_t* buffer)
+{
+    if(osc->pack_put.count != 0){
+        osc_pack_buffer_put(osc, buffer);
+    }
+}
+
+/**
+ * Распаковывает блок буфера.
+ * Последовательное чтение распаковывает по одному блоку,
+ * иначе распаковка начинается с ближайшего ключевого блока.
+ * @param osc Осциллограмма.
+ * @param buffer Буфер.
+ * @param block Номер блока в буфере.
+ * @return Флаг наличия блока.
+ */
+static bool osc_pack_get_block(osc_t* osc, const osc_buffer_t* buffer, size_t block)
+{
+    if(block >= buffer->block_count) return false;
+
+    size_t number = buffer->block_base + block;
+
+    if(osc->pack_get_buffer == buffer){
+        if(osc->pack_get_block == number) return true;
+
+        if(osc->pack_get_block + 1 == number){
+            osc_pack_decode(&osc->pack, &osc->pack_get, osc_pack_buffer_block(osc, buffer, block));
+            osc->pack_get_block = number;
+            return true;
+        }
+    }
+
+    // Первый блок буфера всегда ключевой.
+    size_t first = block;
+    while(first != 0 && !osc_pack_block_key(osc_pack_buffer_block(osc, buffer, first))) first --;
+
+    osc_pack_seq_reset(&osc->pack_get);
+
+    for(; first <= block; first ++){
+        osc_pack_decode(&osc->pack, &osc->pack_get, osc_pack_buffer_block(osc, buffer, first));
+    }
+
+    osc->pack_get_buffer = buffer;
+    osc->pack_get_block = number;
+
+    return true;
+}
+
+/**
+ * Получает данные, содержащие семпл буфера.
+ * Для сжатого буфера - данные распакованного блока,
+ * для размещения записями - запись семпла.
+ * @param osc Осциллограмма.
+ * @param buffer Буфер.
+ * @param index Индекс семпла, заменяется индексом в данных.
+ * @return Данные, либо NULL.
+ */
+static const osc_value_t* osc_buffer_sample_data(osc_t* osc, const osc_buffer_t* buffer, size_t* index)
+{
+    if(osc->layout == OSC_LAYOUT_RECORDS){
+        size_t record = *index;
+        *index = 0;
+        return &buffer->data[record * osc->record_size];
+    }
+
+    if(!osc->packed) return buffer->data;
+
+    if(!osc_pack_get_block(osc, buffer, *index / OSC_PACK_BLOCK_SAMPLES)) return NULL;
+
+    *index %= OSC_PACK_BLOCK_SAMPLES;
+
+    return osc->pack_get.data;
+}
+
 /*
  * Каналы.
  */
@@ -182,15 +391,54 @@ ALWAYS_INLINE static osc_channel_t* osc_channel(osc_t* osc, size_t n)
     return &osc->channels[n];
 }
 
+/**
+ * Получает индекс семпла канала пониженной частоты
+ * по индексу семпла буфера.
+ * Семпл группы записывается по завершении её периода,
+ * поэтому семплы незавершённого периода
+ * получают предыдущий семпл группы.
+ * @param osc Осциллограмма.
+ * @param channel Канал.
+ * @param buffer Буфер.
+ * @param index Индекс семпла буфера, заменяется индексом семпла канала.
+ * @return Флаг наличия семпла канала.
+ */
+ALWAYS_INLINE static bool osc_rate_index(osc_t* osc, const osc_channel_t* channel, const osc_buffer_t* buffer, size_t* index)
+{
+    size_t div = channel->rate;
+
+    if(div == 1) return true;
+
+    size_t span = osc->rates_span;
+
+    // Число семплов от последнего записанного.
+    size_t back = (*index < buffer->index) ? (buffer->index - 1 - *index) :
+                                             (buffer->count + buffer->index - 1 - *index);
+    // Номер последнего семпла и число семплов незавершённого периода.
+    size_t last = (buffer->rate_index + span - 1) % span;
+    size_t done = (last + 1) % div;
+
+    if(back < done){
+        // Периоды групп отсчитываются от начала записи буфера.
+        if(buffer->count < div) return false;
+        back = done;
+    }
+
+    *index = ((last + span - back) % span) / div;
+
+    return true;
+}
+
 err_t osc_init(osc_t* osc, osc_value_t* data, size_t data_size,
                osc_buffer_t* buffers, size_t buffers_count,
-               osc_channel_t* channels, size_t channels_count)
+               osc_channel_t* channels, osc_plan_item_t* plan, size_t channels_count)
 {
     if(data == NULL) return E_NULL_POINTER;
     if(data_size == 0) return E_INVALID_VALUE;
     if(buffers == NULL) return E_NULL_POINTER;
     if(buffers_count == 0) return E_INVALID_VALUE;
     if(channels == NULL) return E_NULL_POINTER;
+    if(plan == NULL) return E_NULL_POINTER;
     if(channels_count == 0) return E_INVALID_VALUE;
 
     err_t err = E_NO_ERROR;
@@ -200,18 +448,44 @@ err_t osc_init(osc_t* osc, osc_value_t* data, size_t data_size,
     osc->data = data;
     osc->data_size = data_size;
     osc->buffers = buffers;
+    osc->buffers_max = buffers_count;
     osc->buffers_count = buffers_count;
     osc->channels = channels;
     osc->channels_count = channels_count;
+    osc->plan = plan;
 
     osc->buffer_mode = OSC_RING_IN_BUFFER;
 
-    err = osc_init_buffers(osc);
+    osc->rates_lcm = 1;
+    osc->rates_span = 1;
+
+    size_t i;
+    for(i = 0; i < channels_count; i ++){
+        osc_channel(osc, i)->rate = 1;
+    }
+
+    err = osc_init_buffers(osc, 0);
     if(err != E_NO_ERROR) return err;
 
     return E_NO_ERROR;
 }
 
+err_t osc_set_data(osc_t* osc, osc_value_t* data, size_t data_size)
+{
+    if(data == NULL) return E_NULL_POINTER;
+    if(data_size == 0) return E_INVALID_VALUE;
+
+    osc->data = data;
+    osc->data_size = data_size;
+
+    return osc_init_buffers(osc, 0);
+}
+
+size_t osc_data_size(osc_t* osc)
+{
+    return osc->data_size;
+}
+
 osc_buffer_mode_t osc_buffer_mode(osc_t* osc)
 {
     return osc->buffer_mode;
@@ -222,49 +496,19 @@ void osc_set_buffer_mode(osc_t* osc, osc_buffer_mode_t mode)
     osc->buffer_mode = mode;
 }
 
-/**
- * Помещает значение в массив данных канала.
- * @param channel Канал.
- * @param value Значение.
- */
-static void osc_channel_put_value_val(osc_channel_t* channel, osc_buffer_t* buffer, osc_value_t value)
+osc_layout_t osc_layout(osc_t* osc)
 {
-    osc_value_t* data = osc_channel_buffer_data(channel, buffer);
-
-	data[buffer->index] = value;
+    return osc->layout;
 }
 
-/**
- * Помещает битовое значение в данные канала.
- * @param channel Канал.
- * @param value Битовое значение.
- */
-static void osc_channel_put_value_bit(osc_channel_t* channel, osc_buffer_t* buffer, osc_value_t value)
+void osc_set_layout(osc_t* osc, osc_layout_t layout)
 {
-	size_t pos = buffer->index / OSC_BITS_PER_SAMPLE;
-	size_t bit = buffer->index % OSC_BITS_PER_SAMPLE;
-
-	osc_value_t* data = osc_channel_buffer_data(channel, buffer);
-
-	if(value){
-		data[pos] |= (1 << bit);
-	}else{
-		data[pos] &= ~(1 << bit);
-	}
+    osc->layout = layout;
 }
 
-/**
- * Помещает значение в канал по типу.
- * @param channel Канал.
- * @param value Значение.
- */
-static void osc_channel_put_value(osc_channel_t* channel, osc_buffer_t* buffer, osc_value_t value)
+size_t osc_record_size(osc_t* osc)
 {
-	if(channel->type == OSC_VAL){
-        osc_channel_put_value_val(channel, buffer, value);
-	}else{// OSC_BIT
-        osc_channel_put_value_bit(channel, buffer, value);
-	}
+    return osc->record_size;
 }
 
 /**
@@ -276,10 +520,12 @@ static void osc_channel_put_value(osc_channel_t* channel, osc_buffer_t* buffer,
 static osc_value_t osc_channel_get_value_val(osc_t* osc, osc_channel_t* channel, osc_buffer_t* buffer, size_t index)
 {
 	if(index >= buffer->count) return 0;
+	if(!osc_rate_index(osc, channel, buffer, &index)) return 0;
 
-	osc_value_t* data = osc_channel_buffer_data(channel, buffer);
+	const osc_value_t* data = osc_buffer_sample_data(osc, buffer, &index);
+	if(data == NULL) return 0;
 
-	return data[index];
+	return data[channel->offset + index];
 }
 
 /**
@@ -291,13 +537,16 @@ static osc_value_t osc_channel_get_value_val(osc_t* osc, osc_channel_t* channel,
 static osc_value_t osc_channel_get_value_bit(osc_t* osc, osc_channel_t* channel, osc_buffer_t* buffer,  size_t index)
 {
     if(index >= buffer->count) return 0;
+    if(!osc_rate_index(osc, channel, buffer, &index)) return 0;
 
-	size_t pos = index / OSC_BITS_PER_SAMPLE;
-	size_t bit = index % OSC_BITS_PER_SAMPLE;
+	const osc_value_t* data = osc_buffer_sample_data(osc, buffer, &index);
+	if(data == NULL) return 0;
 
-	osc_value_t* data = osc_channel_buffer_data(channel, buffer);
+	// В записи семпла бит определяется каналом.
+	size_t pos = index / OSC_BITS_PER_SAMPLE;
+	size_t bit = index % OSC_BITS_PER_SAMPLE + channel->bit;
 
-	return (data[pos] & (1 << bit)) ? 1 : 0;
+	return (data[channel->offset + pos] & (1 << bit)) ? 1 : 0;
 }
 
 /**
@@ -314,124 +563,417 @@ static osc_value_t osc_channel_get_value(osc_t* osc, osc_channel_t* channel, osc
 	return osc_channel_get_value_bit(osc, channel, buffer, index);
 }
 
+/*
+ * Экстремум.
+ */
+//! Сбрасывает экстремум.
+ALWAYS_INLINE static void osc_env_reset(osc_env_t* env)
+{
+    env->value = 0;
+    env->empty = true;
+}
+
+//! Добавляет значение в минимум.
+ALWAYS_INLINE static void osc_env_put_min(osc_env_t* env, osc_value_t value)
+{
+    if(env->empty || value < env->value) env->value = value;
+    env->empty = false;
+}
+
+//! Добавляет значение в максимум.
+ALWAYS_INLINE static void osc_env_put_max(osc_env_t* env, osc_value_t value)
+{
+    if(env->empty || value > env->value) env->value = value;
+    env->empty = false;
+}
+
+//! Получает экстремум и начинает новый интервал.
+ALWAYS_INLINE static osc_value_t osc_env_calc(osc_env_t* env)
+{
+    env->empty = true;
+    return env->value;
+}
+
+/*
+ * План записи каналов.
+ */
+//! Получает значение для отсутствующего источника.
+static osc_value_t osc_plan_get_none(size_t n)
+{
+    (void) n;
+
+    return 0;
+}
+
+//! Получает мгновенное значение цифрового входа.
+static osc_value_t osc_plan_get_din_inst(size_t n)
+{
+    return din_state_inst(n) ? 1 : 0;
+}
+
+//! Получает значение цифрового входа.
+static osc_value_t osc_plan_get_din(size_t n)
+{
+    return din_state(n) ? 1 : 0;
+}
+
 /**
- * Добавляет значение в усреднение канала.
+ * Получает каллбэк значения источника канала.
  * @param channel Канал.
- * @param value Значение.
+ * @return Каллбэк.
  */
-ALWAYS_INLINE static void osc_channel_append_value(osc_channel_t* channel, osc_value_t value)
+static osc_plan_get_value_t osc_plan_channel_get_value(osc_channel_t* channel)
 {
-    if(channel->type == OSC_VAL){
-        avg_put(&channel->avg, value);
-    }else{
-        maj_put(&channel->maj, value);
+    switch(channel->src){
+    case OSC_AIN:
+        return (channel->src_type == OSC_INST) ? ain_value_inst : ain_value;
+    case OSC_DIN:
+        return (channel->src_type == OSC_INST) ? osc_plan_get_din_inst : osc_plan_get_din;
+    default:
+        break;
     }
+    return osc_plan_get_none;
 }
 
 /**
- * Добавляет значение аналогового входа.
+ * Получает вид элемента плана для канала.
  * @param channel Канал.
+ * @param rate Коэффициент деления частоты дискретизации.
+ * @return Вид элемента плана.
  */
-static void osc_channel_append_ain(osc_channel_t* channel)
+static osc_plan_kind_t osc_plan_channel_kind(osc_channel_t* channel, size_t rate)
+{
+    if(channel->type == OSC_BIT){
+        switch(channel->decim){
+        case OSC_DECIM_MIN:
+            return OSC_PLAN_BIT_MIN;
+        case OSC_DECIM_MAX:
+            return OSC_PLAN_BIT_MAX;
+        default:
+            break;
+        }
+        return OSC_PLAN_BIT;
+    }
+
+    // Прореживание единственного значения не изменяет его.
+    // Канал вне АЦП читается через ain_value_inst() и равен нулю.
+    if(rate == 1 && channel->src == OSC_AIN && channel->src_type == OSC_INST &&
+       channel->src_channel < AIN_CHANNELS_COUNT){
+        return OSC_PLAN_VAL_DIRECT;
+    }
+
+    switch(channel->decim){
+    case OSC_DECIM_MIN:
+        return OSC_PLAN_VAL_MIN;
+    case OSC_DECIM_MAX:
+        return OSC_PLAN_VAL_MAX;
+    default:
+        break;
+    }
+
+    return OSC_PLAN_VAL_AVG;
+}
+
+/**
+ * Составляет план записи разрешённых каналов группы,
+ * сгруппированный по видам элементов.
+ * @param osc Осциллограмма.
+ * @param rate Коэффициент деления частоты дискретизации.
+ * @param div Делитель частоты семплов группы.
+ * @param plan_index Начала элементов плана группы каждого вида.
+ * @param count Число элементов плана предыдущих групп.
+ * @return Число элементов плана с учётом группы.
+ */
+static size_t osc_plan_build_group(osc_t* osc, size_t rate, size_t div, size_t* plan_index, size_t count)
 {
-	q15_t q = 0;
-	osc_value_t value = 0;
+    osc_channel_t* channel = NULL;
+    osc_plan_item_t* item = NULL;
+    size_t kind, i;
+
+    for(kind = 0; kind < OSC_PLAN_KINDS; kind ++){
+        plan_index[kind] = count;
+
+        for(i = 0; i < osc->channels_count; i ++){
+            channel = osc_channel(osc, i);
+
+            if(!channel->enabled) continue;
+            if(channel->offset == OSC_INDEX_INVALID) continue;
+            if(channel->rate != div) continue;
+            if(osc_plan_channel_kind(channel, rate * div) != kind) continue;
+
+            item = &osc->plan[count ++];
+
+            item->channel = channel;
+            if(kind == OSC_PLAN_VAL_DIRECT){
+                item->value = ain_value_inst_ptr(channel->src_channel);
+            }else{
+                item->get_value = osc_plan_channel_get_value(channel);
+            }
+            item->src_channel = channel->src_channel;
+            item->offset = channel->offset;
+            item->mask = (osc_value_t)(1 << channel->bit);
+        }
+    }
+    plan_index[OSC_PLAN_KINDS] = count;
 
-	if(channel->src_type == OSC_INST){
-		q = ain_value_inst(channel->src_channel);
-	}else{
-		q = ain_value(channel->src_channel);
-	}
+    return count;
+}
 
-	value = q;
+/**
+ * Составляет план записи разрешённых каналов:
+ * каналы частоты осциллограммы, затем группы пониженной частоты.
+ * @param osc Осциллограмма.
+ * @param rate Коэффициент деления частоты дискретизации.
+ */
+static void osc_plan_build(osc_t* osc, size_t rate)
+{
+    size_t count = osc_plan_build_group(osc, rate, 1, osc->plan_index, 0);
+
+    size_t i;
+    for(i = 0; i < osc->rates_count; i ++){
+        count = osc_plan_build_group(osc, rate, osc->rates[i].div, osc->rates[i].plan_index, count);
+    }
+}
 
-	osc_channel_append_value(channel, value);
+//! Сбрасывает план записи каналов.
+static void osc_plan_reset(osc_t* osc)
+{
+    size_t kind;
+    for(kind = 0; kind <= OSC_PLAN_KINDS; kind ++){
+        osc->plan_index[kind] = 0;
+    }
+    osc->rates_count = 0;
 }
 
 /**
- * Добавляет значение цифрового входа.
- * @param channel Канал.
+ * Добавляет значения источников
+ * в усреднение каналов группы.
+ * @param osc Осциллограмма.
+ * @param plan_index Начала элементов плана группы каждого вида.
  */
-static void osc_channel_append_din(osc_channel_t* channel)
+static void osc_plan_append_group(osc_t* osc, const size_t* plan_index)
 {
-	osc_value_t value = 0;
+    osc_plan_item_t* item = &osc->plan[plan_index[OSC_PLAN_VAL_AVG]];
+    osc_plan_item_t* end = &osc->plan[plan_index[OSC_PLAN_VAL_MIN]];
 
-	if(channel->src_type == OSC_INST){
-	    value = din_state_inst(channel->src_channel);
-    }else{
-        value = din_state(channel->src_channel);
+    for(; item != end; item ++){
+        avg_put(&item->channel->avg, item->get_value(item->src_channel));
+    }
+
+    end = &osc->plan[plan_index[OSC_PLAN_VAL_MAX]];
+
+    for(; item != end; item ++){
+        osc_env_put_min(&item->channel->env, item->get_value(item->src_channel));
+    }
+
+    end = &osc->plan[plan_index[OSC_PLAN_BIT]];
+
+    for(; item != end; item ++){
+        osc_env_put_max(&item->channel->env, item->get_value(item->src_channel));
+    }
+
+    end = &osc->plan[plan_index[OSC_PLAN_BIT_MIN]];
+
+    for(; item != end; item ++){
+        maj_put(&item->channel->maj, item->get_value(item->src_channel));
     }
 
-	osc_channel_append_value(channel, value);
+    end = &osc->plan[plan_index[OSC_PLAN_BIT_MAX]];
+
+    for(; item != end; item ++){
+        osc_env_put_min(&item->channel->env, item->get_value(item->src_channel));
+    }
+
+    end = &osc->plan[plan_index[OSC_PLAN_KINDS]];
+
+    for(; item != end; item ++){
+        osc_env_put_max(&item->channel->env, item->get_value(item->src_channel));
+    }
 }
 
 /**
- * Добавляет данные в канал.
- * @param channel Канал.
- * @return Флаг добавления.
+ * Добавляет значения источников
+ * в усреднение каналов.
+ * @param osc Осциллограмма.
  */
-static bool osc_channel_append(osc_channel_t* channel)
-{
-	if(!channel->enabled) return false;
-	if(channel->offset == OSC_INDEX_INVALID) return false;
-
-	switch(channel->src){
-	case OSC_AIN:
-		osc_channel_append_ain(channel);
-		break;
-	case OSC_DIN:
-		osc_channel_append_din(channel);
-		break;
-	default:
-		return false;
-	}
+static void osc_plan_append(osc_t* osc)
+{
+    osc_plan_append_group(osc, osc->plan_index);
 
-	return true;
+    size_t i;
+    for(i = 0; i < osc->rates_count; i ++){
+        osc_plan_append_group(osc, osc->rates[i].plan_index);
+    }
 }
 
 /**
- * Помещает данные в канал.
- * @param channel Канал.
- * @return Флаг добавления.
+ * Помещает значения каналов группы в данные.
+ * @param osc Осциллограмма.
+ * @param plan_index Начала элементов плана группы каждого вида.
+ * @param data Данные буфера, либо накапливаемого блока.
+ * @param index Индекс семпла.
  */
-static bool osc_channel_put(osc_channel_t* channel, osc_buffer_t* buffer)
+static void osc_plan_put(osc_t* osc, const size_t* plan_index, osc_value_t* data, size_t index)
 {
-    if(!channel->enabled) return false;
-    if(channel->offset == OSC_INDEX_INVALID) return false;
+    osc_plan_item_t* item = &osc->plan[plan_index[OSC_PLAN_VAL_DIRECT]];
+    osc_plan_item_t* end = &osc->plan[plan_index[OSC_PLAN_VAL_AVG]];
 
-    osc_value_t value = 0;
+    for(; item != end; item ++){
+        data[item->offset + index] = *item->value;
+    }
 
-    if(channel->type == OSC_VAL){
-        value = avg_calc(&channel->avg);
-    }else{
-        value = maj_calc(&channel->maj);
+    end = &osc->plan[plan_index[OSC_PLAN_VAL_MIN]];
+
+    for(; item != end; item ++){
+        data[item->offset + index] = avg_calc(&item->channel->avg);
     }
 
-    osc_channel_put_value(channel, buffer, value);
+    end = &osc->plan[plan_index[OSC_PLAN_BIT]];
 
-    return true;
+    for(; item != end; item ++){
+        data[item->offset + index] = osc_env_calc(&item->channel->env);
+    }
+
+    end = &osc->plan[plan_index[OSC_PLAN_KINDS]];
+
+    if(item == end) return;
+
+    // Биты упаковываются по OSC_BITS_PER_SAMPLE семплов.
+    size_t pos = index / OSC_BITS_PER_SAMPLE;
+    osc_value_t mask = (osc_value_t)(1 << (index % OSC_BITS_PER_SAMPLE));
+
+    end = &osc->plan[plan_index[OSC_PLAN_BIT_MIN]];
+
+    for(; item != end; item ++){
+        if(maj_calc(&item->channel->maj)){
+            data[item->offset + pos] |= mask;
+        }else{
+            data[item->offset + pos] &= ~mask;
+        }
+    }
+
+    end = &osc->plan[plan_index[OSC_PLAN_KINDS]];
+
+    for(; item != end; item ++){
+        if(osc_env_calc(&item->channel->env)){
+            data[item->offset + pos] |= mask;
+        }else{
+            data[item->offset + pos] &= ~mask;
+        }
+    }
 }
 
-//! Получает время последнего семпла.
-static void osc_calc_last_sample_time(size_t skew, struct timeval* tv)
+/**
+ * Устанавливает номер и отметку времени записи.
+ * Номер семпла в COMTRADE отсчитывается с единицы,
+ * отметка времени - в периодах семплов.
+ * @param record Запись.
+ * @param sample Номер семпла.
+ */
+ALWAYS_INLINE static void osc_record_set_number(osc_value_t* record, size_t sample)
 {
-    if(!tv) return;
-    // Время между семплами.
-    struct timeval sample_tv = {0, AIN_SAMPLE_PERIOD_US};
-    // Время последнего семпла.
-    struct timeval end_time = {0, 0};
+    uint32_t header[2] = {sample + 1, sample};
+
+    memcpy(record, header, sizeof(header));
+}
+
+/**
+ * Помещает значения каналов в запись семпла буфера.
+ * Записи нумеруются по индексу в кольце буфера.
+ * @param osc Осциллограмма.
+ * @param buffer Буфер.
+ */
+static void osc_plan_put_record(osc_t* osc, osc_buffer_t* buffer)
+{
+    size_t index = buffer->index;
+    osc_value_t* data = &buffer->data[index * osc->record_size];
+    osc_value_t value;
+
+    osc_record_set_number(data, index);
+
+    osc_plan_item_t* item = &osc->plan[osc->plan_index[OSC_PLAN_VAL_DIRECT]];
+    osc_plan_item_t* end = &osc->plan[osc->plan_index[OSC_PLAN_VAL_AVG]];
+
+    for(; item != end; item ++){
+        value = *item->value;
+        if(value < OSC_RECORD_VALUE_MIN) value = OSC_RECORD_VALUE_MIN;
+        data[item->offset] = value;
+    }
+
+    end = &osc->plan[osc->plan_index[OSC_PLAN_VAL_MIN]];
+
+    for(; item != end; item ++){
+        value = avg_calc(&item->channel->avg);
+        if(value < OSC_RECORD_VALUE_MIN) value = OSC_RECORD_VALUE_MIN;
+        data[item->offset] = value;
+    }
+
+    end = &osc->plan[osc->plan_index[OSC_PLAN_BIT]];
+
+    for(; item != end; item ++){
+        value = osc_env_calc(&item->channel->env);
+        if(value < OSC_RECORD_VALUE_MIN) value = OSC_RECORD_VALUE_MIN;
+        data[item->offset] = value;
+    }
+
+    end = &osc->plan[osc->plan_index[OSC_PLAN_KINDS]];
+
+    if(item == end) return;
+
+    // Цифровые каналы упаковываются по словам записи.
+    size_t digital = OSC_RECORD_HEADER_SIZE + osc->analog_channels;
+    memset(&data[digital], 0x0, (osc->record_size - digital) * sizeof(osc_value_t));
+
+    end = &osc->plan[osc->plan_index[OSC_PLAN_BIT_MIN]];
+
+    for(; item != end; item ++){
+        if(maj_calc(&item->channel->maj)){
+            data[item->offset] |= item->mask;
+        }
+    }
+
+    end = &osc->plan[osc->plan_index[OSC_PLAN_KINDS]];
 
-    // Получим текущее время.
-    gettimeofday(&end_time, NULL);
+    for(; item != end; item ++){
+        if(osc_env_calc(&item->channel->env)){
+            data[item->offset] |= item->mask;
+        }
+    }
+}
+
+/**
+ * Помещает значения каналов групп пониженной частоты,
+ * период которых завершается текущим семплом, в буфер.
+ * @param osc Осциллограмма.
+ * @param buffer Буфер.
+ */
+static void osc_rates_put(osc_t* osc, osc_buffer_t* buffer)
+{
+    size_t number = buffer->rate_index;
+    const osc_rate_t* rate = NULL;
 
     size_t i;
-    for(i = 0; i < skew; i ++) {
-        // Вычтем время с последнего семпла.
-        timersub(&end_time, &sample_tv, &end_time);
+    for(i = 0; i < osc->rates_count; i ++){
+        rate = &osc->rates[i];
+
+        if((number + 1) % rate->div != 0) continue;
+
+        osc_plan_put(osc, rate->plan_index, buffer->data, number / rate->div);
     }
 
-    tv->tv_sec = end_time.tv_sec;
-    tv->tv_usec = end_time.tv_usec;
+    if(++ number >= osc->rates_span) number = 0;
+
+    buffer->rate_index = number;
+}
+
+/**
+ * Получает номер кадра АЦП последнего семпла.
+ * @param skew Число семплов АЦП с последнего семпла.
+ * @return Номер кадра АЦП.
+ */
+static uint64_t osc_calc_last_sample_frame(size_t skew)
+{
+    return ain_sample_frame() - (uint64_t)skew * ain_oversample_rate();
 }
 
 ALWAYS_INLINE static void osc_pause_mark_put_buffer(osc_t* osc, osc_buffer_t* buffer)
@@ -443,7 +985,7 @@ ALWAYS_INLINE static void osc_pause_mark_put_buffer(osc_t* osc, osc_buffer_t* bu
 ALWAYS_INLINE static void osc_pause_calc_sample_time(osc_t* osc, osc_buffer_t* buffer, size_t pause_skew)
 {
     // Получим время паузы.
-    osc_calc_last_sample_time(decim_skew(&osc->decim) + pause_skew, &buffer->end_time);
+    buffer->end_frame = osc_calc_last_sample_frame(decim_skew(&osc->decim) + pause_skew);
 }
 
 static void osc_pause_next_put_buffer(osc_t* osc)
@@ -462,6 +1004,8 @@ static void osc_pause_next_put_buffer(osc_t* osc)
 
 static void osc_pause_put_buffer(osc_t* osc, osc_buffer_t* buffer, size_t pause_skew)
 {
+    // Сожмём накопленные семплы.
+    if(osc->packed) osc_pack_flush(osc, buffer);
     // Остановим запись в текущий буфер.
     osc_pause_mark_put_buffer(osc, buffer);
     // Вычислим время последнего записанного семпла.
@@ -553,16 +1097,8 @@ void osc_append(osc_t* osc)
     // Если запись в текущий буфер остановлена - возврат.
     if(buffer->paused) return;
 
-	osc_channel_t* channel = NULL;
-	size_t i;
-
 	// Добавим данные в усреднение каналов.
-	for(i = 0; i < osc->channels_count; i ++){
-
-		channel = osc_channel(osc, i);
-
-		osc_channel_append(channel);
-	}
+	osc_plan_append(osc);
 
 	// Увеличим индекс дециматора.
 	decim_put(&osc->decim, 0);
@@ -570,17 +1106,28 @@ void osc_append(osc_t* osc)
 	// Если пора записывать осциллограмму -
 	// поместим данные в буферы каналов.
 	if(decim_ready(&osc->decim)){
-	    // Добавим данные в усреднение каналов.
-	    for(i = 0; i < osc->channels_count; i ++){
+	    if(osc->layout == OSC_LAYOUT_RECORDS){
+	        // Поместим запись семпла в буфер.
+	        osc_plan_put_record(osc, buffer);
+
+	        // Увеличим индекс.
+	        osc_inc_put_index(osc, buffer);
+	    }else if(osc->packed){
+	        // Поместим значения в накапливаемый блок.
+	        osc_plan_put(osc, osc->plan_index, osc->pack_put.data, osc->pack_put.count);
+
+	        // Сожмём заполненный блок.
+	        osc_pack_inc_put_index(osc, buffer);
+	    }else{
+	        // Поместим значения в буферы данных.
+	        osc_plan_put(osc, osc->plan_index, buffer->data, buffer->index);
 
-	        channel = osc_channel(osc, i);
+	        // Поместим значения групп пониженной частоты.
+	        if(osc->rates_count != 0) osc_rates_put(osc, buffer);
 
-	        // Поместим значение в буфер данных.
-	        osc_channel_put(channel, buffer);
+	        // Увеличим индекс.
+	        osc_inc_put_index(osc, buffer);
 	    }
-
-	    // Увеличим индекс.
-	    osc_inc_put_index(osc, buffer);
 	}
 }
 
@@ -626,10 +1173,21 @@ void osc_reset(osc_t* osc)
     osc->pause_samples = 0;
     osc->pause_counter = 0;
 
+    // Сжатие.
+    osc_pack_seq_reset(&osc->pack_put);
+    osc->pack_get_buffer = NULL;
+
     // Расчётные при инициализации данные.
     osc->enabled_channels = 0;
     osc->analog_channels = 0;
     osc->digital_channels = 0;
+
+    // План записи каналов.
+    osc_plan_reset(osc);
+
+    // Группы каналов пониженной частоты.
+    osc->rates_lcm = 1;
+    osc->rates_span = 1;
 }
 
 iq15_t osc_time(osc_t* osc)
@@ -657,6 +1215,36 @@ size_t osc_buffers_count(osc_t* osc)
     return osc->buffers_count;
 }
 
+err_t osc_set_buffers_count(osc_t* osc, size_t count)
+{
+    if(count == 0) return E_INVALID_VALUE;
+    if(count > osc->buffers_max) return E_OUT_OF_RANGE;
+
+    osc->buffers_count = count;
+
+    return osc_init_buffers(osc, 0);
+}
+
+void osc_set_buffer_time(osc_t* osc, iq15_t time)
+{
+    osc->buf_time = time;
+}
+
+void osc_set_packed(osc_t* osc, bool packed)
+{
+    osc->packed = packed;
+}
+
+bool osc_packed(osc_t* osc)
+{
+    return osc->packed;
+}
+
+size_t osc_current_put_buffer(osc_t* osc)
+{
+    return osc->put_buf_index;
+}
+
 size_t osc_current_buffer(osc_t* osc)
 {
     return osc->get_buf_index;
@@ -716,7 +1304,8 @@ size_t osc_buffer_sample_number_index(osc_t* osc, size_t buf, size_t sample)
 
     if(sample >= buffer->count) return OSC_INDEX_INVALID;
 
-    if(buffer->count < osc->samples) return sample;
+    // Сжатый буфер хранит семплы по порядку.
+    if(osc->packed || buffer->count < osc->samples) return sample;
 
     size_t index = sample + buffer->index;
 
@@ -730,10 +1319,181 @@ osc_value_t osc_buffer_channel_value(osc_t* osc, size_t buf, size_t n, size_t in
     if(buf >= osc->buffers_count) return 0;
     if(n >= osc->channels_count) return 0;
 
-    osc_buffer_t* buffer = osc_buffer(osc, buf);
-    osc_channel_t* channel = osc_channel(osc, n);
+    osc_buffer_t* buffer = osc_buffer(osc, buf);
+    osc_channel_t* channel = osc_channel(osc, n);
+
+    return osc_channel_get_value(osc, channel, buffer, index);
+}
+
+err_t osc_buffer_sample_values(osc_t* osc, size_t buf, size_t sample, osc_value_t* analog, uint32_t* digital)
+{
+    if(buf >= osc->buffers_count) return E_OUT_OF_RANGE;
+    if(analog == NULL && osc->analog_channels != 0) return E_NULL_POINTER;
+    if(digital == NULL) return E_NULL_POINTER;
+
+    osc_buffer_t* buffer = osc_buffer(osc, buf);
+    const osc_plan_item_t* map = osc->plan;
+    size_t analog_count = osc->analog_channels;
+    size_t digital_count = osc->digital_channels;
+
+    if(digital_count > OSC_SAMPLE_DIGITAL_BITS) digital_count = OSC_SAMPLE_DIGITAL_BITS;
+
+    size_t index = osc_buffer_sample_number_index(osc, buf, sample);
+    if(index == OSC_INDEX_INVALID){
+        memset(analog, 0x0, analog_count * sizeof(osc_value_t));
+        *digital = 0;
+        return E_OUT_OF_RANGE;
+    }
+
+    const osc_value_t* data = osc_buffer_sample_data(osc, buffer, &index);
+    if(data == NULL){
+        memset(analog, 0x0, analog_count * sizeof(osc_value_t));
+        *digital = 0;
+        return E_OUT_OF_RANGE;
+    }
+
+    osc_channel_t* channel = NULL;
+    size_t rate_index;
+
+    size_t i;
+    for(i = 0; i < analog_count; i ++){
+        channel = osc_channel(osc, map[i].map_index);
+        if(channel->rate == 1){
+            analog[i] = data[channel->offset + index];
+        }else{
+            // Каналы пониженной частоты хранят свой поток семплов.
+            rate_index = index;
+            analog[i] = osc_rate_index(osc, channel, buffer, &rate_index) ?
+                        data[channel->offset + rate_index] : 0;
+        }
+    }
+
+    // Цифровые каналы хранят бит семпла в одном и том же
+    // слове и разряде, в записи семпла - в разряде канала.
+    size_t pos = index / OSC_BITS_PER_SAMPLE;
+    size_t bit = index % OSC_BITS_PER_SAMPLE;
+    uint32_t bits = 0;
+
+    map += analog_count;
+
+    for(i = 0; i < digital_count; i ++){
+        channel = osc_channel(osc, map[i].map_index);
+        if(channel->rate == 1){
+            if(data[channel->offset + pos] & (1 << (bit + channel->bit))){
+                bits |= ((uint32_t)1 << i);
+            }
+        }else{
+            rate_index = index;
+            if(osc_rate_index(osc, channel, buffer, &rate_index) &&
+               (data[channel->offset + rate_index / OSC_BITS_PER_SAMPLE] & (1 << (rate_index % OSC_BITS_PER_SAMPLE)))){
+                bits |= ((uint32_t)1 << i);
+            }
+        }
+    }
+
+    *digital = bits;
+
+    return E_NO_ERROR;
+}
+
+/**
+ * Заполняет участок данных канала.
+ * @param span Участок.
+ * @param channel Канал.
+ * @param data Данные канала в буфере.
+ * @param index Индекс первого семпла.
+ * @param count Число семплов.
+ */
+static void osc_span_set(osc_span_t* span, osc_channel_t* channel, const osc_value_t* data, size_t index, size_t count)
+{
+    if(channel->type == OSC_VAL){
+        span->data = &data[index];
+        span->bit = 0;
+    }else{
+        span->data = &data[index / OSC_BITS_PER_SAMPLE];
+        span->bit = index % OSC_BITS_PER_SAMPLE;
+    }
+    span->count = count;
+}
+
+err_t osc_buffer_channel_spans(osc_t* osc, size_t buf, size_t n, size_t sample, size_t count,
+                               osc_span_t* spans, size_t* spans_count)
+{
+    if(spans == NULL) return E_NULL_POINTER;
+    if(spans_count == NULL) return E_NULL_POINTER;
+    if(buf >= osc->buffers_count) return E_OUT_OF_RANGE;
+    if(n >= osc->channels_count) return E_OUT_OF_RANGE;
+
+    *spans_count = 0;
+
+    osc_buffer_t* buffer = osc_buffer(osc, buf);
+    osc_channel_t* channel = osc_channel(osc, n);
+
+    if(!channel->enabled || channel->offset == OSC_INDEX_INVALID) return E_STATE;
+    if(osc->packed || osc->layout == OSC_LAYOUT_RECORDS) return E_STATE;
+    if(channel->rate != 1) return E_STATE;
+    if(sample > buffer->count || count > buffer->count - sample) return E_OUT_OF_RANGE;
+    if(count == 0) return E_NO_ERROR;
+
+    const osc_value_t* data = osc_channel_buffer_data(channel, buffer);
+
+    // Индекс первого семпла и число семплов до конца кольца.
+    size_t index = osc_buffer_sample_number_index(osc, buf, sample);
+    size_t tail = buffer->count - index;
+    size_t part = (count < tail) ? count : tail;
+
+    osc_span_set(&spans[0], channel, data, index, part);
+    *spans_count = 1;
+
+    if(part < count){
+        osc_span_set(&spans[1], channel, data, 0, count - part);
+        *spans_count = 2;
+    }
+
+    return E_NO_ERROR;
+}
+
+err_t osc_buffer_records(osc_t* osc, size_t buf, osc_span_t* spans, size_t* spans_count)
+{
+    if(spans == NULL) return E_NULL_POINTER;
+    if(spans_count == NULL) return E_NULL_POINTER;
+    if(buf >= osc->buffers_count) return E_OUT_OF_RANGE;
+
+    *spans_count = 0;
+
+    osc_buffer_t* buffer = osc_buffer(osc, buf);
+
+    if(osc->layout != OSC_LAYOUT_RECORDS) return E_STATE;
+    // Запись в буфер должна быть остановлена.
+    if(!buffer->paused) return E_STATE;
+    if(buffer->count == 0) return E_NO_ERROR;
+
+    size_t record_size = osc->record_size;
+    // Индекс самого старого семпла.
+    size_t first = (buffer->count < osc->samples) ? 0 : buffer->index;
+    size_t part = buffer->count - first;
+
+    // Кольцо перешло через начало - пронумеруем записи заново.
+    if(first != 0){
+        size_t i;
+        for(i = 0; i < buffer->count; i ++){
+            osc_record_set_number(&buffer->data[((i < part) ? (first + i) : (i - part)) * record_size], i);
+        }
+    }
+
+    spans[0].data = &buffer->data[first * record_size];
+    spans[0].count = part;
+    spans[0].bit = 0;
+    *spans_count = 1;
 
-    return osc_channel_get_value(osc, channel, buffer, index);
+    if(first != 0){
+        spans[1].data = buffer->data;
+        spans[1].count = first;
+        spans[1].bit = 0;
+        *spans_count = 2;
+    }
+
+    return E_NO_ERROR;
 }
 
 bool osc_buffer_paused(osc_t* osc, size_t buf)
@@ -754,6 +1514,33 @@ void osc_buffer_resume(osc_t* osc, size_t buf)
     osc_buffer_t* buffer = osc_buffer(osc, buf);
 
     osc_buffer_reset(buffer);
+
+    if(osc->pack_get_buffer == buffer) osc->pack_get_buffer = NULL;
+}
+
+void osc_time_us_to_timeval(uint64_t time, struct timeval* tv)
+{
+    tv->tv_sec = (time_t)(time / 1000000);
+    tv->tv_usec = (suseconds_t)(time % 1000000);
+}
+
+/**
+ * Получает номер кадра АЦП семпла буфера.
+ * @param osc Осциллограмма.
+ * @param buffer Буфер.
+ * @param sample Номер семпла.
+ * @return Номер кадра АЦП.
+ */
+static uint64_t osc_buffer_sample_frame(osc_t* osc, osc_buffer_t* buffer, size_t sample)
+{
+    // Число кадров АЦП на семпл осциллограммы.
+    uint64_t frames = (uint64_t)osc_rate(osc) * ain_oversample_rate();
+
+    // Кадр отсчитывается от последнего семпла буфера.
+    if(sample < buffer->count){
+        return buffer->end_frame - (buffer->count - 1 - sample) * frames;
+    }
+    return buffer->end_frame + (sample + 1 - buffer->count) * frames;
 }
 
 err_t osc_buffer_end_time(osc_t* osc, size_t buf, struct timeval* tv)
@@ -763,8 +1550,7 @@ err_t osc_buffer_end_time(osc_t* osc, size_t buf, struct timeval* tv)
 
     osc_buffer_t* buffer = osc_buffer(osc, buf);
 
-    tv->tv_sec = buffer->end_time.tv_sec;
-    tv->tv_usec = buffer->end_time.tv_usec;
+    ain_frame_time(buffer->end_frame, tv);
 
     return E_NO_ERROR;
 }
@@ -774,73 +1560,64 @@ err_t osc_buffer_start_time(osc_t* osc, size_t buf, struct timeval* tv)
     if(buf >= osc->buffers_count) return E_OUT_OF_RANGE;
     if(!tv) return E_NULL_POINTER;
 
-    err_t err = E_NO_ERROR;
-
-    struct timeval time_tv;
-    err = osc_buffer_end_time(osc, buf, &time_tv);
-    if(err != E_NO_ERROR) return err;
-
-    struct timeval period_tv;
-    err = osc_sample_period(osc, &period_tv);
-    if(err != E_NO_ERROR) return err;
+    osc_buffer_t* buffer = osc_buffer(osc, buf);
 
-    size_t buf_samples = osc_buffer_samples_count(osc, buf);
+    uint64_t frame = buffer->end_frame;
 
-    size_t i;
-    for(i = 1; i < buf_samples; i ++){
-        timersub(&time_tv, &period_tv, &time_tv);
+    if(buffer->count > 1){
+        frame = osc_buffer_sample_frame(osc, buffer, 0);
     }
 
-    tv->tv_sec = time_tv.tv_sec;
-    tv->tv_usec = time_tv.tv_usec;
+    ain_frame_time(frame, tv);
 
     return E_NO_ERROR;
 }
 
-err_t osc_buffer_sample_time(osc_t* osc, size_t buf, size_t sample, struct timeval* tv)
+err_t osc_buffer_sample_time_us(osc_t* osc, size_t buf, size_t sample, uint64_t* time)
 {
     if(buf >= osc->buffers_count) return E_OUT_OF_RANGE;
-    if(!tv) return E_NULL_POINTER;
+    if(!time) return E_NULL_POINTER;
 
-    err_t err = E_NO_ERROR;
+    osc_buffer_t* buffer = osc_buffer(osc, buf);
 
-    struct timeval time_tv;
-    err = osc_buffer_end_time(osc, buf, &time_tv);
-    if(err != E_NO_ERROR) return err;
+    *time = ain_frame_time_us(osc_buffer_sample_frame(osc, buffer, sample));
 
-    struct timeval period_tv;
-    err = osc_sample_period(osc, &period_tv);
-    if(err != E_NO_ERROR) return err;
+    return E_NO_ERROR;
+}
 
-    size_t buf_samples_count = osc_buffer_samples_count(osc, buf);
+err_t osc_buffer_sample_time(osc_t* osc, size_t buf, size_t sample, struct timeval* tv)
+{
+    if(!tv) return E_NULL_POINTER;
 
-    size_t sample_count = sample + 1;
-    size_t i;
+    uint64_t time = 0;
 
-    if(sample_count <= buf_samples_count){
-        for(i = sample_count; i < buf_samples_count; i ++){
-            timersub(&time_tv, &period_tv, &time_tv);
-        }
-    }else{
-        for(i = buf_samples_count; i < sample_count; i ++){
-            timeradd(&time_tv, &period_tv, &time_tv);
-        }
-    }
+    err_t err = osc_buffer_sample_time_us(osc, buf, sample, &time);
+    if(err != E_NO_ERROR) return err;
 
-    tv->tv_sec = time_tv.tv_sec;
-    tv->tv_usec = time_tv.tv_usec;
+    osc_time_us_to_timeval(time, tv);
 
     return E_NO_ERROR;
 }
 
+/**
+ * Вычисляет число семплов АЦП до паузы.
+ * @param time Время.
+ * @return Число семплов.
+ */
+static size_t osc_pause_time_samples(iq15_t time)
+{
+    lq15_t time_samples = iq15_imull(time, (int32_t)ain_sample_freq());
+
+    return (size_t)IQ15_INT(time_samples);
+}
+
 void osc_pause(osc_t* osc, iq15_t time)
 {
     osc_buffer_t* buffer = osc_buffer(osc, osc->put_buf_index);
 
     if(buffer->paused) return;
 
-    lq15_t time_samples = iq15_imull(time, AIN_SAMPLE_FREQ);
-    size_t samples = (size_t)IQ15_INT(time_samples);
+    size_t samples = osc_pause_time_samples(time);
 
     osc->pause_counter = 0;
     osc->pause_samples = samples;
@@ -863,19 +1640,56 @@ bool osc_pause_pending(osc_t* osc)
     return osc->pause_enabled;
 }
 
+bool osc_pause_extend(osc_t* osc, iq15_t time, iq15_t time_max)
+{
+    if(!osc->pause_enabled) return false;
+
+    size_t samples = osc->pause_counter + osc_pause_time_samples(time);
+    size_t samples_max = osc_pause_time_samples(time_max);
+
+    // Начало паузы должно остаться в буфере.
+    size_t buf_samples = osc->samples * decim_scale(&osc->decim);
+    if(samples_max >= buf_samples) samples_max = buf_samples - 1;
+
+    if(samples > samples_max) samples = samples_max;
+
+    // Счётчик сравнивается с числом семплов до паузы
+    // в задаче АЦП, поэтому число семплов только увеличивается.
+    if(samples > osc->pause_samples) osc->pause_samples = samples;
+
+    // Пауза могла завершиться до продления.
+    return osc->pause_enabled;
+}
+
 err_t osc_sample_period(osc_t* osc, struct timeval* tv)
 {
     if(!tv) return E_NULL_POINTER;
 
-    tv->tv_sec = 0;
-    tv->tv_usec = AIN_SAMPLE_PERIOD_US * osc_rate(osc);
+    osc_samples_time(osc, 1, tv);
 
     return E_NO_ERROR;
 }
 
+uint64_t osc_sample_period_ns(osc_t* osc)
+{
+    uint32_t freq = ain_sample_freq();
+
+    return ((uint64_t)osc_rate(osc) * 1000000000 + freq / 2) / freq;
+}
+
+void osc_samples_time(osc_t* osc, size_t samples, struct timeval* tv)
+{
+    ain_samples_time((uint32_t)(samples * osc_rate(osc)), tv);
+}
+
+uint64_t osc_samples_time_us(osc_t* osc, size_t samples)
+{
+    return ain_samples_time_us((uint32_t)(samples * osc_rate(osc)));
+}
+
 iq15_t osc_sample_freq(osc_t* osc)
 {
-    return IQ15F(AIN_SAMPLE_FREQ, osc_rate(osc));
+    return IQ15F((int32_t)ain_sample_freq(), osc_rate(osc));
 }
 
 err_t osc_channel_set_enabled(osc_t* osc, size_t n, bool enabled)
@@ -906,6 +1720,12 @@ err_t osc_channel_reset(osc_t* osc, size_t n)
 
 	channel->enabled = false;
 	channel->offset = OSC_INDEX_INVALID;
+	channel->bit = 0;
+	channel->rate = 1;
+	channel->decim = OSC_DECIM_AVG;
+
+	// План ссылается на каналы и составляется заново.
+	osc_plan_reset(osc);
 
 	if(channel->type == OSC_VAL){
 	    avg_reset(&channel->avg);
@@ -952,6 +1772,79 @@ size_t osc_channel_src_channel(osc_t* osc, size_t n)
     return channel->src_channel;
 }
 
+size_t osc_channel_rate(osc_t* osc, size_t n)
+{
+    if(n >= osc->channels_count) return 1;
+
+    osc_channel_t* channel = osc_channel(osc, n);
+
+    return channel->rate;
+}
+
+err_t osc_channel_set_rate(osc_t* osc, size_t n, size_t rate)
+{
+    if(n >= osc->channels_count) return E_OUT_OF_RANGE;
+    if(rate == 0) return E_INVALID_VALUE;
+
+    osc_channel_t* channel = osc_channel(osc, n);
+
+    channel->rate = rate;
+
+    return E_NO_ERROR;
+}
+
+osc_decim_t osc_channel_decim(osc_t* osc, size_t n)
+{
+    if(n >= osc->channels_count) return OSC_DECIM_AVG;
+
+    osc_channel_t* channel = osc_channel(osc, n);
+
+    return channel->decim;
+}
+
+err_t osc_channel_set_decim(osc_t* osc, size_t n, osc_decim_t decim)
+{
+    if(n >= osc->channels_count) return E_OUT_OF_RANGE;
+
+    osc_channel_t* channel = osc_channel(osc, n);
+
+    switch(decim){
+    case OSC_DECIM_AVG:
+        if(channel->type == OSC_VAL){
+            avg_reset(&channel->avg);
+        }else{
+            maj_reset(&channel->maj);
+        }
+        break;
+    case OSC_DECIM_MIN:
+    case OSC_DECIM_MAX:
+        osc_env_reset(&channel->env);
+        break;
+    default:
+        return E_INVALID_VALUE;
+    }
+
+    channel->decim = decim;
+
+    // План ссылается на каналы и составляется заново.
+    osc_plan_reset(osc);
+
+    return E_NO_ERROR;
+}
+
+const char* osc_decim_name(osc_decim_t decim)
+{
+    switch(decim){
+    case OSC_DECIM_MIN:
+        return "min";
+    case OSC_DECIM_MAX:
+        return "max";
+    default:
+        break;
+    }
+    return NULL;
+}
+
 err_t osc_channel_init(osc_t* osc, size_t n, osc_src_t src, osc_type_t type, osc_src_type_t src_type, size_t src_channel)
 {
 	if(n >= osc->channels_count) return E_OUT_OF_RANGE;
@@ -984,6 +1877,24 @@ static size_t osc_channel_count_to_size(osc_channel_t* channel, size_t count)
 	return size;
 }
 
+/**
+ * Вычисляет число семплов канала в буфере.
+ * Поток семплов группы пониженной частоты охватывает
+ * период номеров семплов, кратный делителям всех групп.
+ * @param osc Осциллограмма.
+ * @param channel Канал.
+ * @param count Число семплов осциллограммы.
+ * @return Число семплов канала.
+ */
+static size_t osc_channel_samples(osc_t* osc, osc_channel_t* channel, size_t count)
+{
+    if(channel->rate == 1) return count;
+
+    size_t lcm = osc->rates_lcm;
+
+    return ((count + lcm - 1) / lcm) * lcm / channel->rate;
+}
+
 /**
  * Вычисляет размер данных группы каналов,
  * эквивалентный по времени записи максимальной длине буфера.
@@ -1006,7 +1917,7 @@ static size_t osc_channels_calc_req_size(osc_t* osc, size_t count)
     	// Пропуск запрещённых каналов.
         if(!channel->enabled) continue;
 
-        req_size += osc_channel_count_to_size(channel, count);
+        req_size += osc_channel_count_to_size(channel, osc_channel_samples(osc, channel, count));
     }
 
     return req_size;
@@ -1054,7 +1965,7 @@ static err_t osc_alloc_buffers(osc_t* osc, size_t samples_count)
     	if(!channel->enabled) continue;
 
     	// Вычислим размер буфера.
-    	size = osc_channel_count_to_size(channel, samples_count);
+    	size = osc_channel_count_to_size(channel, osc_channel_samples(osc, channel, samples_count));
 
     	// Минимальный размер.
 		if(size == 0) return E_INVALID_VALUE;
@@ -1079,7 +1990,7 @@ static err_t osc_alloc_buffers(osc_t* osc, size_t samples_count)
 static iq15_t osc_calc_time(osc_t* osc, size_t osc_rate, iq15_t size_rate)
 {
     // Время буфера для осциллограмм.
-    iq15_t buf_time = (iq15_t)LQ15F(osc->buf_samples, AIN_SAMPLE_FREQ);
+    iq15_t buf_time = (iq15_t)LQ15F(osc->buf_samples, ain_sample_freq());
     // Учтём снижение частоты дискретизации.
     buf_time = iq15_imul(buf_time, osc_rate);
     // Вычислим время.
@@ -1088,6 +1999,19 @@ static iq15_t osc_calc_time(osc_t* osc, size_t osc_rate, iq15_t size_rate)
     return time;
 }
 
+/**
+ * Вычисляет число семплов осциллограммы за заданное время.
+ * @param osc_rate Коэффициент деления частоты дискретизации.
+ * @param time Время.
+ * @return Число семплов.
+ */
+static size_t osc_calc_time_samples(osc_t* osc, size_t osc_rate, iq15_t time)
+{
+    int64_t samples = (int64_t)time * ain_sample_freq() / osc_rate;
+
+    return (size_t)(samples >> Q15_FRACT_BITS);
+}
+
 static void osc_calc_channels_types_count(osc_t* osc)
 {
     osc_channel_t* channel = NULL;
@@ -1107,12 +2031,212 @@ static void osc_calc_channels_types_count(osc_t* osc)
     }
 }
 
+//! Вычисляет наибольший общий делитель.
+static size_t osc_gcd(size_t a, size_t b)
+{
+    while(b != 0){
+        size_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+/**
+ * Составляет группы разрешённых каналов пониженной частоты.
+ * @param osc Осциллограмма.
+ * @return Код ошибки.
+ */
+static err_t osc_init_rates(osc_t* osc)
+{
+    osc_channel_t* channel = NULL;
+    size_t lcm = 1;
+    size_t i, j;
+
+    osc->rates_count = 0;
+
+    for(i = 0; i < osc->channels_count; i ++){
+        channel = osc_channel(osc, i);
+        if(!channel->enabled || channel->rate == 1) continue;
+
+        for(j = 0; j < osc->rates_count; j ++){
+            if(osc->rates[j].div == channel->rate) break;
+        }
+        if(j < osc->rates_count) continue;
+
+        if(osc->rates_count >= OSC_RATES_MAX) return E_OUT_OF_RANGE;
+
+        osc->rates[osc->rates_count ++].div = channel->rate;
+
+        lcm = lcm / osc_gcd(lcm, channel->rate) * channel->rate;
+        if(lcm > UINT16_MAX) return E_OUT_OF_RANGE;
+    }
+
+    osc->rates_lcm = lcm;
+    osc->rates_span = lcm;
+
+    // Группы хранятся только в несжатых буферах каналами.
+    if(osc->rates_count != 0 && (osc->packed || osc->layout == OSC_LAYOUT_RECORDS)) return E_STATE;
+
+    return E_NO_ERROR;
+}
+
+/**
+ * Заполняет таблицу индексов каналов
+ * по номерам аналоговых и цифровых каналов.
+ * @param osc Осциллограмма.
+ */
+static void osc_build_channels_map(osc_t* osc)
+{
+    osc_channel_t* channel = NULL;
+    size_t analog = 0;
+    size_t digital = osc->analog_channels;
+
+    size_t i;
+    for(i = 0; i < osc->channels_count; i ++){
+        channel = osc_channel(osc, i);
+        if(!channel->enabled) continue;
+
+        if(channel->type == OSC_VAL) osc->plan[analog ++].map_index = i;
+        else osc->plan[digital ++].map_index = i;
+    }
+}
+
+/**
+ * Инициализирует кодек и распределяет память буферов,
+ * оставляя в конце память накапливаемого и распакованного блоков.
+ * @param osc Осциллограмма.
+ * @param rate Коэффициент деления частоты дискретизации.
+ * @return Код ошибки.
+ */
+static err_t osc_init_pack(osc_t* osc, size_t rate)
+{
+    osc->pack_get_buffer = NULL;
+
+    if(!osc->packed) return osc_init_buffers(osc, 0);
+
+    // Сжатие только для кольца внутри буфера.
+    if(osc->buffer_mode != OSC_RING_IN_BUFFER) return E_STATE;
+
+    // Частота сети относительно частоты семплов осциллограммы.
+    uint32_t freq = (uint32_t)((((uint64_t)ain_power_freq() * rate) << Q15_FRACT_BITS) / ain_sample_freq());
+    if(freq > INT16_MAX) freq = 0;
+
+    osc_pack_init(&osc->pack, osc->analog_channels, osc->digital_channels, (q15_t)freq);
+
+    size_t seq_size = osc_pack_seq_size(&osc->pack);
+    size_t reserve = seq_size * 2;
+
+    if(reserve >= osc->data_size) return E_OUT_OF_MEMORY;
+
+    osc_value_t* seq_data = &osc->data[osc->data_size - reserve];
+
+    osc_pack_seq_init(&osc->pack_put, seq_data);
+    osc_pack_seq_init(&osc->pack_get, seq_data + seq_size);
+
+    return osc_init_buffers(osc, reserve);
+}
+
+/**
+ * Делит память сжатого буфера между таблицей и потоком блоков.
+ * Таблица рассчитана на наибольшую степень сжатия OSC_PACK_RATIO_MAX.
+ * @param osc Осциллограмма.
+ * @param rate Коэффициент деления частоты дискретизации.
+ * @return Число семплов, умещающихся в буфер при наихудшем сжатии.
+ */
+static size_t osc_pack_calc_samples(osc_t* osc, size_t rate)
+{
+    size_t size = osc->buf_samples;
+    size_t words = OSC_PACK_BLOCK_WORDS_MAX(osc->analog_channels, osc->digital_channels);
+    size_t values = OSC_PACK_BLOCK_VALUES(osc->analog_channels, osc->digital_channels);
+
+    size_t blocks = (size_t)(((uint64_t)size * OSC_PACK_RATIO_MAX) / (values + OSC_PACK_RATIO_MAX));
+
+    // Предельное время буфера ограничивает число блоков
+    // с точностью до интервала ключевых блоков.
+    if(osc->buf_time > 0){
+        size_t time_blocks = (osc_calc_time_samples(osc, rate, osc->buf_time) +
+                              OSC_PACK_BLOCK_SAMPLES - 1) / OSC_PACK_BLOCK_SAMPLES;
+        time_blocks += OSC_PACK_KEY_BLOCKS;
+        if(blocks > time_blocks) blocks = time_blocks;
+    }
+
+    size_t stream = size - blocks;
+
+    // Смещения блоков в таблице 16-битные.
+    if(stream > (UINT16_MAX + 1)) stream = UINT16_MAX + 1;
+
+    osc->pack_blocks = blocks;
+    osc->pack_stream = stream;
+
+    // Блоки наибольшего размера с учётом места, теряемого
+    // при переходе через начало потока, вытеснения до ключевого блока
+    // и неполного последнего блока.
+    size_t fit = stream / words;
+    if(fit < 2) return 0;
+    fit -= 2;
+    if(fit > blocks) fit = blocks;
+    if(fit <= OSC_PACK_KEY_BLOCKS) return 0;
+
+    return (fit - OSC_PACK_KEY_BLOCKS) * OSC_PACK_BLOCK_SAMPLES;
+}
+
+/**
+ * Устанавливает смещения данных каналов
+ * в накапливаемом и распакованном блоках.
+ * @param osc Осциллограмма.
+ */
+static void osc_pack_alloc_channels(osc_t* osc)
+{
+    size_t i;
+    for(i = 0; i < osc->analog_channels; i ++){
+        osc_channel(osc, osc->plan[i].map_index)->offset = osc_pack_analog_offset(&osc->pack, i);
+    }
+
+    for(i = 0; i < osc->digital_channels; i ++){
+        osc_channel(osc, osc->plan[osc->analog_channels + i].map_index)->offset = osc_pack_digital_offset(&osc->pack, i);
+    }
+}
+
+/**
+ * Устанавливает смещения данных каналов в записи семпла.
+ * @param osc Осциллограмма.
+ */
+static void osc_alloc_records(osc_t* osc)
+{
+    osc_channel_t* channel = NULL;
+    size_t digital = OSC_RECORD_HEADER_SIZE + osc->analog_channels;
+
+    size_t i;
+    for(i = 0; i < osc->analog_channels; i ++){
+        osc_channel(osc, osc->plan[i].map_index)->offset = OSC_RECORD_HEADER_SIZE + i;
+    }
+
+    for(i = 0; i < osc->digital_channels; i ++){
+        channel = osc_channel(osc, osc->plan[osc->analog_channels + i].map_index);
+        channel->offset = digital + i / OSC_BITS_PER_SAMPLE;
+        channel->bit = i % OSC_BITS_PER_SAMPLE;
+    }
+}
+
 err_t osc_init_channels(osc_t* osc, size_t rate)
 {
     if(rate == 0) return E_INVALID_VALUE;
+    if(osc->packed && osc->layout == OSC_LAYOUT_RECORDS) return E_STATE;
 
     err_t err = E_NO_ERROR;
 
+    // Числов каналов разного типа.
+    osc_calc_channels_types_count(osc);
+
+    // Группы каналов пониженной частоты.
+    err = osc_init_rates(osc);
+    if(err != E_NO_ERROR) return err;
+
+    // Кодек и память буферов.
+    err = osc_init_pack(osc, rate);
+    if(err != E_NO_ERROR) return err;
+
     // Полный размер буфера.
     const size_t total_size = osc->buf_samples;
     // Число семплов по-умолчанию.
@@ -1125,29 +2249,67 @@ err_t osc_init_channels(osc_t* osc, size_t rate)
     // Для поддержки буферов большого объёма (больше 64кб).
     iq15_t size_rate = (iq15_t)((((int64_t)total_size) << Q15_FRACT_BITS) / total_req_size);
 
-    // Вычислим число семплов.
-    samples_count = osc_calc_channel_samples(osc, size_rate);
+    osc->record_size = 0;
+
+    if(osc->layout == OSC_LAYOUT_RECORDS){
+        // Число записей семплов.
+        osc->record_size = OSC_RECORD_HEADER_SIZE + osc->analog_channels +
+                (osc->digital_channels + OSC_BITS_PER_SAMPLE - 1) / OSC_BITS_PER_SAMPLE;
+        samples_count = osc->buf_samples / osc->record_size;
+        size_rate = (iq15_t)((((int64_t)samples_count) << Q15_FRACT_BITS) / osc->buf_samples);
+    }else if(osc->packed){
+        // Число семплов при наихудшем сжатии.
+        samples_count = osc_pack_calc_samples(osc, rate);
+        size_rate = (iq15_t)((((int64_t)samples_count) << Q15_FRACT_BITS) / osc->buf_samples);
+    }else{
+        // Вычислим число семплов.
+        samples_count = osc_calc_channel_samples(osc, size_rate);
+
+        // Если вдруг из-за погрешности число семплов всё ещё слишком велико,
+        // будем уменьшать число семплов, пока не влезем в буфер.
+        do {
+            // Вычислим нужный размер.
+            total_req_size = osc_channels_calc_req_size(osc, samples_count);
+            // Если влезли в буфер - идём дальше.
+            if(total_req_size <= total_size) break;
+            // Уменьшим число семплов.
+            samples_count --;
+        } while(samples_count);
+    }
 
-    // Если вдруг из-за погрешности число семплов всё ещё слишком велико,
-    // будем уменьшать число семплов, пока не влезем в буфер.
-    do {
-        // Вычислим нужный размер.
-        total_req_size = osc_channels_calc_req_size(osc, samples_count);
-        // Если влезли в буфер - идём дальше.
-        if(total_req_size <= total_size) break;
-        // Уменьшим число семплов.
-        samples_count --;
-    } while(samples_count);
+    // Ограничим число семплов предельным временем буфера.
+    if(osc->buf_time > 0){
+        size_t time_samples = osc_calc_time_samples(osc, rate, osc->buf_time);
+        if(time_samples < samples_count){
+            samples_count = time_samples;
+            size_rate = (iq15_t)((((int64_t)samples_count) << Q15_FRACT_BITS) / osc->buf_samples);
+        }
+    }
 
     // Если число выходит за пределы - ошибка.
     if(samples_count == 0 || samples_count > osc->buf_samples) return E_OUT_OF_RANGE;
+    // Буфер должен вмещать период каждой группы.
+    if(samples_count < osc->rates_lcm) return E_OUT_OF_RANGE;
+
+    // Период номеров семплов групп.
+    osc->rates_span = ((samples_count + osc->rates_lcm - 1) / osc->rates_lcm) * osc->rates_lcm;
 
     // Выделим память.
-    err = osc_alloc_buffers(osc, samples_count);
-    if(err != E_NO_ERROR) return err;
+    if(osc->layout == OSC_LAYOUT_CHANNELS && !osc->packed){
+        err = osc_alloc_buffers(osc, samples_count);
+        if(err != E_NO_ERROR) return err;
+    }
 
-    // Числов каналов разного типа.
-     osc_calc_channels_types_count(osc);
+    // Индексы каналов по номерам каналов каждого типа.
+    osc_build_channels_map(osc);
+
+    if(osc->layout == OSC_LAYOUT_RECORDS){
+        // Данные каналов размещаются в записях семплов.
+        osc_alloc_records(osc);
+    }else if(osc->packed){
+        // Сжатые данные каналов размещаются в блоках.
+        osc_pack_alloc_channels(osc);
+    }
 
     // Число семплов.
     osc->samples = samples_count;
@@ -1155,6 +2317,9 @@ err_t osc_init_channels(osc_t* osc, size_t rate)
     // Дециматоры.
     decim_init(&osc->decim, rate);
 
+    // План записи каналов.
+    osc_plan_build(osc, rate);
+
     // Вычисление времени осциллограммы.
     osc->time = osc_calc_time(osc, rate, size_rate);
 
@@ -1207,44 +2372,17 @@ iq15_t osc_channel_scale(osc_t* osc, size_t n)
     return IQ15I(1);
 }
 
-/**
- * Получает индекс канала по типу и номеру.
- * @param osc Осциллограмма.
- * @param type Тип канала.
- * @param n Номер канала канала заданного типа.
- * @return Индекс канала.
- */
-static size_t osc_channel_type_index(osc_t* osc, osc_type_t type, size_t n)
-{
-    osc_channel_t* channel = NULL;
-    size_t ch_cnt = 0;
-
-    size_t i;
-    for(i = 0; i < osc->channels_count; i ++){
-        channel = osc_channel(osc, i);
-
-        if(!channel->enabled) continue;
-
-        if(channel->type == type){
-            if(ch_cnt == n) return i;
-
-            ch_cnt ++;
-        }
-    }
-    return OSC_INDEX_INVALID;
-}
-
 size_t osc_analog_channel_index(osc_t* osc, size_t n)
 {
     if(n >= osc->analog_channels) return OSC_INDEX_INVALID;
 
-    return osc_channel_type_index(osc, OSC_VAL, n);
+    return osc->plan[n].map_index;
 }
 
 size_t osc_digital_channel_index(osc_t* osc, size_t n)
 {
     if(n >= osc->digital_channels) return OSC_INDEX_INVALID;
 
-    return osc_channel_type_index(osc, OSC_BIT, n);
+    return osc->plan[osc->analog_channels + n].map_index;
 }
 
@@ -15,6 +15,7 @@
 #include "dsp/decim.h"
 #include "dsp/avg.h"
 #include "dsp/maj.h"
+#include "osc_pack.h"
 
 
 //! Неправильный индекс.
@@ -29,9 +30,18 @@
 //! Тип значения осциллограммы.
 typedef int16_t osc_value_t;
 
+//! Число блоков между ключевыми блоками сжатого буфера.
+#define OSC_PACK_KEY_BLOCKS 8
+
+//! Наибольшая степень сжатия для расчёта таблицы блоков сжатого буфера.
+#define OSC_PACK_RATIO_MAX 4
+
 //! Число цифровых сигналов в одном семпле.
 #define OSC_BITS_PER_SAMPLE (sizeof(osc_value_t) * 8)
 
+//! Максимальное число цифровых каналов в упакованном слове семпла.
+#define OSC_SAMPLE_DIGITAL_BITS 32
+
 //! Тип источника.
 typedef enum _Osc_Src {
     OSC_AIN = 0, //!< Аналоговый вход.
@@ -50,6 +60,13 @@ typedef enum _Osc_Src_Type {
     OSC_EFF = 1 //!< Действующее значение.
 } osc_src_type_t;
 
+//! Тип прореживания значений канала между семплами.
+typedef enum _Osc_Decim {
+    OSC_DECIM_AVG = 0, //!< Среднее, для цифровых каналов - мажоритар.
+    OSC_DECIM_MIN = 1, //!< Минимум, для цифровых каналов - И.
+    OSC_DECIM_MAX = 2 //!< Максимум, для цифровых каналов - ИЛИ.
+} osc_decim_t;
+
 
 //! Тип режима переключения буферов.
 typedef enum _Osc_Buffer_Mode {
@@ -57,16 +74,57 @@ typedef enum _Osc_Buffer_Mode {
     OSC_BUFFER_IN_RING = 1 //!< Кольцо из всех буферов.
 } osc_buffer_mode_t;
 
+//! Тип размещения данных в буфере.
+typedef enum _Osc_Layout {
+    OSC_LAYOUT_CHANNELS = 0, //!< Данные каждого канала подряд.
+    OSC_LAYOUT_RECORDS = 1 //!< Семплы записями COMTRADE.
+} osc_layout_t;
+
+//! Размер заголовка записи (номер семпла и отметка времени) в значениях.
+#define OSC_RECORD_HEADER_SIZE 4
+
+//! Минимальное значение аналогового канала в записи,
+//! -32768 в COMTRADE обозначает отсутствие значения.
+#define OSC_RECORD_VALUE_MIN (-32767)
+
 //! Структура буфера данных осциллограммы.
 typedef struct _Osc_Buffer {
     osc_value_t* data; //!< Данные буфера.
     size_t size; //!< Размер буфера.
     size_t index; //!< Текущий индекс.
     size_t count; //! Число значений в буфере.
-    struct timeval end_time; //!< Время последнего семпла.
+    uint64_t end_frame; //!< Номер кадра АЦП последнего семпла.
+    size_t rate_index; //!< Номер семпла в периоде групп частот.
     bool paused; //!< Флаг паузы записи.
+    // Сжатые данные.
+    size_t block_first; //!< Индекс первого блока в таблице блоков.
+    size_t block_count; //!< Число блоков.
+    size_t block_base; //!< Число вытесненных блоков.
+    size_t block_key; //!< Число блоков с последнего ключевого, включая его.
+    size_t stream_head; //!< Индекс свободного места в потоке блоков.
 } osc_buffer_t;
 
+//! Максимальное число участков данных диапазона семплов.
+#define OSC_SPANS_MAX 2
+
+/**
+ * Непрерывный участок данных канала в буфере.
+ * Для цифровых каналов семпл i участка хранится
+ * в бите (bit + i) % OSC_BITS_PER_SAMPLE
+ * слова data[(bit + i) / OSC_BITS_PER_SAMPLE].
+ */
+typedef struct _Osc_Span {
+    const osc_value_t* data; //!< Данные.
+    size_t count; //!< Число семплов.
+    size_t bit; //!< Бит первого семпла цифрового канала.
+} osc_span_t;
+
+//! Экстремум значений канала между семплами.
+typedef struct _Osc_Env {
+    osc_value_t value; //!< Экстремум.
+    bool empty; //!< Флаг отсутствия значений.
+} osc_env_t;
+
 //! Структура канала осциллограммы.
 typedef struct _Osc_Channel {
     osc_src_t src; //!< Источник данных.
@@ -76,11 +134,68 @@ typedef struct _Osc_Channel {
     union {
         avg_t avg; //!< Усреднение.
         maj_t maj; //!< Мажоритар.
+        osc_env_t env; //!< Экстремум.
     };
     size_t offset; //!< Данные.
+    size_t bit; //!< Бит цифрового канала в слове записи.
+    size_t rate; //!< Делитель частоты семплов канала относительно частоты осциллограммы.
+    osc_decim_t decim; //!< Тип прореживания.
     bool enabled; //!< Разрешение канала.
 } osc_channel_t;
 
+//! Вид элемента плана записи каналов.
+typedef enum _Osc_Plan_Kind {
+    OSC_PLAN_VAL_DIRECT = 0, //!< Мгновенное значение аналогового входа без усреднения.
+    OSC_PLAN_VAL_AVG = 1, //!< Усредняемое значение.
+    OSC_PLAN_VAL_MIN = 2, //!< Минимальное значение.
+    OSC_PLAN_VAL_MAX = 3, //!< Максимальное значение.
+    OSC_PLAN_BIT = 4, //!< Мажоритарное битовое значение.
+    OSC_PLAN_BIT_MIN = 5, //!< Битовое значение по И.
+    OSC_PLAN_BIT_MAX = 6 //!< Битовое значение по ИЛИ.
+} osc_plan_kind_t;
+
+//! Число видов элементов плана записи каналов.
+#define OSC_PLAN_KINDS 7
+
+/**
+ * Каллбэк получения значения источника канала.
+ * @param n Номер канала источника.
+ * @return Значение.
+ */
+typedef osc_value_t (*osc_plan_get_value_t)(size_t n);
+
+/**
+ * Элемент плана записи каналов.
+ * Составляется для разрешённых каналов
+ * при инициализации каналов.
+ */
+typedef struct _Osc_Plan_Item {
+    osc_channel_t* channel; //!< Канал.
+    union {
+        const q15_t* value; //!< Значение источника для OSC_PLAN_VAL_DIRECT.
+        osc_plan_get_value_t get_value; //!< Получение значения источника.
+    };
+    size_t src_channel; //!< Номер канала источника.
+    size_t offset; //!< Смещение данных канала в буфере.
+    osc_value_t mask; //!< Маска бита цифрового канала в слове записи.
+    size_t map_index; //!< Индекс канала с порядковым номером, равным индексу элемента
+                      //!< (сначала аналоговые, затем цифровые каналы).
+} osc_plan_item_t;
+
+//! Максимальное число групп каналов пониженной частоты.
+#define OSC_RATES_MAX 4
+
+/**
+ * Группа каналов пониженной частоты.
+ * Группа хранит в буфере свой поток семплов,
+ * семпл группы записывается по завершении
+ * каждых div семплов осциллограммы.
+ */
+typedef struct _Osc_Rate {
+    size_t div; //!< Делитель частоты семплов группы.
+    size_t plan_index[OSC_PLAN_KINDS + 1]; //!< Начала элементов плана группы каждого вида.
+} osc_rate_t;
+
 //! Пул данных осциллограмм.
 typedef struct _Osc_Pool {
     osc_value_t* data; //!< Буфер данных пула.
@@ -94,17 +209,22 @@ typedef struct _Osc {
     osc_value_t* data; //!< Данные осциллограммы.
     size_t data_size; //!< Размер данных.
     osc_buffer_t* buffers; //!< Буфера.
-    size_t buffers_count; //!< Количество буферов.
+    size_t buffers_max; //!< Размер массива буферов.
+    size_t buffers_count; //!< Количество используемых буферов.
     osc_channel_t* channels; //!< Каналы осциллограммы.
     size_t channels_count; //!< Количество каналов в буфере.
+    osc_plan_item_t* plan; //!< План записи каналов размером channels_count.
     // Индексы буферов.
     size_t put_buf_index; //!< Индекс буфера для записи.
     size_t get_buf_index; //!< Индекс буфера для чтения.
     // Параметры данных в буферах.
     size_t buf_samples; //!< Максимальное число семплов в буфере.
     size_t samples; //!< Число используемых семплов в бефере.
+    iq15_t buf_time; //!< Предельное время буфера, 0 - не ограничено.
     // Общие данные времени выполнения.
     osc_buffer_mode_t buffer_mode; //!< Режим буферов.
+    osc_layout_t layout; //!< Размещение данных в буфере.
+    size_t record_size; //!< Размер записи семпла в значениях.
     bool enabled; //!< Разрешение каналов.
     decim_t decim; //!< Дециматор.
     iq15_t time; //!< Время осциллограммы.
@@ -112,10 +232,24 @@ typedef struct _Osc {
     bool pause_enabled; //!< Разрешение паузы.
     size_t pause_counter; //!< Счётчик семплов до паузы.
     size_t pause_samples; //!< Число семплов до паузы.
+    // Сжатие.
+    bool packed; //!< Разрешение сжатия буферов.
+    osc_pack_t pack; //!< Кодек блоков.
+    osc_pack_seq_t pack_put; //!< Накапливаемый блок буфера записи.
+    osc_pack_seq_t pack_get; //!< Распакованный блок буфера чтения.
+    const osc_buffer_t* pack_get_buffer; //!< Буфер распакованного блока.
+    size_t pack_get_block; //!< Номер распакованного блока с начала записи буфера.
+    size_t pack_blocks; //!< Размер таблицы блоков буфера.
+    size_t pack_stream; //!< Размер потока блоков буфера.
     // Вычисленные данные на момент инициализации.
     size_t enabled_channels; //!< Разрешённые каналы.
     size_t analog_channels; //!< Число аналоговых каналов.
     size_t digital_channels; //!< Число цифровых каналов.
+    size_t plan_index[OSC_PLAN_KINDS + 1]; //!< Начала элементов плана каждого вида.
+    osc_rate_t rates[OSC_RATES_MAX]; //!< Группы каналов пониженной частоты.
+    size_t rates_count; //!< Число групп каналов пониженной частоты.
+    size_t rates_lcm; //!< Наименьшее общее кратное делителей групп.
+    size_t rates_span; //!< Период номеров семплов групп, кратный делителям групп.
 } osc_t;
 
 
@@ -127,12 +261,31 @@ typedef struct _Osc {
  * @param buffers Буферы данных.
  * @param buffers_count Число буферов данных.
  * @param channels Каналы осциллограммы.
+ * @param plan План записи каналов размером channels_count.
  * @param channels_count Число каналов.
  * @return Код ошибки.
  */
 extern err_t osc_init(osc_t* osc, osc_value_t* data, size_t data_size,
                       osc_buffer_t* buffers, size_t buffers_count,
-                      osc_channel_t* channels, size_t channels_count);
+                      osc_channel_t* channels, osc_plan_item_t* plan, size_t channels_count);
+
+/**
+ * Устанавливает память данных осциллограммы
+ * и делит её между буферами.
+ * Должно вызываться до osc_init_channels().
+ * @param osc Осциллограмма.
+ * @param data Буфер данных.
+ * @param data_size Размер буфера данных.
+ * @return Код ошибки.
+ */
+extern err_t osc_set_data(osc_t* osc, osc_value_t* data, size_t data_size);
+
+/**
+ * Получает размер памяти данных осциллограммы.
+ * @param osc Осциллограмма.
+ * @return Размер данных.
+ */
+extern size_t osc_data_size(osc_t* osc);
 
 /**
  * Получает режим буферов осциллограммы.
@@ -148,6 +301,33 @@ extern osc_buffer_mode_t osc_buffer_mode(osc_t* osc);
  */
 extern void osc_set_buffer_mode(osc_t* osc, osc_buffer_mode_t mode);
 
+/**
+ * Получает размещение данных в буфере.
+ * @param osc Осциллограмма.
+ * @return Размещение данных.
+ */
+extern osc_layout_t osc_layout(osc_t* osc);
+
+/**
+ * Устанавливает размещение данных в буфере.
+ * В размещении OSC_LAYOUT_RECORDS каждый семпл записывается
+ * готовой записью двоичного файла данных COMTRADE:
+ * номер семпла, отметка времени в периодах семплов,
+ * аналоговые каналы, слова цифровых каналов.
+ * Несовместимо со сжатием буферов.
+ * Должно вызываться до osc_init_channels().
+ * @param osc Осциллограмма.
+ * @param layout Размещение данных.
+ */
+extern void osc_set_layout(osc_t* osc, osc_layout_t layout);
+
+/**
+ * Получает размер записи семпла.
+ * @param osc Осциллограмма.
+ * @return Размер записи в значениях, 0 для размещения каналами.
+ */
+extern size_t osc_record_size(osc_t* osc);
+
 /**
  * Обрабатывает очередной тик АЦП.
  * Добавляет данные в осциллограммы.
@@ -212,6 +392,44 @@ extern size_t osc_samples_count(osc_t* osc);
  */
 extern size_t osc_buffers_count(osc_t* osc);
 
+/**
+ * Устанавливает число используемых буферов
+ * и делит между ними память осциллограммы.
+ * Должно вызываться до osc_init_channels().
+ * @param osc Осциллограмма.
+ * @param count Число буферов, не более переданного в osc_init().
+ * @return Код ошибки.
+ */
+extern err_t osc_set_buffers_count(osc_t* osc, size_t count);
+
+/**
+ * Устанавливает предельное время записи буфера.
+ * Должно вызываться до osc_init_channels().
+ * @param osc Осциллограмма.
+ * @param time Время, с, 0 - ограничено только памятью буфера.
+ */
+extern void osc_set_buffer_time(osc_t* osc, iq15_t time);
+
+/**
+ * Устанавливает разрешение сжатия буферов.
+ * Сжатие возможно только в режиме OSC_RING_IN_BUFFER.
+ * Семплы сжимаются без потерь блоками по OSC_PACK_BLOCK_SAMPLES
+ * при записи и распаковываются при чтении.
+ * Время осциллограммы рассчитывается по наихудшему сжатию,
+ * при сжимаемых данных буфер хранит больше семплов.
+ * Должно вызываться до osc_init_channels().
+ * @param osc Осциллограмма.
+ * @param packed Разрешение сжатия.
+ */
+extern void osc_set_packed(osc_t* osc, bool packed);
+
+/**
+ * Получает разрешение сжатия буферов.
+ * @param osc Осциллограмма.
+ * @return Разрешение сжатия.
+ */
+extern bool osc_packed(osc_t* osc);
+
 /**
  * Получает текущий буфер чтения осциллограмм.
  * @param osc Осциллограмма.
@@ -219,6 +437,13 @@ extern size_t osc_buffers_count(osc_t* osc);
  */
 extern size_t osc_current_buffer(osc_t* osc);
 
+/**
+ * Получает текущий буфер записи осциллограмм.
+ * @param osc Осциллограмма.
+ * @return Текущий буфер записи.
+ */
+extern size_t osc_current_put_buffer(osc_t* osc);
+
 /**
  * Переходит на следующий буфер чтения.
  * @param osc Осциллограмма.
@@ -284,6 +509,51 @@ extern size_t osc_buffer_sample_number_index(osc_t* osc, size_t buf, size_t samp
  */
 extern osc_value_t osc_buffer_channel_value(osc_t* osc, size_t buf, size_t n, size_t index);
 
+/**
+ * Получает значения всех разрешённых каналов семпла.
+ * Аналоговые каналы следуют в порядке их номеров,
+ * цифровой канал с номером n упаковывается в бит n.
+ * Упаковывается не более OSC_SAMPLE_DIGITAL_BITS цифровых каналов.
+ * @param osc Осциллограмма.
+ * @param buf Буфер данных.
+ * @param sample Номер семпла.
+ * @param analog Значения аналоговых каналов, osc_analog_channels() элементов.
+ * @param digital Упакованные значения цифровых каналов.
+ * @return Код ошибки.
+ */
+extern err_t osc_buffer_sample_values(osc_t* osc, size_t buf, size_t sample, osc_value_t* analog, uint32_t* digital);
+
+/**
+ * Получает участки данных канала для диапазона семплов.
+ * Участки указывают непосредственно на данные буфера,
+ * при переходе кольца буфера через начало участков два.
+ * Для сжатых буферов, размещения записями
+ * и каналов пониженной частоты недоступно.
+ * @param osc Осциллограмма.
+ * @param buf Буфер данных.
+ * @param n Номер канала.
+ * @param sample Номер первого семпла.
+ * @param count Число семплов.
+ * @param spans Участки данных, OSC_SPANS_MAX элементов.
+ * @param spans_count Число полученных участков.
+ * @return Код ошибки.
+ */
+extern err_t osc_buffer_channel_spans(osc_t* osc, size_t buf, size_t n, size_t sample, size_t count,
+                                      osc_span_t* spans, size_t* spans_count);
+
+/**
+ * Получает участки записей семплов остановленного буфера
+ * в размещении OSC_LAYOUT_RECORDS.
+ * Нумерует записи по порядку семплов, если кольцо буфера
+ * перешло через начало, иначе записи уже пронумерованы при добавлении.
+ * @param osc Осциллограмма.
+ * @param buf Буфер данных.
+ * @param spans Участки записей, OSC_SPANS_MAX элементов, число семплов участка - число записей.
+ * @param spans_count Число полученных участков.
+ * @return Код ошибки.
+ */
+extern err_t osc_buffer_records(osc_t* osc, size_t buf, osc_span_t* spans, size_t* spans_count);
+
 /**
  * Получает флаг паузы буфера осциллограммы.
  * @param osc Осциллограмма.
@@ -328,6 +598,23 @@ extern err_t osc_buffer_start_time(osc_t* osc, size_t buf, struct timeval* tv);
  */
 extern err_t osc_buffer_sample_time(osc_t* osc, size_t buf, size_t sample, struct timeval* tv);
 
+/**
+ * Получает время семпла осциллограммы в буфере в мкс.
+ * @param osc Осциллограмма.
+ * @param buf Буфер.
+ * @param sample Номер семпла.
+ * @param time Время, мкс.
+ * @return Код ошибки.
+ */
+extern err_t osc_buffer_sample_time_us(osc_t* osc, size_t buf, size_t sample, uint64_t* time);
+
+/**
+ * Преобразует время в мкс в struct timeval.
+ * @param time Время, мкс.
+ * @param tv Время.
+ */
+extern void osc_time_us_to_timeval(uint64_t time, struct timeval* tv);
+
 /**
  * Делает паузу записи осциллограммы в текущий буфер после
  * количества семплов, эквивалентное заданному времени.
@@ -350,6 +637,18 @@ extern void osc_pause_current(osc_t* osc);
  */
 extern bool osc_pause_pending(osc_t* osc);
 
+/**
+ * Продлевает ожидающуюся паузу записи так, чтобы
+ * после текущего семпла было записано не менее заданного времени.
+ * Время от начала паузы ограничивается предельным временем
+ * и временем буфера, чтобы момент начала паузы остался в буфере.
+ * @param osc Осциллограмма.
+ * @param time Время после текущего семпла.
+ * @param time_max Предельное время от начала паузы.
+ * @return Флаг ожидающейся паузы.
+ */
+extern bool osc_pause_extend(osc_t* osc, iq15_t time, iq15_t time_max);
+
 /**
  * Получает время (период) семпла осциллограммы.
  * @param osc Осциллограмма.
@@ -358,6 +657,30 @@ extern bool osc_pause_pending(osc_t* osc);
  */
 extern err_t osc_sample_period(osc_t* osc, struct timeval* tv);
 
+/**
+ * Получает время (период) семпла осциллограммы в нс.
+ * Период медленных трендов может превышать 4.29 с.
+ * @param osc Осциллограмма.
+ * @return Время, нс.
+ */
+extern uint64_t osc_sample_period_ns(osc_t* osc);
+
+/**
+ * Получает время заданного числа семплов осциллограммы.
+ * @param osc Осциллограмма.
+ * @param samples Число семплов.
+ * @param tv Время.
+ */
+extern void osc_samples_time(osc_t* osc, size_t samples, struct timeval* tv);
+
+/**
+ * Получает время заданного числа семплов осциллограммы в мкс.
+ * @param osc Осциллограмма.
+ * @param samples Число семплов.
+ * @return Время, мкс.
+ */
+extern uint64_t osc_samples_time_us(osc_t* osc, size_t samples);
+
 /**
  * Получает частоту семплирования осциллограммы.
  * @param osc Осциллограмма.
@@ -422,6 +745,63 @@ extern osc_src_type_t osc_channel_src_type(osc_t* osc, size_t n);
  */
 extern size_t osc_channel_src_channel(osc_t* osc, size_t n);
 
+/**
+ * Получает делитель частоты семплов канала.
+ * @param osc Осциллограмма.
+ * @param n Номер канала.
+ * @return Делитель частоты семплов канала.
+ */
+extern size_t osc_channel_rate(osc_t* osc, size_t n);
+
+/**
+ * Устанавливает делитель частоты семплов канала
+ * относительно частоты осциллограммы.
+ * Каналы с одинаковым делителем образуют группу,
+ * хранящую в буфере свой поток семплов,
+ * поэтому медленные каналы занимают в div раз меньше памяти.
+ * При чтении значение семпла группы повторяется
+ * для всех семплов осциллограммы его периода.
+ * Несовместимо со сжатием и размещением записями.
+ * Должно вызываться до osc_init_channels().
+ * @param osc Осциллограмма.
+ * @param n Номер канала.
+ * @param rate Делитель, 1 - частота осциллограммы.
+ * @return Код ошибки.
+ */
+extern err_t osc_channel_set_rate(osc_t* osc, size_t n, size_t rate);
+
+/**
+ * Получает тип прореживания канала.
+ * @param osc Осциллограмма.
+ * @param n Номер канала.
+ * @return Тип прореживания.
+ */
+extern osc_decim_t osc_channel_decim(osc_t* osc, size_t n);
+
+/**
+ * Устанавливает тип прореживания значений канала
+ * между семплами осциллограммы.
+ * Минимум и максимум вычисляются при добавлении каждого
+ * значения источника, поэтому кратковременные выбросы
+ * и провалы сохраняются при любом делителе частоты.
+ * Для огибающей сигнала записываются два канала
+ * одного источника с минимумом и максимумом.
+ * Должно вызываться до osc_init_channels().
+ * @param osc Осциллограмма.
+ * @param n Номер канала.
+ * @param decim Тип прореживания.
+ * @return Код ошибки.
+ */
+extern err_t osc_channel_set_decim(osc_t* osc, size_t n, osc_decim_t decim);
+
+/**
+ * Получает имя типа прореживания для
+ * идентификатора канала в файлах осциллограмм.
+ * @param decim Тип прореживания.
+ * @return Имя, либо NULL для среднего.
+ */
+extern const char* osc_decim_name(osc_decim_t decim);
+
 /**
  * Инициализирует канал.
  * Сбрасывает настройки данных канала и
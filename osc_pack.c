@@ -0,0 +1,414 @@
+#include "osc_pack.h"
+#include "defs/defs.h"
+#include <string.h>
+#include <arm_math.h>
+
+
+//! Предсказатели значений аналоговых каналов.
+typedef enum _Osc_Pack_Pred {
+    OSC_PACK_PRED_DELTA = 0, //!< Предыдущее значение.
+    OSC_PACK_PRED_LINEAR = 1, //!< Линейная экстраполяция по двум значениям.
+    OSC_PACK_PRED_RESONANT = 2, //!< Синусоида частоты сети по двум значениям.
+    OSC_PACK_PRED_CYCLE = 3, //!< Значение периодом сети ранее.
+    OSC_PACK_PRED_RAW = 4 //!< Без предсказания.
+} osc_pack_pred_t;
+
+//! Число предсказателей.
+#define OSC_PACK_PREDS 5
+
+//! Запись битового потока.
+typedef struct _Osc_Pack_Writer {
+    uint16_t* dst; //!< Данные.
+    uint32_t acc; //!< Накопленные биты.
+    size_t bits; //!< Число накопленных бит.
+} osc_pack_writer_t;
+
+//! Чтение битового потока.
+typedef struct _Osc_Pack_Reader {
+    const uint16_t* src; //!< Данные.
+    uint32_t acc; //!< Прочитанные биты.
+    size_t bits; //!< Число прочитанных бит.
+} osc_pack_reader_t;
+
+
+void osc_pack_init(osc_pack_t* pack, size_t analog, size_t digital, q15_t freq)
+{
+    pack->analog = analog;
+    pack->digital = digital;
+
+    // 2*cos(w) в Q14 совпадает с cos(w) в Q15.
+    pack->coef = arm_cos_q15(freq);
+
+    // Период сети в целых семплах.
+    pack->period = 0;
+    if(freq > 0){
+        pack->period = (((size_t)1 << Q15_FRACT_BITS) + (size_t)freq / 2) / (size_t)freq;
+        if(pack->period > OSC_PACK_HISTORY_MAX) pack->period = 0;
+    }
+
+    // Резонансному предсказателю нужны два предыдущих семпла.
+    pack->history = (pack->period > 2) ? pack->period : 2;
+}
+
+size_t osc_pack_seq_size(const osc_pack_t* pack)
+{
+    return pack->analog * (pack->history + OSC_PACK_BLOCK_SAMPLES) + pack->digital;
+}
+
+size_t osc_pack_analog_offset(const osc_pack_t* pack, size_t n)
+{
+    return n * (pack->history + OSC_PACK_BLOCK_SAMPLES) + pack->history;
+}
+
+size_t osc_pack_digital_offset(const osc_pack_t* pack, size_t n)
+{
+    return pack->analog * (pack->history + OSC_PACK_BLOCK_SAMPLES) + n;
+}
+
+void osc_pack_seq_init(osc_pack_seq_t* seq, int16_t* data)
+{
+    seq->data = data;
+
+    osc_pack_seq_reset(seq);
+}
+
+void osc_pack_seq_reset(osc_pack_seq_t* seq)
+{
+    seq->count = 0;
+    seq->valid = 0;
+}
+
+/**
+ * Переносит семплы блока в предысторию.
+ * @param pack Кодек.
+ * @param seq Последовательность.
+ */
+static void osc_pack_seq_advance(const osc_pack_t* pack, osc_pack_seq_t* seq)
+{
+    size_t count = seq->count;
+
+    if(count == 0) return;
+
+    size_t history = pack->history;
+    int16_t* v = seq->data;
+
+    size_t i;
+    for(i = 0; i < pack->analog; i ++){
+        memmove(v, &v[count], history * sizeof(int16_t));
+        v += history + OSC_PACK_BLOCK_SAMPLES;
+    }
+
+    seq->valid += count;
+    if(seq->valid > history) seq->valid = history;
+
+    seq->count = 0;
+}
+
+//! Переводит остаток со знаком в беззнаковое значение.
+ALWAYS_INLINE static uint32_t osc_pack_zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+//! Переводит беззнаковое значение в остаток со знаком.
+ALWAYS_INLINE static int32_t osc_pack_unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 0x1);
+}
+
+//! Получает число значащих бит.
+ALWAYS_INLINE static size_t osc_pack_width(uint32_t value)
+{
+    return (value == 0) ? 0 : (32 - __builtin_clz(value));
+}
+
+//! Получает маску семплов блока.
+ALWAYS_INLINE static uint32_t osc_pack_mask(size_t count)
+{
+    return ((uint32_t)1 << count) - 1;
+}
+
+/**
+ * Вычисляет предсказание значения.
+ * При недостатке предыстории предсказатели
+ * по двум значениям используют предыдущее значение.
+ * @param pack Кодек.
+ * @param pred Предсказатель.
+ * @param x Семплы блока, предыстория по отрицательным индексам.
+ * @param i Индекс семпла.
+ * @param prev Число доступных семплов до семпла i.
+ * @return Предсказание.
+ */
+ALWAYS_INLINE static int32_t osc_pack_predict(const osc_pack_t* pack, osc_pack_pred_t pred,
+                                              const int16_t* x, int32_t i, size_t prev)
+{
+    switch(pred){
+    default:
+    case OSC_PACK_PRED_DELTA:
+        return x[i - 1];
+    case OSC_PACK_PRED_LINEAR:
+        if(prev < 2) return x[i - 1];
+        return 2 * (int32_t)x[i - 1] - x[i - 2];
+    case OSC_PACK_PRED_RESONANT:
+        if(prev < 2) return x[i - 1];
+        return ((pack->coef * x[i - 1]) >> 14) - x[i - 2];
+    case OSC_PACK_PRED_CYCLE:
+        return x[i - (int32_t)pack->period];
+    case OSC_PACK_PRED_RAW:
+        return 0;
+    }
+}
+
+/**
+ * Выбирает предсказатель с наименьшей разрядностью остатков.
+ * @param pack Кодек.
+ * @param x Семплы блока канала, предыстория по отрицательным индексам.
+ * @param count Число семплов.
+ * @param valid Число достоверных семплов предыстории.
+ * @param width Разрядность остатков.
+ * @return Предсказатель.
+ */
+static osc_pack_pred_t osc_pack_analyze(const osc_pack_t* pack, const int16_t* x,
+                                        size_t count, size_t valid, size_t* width)
+{
+    uint32_t bits[OSC_PACK_PREDS] = {0};
+    bool cycle = pack->period != 0 && valid >= pack->period;
+    int32_t period = (int32_t)pack->period;
+    int32_t coef = pack->coef;
+    int32_t i = (valid == 0) ? 1 : 0;
+    int32_t n = (int32_t)count;
+
+    // Разрядность определяется по объединению битов всех остатков.
+    // Первые семплы без двух предыдущих значений.
+    for(; i < n && (valid + i) < 2; i ++){
+        uint32_t d = osc_pack_zigzag((int32_t)x[i] - x[i - 1]);
+        bits[OSC_PACK_PRED_DELTA] |= d;
+        bits[OSC_PACK_PRED_LINEAR] |= d;
+        bits[OSC_PACK_PRED_RESONANT] |= d;
+        if(cycle) bits[OSC_PACK_PRED_CYCLE] |= osc_pack_zigzag((int32_t)x[i] - x[i - period]);
+        bits[OSC_PACK_PRED_RAW] |= osc_pack_zigzag(x[i]);
+    }
+    for(; i < n; i ++){
+        bits[OSC_PACK_PRED_DELTA] |= osc_pack_zigzag((int32_t)x[i] - x[i - 1]);
+        bits[OSC_PACK_PRED_LINEAR] |= osc_pack_zigzag((int32_t)x[i] - (2 * (int32_t)x[i - 1] - x[i - 2]));
+        bits[OSC_PACK_PRED_RESONANT] |= osc_pack_zigzag((int32_t)x[i] - (((coef * x[i - 1]) >> 14) - x[i - 2]));
+        if(cycle) bits[OSC_PACK_PRED_CYCLE] |= osc_pack_zigzag((int32_t)x[i] - x[i - period]);
+        bits[OSC_PACK_PRED_RAW] |= osc_pack_zigzag(x[i]);
+    }
+
+    osc_pack_pred_t pred = OSC_PACK_PRED_RAW;
+    size_t min_width = osc_pack_width(bits[OSC_PACK_PRED_RAW]);
+    size_t cur_width;
+
+    size_t p;
+    for(p = 0; p < OSC_PACK_PRED_RAW; p ++){
+        if(p == OSC_PACK_PRED_CYCLE && !cycle) continue;
+
+        cur_width = osc_pack_width(bits[p]);
+        if(cur_width < min_width){
+            min_width = cur_width;
+            pred = (osc_pack_pred_t)p;
+        }
+    }
+
+    *width = min_width;
+
+    return pred;
+}
+
+//! Получает флаг постоянного значения цифрового канала.
+ALWAYS_INLINE static bool osc_pack_digital_const(uint32_t bits, uint32_t mask)
+{
+    return bits == 0 || bits == mask;
+}
+
+size_t osc_pack_block_words(const osc_pack_t* pack, const osc_pack_seq_t* seq, bool key)
+{
+    size_t count = seq->count;
+    size_t valid = key ? 0 : seq->valid;
+    size_t bits = OSC_PACK_BLOCK_HEADER_BITS;
+    size_t stride = pack->history + OSC_PACK_BLOCK_SAMPLES;
+    const int16_t* x = &seq->data[pack->history];
+    size_t width;
+
+    size_t i;
+    for(i = 0; i < pack->analog; i ++){
+        osc_pack_analyze(pack, x, count, valid, &width);
+
+        bits += OSC_PACK_PRED_BITS + OSC_PACK_WIDTH_BITS;
+        if(valid == 0){
+            bits += OSC_PACK_VALUE_BITS + (count - 1) * width;
+        }else{
+            bits += count * width;
+        }
+
+        x += stride;
+    }
+
+    const int16_t* digital = &seq->data[osc_pack_digital_offset(pack, 0)];
+    uint32_t mask = osc_pack_mask(count);
+
+    for(i = 0; i < pack->digital; i ++){
+        bits += osc_pack_digital_const((uint16_t)digital[i] & mask, mask) ? 2 : (1 + count);
+    }
+
+    return (bits + 15) / 16;
+}
+
+//! Записывает в поток до 16 бит.
+ALWAYS_INLINE static void osc_pack_put(osc_pack_writer_t* w, uint32_t value, size_t bits)
+{
+    w->acc |= value << w->bits;
+    w->bits += bits;
+
+    if(w->bits >= 16){
+        *w->dst ++ = (uint16_t)w->acc;
+        w->acc >>= 16;
+        w->bits -= 16;
+    }
+}
+
+//! Читает из потока до 16 бит.
+ALWAYS_INLINE static uint32_t osc_pack_get(osc_pack_reader_t* r, size_t bits)
+{
+    if(r->bits < bits){
+        r->acc |= (uint32_t)(*r->src ++) << r->bits;
+        r->bits += 16;
+    }
+
+    uint32_t value = r->acc & osc_pack_mask(bits);
+
+    r->acc >>= bits;
+    r->bits -= bits;
+
+    return value;
+}
+
+size_t osc_pack_encode(const osc_pack_t* pack, osc_pack_seq_t* seq, int16_t* dst, bool key)
+{
+    if(key) seq->valid = 0;
+
+    size_t count = seq->count;
+    size_t valid = seq->valid;
+    size_t stride = pack->history + OSC_PACK_BLOCK_SAMPLES;
+    const int16_t* x = &seq->data[pack->history];
+    osc_pack_pred_t pred;
+    size_t width;
+
+    osc_pack_writer_t w;
+    w.dst = (uint16_t*)dst;
+    w.acc = 0;
+    w.bits = 0;
+
+    osc_pack_put(&w, (count - 1) | ((valid == 0) ? OSC_PACK_BLOCK_SAMPLES : 0), OSC_PACK_BLOCK_HEADER_BITS);
+
+    size_t i, j;
+    for(i = 0; i < pack->analog; i ++){
+        pred = osc_pack_analyze(pack, x, count, valid, &width);
+
+        j = 0;
+        // Ключевой блок начинается с несжатого значения.
+        if(valid == 0){
+            osc_pack_put(&w, (uint16_t)x[0], OSC_PACK_VALUE_BITS);
+            j = 1;
+        }
+
+        osc_pack_put(&w, pred, OSC_PACK_PRED_BITS);
+        osc_pack_put(&w, width, OSC_PACK_WIDTH_BITS);
+
+        if(width != 0){
+            for(; j < count; j ++){
+                osc_pack_put(&w, osc_pack_zigzag(x[j] - osc_pack_predict(pack, pred, x, j, valid + j)), width);
+            }
+        }
+
+        x += stride;
+    }
+
+    const int16_t* digital = &seq->data[osc_pack_digital_offset(pack, 0)];
+    uint32_t mask = osc_pack_mask(count);
+    uint32_t bits;
+
+    for(i = 0; i < pack->digital; i ++){
+        bits = (uint16_t)digital[i] & mask;
+
+        if(osc_pack_digital_const(bits, mask)){
+            osc_pack_put(&w, 0x1 | ((bits & 0x1) << 1), 2);
+        }else{
+            osc_pack_put(&w, 0x0, 1);
+            osc_pack_put(&w, bits, count);
+        }
+    }
+
+    if(w.bits != 0) *w.dst ++ = (uint16_t)w.acc;
+
+    osc_pack_seq_advance(pack, seq);
+
+    return (size_t)(w.dst - (uint16_t*)dst);
+}
+
+size_t osc_pack_decode(const osc_pack_t* pack, osc_pack_seq_t* seq, const int16_t* src)
+{
+    osc_pack_seq_advance(pack, seq);
+
+    osc_pack_reader_t r;
+    r.src = (const uint16_t*)src;
+    r.acc = 0;
+    r.bits = 0;
+
+    size_t header = osc_pack_get(&r, OSC_PACK_BLOCK_HEADER_BITS);
+    size_t count = (header & (OSC_PACK_BLOCK_SAMPLES - 1)) + 1;
+
+    if(header & OSC_PACK_BLOCK_SAMPLES) seq->valid = 0;
+
+    size_t valid = seq->valid;
+    size_t stride = pack->history + OSC_PACK_BLOCK_SAMPLES;
+    int16_t* x = &seq->data[pack->history];
+    osc_pack_pred_t pred;
+    size_t width;
+    int32_t res;
+
+    size_t i, j;
+    for(i = 0; i < pack->analog; i ++){
+        j = 0;
+        if(valid == 0){
+            x[0] = (int16_t)osc_pack_get(&r, OSC_PACK_VALUE_BITS);
+            j = 1;
+        }
+
+        pred = (osc_pack_pred_t)osc_pack_get(&r, OSC_PACK_PRED_BITS);
+        width = osc_pack_get(&r, OSC_PACK_WIDTH_BITS);
+
+        for(; j < count; j ++){
+            res = (width == 0) ? 0 : osc_pack_unzigzag(osc_pack_get(&r, width));
+            x[j] = (int16_t)(osc_pack_predict(pack, pred, x, j, valid + j) + res);
+        }
+
+        x += stride;
+    }
+
+    int16_t* digital = &seq->data[osc_pack_digital_offset(pack, 0)];
+    uint32_t mask = osc_pack_mask(count);
+
+    for(i = 0; i < pack->digital; i ++){
+        if(osc_pack_get(&r, 1)){
+            digital[i] = (int16_t)(osc_pack_get(&r, 1) ? mask : 0);
+        }else{
+            digital[i] = (int16_t)osc_pack_get(&r, count);
+        }
+    }
+
+    seq->count = count;
+
+    return count;
+}
+
+bool osc_pack_block_key(const int16_t* src)
+{
+    return ((uint16_t)src[0] & OSC_PACK_BLOCK_SAMPLES) != 0;
+}
+
+size_t osc_pack_block_samples(const int16_t* src)
+{
+    return ((uint16_t)src[0] & (OSC_PACK_BLOCK_SAMPLES - 1)) + 1;
+}
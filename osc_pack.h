@@ -0,0 +1,162 @@
+/**
+ * @file osc_pack.h Сжатие без потерь блоков семплов осциллограмм.
+ */
+
+#ifndef OSC_PACK_H_
+#define OSC_PACK_H_
+
+#include "q15/q15.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+
+//! Число семплов в блоке.
+#define OSC_PACK_BLOCK_SAMPLES 16
+
+//! Максимальная длина предыстории (периода сети) в семплах.
+#define OSC_PACK_HISTORY_MAX 64
+
+//! Число бит заголовка блока (число семплов - 1, флаг ключевого блока).
+#define OSC_PACK_BLOCK_HEADER_BITS 5
+
+//! Число бит значения аналогового канала.
+#define OSC_PACK_VALUE_BITS 16
+//! Число бит номера предсказателя.
+#define OSC_PACK_PRED_BITS 3
+//! Число бит разрядности остатков.
+#define OSC_PACK_WIDTH_BITS 5
+
+//! Наибольшее число бит аналогового канала в блоке.
+#define OSC_PACK_ANALOG_BITS_MAX (OSC_PACK_PRED_BITS + OSC_PACK_WIDTH_BITS +\
+                                  OSC_PACK_BLOCK_SAMPLES * OSC_PACK_VALUE_BITS)
+
+//! Наибольшее число бит цифрового канала в блоке.
+#define OSC_PACK_DIGITAL_BITS_MAX (1 + OSC_PACK_BLOCK_SAMPLES)
+
+/**
+ * Наибольший размер сжатого блока в словах.
+ * Несжимаемые данные хранятся без предсказания,
+ * поэтому размер блока ограничен сверху независимо от данных.
+ */
+#define OSC_PACK_BLOCK_WORDS_MAX(analog, digital)\
+            ((OSC_PACK_BLOCK_HEADER_BITS + (analog) * OSC_PACK_ANALOG_BITS_MAX +\
+              (digital) * OSC_PACK_DIGITAL_BITS_MAX + 15) / 16)
+
+//! Размер несжатого блока в словах.
+#define OSC_PACK_BLOCK_VALUES(analog, digital) ((analog) * OSC_PACK_BLOCK_SAMPLES + (digital))
+
+
+//! Кодек блоков семплов.
+typedef struct _Osc_Pack {
+    size_t analog; //!< Число аналоговых каналов.
+    size_t digital; //!< Число цифровых каналов.
+    size_t period; //!< Период сети в семплах, 0 - не используется.
+    size_t history; //!< Длина предыстории в семплах.
+    int32_t coef; //!< Коэффициент резонансного предсказателя 2*cos(w), Q14.
+} osc_pack_t;
+
+/**
+ * Последовательность семплов блока с предысторией.
+ * Каждый аналоговый канал занимает history + OSC_PACK_BLOCK_SAMPLES
+ * значений подряд: предыстория, затем семплы блока.
+ * За ними следуют цифровые каналы по одному слову,
+ * бит i которого - семпл i блока.
+ */
+typedef struct _Osc_Pack_Seq {
+    int16_t* data; //!< Данные размером osc_pack_seq_size().
+    size_t count; //!< Число семплов блока.
+    size_t valid; //!< Число достоверных семплов предыстории.
+} osc_pack_seq_t;
+
+
+/**
+ * Инициализирует кодек.
+ * @param pack Кодек.
+ * @param analog Число аналоговых каналов.
+ * @param digital Число цифровых каналов.
+ * @param freq Отношение частоты сети к частоте семплов, Q15.
+ */
+extern void osc_pack_init(osc_pack_t* pack, size_t analog, size_t digital, q15_t freq);
+
+/**
+ * Получает размер данных последовательности.
+ * @param pack Кодек.
+ * @return Размер в словах.
+ */
+extern size_t osc_pack_seq_size(const osc_pack_t* pack);
+
+/**
+ * Получает смещение семплов блока аналогового канала в последовательности.
+ * @param pack Кодек.
+ * @param n Порядковый номер аналогового канала.
+ * @return Смещение.
+ */
+extern size_t osc_pack_analog_offset(const osc_pack_t* pack, size_t n);
+
+/**
+ * Получает смещение слова блока цифрового канала в последовательности.
+ * @param pack Кодек.
+ * @param n Порядковый номер цифрового канала.
+ * @return Смещение.
+ */
+extern size_t osc_pack_digital_offset(const osc_pack_t* pack, size_t n);
+
+/**
+ * Инициализирует последовательность.
+ * @param seq Последовательность.
+ * @param data Данные размером osc_pack_seq_size().
+ */
+extern void osc_pack_seq_init(osc_pack_seq_t* seq, int16_t* data);
+
+/**
+ * Сбрасывает последовательность.
+ * @param seq Последовательность.
+ */
+extern void osc_pack_seq_reset(osc_pack_seq_t* seq);
+
+/**
+ * Вычисляет размер сжатого блока последовательности.
+ * @param pack Кодек.
+ * @param seq Последовательность с накопленными семплами блока.
+ * @param key Флаг ключевого блока, не использующего предысторию.
+ * @return Размер в словах.
+ */
+extern size_t osc_pack_block_words(const osc_pack_t* pack, const osc_pack_seq_t* seq, bool key);
+
+/**
+ * Сжимает блок последовательности
+ * и переносит его семплы в предысторию.
+ * @param pack Кодек.
+ * @param seq Последовательность с накопленными семплами блока.
+ * @param dst Сжатые данные.
+ * @param key Флаг ключевого блока, не использующего предысторию.
+ * @return Размер в словах.
+ */
+extern size_t osc_pack_encode(const osc_pack_t* pack, osc_pack_seq_t* seq, int16_t* dst, bool key);
+
+/**
+ * Распаковывает очередной блок в последовательность,
+ * перенося семплы предыдущего блока в предысторию.
+ * @param pack Кодек.
+ * @param seq Последовательность.
+ * @param src Сжатые данные.
+ * @return Число семплов в блоке.
+ */
+extern size_t osc_pack_decode(const osc_pack_t* pack, osc_pack_seq_t* seq, const int16_t* src);
+
+/**
+ * Получает флаг ключевого блока.
+ * @param src Сжатые данные.
+ * @return Флаг ключевого блока.
+ */
+extern bool osc_pack_block_key(const int16_t* src);
+
+/**
+ * Получает число семплов сжатого блока.
+ * @param src Сжатые данные.
+ * @return Число семплов.
+ */
+extern size_t osc_pack_block_samples(const int16_t* src);
+
+#endif /* OSC_PACK_H_ */
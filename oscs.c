@@ -1,12 +1,16 @@
 #include "oscs.h"
+#include "arena.h"
 
 //! Структура осциллограмм.
 typedef struct _Oscs {
-    osc_value_t data[OSCS_SAMPLES]; //!< Данные осциллограмм.
-    osc_buffer_t buffers[OSCS_BUFFERS]; //!< Буферы осциллограмм.
+    osc_buffer_t buffers[OSCS_BUFFERS_MAX]; //!< Буферы осциллограмм.
     osc_channel_t channels[OSCS_CHANNELS]; //!< Каналы осциллограмм.
+    osc_plan_item_t plan[OSCS_CHANNELS]; //!< План записи каналов.
     osc_t osc; //!< Осциллограмма.
     bool running; //!< Флаг работы.
+    uint32_t dropped; //!< Число отброшенных событий.
+    comtrade_dat_type_t dat_type; //!< Тип данных COMTRADE.
+    bool cff; //!< Запись единым файлом CFF.
 } oscs_t;
 
 //! Осциллограммы.
@@ -16,10 +20,17 @@ static oscs_t oscs;
 err_t oscs_init(void)
 {
     err_t err = E_NO_ERROR;
+    osc_value_t* data = NULL;
 
-    err = osc_init(&oscs.osc, oscs.data, OSCS_SAMPLES,
-                   oscs.buffers, OSCS_BUFFERS,
-                   oscs.channels, OSCS_CHANNELS);
+    err = arena_alloc(OSCS_SAMPLES, &data);
+    if(err != E_NO_ERROR) return err;
+
+    err = osc_init(&oscs.osc, data, OSCS_SAMPLES,
+                   oscs.buffers, OSCS_BUFFERS_MAX,
+                   oscs.channels, oscs.plan, OSCS_CHANNELS);
+    if(err != E_NO_ERROR) return err;
+
+    err = osc_set_buffers_count(&oscs.osc, OSCS_BUFFERS);
     if(err != E_NO_ERROR) return err;
 
     osc_set_buffer_mode(&oscs.osc, OSC_RING_IN_BUFFER);
@@ -32,6 +43,22 @@ osc_t* oscs_get_osc(void)
     return &oscs.osc;
 }
 
+err_t oscs_set_samples(size_t samples)
+{
+    err_t err = E_NO_ERROR;
+    osc_value_t* data = NULL;
+
+    err = arena_alloc(samples, &data);
+    if(err != E_NO_ERROR) return err;
+
+    return osc_set_data(&oscs.osc, data, samples);
+}
+
+size_t oscs_samples(void)
+{
+    return osc_data_size(&oscs.osc);
+}
+
 void oscs_append(void)
 {
     if(!oscs.running){
@@ -47,6 +74,38 @@ void oscs_pause(iq15_t time)
     osc_pause(&oscs.osc, time);
 }
 
+err_t oscs_capture(iq15_t time)
+{
+    // Текущий буфер уже ожидает окончания записи.
+    if(osc_pause_pending(&oscs.osc)) return E_STATE;
+
+    // Буфер записи занят не записанным событием -
+    // свободных буферов нет.
+    if(osc_buffer_paused(&oscs.osc, osc_current_put_buffer(&oscs.osc))){
+        oscs.dropped ++;
+        return E_OUT_OF_MEMORY;
+    }
+
+    osc_pause(&oscs.osc, time);
+
+    return E_NO_ERROR;
+}
+
+bool oscs_extend(iq15_t time, iq15_t time_max)
+{
+    return osc_pause_extend(&oscs.osc, time, time_max);
+}
+
+uint32_t oscs_dropped(void)
+{
+    return oscs.dropped;
+}
+
+size_t oscs_buffers_count(void)
+{
+    return osc_buffers_count(&oscs.osc);
+}
+
 bool oscs_paused(void)
 {
     return osc_buffer_paused(&oscs.osc, osc_current_buffer(&oscs.osc));
@@ -73,6 +132,37 @@ void oscs_set_enabled(bool enabled)
     osc_set_enabled(&oscs.osc, enabled);
 }
 
+comtrade_dat_type_t oscs_dat_type(void)
+{
+    return oscs.dat_type;
+}
+
+err_t oscs_set_dat_type(comtrade_dat_type_t dat_type)
+{
+    switch(dat_type){
+    case COMTRADE_DAT_BINARY:
+    case COMTRADE_DAT_BINARY32:
+    case COMTRADE_DAT_FLOAT32:
+        break;
+    default:
+        return E_INVALID_VALUE;
+    }
+
+    oscs.dat_type = dat_type;
+
+    return E_NO_ERROR;
+}
+
+bool oscs_cff(void)
+{
+    return oscs.cff;
+}
+
+void oscs_set_cff(bool cff)
+{
+    oscs.cff = cff;
+}
+
 void oscs_reset(void)
 {
     osc_reset(&oscs.osc);
@@ -6,16 +6,21 @@
 #define OSCS_H_
 
 #include "osc.h"
+#include "comtrade.h"
 #include "errors/errors.h"
 #include "q15/q15.h"
+#include <stdint.h>
 #include <stdbool.h>
 
-//! Число семплов осциллограмм.
+//! Число семплов осциллограмм в общей памяти по-умолчанию.
 #define OSCS_SAMPLES 8192
 
-//! Число буферов осциллограмм.
+//! Число буферов осциллограмм по-умолчанию.
 #define OSCS_BUFFERS 2
 
+//! Максимальное число буферов осциллограмм (слотов событий).
+#define OSCS_BUFFERS_MAX 8
+
 //! Число осциллограмм.
 #define OSCS_CHANNELS 16
 
@@ -31,6 +36,20 @@ extern err_t oscs_init(void);
  */
 extern osc_t* oscs_get_osc(void);
 
+/**
+ * Выделяет осциллограммам память семплов из общей памяти.
+ * Должно вызываться после arena_reset() до osc_init_channels().
+ * @param samples Число семплов.
+ * @return Код ошибки.
+ */
+extern err_t oscs_set_samples(size_t samples);
+
+/**
+ * Получает размер памяти семплов осциллограмм.
+ * @return Число семплов.
+ */
+extern size_t oscs_samples(void);
+
 /**
  * Добавляет текущие значения в осциллограмму.
  */
@@ -42,6 +61,37 @@ extern void oscs_append(void);
  */
 extern void oscs_pause(iq15_t time);
 
+/**
+ * Занимает следующий свободный буфер под событие:
+ * останавливает запись текущего буфера через заданное время,
+ * после чего запись продолжается в следующий буфер.
+ * @param time Время до паузы.
+ * @return Код ошибки: E_STATE - событие попадает в уже
+ *         завершающийся буфер, E_OUT_OF_MEMORY - все буферы заняты,
+ *         событие отброшено.
+ */
+extern err_t oscs_capture(iq15_t time);
+
+/**
+ * Продлевает запись текущего буфера, ожидающего окончания записи.
+ * @param time Время записи после текущего семпла.
+ * @param time_max Предельное время записи после начала паузы.
+ * @return Флаг продления записи.
+ */
+extern bool oscs_extend(iq15_t time, iq15_t time_max);
+
+/**
+ * Получает число отброшенных из-за занятости всех буферов событий.
+ * @return Число отброшенных событий.
+ */
+extern uint32_t oscs_dropped(void);
+
+/**
+ * Получает число используемых буферов осциллограмм.
+ * @return Число буферов.
+ */
+extern size_t oscs_buffers_count(void);
+
 /**
  * Получает флаг останова записи в текущий буфер.
  * @return Флаг останова записи.
@@ -72,6 +122,31 @@ extern bool oscs_enabled(void);
  */
 extern void oscs_set_enabled(bool enabled);
 
+/**
+ * Получает тип данных COMTRADE событий.
+ * @return Тип данных.
+ */
+extern comtrade_dat_type_t oscs_dat_type(void);
+
+/**
+ * Устанавливает тип данных COMTRADE событий.
+ * @param dat_type Тип данных.
+ * @return Код ошибки.
+ */
+extern err_t oscs_set_dat_type(comtrade_dat_type_t dat_type);
+
+/**
+ * Получает флаг записи событий единым файлом CFF.
+ * @return Флаг записи файлом CFF.
+ */
+extern bool oscs_cff(void);
+
+/**
+ * Устанавливает флаг записи событий единым файлом CFF.
+ * @param cff Флаг записи файлом CFF.
+ */
+extern void oscs_set_cff(bool cff);
+
 /**
  * Сбрасывает осциллограмму.
  */
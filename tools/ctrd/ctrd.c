@@ -0,0 +1,722 @@
+#include "ctrd.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+//! Максимальная длина строки CFG.
+#define CTRD_LINE_LEN 256
+
+//! Максимальное число полей строки CFG.
+#define CTRD_FIELDS_MAX 16
+
+//! Заголовок секции файла CFF.
+#define CTRD_CFF_SECTION "--- file type: "
+//! Заголовок секции CFG файла CFF.
+#define CTRD_CFF_CFG CTRD_CFF_SECTION "CFG ---"
+//! Заголовок секции DAT файла CFF.
+#define CTRD_CFF_DAT "\n" CTRD_CFF_SECTION "DAT "
+//! Конец заголовка секции DAT файла CFF.
+#define CTRD_CFF_DAT_END " ---"
+
+//! Размер прочитанных данных, после которого они освобождаются.
+#define CTRD_RELEASE_SIZE (8 * 1024 * 1024)
+
+//! Размер номера и отметки времени семпла.
+#define CTRD_RECORD_HEAD_SIZE (sizeof(uint32_t) + sizeof(uint32_t))
+
+
+//! Разбор текста CFG.
+typedef struct _Ctrd_Cfg_Parser {
+    const char* pos; //!< Текущая позиция.
+    const char* end; //!< Конец текста.
+    char line[CTRD_LINE_LEN]; //!< Текущая строка.
+    char* fields[CTRD_FIELDS_MAX]; //!< Поля текущей строки.
+    size_t nfields; //!< Число полей.
+} ctrd_cfg_parser_t;
+
+
+const char* ctrd_strerror(ctrd_err_t err)
+{
+    switch(err){
+    case CTRD_E_NO_ERROR:
+        return "no error";
+    case CTRD_E_NULL_POINTER:
+        return "null pointer";
+    case CTRD_E_INVALID_VALUE:
+        return "invalid format";
+    case CTRD_E_OUT_OF_RANGE:
+        return "data shorter than cfg";
+    case CTRD_E_OUT_OF_MEMORY:
+        return "out of memory";
+    case CTRD_E_IO_ERROR:
+        return "i/o error";
+    case CTRD_E_NOT_IMPLEMENTED:
+        return "unsupported format";
+    case CTRD_E_STATE:
+        return "index does not match data";
+    }
+    return "unknown error";
+}
+
+ctrd_err_t ctrd_map_open(ctrd_map_t* map, const char* path)
+{
+    if(map == NULL || path == NULL) return CTRD_E_NULL_POINTER;
+
+    memset(map, 0x0, sizeof(ctrd_map_t));
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return CTRD_E_IO_ERROR;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        return CTRD_E_IO_ERROR;
+    }
+
+    map->size = (uint64_t)st.st_size;
+    map->mtime = st.st_mtime;
+
+    // Пустой файл не отображается.
+    if(map->size == 0){
+        close(fd);
+        return CTRD_E_NO_ERROR;
+    }
+
+    void* data = mmap(NULL, (size_t)map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // Отображение остаётся действительным после закрытия файла.
+    close(fd);
+
+    if(data == MAP_FAILED){
+        map->size = 0;
+        return CTRD_E_IO_ERROR;
+    }
+
+    map->data = (const uint8_t*)data;
+
+    return CTRD_E_NO_ERROR;
+}
+
+void ctrd_map_close(ctrd_map_t* map)
+{
+    if(map == NULL) return;
+
+    if(map->data) munmap((void*)map->data, (size_t)map->size);
+
+    memset(map, 0x0, sizeof(ctrd_map_t));
+}
+
+/**
+ * Читает следующую строку CFG и разбивает её на поля.
+ * @param parser Разбор.
+ * @return Флаг чтения строки.
+ */
+static bool ctrd_cfg_next_line(ctrd_cfg_parser_t* parser)
+{
+    if(parser->pos >= parser->end) return false;
+
+    const char* eol = memchr(parser->pos, '\n', (size_t)(parser->end - parser->pos));
+    const char* next = eol ? eol + 1 : parser->end;
+    if(eol == NULL) eol = parser->end;
+
+    size_t len = (size_t)(eol - parser->pos);
+    if(len > 0 && parser->pos[len - 1] == '\r') len --;
+    if(len >= CTRD_LINE_LEN) len = CTRD_LINE_LEN - 1;
+
+    memcpy(parser->line, parser->pos, len);
+    parser->line[len] = '\0';
+    parser->pos = next;
+
+    parser->nfields = 0;
+    char* field = parser->line;
+    for(;;){
+        if(parser->nfields < CTRD_FIELDS_MAX) parser->fields[parser->nfields ++] = field;
+        char* comma = strchr(field, ',');
+        if(comma == NULL) break;
+        *comma = '\0';
+        field = comma + 1;
+    }
+
+    return true;
+}
+
+/**
+ * Копирует строковое поле.
+ * @param dst Назначение размером CTRD_NAME_LEN.
+ * @param src Поле.
+ */
+static void ctrd_copy_name(char* dst, const char* src)
+{
+    strncpy(dst, src, CTRD_NAME_LEN - 1);
+    dst[CTRD_NAME_LEN - 1] = '\0';
+}
+
+/**
+ * Разбирает число поля.
+ * @param field Поле.
+ * @param value Значение.
+ * @return Флаг успешного разбора.
+ */
+static bool ctrd_parse_double(const char* field, double* value)
+{
+    char* end = NULL;
+    *value = strtod(field, &end);
+    return end != field;
+}
+
+/**
+ * Разбирает целое беззнаковое число поля.
+ * @param field Поле.
+ * @param value Значение.
+ * @return Флаг успешного разбора.
+ */
+static bool ctrd_parse_ulong(const char* field, unsigned long* value)
+{
+    char* end = NULL;
+    *value = strtoul(field, &end, 10);
+    return end != field;
+}
+
+static ctrd_err_t ctrd_cfg_parse_channels(ctrd_t* ctrd, ctrd_cfg_parser_t* parser)
+{
+    size_t i;
+
+    ctrd->analog = calloc(ctrd->analog_channels ? ctrd->analog_channels : 1, sizeof(ctrd_analog_channel_t));
+    ctrd->digital = calloc(ctrd->digital_channels ? ctrd->digital_channels : 1, sizeof(ctrd_digital_channel_t));
+    if(ctrd->analog == NULL || ctrd->digital == NULL) return CTRD_E_OUT_OF_MEMORY;
+
+    for(i = 0; i < ctrd->analog_channels; i ++){
+        if(!ctrd_cfg_next_line(parser) || parser->nfields < 10) return CTRD_E_INVALID_VALUE;
+
+        ctrd_analog_channel_t* ch = &ctrd->analog[i];
+
+        ctrd_copy_name(ch->ch_id, parser->fields[1]);
+        ctrd_copy_name(ch->uu, parser->fields[4]);
+
+        if(!ctrd_parse_double(parser->fields[5], &ch->a) ||
+           !ctrd_parse_double(parser->fields[6], &ch->b) ||
+           !ctrd_parse_double(parser->fields[8], &ch->min) ||
+           !ctrd_parse_double(parser->fields[9], &ch->max)) return CTRD_E_INVALID_VALUE;
+    }
+
+    for(i = 0; i < ctrd->digital_channels; i ++){
+        if(!ctrd_cfg_next_line(parser) || parser->nfields < 2) return CTRD_E_INVALID_VALUE;
+
+        ctrd_digital_channel_t* ch = &ctrd->digital[i];
+
+        ctrd_copy_name(ch->ch_id, parser->fields[1]);
+        ch->y = (parser->nfields > 4) ? atoi(parser->fields[4]) != 0 : false;
+    }
+
+    return CTRD_E_NO_ERROR;
+}
+
+static ctrd_err_t ctrd_cfg_parse_rates(ctrd_t* ctrd, ctrd_cfg_parser_t* parser)
+{
+    unsigned long nrates = 0;
+    unsigned long endsamp = 0;
+
+    if(!ctrd_cfg_next_line(parser) || !ctrd_parse_ulong(parser->fields[0], &nrates)) return CTRD_E_INVALID_VALUE;
+
+    // При отсутствии частоты дискретизации записывается
+    // одна строка с нулевой частотой, число семплов
+    // определяется размером данных.
+    if(nrates == 0){
+        if(!ctrd_cfg_next_line(parser)) return CTRD_E_INVALID_VALUE;
+        ctrd->samp = 0.0;
+        ctrd->endsamp_unknown = true;
+        return CTRD_E_NO_ERROR;
+    }
+
+    // Данные определяются последней частотой.
+    unsigned long i;
+    for(i = 0; i < nrates; i ++){
+        if(!ctrd_cfg_next_line(parser) || parser->nfields < 2) return CTRD_E_INVALID_VALUE;
+
+        if(!ctrd_parse_double(parser->fields[0], &ctrd->samp) ||
+           !ctrd_parse_ulong(parser->fields[1], &endsamp)) return CTRD_E_INVALID_VALUE;
+    }
+
+    if(endsamp > UINT32_MAX) return CTRD_E_INVALID_VALUE;
+
+    ctrd->endsamp = (uint32_t)endsamp;
+
+    return CTRD_E_NO_ERROR;
+}
+
+/**
+ * Разбирает имя типа данных CFG или заголовка секции DAT файла CFF.
+ * @param name Имя типа.
+ * @param dat_type Тип данных.
+ * @return Код ошибки.
+ */
+static ctrd_err_t ctrd_parse_dat_type(const char* name, ctrd_dat_type_t* dat_type)
+{
+    if(strcmp(name, "BINARY") == 0){
+        *dat_type = CTRD_DAT_BINARY;
+    }else if(strcmp(name, "BINARY32") == 0){
+        *dat_type = CTRD_DAT_BINARY32;
+    }else if(strcmp(name, "FLOAT32") == 0){
+        *dat_type = CTRD_DAT_FLOAT32;
+    }else if(strcmp(name, "ASCII") == 0){
+        // Логгер не пишет данные в текстовом виде.
+        return CTRD_E_NOT_IMPLEMENTED;
+    }else{
+        return CTRD_E_INVALID_VALUE;
+    }
+
+    return CTRD_E_NO_ERROR;
+}
+
+/**
+ * Разбирает текст CFG.
+ * @param ctrd Комтрейд.
+ * @param text Текст.
+ * @param size Размер текста.
+ * @return Код ошибки.
+ */
+static ctrd_err_t ctrd_cfg_parse(ctrd_t* ctrd, const char* text, size_t size)
+{
+    ctrd_err_t err = CTRD_E_NO_ERROR;
+    ctrd_cfg_parser_t parser;
+    unsigned long value = 0;
+
+    parser.pos = text;
+    parser.end = text + size;
+
+    // Станция, устройство и год стандарта.
+    if(!ctrd_cfg_next_line(&parser) || parser.nfields < 2) return CTRD_E_INVALID_VALUE;
+
+    ctrd_copy_name(ctrd->station_name, parser.fields[0]);
+    ctrd_copy_name(ctrd->rec_dev_id, parser.fields[1]);
+    ctrd->rev_year = (parser.nfields > 2) ? (unsigned int)atoi(parser.fields[2]) : 1991;
+
+    // Число каналов.
+    if(!ctrd_cfg_next_line(&parser) || parser.nfields < 3) return CTRD_E_INVALID_VALUE;
+
+    if(!ctrd_parse_ulong(parser.fields[1], &value)) return CTRD_E_INVALID_VALUE;
+    ctrd->analog_channels = value;
+
+    if(!ctrd_parse_ulong(parser.fields[2], &value)) return CTRD_E_INVALID_VALUE;
+    ctrd->digital_channels = value;
+
+    err = ctrd_cfg_parse_channels(ctrd, &parser);
+    if(err != CTRD_E_NO_ERROR) return err;
+
+    // Частота сети.
+    if(!ctrd_cfg_next_line(&parser) || !ctrd_parse_double(parser.fields[0], &ctrd->lf)) return CTRD_E_INVALID_VALUE;
+
+    err = ctrd_cfg_parse_rates(ctrd, &parser);
+    if(err != CTRD_E_NO_ERROR) return err;
+
+    // Время первых данных и события.
+    if(!ctrd_cfg_next_line(&parser) || parser.nfields < 2) return CTRD_E_INVALID_VALUE;
+    snprintf(ctrd->data_time, CTRD_DATETIME_LEN, "%s,%s", parser.fields[0], parser.fields[1]);
+
+    if(!ctrd_cfg_next_line(&parser) || parser.nfields < 2) return CTRD_E_INVALID_VALUE;
+    snprintf(ctrd->trigger_time, CTRD_DATETIME_LEN, "%s,%s", parser.fields[0], parser.fields[1]);
+
+    // Тип данных.
+    if(!ctrd_cfg_next_line(&parser)) return CTRD_E_INVALID_VALUE;
+
+    err = ctrd_parse_dat_type(parser.fields[0], &ctrd->dat_type);
+    if(err != CTRD_E_NO_ERROR) return err;
+
+    // Множитель отметки времени.
+    if(!ctrd_cfg_next_line(&parser) || !ctrd_parse_double(parser.fields[0], &ctrd->timemult)) return CTRD_E_INVALID_VALUE;
+
+    // Коды часового пояса и качества времени
+    // версии 2013 на чтение данных не влияют.
+
+    return CTRD_E_NO_ERROR;
+}
+
+size_t ctrd_record_size(ctrd_dat_type_t dat_type, size_t analog_channels, size_t digital_channels)
+{
+    // Индекс и отметка времени.
+    size_t index_size = CTRD_RECORD_HEAD_SIZE;
+
+    // Аналоговые каналы.
+    size_t analog_size = analog_channels * ((dat_type == CTRD_DAT_BINARY) ? sizeof(int16_t) : sizeof(int32_t));
+
+    // Цифровые каналы.
+    // В 16 битных значениях.
+    size_t digital_size = (digital_channels + (16 - 1)) / 16;
+    // В байтах.
+    digital_size *= 2;
+
+    return index_size + analog_size + digital_size;
+}
+
+/**
+ * Находит секции CFG и DAT файла CFF.
+ * @param ctrd Комтрейд.
+ * @param cfg Текст CFG.
+ * @param cfg_size Размер текста CFG.
+ * @param dat_type Тип данных из заголовка секции DAT.
+ * @return Код ошибки.
+ */
+static ctrd_err_t ctrd_cff_sections(ctrd_t* ctrd, const char** cfg, size_t* cfg_size, ctrd_dat_type_t* dat_type)
+{
+    const char* text = (const char*)ctrd->map.data;
+    size_t size = (size_t)ctrd->map.size;
+
+    size_t cfg_hdr_len = strlen(CTRD_CFF_CFG);
+    if(size < cfg_hdr_len || memcmp(text, CTRD_CFF_CFG, cfg_hdr_len) != 0) return CTRD_E_INVALID_VALUE;
+
+    const char* cfg_begin = memchr(text, '\n', size);
+    if(cfg_begin == NULL) return CTRD_E_INVALID_VALUE;
+    cfg_begin ++;
+
+    // Секция DAT последняя, после неё до конца файла
+    // могут быть только зарезервированные данные.
+    const char* dat_hdr = memmem(cfg_begin, size - (size_t)(cfg_begin - text), CTRD_CFF_DAT, strlen(CTRD_CFF_DAT));
+    if(dat_hdr == NULL) return CTRD_E_INVALID_VALUE;
+
+    // Конец секции CFG - заголовок следующей секции.
+    const char* cfg_end = memmem(cfg_begin, (size_t)(dat_hdr - cfg_begin) + strlen(CTRD_CFF_DAT),
+                                 "\n" CTRD_CFF_SECTION, strlen("\n" CTRD_CFF_SECTION));
+    *cfg = cfg_begin;
+    *cfg_size = (size_t)(cfg_end - cfg_begin) + 1;
+
+    const char* dat_hdr_begin = dat_hdr + strlen(CTRD_CFF_DAT);
+    const char* dat_hdr_end = memchr(dat_hdr_begin, '\n', size - (size_t)(dat_hdr_begin - text));
+    if(dat_hdr_end == NULL) return CTRD_E_INVALID_VALUE;
+
+    char line[CTRD_LINE_LEN];
+    size_t len = (size_t)(dat_hdr_end - dat_hdr_begin);
+    if(len >= CTRD_LINE_LEN) return CTRD_E_INVALID_VALUE;
+    memcpy(line, dat_hdr_begin, len);
+    line[len] = '\0';
+
+    // <тип>: <размер> ---
+    char* colon = strchr(line, ':');
+    if(colon == NULL || strstr(colon, CTRD_CFF_DAT_END) == NULL) return CTRD_E_INVALID_VALUE;
+    *colon = '\0';
+
+    ctrd_err_t err = ctrd_parse_dat_type(line, dat_type);
+    if(err != CTRD_E_NO_ERROR) return err;
+
+    unsigned long long dat_size = 0;
+    char* end = NULL;
+    dat_size = strtoull(colon + 1, &end, 10);
+    if(end == colon + 1) return CTRD_E_INVALID_VALUE;
+
+    ctrd->data_offset = (uint64_t)(dat_hdr_end + 1 - text);
+    ctrd->data_size = dat_size;
+
+    return CTRD_E_NO_ERROR;
+}
+
+/**
+ * Получает путь к файлу данных по пути к *.cfg.
+ * @param path Путь к *.cfg.
+ * @param dat_path Путь к *.dat.
+ * @param size Размер пути к *.dat.
+ * @return Код ошибки.
+ */
+static ctrd_err_t ctrd_dat_path(const char* path, char* dat_path, size_t size)
+{
+    size_t len = strlen(path);
+    if(len < 4 || len >= size) return CTRD_E_INVALID_VALUE;
+
+    memcpy(dat_path, path, len + 1);
+
+    // Регистр расширения сохраняется.
+    bool upper = dat_path[len - 3] == 'C';
+    memcpy(&dat_path[len - 3], upper ? "DAT" : "dat", 3);
+
+    return CTRD_E_NO_ERROR;
+}
+
+ctrd_err_t ctrd_open(ctrd_t* ctrd, const char* path)
+{
+    if(ctrd == NULL || path == NULL) return CTRD_E_NULL_POINTER;
+
+    memset(ctrd, 0x0, sizeof(ctrd_t));
+
+    ctrd_err_t err = CTRD_E_NO_ERROR;
+
+    size_t len = strlen(path);
+    if(len < 4 || path[len - 4] != '.') return CTRD_E_INVALID_VALUE;
+
+    ctrd->cff = strcasecmp(&path[len - 3], "cff") == 0;
+
+    if(ctrd->cff){
+        err = ctrd_map_open(&ctrd->map, path);
+        if(err != CTRD_E_NO_ERROR) return err;
+
+        const char* cfg = NULL;
+        size_t cfg_size = 0;
+        ctrd_dat_type_t dat_type = CTRD_DAT_BINARY;
+
+        err = ctrd_cff_sections(ctrd, &cfg, &cfg_size, &dat_type);
+        if(err == CTRD_E_NO_ERROR) err = ctrd_cfg_parse(ctrd, cfg, cfg_size);
+
+        // Размер записи зависит от типа, тип секции DAT должен совпадать с CFG.
+        if(err == CTRD_E_NO_ERROR && dat_type != ctrd->dat_type) err = CTRD_E_INVALID_VALUE;
+    }else{
+        ctrd_map_t cfg;
+
+        err = ctrd_map_open(&cfg, path);
+        if(err != CTRD_E_NO_ERROR) return err;
+
+        err = ctrd_cfg_parse(ctrd, (const char*)cfg.data, (size_t)cfg.size);
+
+        ctrd_map_close(&cfg);
+
+        char dat_path[FILENAME_MAX];
+        if(err == CTRD_E_NO_ERROR) err = ctrd_dat_path(path, dat_path, FILENAME_MAX);
+        if(err == CTRD_E_NO_ERROR) err = ctrd_map_open(&ctrd->map, dat_path);
+
+        ctrd->data_offset = 0;
+        ctrd->data_size = ctrd->map.size;
+    }
+
+    if(err != CTRD_E_NO_ERROR){
+        ctrd_close(ctrd);
+        return err;
+    }
+
+    ctrd->record_size = ctrd_record_size(ctrd->dat_type, ctrd->analog_channels, ctrd->digital_channels);
+
+    if(ctrd->endsamp_unknown){
+        uint64_t records = ctrd->data_size / ctrd->record_size;
+        ctrd->endsamp = (records > UINT32_MAX) ? UINT32_MAX : (uint32_t)records;
+    }
+
+    // Последовательное чтение при проверке и построении индекса.
+    if(ctrd->map.data) madvise((void*)ctrd->map.data, (size_t)ctrd->map.size, MADV_SEQUENTIAL);
+
+    return CTRD_E_NO_ERROR;
+}
+
+void ctrd_close(ctrd_t* ctrd)
+{
+    if(ctrd == NULL) return;
+
+    ctrd_map_close(&ctrd->map);
+
+    free(ctrd->analog);
+    free(ctrd->digital);
+
+    memset(ctrd, 0x0, sizeof(ctrd_t));
+}
+
+/**
+ * Получает число полных записей в данных.
+ * @param ctrd Комтрейд.
+ * @return Число записей.
+ */
+static uint64_t ctrd_records_present(const ctrd_t* ctrd)
+{
+    uint64_t size = ctrd->data_size;
+
+    if(ctrd->data_offset + size > ctrd->map.size){
+        size = (ctrd->map.size > ctrd->data_offset) ? ctrd->map.size - ctrd->data_offset : 0;
+    }
+
+    return size / ctrd->record_size;
+}
+
+uint64_t ctrd_records(const ctrd_t* ctrd)
+{
+    uint64_t present = ctrd_records_present(ctrd);
+
+    return (present < ctrd->endsamp) ? present : ctrd->endsamp;
+}
+
+const uint8_t* ctrd_record(const ctrd_t* ctrd, uint64_t sample)
+{
+    if(sample >= ctrd->endsamp) return NULL;
+
+    if(ctrd_record_offset(ctrd, sample + 1) > ctrd->map.size) return NULL;
+
+    return ctrd->map.data + ctrd_record_offset(ctrd, sample);
+}
+
+/**
+ * Читает 32 битное значение little-endian.
+ * @param ptr Данные.
+ * @return Значение.
+ */
+static uint32_t ctrd_get_u32(const uint8_t* ptr)
+{
+    return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) |
+           ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+void ctrd_release(const ctrd_t* ctrd, uint64_t sample)
+{
+    if(ctrd->map.data == NULL) return;
+
+    uint64_t end = ctrd_record_offset(ctrd, sample);
+    if(end > ctrd->map.size) end = ctrd->map.size;
+
+    // Освобождаются только целые блоки,
+    // чтобы не вызывать madvise на каждую запись.
+    end -= end % CTRD_RELEASE_SIZE;
+    if(end == 0) return;
+
+    // Страницы файла перечитываются с диска при следующем обращении.
+    madvise((void*)ctrd->map.data, (size_t)end, MADV_DONTNEED);
+}
+
+uint32_t ctrd_record_number(const uint8_t* rec)
+{
+    return ctrd_get_u32(rec);
+}
+
+uint32_t ctrd_record_timestamp(const uint8_t* rec)
+{
+    return ctrd_get_u32(rec + sizeof(uint32_t));
+}
+
+bool ctrd_record_raw(const ctrd_t* ctrd, const uint8_t* rec, size_t index, double* value)
+{
+    const uint8_t* ptr = rec + CTRD_RECORD_HEAD_SIZE;
+
+    switch(ctrd->dat_type){
+    default:
+    case CTRD_DAT_BINARY:{
+        ptr += index * sizeof(int16_t);
+        int16_t x = (int16_t)((uint16_t)ptr[0] | ((uint16_t)ptr[1] << 8));
+        *value = x;
+        return x != CTRD_DAT_MISSING;
+    }
+    case CTRD_DAT_BINARY32:{
+        ptr += index * sizeof(int32_t);
+        int32_t x = (int32_t)ctrd_get_u32(ptr);
+        *value = x;
+        return x != CTRD_DAT32_MISSING;
+    }
+    case CTRD_DAT_FLOAT32:{
+        ptr += index * sizeof(float);
+        uint32_t bits = ctrd_get_u32(ptr);
+        float x;
+        memcpy(&x, &bits, sizeof(float));
+        *value = x;
+        return !isnan(x);
+    }
+    }
+}
+
+double ctrd_record_analog(const ctrd_t* ctrd, const uint8_t* rec, size_t index)
+{
+    double x = 0.0;
+
+    if(!ctrd_record_raw(ctrd, rec, index, &x)) return NAN;
+
+    return ctrd->analog[index].a * x + ctrd->analog[index].b;
+}
+
+bool ctrd_record_digital(const ctrd_t* ctrd, const uint8_t* rec, size_t index)
+{
+    const uint8_t* ptr = rec + ctrd->record_size - ((ctrd->digital_channels + (16 - 1)) / 16) * 2;
+
+    return (ptr[index / 8] >> (index % 8)) & 0x1;
+}
+
+uint64_t ctrd_find_timestamp(const ctrd_t* ctrd, uint32_t timestamp)
+{
+    uint64_t count = ctrd_records(ctrd);
+    if(count == 0) return 0;
+
+    uint32_t first = ctrd_record_timestamp(ctrd_record(ctrd, 0));
+    if(timestamp <= first) return 0;
+
+    // Без пропусков отметка времени растёт на один за семпл.
+    uint64_t guess = (uint64_t)(timestamp - first);
+    if(guess < count){
+        if(ctrd_record_timestamp(ctrd_record(ctrd, guess)) == timestamp &&
+           ctrd_record_timestamp(ctrd_record(ctrd, guess - 1)) < timestamp) return guess;
+    }
+
+    // Отметки времени не убывают.
+    uint64_t lo = 0;
+    uint64_t hi = count;
+    while(lo < hi){
+        uint64_t mid = lo + (hi - lo) / 2;
+        if(ctrd_record_timestamp(ctrd_record(ctrd, mid)) < timestamp){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+ctrd_err_t ctrd_check(const ctrd_t* ctrd, ctrd_check_t* check)
+{
+    if(ctrd == NULL || check == NULL) return CTRD_E_NULL_POINTER;
+
+    memset(check, 0x0, sizeof(ctrd_check_t));
+    check->first_bad = UINT64_MAX;
+
+    uint64_t need = (uint64_t)ctrd->endsamp * ctrd->record_size;
+
+    check->records = ctrd_records(ctrd);
+
+    // Размер секции DAT файла CFF обновляется вместе с числом семплов.
+    if(ctrd->cff && ctrd->data_size != need) return CTRD_E_INVALID_VALUE;
+
+    // Файл данных может быть длиннее из-за резервирования места
+    // и записи после последнего обновления числа семплов.
+    if(ctrd->map.size > ctrd->data_offset + need){
+        check->extra_bytes = ctrd->map.size - ctrd->data_offset - need;
+    }
+
+    uint32_t last_timestamp = 0;
+    uint64_t i;
+    size_t ch;
+
+    for(i = 0; i < check->records; i ++){
+        const uint8_t* rec = ctrd_record(ctrd, i);
+        bool bad = false;
+
+        if(ctrd_record_number(rec) != (uint32_t)(i + 1)){
+            check->bad_numbers ++;
+            bad = true;
+        }
+
+        uint32_t timestamp = ctrd_record_timestamp(rec);
+        if(i != 0 && timestamp < last_timestamp){
+            check->bad_timestamps ++;
+            bad = true;
+        }
+        last_timestamp = timestamp;
+
+        for(ch = 0; ch < ctrd->analog_channels; ch ++){
+            double x;
+            if(!ctrd_record_raw(ctrd, rec, ch, &x)){
+                check->missing ++;
+                continue;
+            }
+            if(x < ctrd->analog[ch].min || x > ctrd->analog[ch].max){
+                check->out_of_range ++;
+                bad = true;
+            }
+        }
+
+        if(bad && check->first_bad == UINT64_MAX) check->first_bad = i;
+
+        if((i & 0xffff) == 0) ctrd_release(ctrd, i);
+    }
+
+    if(check->records < ctrd->endsamp) return CTRD_E_OUT_OF_RANGE;
+
+    return CTRD_E_NO_ERROR;
+}
+
+bool ctrd_check_ok(const ctrd_check_t* check)
+{
+    return check->bad_numbers == 0 && check->bad_timestamps == 0 && check->out_of_range == 0;
+}
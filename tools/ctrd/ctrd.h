@@ -0,0 +1,271 @@
+/**
+ * @file ctrd.h Библиотека чтения файлов COMTRADE логгера на компьютере.
+ * Файлы данных отображаются в память, записи читаются
+ * по номеру семпла без чтения всего файла.
+ */
+
+#ifndef CTRD_H_
+#define CTRD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+
+
+//! Максимальная длина строковых полей CFG.
+#define CTRD_NAME_LEN 64
+
+//! Максимальная длина строки даты и времени CFG.
+#define CTRD_DATETIME_LEN 32
+
+//! Несуществующее значение 16 битных данных.
+#define CTRD_DAT_MISSING ((int16_t)0x8000)
+
+//! Несуществующее значение 32 битных данных.
+#define CTRD_DAT32_MISSING ((int32_t)0x80000000)
+
+
+//! Коды ошибок.
+typedef enum _Ctrd_Err {
+    CTRD_E_NO_ERROR = 0, //!< Нет ошибки.
+    CTRD_E_NULL_POINTER, //!< Нулевой указатель.
+    CTRD_E_INVALID_VALUE, //!< Неверный формат файла.
+    CTRD_E_OUT_OF_RANGE, //!< Данных меньше, чем указано в CFG.
+    CTRD_E_OUT_OF_MEMORY, //!< Недостаточно памяти.
+    CTRD_E_IO_ERROR, //!< Ошибка ввода-вывода.
+    CTRD_E_NOT_IMPLEMENTED, //!< Формат не поддерживается.
+    CTRD_E_STATE //!< Индекс не соответствует файлу данных.
+} ctrd_err_t;
+
+//! Тип данных DAT файла.
+typedef enum _Ctrd_Dat_Type {
+    CTRD_DAT_BINARY = 0, //!< 16 битные целые.
+    CTRD_DAT_BINARY32 = 1, //!< 32 битные целые.
+    CTRD_DAT_FLOAT32 = 2 //!< 32 битные с плавающей запятой.
+} ctrd_dat_type_t;
+
+//! Описание аналогового канала.
+typedef struct _Ctrd_Analog_Channel {
+    char ch_id[CTRD_NAME_LEN]; //!< Идентификатор канала.
+    char uu[CTRD_NAME_LEN]; //!< Единица измерения.
+    double a; //!< Коэффициент значения.
+    double b; //!< Смещение значения.
+    double min; //!< Минимум значения в файле данных.
+    double max; //!< Максимум значения в файле данных.
+} ctrd_analog_channel_t;
+
+//! Описание цифрового канала.
+typedef struct _Ctrd_Digital_Channel {
+    char ch_id[CTRD_NAME_LEN]; //!< Идентификатор канала.
+    bool y; //!< Нормальное состояние канала.
+} ctrd_digital_channel_t;
+
+//! Отображённый в память файл.
+typedef struct _Ctrd_Map {
+    const uint8_t* data; //!< Данные.
+    uint64_t size; //!< Размер.
+    time_t mtime; //!< Время изменения.
+} ctrd_map_t;
+
+//! Открытые файлы COMTRADE.
+typedef struct _Ctrd {
+    // Конфигурация.
+    char station_name[CTRD_NAME_LEN]; //!< Имя станции.
+    char rec_dev_id[CTRD_NAME_LEN]; //!< Идентификатор записывающего устройства.
+    unsigned int rev_year; //!< Год версии стандарта.
+    size_t analog_channels; //!< Число аналоговых каналов.
+    ctrd_analog_channel_t* analog; //!< Аналоговые каналы.
+    size_t digital_channels; //!< Число цифровых каналов.
+    ctrd_digital_channel_t* digital; //!< Цифровые каналы.
+    double lf; //!< Частота сети.
+    double samp; //!< Частота дискретизации последней частоты.
+    uint32_t endsamp; //!< Номер последнего семпла.
+    bool endsamp_unknown; //!< Число семплов не указано в CFG.
+    char data_time[CTRD_DATETIME_LEN]; //!< Время первых данных.
+    char trigger_time[CTRD_DATETIME_LEN]; //!< Время события.
+    ctrd_dat_type_t dat_type; //!< Тип данных.
+    double timemult; //!< Множитель отметки времени, мкс.
+    bool cff; //!< Единый файл CFF.
+    // Данные.
+    ctrd_map_t map; //!< Файл данных (*.dat или *.cff).
+    uint64_t data_offset; //!< Начало записей в файле данных.
+    uint64_t data_size; //!< Размер данных в файле от начала записей.
+    size_t record_size; //!< Размер записи.
+} ctrd_t;
+
+//! Результат проверки файлов.
+typedef struct _Ctrd_Check {
+    uint64_t records; //!< Число полных записей в данных.
+    uint64_t extra_bytes; //!< Данные после последней записи по CFG.
+    uint64_t bad_numbers; //!< Записи с неверным номером семпла.
+    uint64_t bad_timestamps; //!< Записи с убывающей отметкой времени.
+    uint64_t out_of_range; //!< Значения вне границ канала.
+    uint64_t missing; //!< Несуществующие значения.
+    uint64_t first_bad; //!< Индекс первой ошибочной записи.
+} ctrd_check_t;
+
+
+/**
+ * Получает описание кода ошибки.
+ * @param err Код ошибки.
+ * @return Описание.
+ */
+extern const char* ctrd_strerror(ctrd_err_t err);
+
+/**
+ * Открывает файлы COMTRADE.
+ * Для *.cfg отображает в память файл *.dat с тем же именем,
+ * для *.cff - сам файл, записи начинаются с секции DAT.
+ * @param ctrd Комтрейд.
+ * @param path Путь к *.cfg или *.cff.
+ * @return Код ошибки.
+ */
+extern ctrd_err_t ctrd_open(ctrd_t* ctrd, const char* path);
+
+/**
+ * Закрывает файлы COMTRADE.
+ * @param ctrd Комтрейд.
+ */
+extern void ctrd_close(ctrd_t* ctrd);
+
+/**
+ * Вычисляет размер записи так же, как comtrade_dat_record_size().
+ * @param dat_type Тип данных.
+ * @param analog_channels Число аналоговых каналов.
+ * @param digital_channels Число цифровых каналов.
+ * @return Размер записи.
+ */
+extern size_t ctrd_record_size(ctrd_dat_type_t dat_type, size_t analog_channels, size_t digital_channels);
+
+/**
+ * Получает число семплов в файле по CFG.
+ * @param ctrd Комтрейд.
+ * @return Число семплов.
+ */
+static inline uint64_t ctrd_samples(const ctrd_t* ctrd)
+{
+    return ctrd->endsamp;
+}
+
+/**
+ * Получает число записей в данных.
+ * После сбоя записи данных может быть меньше, чем указано в CFG.
+ * @param ctrd Комтрейд.
+ * @return Число записей, не больше числа семплов по CFG.
+ */
+extern uint64_t ctrd_records(const ctrd_t* ctrd);
+
+/**
+ * Получает смещение записи в файле данных.
+ * @param ctrd Комтрейд.
+ * @param sample Индекс семпла.
+ * @return Смещение.
+ */
+static inline uint64_t ctrd_record_offset(const ctrd_t* ctrd, uint64_t sample)
+{
+    return ctrd->data_offset + sample * ctrd->record_size;
+}
+
+/**
+ * Получает запись семпла.
+ * @param ctrd Комтрейд.
+ * @param sample Индекс семпла.
+ * @return Запись, NULL если семпла нет в данных.
+ */
+extern const uint8_t* ctrd_record(const ctrd_t* ctrd, uint64_t sample);
+
+/**
+ * Освобождает память прочитанных данных до семпла.
+ * Вызывается при последовательном чтении,
+ * чтобы отображение файла не занимало память.
+ * @param ctrd Комтрейд.
+ * @param sample Индекс семпла.
+ */
+extern void ctrd_release(const ctrd_t* ctrd, uint64_t sample);
+
+/**
+ * Получает номер семпла записи.
+ * @param rec Запись.
+ * @return Номер семпла.
+ */
+extern uint32_t ctrd_record_number(const uint8_t* rec);
+
+/**
+ * Получает отметку времени записи.
+ * @param rec Запись.
+ * @return Отметка времени.
+ */
+extern uint32_t ctrd_record_timestamp(const uint8_t* rec);
+
+/**
+ * Получает значение аналогового канала в файле данных.
+ * @param ctrd Комтрейд.
+ * @param rec Запись.
+ * @param index Индекс канала.
+ * @param value Значение.
+ * @return Флаг существования значения.
+ */
+extern bool ctrd_record_raw(const ctrd_t* ctrd, const uint8_t* rec, size_t index, double* value);
+
+/**
+ * Получает значение аналогового канала a * x + b.
+ * @param ctrd Комтрейд.
+ * @param rec Запись.
+ * @param index Индекс канала.
+ * @return Значение, NAN для несуществующего значения.
+ */
+extern double ctrd_record_analog(const ctrd_t* ctrd, const uint8_t* rec, size_t index);
+
+/**
+ * Получает значение цифрового канала.
+ * @param ctrd Комтрейд.
+ * @param rec Запись.
+ * @param index Индекс канала.
+ * @return Значение.
+ */
+extern bool ctrd_record_digital(const ctrd_t* ctrd, const uint8_t* rec, size_t index);
+
+/**
+ * Ищет первый семпл с отметкой времени не меньше заданной.
+ * Отметки времени трендов идут с шагом в один семпл,
+ * поэтому семпл находится по разнице отметок за O(1),
+ * при пропусках - двоичным поиском.
+ * @param ctrd Комтрейд.
+ * @param timestamp Отметка времени.
+ * @return Индекс семпла, число семплов если такого нет.
+ */
+extern uint64_t ctrd_find_timestamp(const ctrd_t* ctrd, uint32_t timestamp);
+
+/**
+ * Проверяет размеры и записи файла данных.
+ * Записи читаются последовательно.
+ * @param ctrd Комтрейд.
+ * @param check Результат проверки.
+ * @return Код ошибки, CTRD_E_OUT_OF_RANGE если данных
+ *         меньше, чем указано в CFG.
+ */
+extern ctrd_err_t ctrd_check(const ctrd_t* ctrd, ctrd_check_t* check);
+
+/**
+ * Проверяет отсутствие ошибок в результате проверки.
+ * @param check Результат проверки.
+ * @return Флаг отсутствия ошибок.
+ */
+extern bool ctrd_check_ok(const ctrd_check_t* check);
+
+/**
+ * Отображает файл в память только для чтения.
+ * @param map Отображение.
+ * @param path Путь.
+ * @return Код ошибки.
+ */
+extern ctrd_err_t ctrd_map_open(ctrd_map_t* map, const char* path);
+
+/**
+ * Закрывает отображение файла.
+ * @param map Отображение.
+ */
+extern void ctrd_map_close(ctrd_map_t* map);
+
+#endif /* CTRD_H_ */
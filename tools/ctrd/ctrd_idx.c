@@ -0,0 +1,337 @@
+#include "ctrd_idx.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+
+//! Смещения полей заголовка индекса.
+#define CTRD_IDX_MAGIC_LEN 8
+#define CTRD_IDX_OFF_VERSION 8
+#define CTRD_IDX_OFF_RECORD_SIZE 12
+#define CTRD_IDX_OFF_DATA_OFFSET 16
+#define CTRD_IDX_OFF_FILE_SIZE 24
+#define CTRD_IDX_OFF_FILE_MTIME 32
+#define CTRD_IDX_OFF_SAMPLES 40
+#define CTRD_IDX_OFF_ANALOG 44
+#define CTRD_IDX_OFF_BLOCK_SAMPLES 48
+#define CTRD_IDX_OFF_BLOCKS 52
+
+//! Смещения полей записи блока.
+#define CTRD_IDX_BLOCK_OFF_OFFSET 0
+#define CTRD_IDX_BLOCK_OFF_FIRST 8
+#define CTRD_IDX_BLOCK_OFF_LAST 12
+
+//! Суффикс временного файла индекса.
+#define CTRD_IDX_TMP_SUFFIX ".tmp"
+
+
+// Значения в индексе хранятся в little-endian.
+
+static void ctrd_idx_put_u32(uint8_t* ptr, uint32_t value)
+{
+    ptr[0] = (uint8_t)value;
+    ptr[1] = (uint8_t)(value >> 8);
+    ptr[2] = (uint8_t)(value >> 16);
+    ptr[3] = (uint8_t)(value >> 24);
+}
+
+static void ctrd_idx_put_u64(uint8_t* ptr, uint64_t value)
+{
+    ctrd_idx_put_u32(ptr, (uint32_t)value);
+    ctrd_idx_put_u32(ptr + 4, (uint32_t)(value >> 32));
+}
+
+static void ctrd_idx_put_float(uint8_t* ptr, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(uint32_t));
+    ctrd_idx_put_u32(ptr, bits);
+}
+
+static uint32_t ctrd_idx_get_u32(const uint8_t* ptr)
+{
+    return (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) |
+           ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+}
+
+static uint64_t ctrd_idx_get_u64(const uint8_t* ptr)
+{
+    return (uint64_t)ctrd_idx_get_u32(ptr) | ((uint64_t)ctrd_idx_get_u32(ptr + 4) << 32);
+}
+
+static float ctrd_idx_get_float(const uint8_t* ptr)
+{
+    uint32_t bits = ctrd_idx_get_u32(ptr);
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+/**
+ * Получает размер записи блока.
+ * @param analog_channels Число аналоговых каналов.
+ * @return Размер записи блока.
+ */
+static size_t ctrd_idx_block_size(size_t analog_channels)
+{
+    return CTRD_IDX_BLOCK_HEAD_SIZE + analog_channels * 2 * sizeof(float);
+}
+
+ctrd_err_t ctrd_idx_path(const char* path, char* idx_path, size_t size)
+{
+    if(path == NULL || idx_path == NULL) return CTRD_E_NULL_POINTER;
+
+    size_t len = strlen(path);
+    if(len < 4 || path[len - 4] != '.' || len >= size) return CTRD_E_INVALID_VALUE;
+
+    memcpy(idx_path, path, len - 3);
+    memcpy(&idx_path[len - 3], CTRD_IDX_EXT, sizeof(CTRD_IDX_EXT));
+
+    return CTRD_E_NO_ERROR;
+}
+
+/**
+ * Записывает заголовок индекса.
+ * @param f Файл.
+ * @param header Заголовок.
+ * @return Код ошибки.
+ */
+static ctrd_err_t ctrd_idx_write_header(FILE* f, const ctrd_idx_header_t* header)
+{
+    uint8_t buf[CTRD_IDX_HEADER_SIZE];
+
+    memset(buf, 0x0, CTRD_IDX_HEADER_SIZE);
+
+    memcpy(buf, CTRD_IDX_MAGIC, CTRD_IDX_MAGIC_LEN);
+    ctrd_idx_put_u32(&buf[CTRD_IDX_OFF_VERSION], header->version);
+    ctrd_idx_put_u32(&buf[CTRD_IDX_OFF_RECORD_SIZE], header->record_size);
+    ctrd_idx_put_u64(&buf[CTRD_IDX_OFF_DATA_OFFSET], header->data_offset);
+    ctrd_idx_put_u64(&buf[CTRD_IDX_OFF_FILE_SIZE], header->data_file_size);
+    ctrd_idx_put_u64(&buf[CTRD_IDX_OFF_FILE_MTIME], (uint64_t)header->data_file_mtime);
+    ctrd_idx_put_u32(&buf[CTRD_IDX_OFF_SAMPLES], header->samples);
+    ctrd_idx_put_u32(&buf[CTRD_IDX_OFF_ANALOG], header->analog_channels);
+    ctrd_idx_put_u32(&buf[CTRD_IDX_OFF_BLOCK_SAMPLES], header->block_samples);
+    ctrd_idx_put_u32(&buf[CTRD_IDX_OFF_BLOCKS], header->blocks);
+
+    if(fwrite(buf, CTRD_IDX_HEADER_SIZE, 1, f) != 1) return CTRD_E_IO_ERROR;
+
+    return CTRD_E_NO_ERROR;
+}
+
+/**
+ * Вычисляет и записывает запись блока.
+ * @param f Файл.
+ * @param ctrd Комтрейд.
+ * @param first Индекс первого семпла блока.
+ * @param count Число семплов блока.
+ * @param buf Буфер записи блока.
+ * @return Код ошибки.
+ */
+static ctrd_err_t ctrd_idx_write_block(FILE* f, const ctrd_t* ctrd, uint64_t first, uint64_t count, uint8_t* buf)
+{
+    size_t ch;
+    uint64_t i;
+
+    const uint8_t* rec = ctrd_record(ctrd, first);
+    if(rec == NULL) return CTRD_E_OUT_OF_RANGE;
+
+    ctrd_idx_put_u64(&buf[CTRD_IDX_BLOCK_OFF_OFFSET], ctrd_record_offset(ctrd, first));
+    ctrd_idx_put_u32(&buf[CTRD_IDX_BLOCK_OFF_FIRST], ctrd_record_timestamp(rec));
+    ctrd_idx_put_u32(&buf[CTRD_IDX_BLOCK_OFF_LAST], ctrd_record_timestamp(ctrd_record(ctrd, first + count - 1)));
+
+    for(ch = 0; ch < ctrd->analog_channels; ch ++){
+        double min = INFINITY;
+        double max = -INFINITY;
+
+        // Блок помещается в кэш, поэтому каналы
+        // проходятся по записям блока отдельно.
+        for(i = 0; i < count; i ++){
+            double value = ctrd_record_analog(ctrd, ctrd_record(ctrd, first + i), ch);
+            if(isnan(value)) continue;
+            if(value < min) min = value;
+            if(value > max) max = value;
+        }
+
+        if(min > max){
+            min = NAN;
+            max = NAN;
+        }
+
+        uint8_t* ptr = &buf[CTRD_IDX_BLOCK_HEAD_SIZE + ch * 2 * sizeof(float)];
+        ctrd_idx_put_float(ptr, (float)min);
+        ctrd_idx_put_float(ptr + sizeof(float), (float)max);
+    }
+
+    if(fwrite(buf, ctrd_idx_block_size(ctrd->analog_channels), 1, f) != 1) return CTRD_E_IO_ERROR;
+
+    return CTRD_E_NO_ERROR;
+}
+
+ctrd_err_t ctrd_idx_build(const ctrd_t* ctrd, const char* idx_path, uint32_t block_samples)
+{
+    if(ctrd == NULL || idx_path == NULL) return CTRD_E_NULL_POINTER;
+    if(block_samples == 0) return CTRD_E_INVALID_VALUE;
+
+    ctrd_err_t err = CTRD_E_NO_ERROR;
+
+    uint64_t samples = ctrd_records(ctrd);
+
+    ctrd_idx_header_t header;
+    header.version = CTRD_IDX_VERSION;
+    header.record_size = (uint32_t)ctrd->record_size;
+    header.data_offset = ctrd->data_offset;
+    header.data_file_size = ctrd->map.size;
+    header.data_file_mtime = (int64_t)ctrd->map.mtime;
+    header.samples = (uint32_t)samples;
+    header.analog_channels = (uint32_t)ctrd->analog_channels;
+    header.block_samples = block_samples;
+    header.blocks = (uint32_t)((samples + block_samples - 1) / block_samples);
+
+    char tmp_path[FILENAME_MAX];
+    if(snprintf(tmp_path, FILENAME_MAX, "%s" CTRD_IDX_TMP_SUFFIX, idx_path) >= FILENAME_MAX) return CTRD_E_INVALID_VALUE;
+
+    uint8_t* buf = malloc(ctrd_idx_block_size(ctrd->analog_channels));
+    if(buf == NULL) return CTRD_E_OUT_OF_MEMORY;
+
+    FILE* f = fopen(tmp_path, "wb");
+    if(f == NULL){
+        free(buf);
+        return CTRD_E_IO_ERROR;
+    }
+
+    err = ctrd_idx_write_header(f, &header);
+
+    uint32_t block;
+    for(block = 0; err == CTRD_E_NO_ERROR && block < header.blocks; block ++){
+        uint64_t first = (uint64_t)block * block_samples;
+        uint64_t count = samples - first;
+        if(count > block_samples) count = block_samples;
+
+        err = ctrd_idx_write_block(f, ctrd, first, count, buf);
+
+        ctrd_release(ctrd, first);
+    }
+
+    free(buf);
+
+    if(fclose(f) != 0 && err == CTRD_E_NO_ERROR) err = CTRD_E_IO_ERROR;
+
+    if(err == CTRD_E_NO_ERROR && rename(tmp_path, idx_path) != 0) err = CTRD_E_IO_ERROR;
+
+    if(err != CTRD_E_NO_ERROR) remove(tmp_path);
+
+    return err;
+}
+
+ctrd_err_t ctrd_idx_open(ctrd_idx_t* idx, const char* idx_path)
+{
+    if(idx == NULL || idx_path == NULL) return CTRD_E_NULL_POINTER;
+
+    memset(idx, 0x0, sizeof(ctrd_idx_t));
+
+    ctrd_err_t err = ctrd_map_open(&idx->map, idx_path);
+    if(err != CTRD_E_NO_ERROR) return err;
+
+    const uint8_t* buf = idx->map.data;
+
+    if(idx->map.size < CTRD_IDX_HEADER_SIZE || memcmp(buf, CTRD_IDX_MAGIC, CTRD_IDX_MAGIC_LEN) != 0){
+        ctrd_idx_close(idx);
+        return CTRD_E_INVALID_VALUE;
+    }
+
+    ctrd_idx_header_t* header = &idx->header;
+    header->version = ctrd_idx_get_u32(&buf[CTRD_IDX_OFF_VERSION]);
+    header->record_size = ctrd_idx_get_u32(&buf[CTRD_IDX_OFF_RECORD_SIZE]);
+    header->data_offset = ctrd_idx_get_u64(&buf[CTRD_IDX_OFF_DATA_OFFSET]);
+    header->data_file_size = ctrd_idx_get_u64(&buf[CTRD_IDX_OFF_FILE_SIZE]);
+    header->data_file_mtime = (int64_t)ctrd_idx_get_u64(&buf[CTRD_IDX_OFF_FILE_MTIME]);
+    header->samples = ctrd_idx_get_u32(&buf[CTRD_IDX_OFF_SAMPLES]);
+    header->analog_channels = ctrd_idx_get_u32(&buf[CTRD_IDX_OFF_ANALOG]);
+    header->block_samples = ctrd_idx_get_u32(&buf[CTRD_IDX_OFF_BLOCK_SAMPLES]);
+    header->blocks = ctrd_idx_get_u32(&buf[CTRD_IDX_OFF_BLOCKS]);
+
+    idx->block_size = ctrd_idx_block_size(header->analog_channels);
+
+    if(header->version != CTRD_IDX_VERSION ||
+       idx->map.size != CTRD_IDX_HEADER_SIZE + (uint64_t)header->blocks * idx->block_size){
+        ctrd_idx_close(idx);
+        return CTRD_E_INVALID_VALUE;
+    }
+
+    return CTRD_E_NO_ERROR;
+}
+
+void ctrd_idx_close(ctrd_idx_t* idx)
+{
+    if(idx == NULL) return;
+
+    ctrd_map_close(&idx->map);
+
+    memset(idx, 0x0, sizeof(ctrd_idx_t));
+}
+
+bool ctrd_idx_match(const ctrd_idx_t* idx, const ctrd_t* ctrd)
+{
+    const ctrd_idx_header_t* header = &idx->header;
+
+    return header->record_size == ctrd->record_size &&
+           header->data_offset == ctrd->data_offset &&
+           header->data_file_size == ctrd->map.size &&
+           header->data_file_mtime == (int64_t)ctrd->map.mtime &&
+           header->samples == ctrd_records(ctrd) &&
+           header->analog_channels == ctrd->analog_channels;
+}
+
+/**
+ * Получает запись блока.
+ * @param idx Индекс.
+ * @param block Номер блока.
+ * @return Запись блока.
+ */
+static const uint8_t* ctrd_idx_block(const ctrd_idx_t* idx, uint32_t block)
+{
+    return idx->map.data + CTRD_IDX_HEADER_SIZE + (uint64_t)block * idx->block_size;
+}
+
+uint64_t ctrd_idx_block_offset(const ctrd_idx_t* idx, uint32_t block)
+{
+    return ctrd_idx_get_u64(ctrd_idx_block(idx, block) + CTRD_IDX_BLOCK_OFF_OFFSET);
+}
+
+uint32_t ctrd_idx_block_first_timestamp(const ctrd_idx_t* idx, uint32_t block)
+{
+    return ctrd_idx_get_u32(ctrd_idx_block(idx, block) + CTRD_IDX_BLOCK_OFF_FIRST);
+}
+
+uint32_t ctrd_idx_block_last_timestamp(const ctrd_idx_t* idx, uint32_t block)
+{
+    return ctrd_idx_get_u32(ctrd_idx_block(idx, block) + CTRD_IDX_BLOCK_OFF_LAST);
+}
+
+float ctrd_idx_block_min(const ctrd_idx_t* idx, uint32_t block, size_t index)
+{
+    return ctrd_idx_get_float(ctrd_idx_block(idx, block) + CTRD_IDX_BLOCK_HEAD_SIZE + index * 2 * sizeof(float));
+}
+
+float ctrd_idx_block_max(const ctrd_idx_t* idx, uint32_t block, size_t index)
+{
+    return ctrd_idx_get_float(ctrd_idx_block(idx, block) + CTRD_IDX_BLOCK_HEAD_SIZE + (index * 2 + 1) * sizeof(float));
+}
+
+uint32_t ctrd_idx_find_timestamp(const ctrd_idx_t* idx, uint32_t timestamp)
+{
+    // Отметки времени не убывают.
+    uint32_t lo = 0;
+    uint32_t hi = idx->header.blocks;
+    while(lo < hi){
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(ctrd_idx_block_last_timestamp(idx, mid) < timestamp){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
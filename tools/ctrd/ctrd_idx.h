@@ -0,0 +1,151 @@
+/**
+ * @file ctrd_idx.h Индекс файлов данных COMTRADE.
+ * Индекс хранится рядом с файлом данных (*.idx) и содержит
+ * для каждого блока семплов смещение первой записи, отметки
+ * времени первого и последнего семпла и минимум и максимум
+ * каждого аналогового канала. Записи блоков одного размера,
+ * поэтому блок читается по номеру без чтения всего индекса.
+ */
+
+#ifndef CTRD_IDX_H_
+#define CTRD_IDX_H_
+
+#include "ctrd.h"
+
+
+//! Сигнатура файла индекса.
+#define CTRD_IDX_MAGIC "CTRDIDX1"
+
+//! Версия формата индекса.
+#define CTRD_IDX_VERSION 1
+
+//! Размер заголовка индекса.
+#define CTRD_IDX_HEADER_SIZE 64
+
+//! Размер записи блока без значений каналов.
+#define CTRD_IDX_BLOCK_HEAD_SIZE 16
+
+//! Число семплов в блоке индекса по-умолчанию.
+#define CTRD_IDX_BLOCK_SAMPLES 1024
+
+//! Расширение файла индекса.
+#define CTRD_IDX_EXT "idx"
+
+
+//! Заголовок индекса.
+typedef struct _Ctrd_Idx_Header {
+    uint32_t version; //!< Версия формата.
+    uint32_t record_size; //!< Размер записи данных.
+    uint64_t data_offset; //!< Начало записей в файле данных.
+    uint64_t data_file_size; //!< Размер файла данных при построении.
+    int64_t data_file_mtime; //!< Время изменения файла данных при построении.
+    uint32_t samples; //!< Число семплов.
+    uint32_t analog_channels; //!< Число аналоговых каналов.
+    uint32_t block_samples; //!< Число семплов в блоке.
+    uint32_t blocks; //!< Число блоков.
+} ctrd_idx_header_t;
+
+//! Открытый индекс.
+typedef struct _Ctrd_Idx {
+    ctrd_map_t map; //!< Файл индекса.
+    ctrd_idx_header_t header; //!< Заголовок.
+    size_t block_size; //!< Размер записи блока.
+} ctrd_idx_t;
+
+
+/**
+ * Получает путь к индексу по пути к *.cfg или *.cff.
+ * @param path Путь к файлу COMTRADE.
+ * @param idx_path Путь к индексу.
+ * @param size Размер пути к индексу.
+ * @return Код ошибки.
+ */
+extern ctrd_err_t ctrd_idx_path(const char* path, char* idx_path, size_t size);
+
+/**
+ * Строит индекс за один последовательный проход по данным.
+ * Индекс записывается во временный файл и переименовывается,
+ * поэтому читатели не видят недописанный индекс.
+ * @param ctrd Комтрейд.
+ * @param idx_path Путь к индексу.
+ * @param block_samples Число семплов в блоке.
+ * @return Код ошибки.
+ */
+extern ctrd_err_t ctrd_idx_build(const ctrd_t* ctrd, const char* idx_path, uint32_t block_samples);
+
+/**
+ * Открывает индекс.
+ * @param idx Индекс.
+ * @param idx_path Путь к индексу.
+ * @return Код ошибки.
+ */
+extern ctrd_err_t ctrd_idx_open(ctrd_idx_t* idx, const char* idx_path);
+
+/**
+ * Закрывает индекс.
+ * @param idx Индекс.
+ */
+extern void ctrd_idx_close(ctrd_idx_t* idx);
+
+/**
+ * Проверяет соответствие индекса файлу данных.
+ * Индекс продолжаемого тренда устаревает
+ * при каждой синхронизации файла.
+ * @param idx Индекс.
+ * @param ctrd Комтрейд.
+ * @return Флаг соответствия.
+ */
+extern bool ctrd_idx_match(const ctrd_idx_t* idx, const ctrd_t* ctrd);
+
+/**
+ * Получает смещение первой записи блока в файле данных.
+ * @param idx Индекс.
+ * @param block Номер блока.
+ * @return Смещение.
+ */
+extern uint64_t ctrd_idx_block_offset(const ctrd_idx_t* idx, uint32_t block);
+
+/**
+ * Получает отметку времени первого семпла блока.
+ * @param idx Индекс.
+ * @param block Номер блока.
+ * @return Отметка времени.
+ */
+extern uint32_t ctrd_idx_block_first_timestamp(const ctrd_idx_t* idx, uint32_t block);
+
+/**
+ * Получает отметку времени последнего семпла блока.
+ * @param idx Индекс.
+ * @param block Номер блока.
+ * @return Отметка времени.
+ */
+extern uint32_t ctrd_idx_block_last_timestamp(const ctrd_idx_t* idx, uint32_t block);
+
+/**
+ * Получает минимум аналогового канала в блоке.
+ * @param idx Индекс.
+ * @param block Номер блока.
+ * @param index Индекс канала.
+ * @return Минимум, NAN если все значения не существуют.
+ */
+extern float ctrd_idx_block_min(const ctrd_idx_t* idx, uint32_t block, size_t index);
+
+/**
+ * Получает максимум аналогового канала в блоке.
+ * @param idx Индекс.
+ * @param block Номер блока.
+ * @param index Индекс канала.
+ * @return Максимум, NAN если все значения не существуют.
+ */
+extern float ctrd_idx_block_max(const ctrd_idx_t* idx, uint32_t block, size_t index);
+
+/**
+ * Ищет блок, содержащий первый семпл с отметкой
+ * времени не меньше заданной.
+ * @param idx Индекс.
+ * @param timestamp Отметка времени.
+ * @return Номер блока, число блоков если такого нет.
+ */
+extern uint32_t ctrd_idx_find_timestamp(const ctrd_idx_t* idx, uint32_t timestamp);
+
+#endif /* CTRD_IDX_H_ */
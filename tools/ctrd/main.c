@@ -0,0 +1,394 @@
+/**
+ * @file main.c Утилита чтения, проверки и индексации файлов COMTRADE логгера.
+ * Вывод записывается по мере чтения записей,
+ * файлы данных целиком в память не загружаются.
+ */
+
+#include "ctrd.h"
+#include "ctrd_idx.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+
+//! Коды возврата.
+//! Успех.
+#define CTRD_EXIT_OK 0
+//! Ошибки в данных.
+#define CTRD_EXIT_INVALID 1
+//! Ошибка аргументов или ввода-вывода.
+#define CTRD_EXIT_ERROR 2
+
+//! Размер буфера вывода.
+#define CTRD_OUT_BUF_SIZE 65536
+
+
+//! Параметры команд.
+typedef struct _Ctrd_Opts {
+    uint32_t block_samples; //!< Число семплов в блоке индекса.
+    uint64_t first; //!< Номер первого семпла.
+    uint64_t count; //!< Число семплов или блоков.
+    bool has_from; //!< Флаг начальной отметки времени.
+    uint32_t from; //!< Начальная отметка времени.
+    bool has_to; //!< Флаг конечной отметки времени.
+    uint32_t to; //!< Конечная отметка времени.
+} ctrd_opts_t;
+
+//! Команда.
+typedef struct _Ctrd_Cmd {
+    const char* name; //!< Имя.
+    int (*proc)(const char* path, const ctrd_opts_t* opts); //!< Обработка одного файла.
+    const char* help; //!< Описание.
+} ctrd_cmd_t;
+
+
+static void print_error(const char* path, ctrd_err_t err)
+{
+    fprintf(stderr, "%s: %s\n", path, ctrd_strerror(err));
+}
+
+static const char* dat_type_name(ctrd_dat_type_t dat_type)
+{
+    switch(dat_type){
+    case CTRD_DAT_BINARY:
+        return "BINARY";
+    case CTRD_DAT_BINARY32:
+        return "BINARY32";
+    case CTRD_DAT_FLOAT32:
+        return "FLOAT32";
+    }
+    return "?";
+}
+
+static int cmd_info(const char* path, const ctrd_opts_t* opts)
+{
+    (void) opts;
+
+    ctrd_t ctrd;
+    ctrd_err_t err = ctrd_open(&ctrd, path);
+    if(err != CTRD_E_NO_ERROR){
+        print_error(path, err);
+        return CTRD_EXIT_ERROR;
+    }
+
+    printf("file: %s\n", path);
+    printf("station: %s\n", ctrd.station_name);
+    printf("device: %s\n", ctrd.rec_dev_id);
+    printf("revision: %u%s\n", ctrd.rev_year, ctrd.cff ? " (cff)" : "");
+    printf("channels: %zuA %zuD\n", ctrd.analog_channels, ctrd.digital_channels);
+    printf("rate: %g Hz\n", ctrd.samp);
+    printf("samples: %u\n", ctrd.endsamp);
+    printf("records: %llu\n", (unsigned long long)ctrd_records(&ctrd));
+    printf("start: %s\n", ctrd.data_time);
+    printf("trigger: %s\n", ctrd.trigger_time);
+    printf("type: %s\n", dat_type_name(ctrd.dat_type));
+    printf("timemult: %g us\n", ctrd.timemult);
+    printf("record size: %zu\n", ctrd.record_size);
+    printf("data offset: %llu\n", (unsigned long long)ctrd.data_offset);
+    printf("data file size: %llu\n", (unsigned long long)ctrd.map.size);
+
+    size_t i;
+    for(i = 0; i < ctrd.analog_channels; i ++){
+        ctrd_analog_channel_t* ch = &ctrd.analog[i];
+        printf("A%zu: %s, %s, a=%.9g, b=%.9g, [%g, %g]\n", i + 1, ch->ch_id, ch->uu, ch->a, ch->b, ch->min, ch->max);
+    }
+    for(i = 0; i < ctrd.digital_channels; i ++){
+        printf("D%zu: %s\n", i + 1, ctrd.digital[i].ch_id);
+    }
+
+    ctrd_close(&ctrd);
+
+    return CTRD_EXIT_OK;
+}
+
+static int cmd_check(const char* path, const ctrd_opts_t* opts)
+{
+    (void) opts;
+
+    ctrd_t ctrd;
+    ctrd_err_t err = ctrd_open(&ctrd, path);
+    if(err != CTRD_E_NO_ERROR){
+        print_error(path, err);
+        return CTRD_EXIT_INVALID;
+    }
+
+    ctrd_check_t check;
+    err = ctrd_check(&ctrd, &check);
+
+    printf("%s: samples=%u records=%llu record_size=%zu extra_bytes=%llu"
+           " bad_numbers=%llu bad_timestamps=%llu out_of_range=%llu missing=%llu",
+           path, ctrd.endsamp, (unsigned long long)check.records, ctrd.record_size,
+           (unsigned long long)check.extra_bytes, (unsigned long long)check.bad_numbers,
+           (unsigned long long)check.bad_timestamps, (unsigned long long)check.out_of_range,
+           (unsigned long long)check.missing);
+
+    if(check.first_bad != UINT64_MAX) printf(" first_bad=%llu", (unsigned long long)check.first_bad + 1);
+
+    bool ok = err == CTRD_E_NO_ERROR && ctrd_check_ok(&check);
+
+    printf(" %s\n", ok ? "OK" : (err != CTRD_E_NO_ERROR) ? ctrd_strerror(err) : "INVALID");
+
+    ctrd_close(&ctrd);
+
+    return ok ? CTRD_EXIT_OK : CTRD_EXIT_INVALID;
+}
+
+/**
+ * Открывает индекс, при отсутствии или
+ * несоответствии данным строит его заново.
+ * @param idx Индекс.
+ * @param ctrd Комтрейд.
+ * @param path Путь к файлу COMTRADE.
+ * @param block_samples Число семплов в блоке нового индекса.
+ * @param force Флаг построения существующего индекса.
+ * @return Код ошибки.
+ */
+static ctrd_err_t open_index(ctrd_idx_t* idx, const ctrd_t* ctrd, const char* path, uint32_t block_samples, bool force)
+{
+    char idx_path[FILENAME_MAX];
+
+    ctrd_err_t err = ctrd_idx_path(path, idx_path, FILENAME_MAX);
+    if(err != CTRD_E_NO_ERROR) return err;
+
+    if(!force && ctrd_idx_open(idx, idx_path) == CTRD_E_NO_ERROR){
+        if(ctrd_idx_match(idx, ctrd)) return CTRD_E_NO_ERROR;
+        ctrd_idx_close(idx);
+    }
+
+    err = ctrd_idx_build(ctrd, idx_path, block_samples);
+    if(err != CTRD_E_NO_ERROR) return err;
+
+    return ctrd_idx_open(idx, idx_path);
+}
+
+static int cmd_index(const char* path, const ctrd_opts_t* opts)
+{
+    ctrd_t ctrd;
+    ctrd_err_t err = ctrd_open(&ctrd, path);
+    if(err != CTRD_E_NO_ERROR){
+        print_error(path, err);
+        return CTRD_EXIT_ERROR;
+    }
+
+    ctrd_idx_t idx;
+    err = open_index(&idx, &ctrd, path, opts->block_samples, true);
+    if(err != CTRD_E_NO_ERROR){
+        print_error(path, err);
+        ctrd_close(&ctrd);
+        return CTRD_EXIT_ERROR;
+    }
+
+    printf("%s: %u samples, %u blocks of %u\n", path, idx.header.samples, idx.header.blocks, idx.header.block_samples);
+
+    ctrd_idx_close(&idx);
+    ctrd_close(&ctrd);
+
+    return CTRD_EXIT_OK;
+}
+
+static void print_value(double value)
+{
+    if(isnan(value)){
+        fputs(",", stdout);
+    }else{
+        printf(",%.9g", value);
+    }
+}
+
+static int cmd_dump(const char* path, const ctrd_opts_t* opts)
+{
+    ctrd_t ctrd;
+    ctrd_err_t err = ctrd_open(&ctrd, path);
+    if(err != CTRD_E_NO_ERROR){
+        print_error(path, err);
+        return CTRD_EXIT_ERROR;
+    }
+
+    uint64_t records = ctrd_records(&ctrd);
+    uint64_t sample = (opts->first != 0) ? opts->first - 1 : 0;
+    if(opts->has_from){
+        uint64_t from = ctrd_find_timestamp(&ctrd, opts->from);
+        if(from > sample) sample = from;
+    }
+
+    size_t i;
+
+    fputs("n,timestamp", stdout);
+    for(i = 0; i < ctrd.analog_channels; i ++) printf(",%s", ctrd.analog[i].ch_id);
+    for(i = 0; i < ctrd.digital_channels; i ++) printf(",%s", ctrd.digital[i].ch_id);
+    fputs("\n", stdout);
+
+    uint64_t n;
+    for(n = 0; sample < records && (opts->count == 0 || n < opts->count); sample ++, n ++){
+        const uint8_t* rec = ctrd_record(&ctrd, sample);
+        uint32_t timestamp = ctrd_record_timestamp(rec);
+
+        if(opts->has_to && timestamp > opts->to) break;
+
+        printf("%u,%u", ctrd_record_number(rec), timestamp);
+
+        for(i = 0; i < ctrd.analog_channels; i ++){
+            print_value(ctrd_record_analog(&ctrd, rec, i));
+        }
+        for(i = 0; i < ctrd.digital_channels; i ++){
+            printf(",%d", (int)ctrd_record_digital(&ctrd, rec, i));
+        }
+        fputs("\n", stdout);
+
+        if((n & 0xffff) == 0) ctrd_release(&ctrd, sample);
+    }
+
+    ctrd_close(&ctrd);
+
+    return ferror(stdout) ? CTRD_EXIT_ERROR : CTRD_EXIT_OK;
+}
+
+static int cmd_env(const char* path, const ctrd_opts_t* opts)
+{
+    ctrd_t ctrd;
+    ctrd_err_t err = ctrd_open(&ctrd, path);
+    if(err != CTRD_E_NO_ERROR){
+        print_error(path, err);
+        return CTRD_EXIT_ERROR;
+    }
+
+    ctrd_idx_t idx;
+    err = open_index(&idx, &ctrd, path, opts->block_samples, false);
+    if(err != CTRD_E_NO_ERROR){
+        print_error(path, err);
+        ctrd_close(&ctrd);
+        return CTRD_EXIT_ERROR;
+    }
+
+    uint32_t block = opts->has_from ? ctrd_idx_find_timestamp(&idx, opts->from) : 0;
+
+    size_t i;
+
+    fputs("offset,first_timestamp,last_timestamp", stdout);
+    for(i = 0; i < ctrd.analog_channels; i ++) printf(",%s_min,%s_max", ctrd.analog[i].ch_id, ctrd.analog[i].ch_id);
+    fputs("\n", stdout);
+
+    uint64_t n;
+    for(n = 0; block < idx.header.blocks && (opts->count == 0 || n < opts->count); block ++, n ++){
+        uint32_t first = ctrd_idx_block_first_timestamp(&idx, block);
+
+        if(opts->has_to && first > opts->to) break;
+
+        printf("%llu,%u,%u", (unsigned long long)ctrd_idx_block_offset(&idx, block),
+               first, ctrd_idx_block_last_timestamp(&idx, block));
+
+        for(i = 0; i < ctrd.analog_channels; i ++){
+            print_value(ctrd_idx_block_min(&idx, block, i));
+            print_value(ctrd_idx_block_max(&idx, block, i));
+        }
+        fputs("\n", stdout);
+    }
+
+    ctrd_idx_close(&idx);
+    ctrd_close(&ctrd);
+
+    return ferror(stdout) ? CTRD_EXIT_ERROR : CTRD_EXIT_OK;
+}
+
+//! Команды.
+static const ctrd_cmd_t commands[] = {
+    {"info", cmd_info, "print configuration and data sizes"},
+    {"check", cmd_check, "validate record size, numbering, timestamps and ranges"},
+    {"index", cmd_index, "build the <name>.idx sidecar index"},
+    {"dump", cmd_dump, "print samples as CSV"},
+    {"env", cmd_env, "print per-block min/max envelope as CSV (builds index if stale)"},
+};
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "usage: %s <command> [options] <file.cfg|file.cff>...\n", prog);
+    fprintf(stderr, "commands:\n");
+
+    size_t i;
+    for(i = 0; i < sizeof(commands) / sizeof(commands[0]); i ++){
+        fprintf(stderr, "  %-6s %s\n", commands[i].name, commands[i].help);
+    }
+
+    fprintf(stderr, "options:\n"
+                    "  -b N   samples per index block (default %u)\n"
+                    "  -s N   first sample number (dump)\n"
+                    "  -n N   number of samples (dump) or blocks (env)\n"
+                    "  -t T   first timestamp (dump, env)\n"
+                    "  -T T   last timestamp (dump, env)\n",
+                    CTRD_IDX_BLOCK_SAMPLES);
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2){
+        usage(argv[0]);
+        return CTRD_EXIT_ERROR;
+    }
+
+    const ctrd_cmd_t* cmd = NULL;
+
+    size_t i;
+    for(i = 0; i < sizeof(commands) / sizeof(commands[0]); i ++){
+        if(strcmp(argv[1], commands[i].name) == 0) cmd = &commands[i];
+    }
+    if(cmd == NULL){
+        usage(argv[0]);
+        return CTRD_EXIT_ERROR;
+    }
+
+    ctrd_opts_t opts;
+    memset(&opts, 0x0, sizeof(ctrd_opts_t));
+    opts.block_samples = CTRD_IDX_BLOCK_SAMPLES;
+
+    // Опции после имени команды.
+    optind = 2;
+
+    int opt;
+    while((opt = getopt(argc, argv, "b:s:n:t:T:")) != -1){
+        switch(opt){
+        case 'b':
+            opts.block_samples = (uint32_t)strtoul(optarg, NULL, 0);
+            if(opts.block_samples == 0){
+                usage(argv[0]);
+                return CTRD_EXIT_ERROR;
+            }
+            break;
+        case 's':
+            opts.first = strtoull(optarg, NULL, 0);
+            break;
+        case 'n':
+            opts.count = strtoull(optarg, NULL, 0);
+            break;
+        case 't':
+            opts.has_from = true;
+            opts.from = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'T':
+            opts.has_to = true;
+            opts.to = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+            return CTRD_EXIT_ERROR;
+        }
+    }
+
+    if(optind >= argc){
+        usage(argv[0]);
+        return CTRD_EXIT_ERROR;
+    }
+
+    setvbuf(stdout, NULL, _IOFBF, CTRD_OUT_BUF_SIZE);
+
+    int res = CTRD_EXIT_OK;
+
+    int arg;
+    for(arg = optind; arg < argc; arg ++){
+        int r = cmd->proc(argv[arg], &opts);
+        if(r > res) res = r;
+    }
+
+    return res;
+}
@@ -0,0 +1,325 @@
+/**
+ * @file test_comtrade.c Проверка чтения файлов, записанных comtrade.c.
+ * Файлы пишутся на диск FatFs в памяти из tools/sim
+ * для всех типов данных отдельными CFG и DAT и единым CFF,
+ * копируются во временный каталог и читаются ctrd.
+ * Проверяются конфигурация, номера и отметки времени семплов
+ * и значения всех каналов.
+ */
+
+#include "ctrd.h"
+#include "comtrade.h"
+#include "ramdisk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+
+//! Число семплов.
+#define TEST_SAMPLES 1000
+//! Число аналоговых каналов.
+#define TEST_ANALOG 5
+//! Число цифровых каналов.
+#define TEST_DIGITAL 19
+//! Число семплов за вызов записи.
+#define TEST_RUN 37
+
+//! Размер диска, секторов (40 Мб).
+#define TEST_DISK_SECTORS (40 * 1024 * 2)
+
+//! Допустимая погрешность значения FLOAT32.
+#define TEST_FLOAT32_EPS 1e-3
+
+
+//! Имена типов данных.
+static const char* test_dat_type_names[] = {
+    "binary", "binary32", "float32"
+};
+
+static char test_dir[] = "/tmp/ctrd_test_XXXXXX";
+
+static size_t test_errors = 0;
+
+
+//! Получает значение аналогового канала в файле данных BINARY.
+static int16_t test_raw(size_t index, size_t sample)
+{
+    return (int16_t)((sample * 31 + index * 977) % 30000) - 15000;
+}
+
+static void test_get_analog_channel(comtrade_t* comtrade, size_t index, comtrade_analog_channel_t* channel)
+{
+    (void) comtrade; (void) index;
+
+    channel->ch_id = "U";
+    channel->uu = "V";
+    channel->a = IQ15(1);
+    channel->min = COMTRADE_DAT_MIN;
+    channel->max = COMTRADE_DAT_MAX;
+    channel->primary = IQ15(1);
+    channel->secondary = IQ15(1);
+    channel->ps = COMTRADE_PS_PRIMARY;
+}
+
+static void test_get_digital_channel(comtrade_t* comtrade, size_t index, comtrade_digital_channel_t* channel)
+{
+    (void) comtrade; (void) index;
+
+    channel->ch_id = "DI";
+}
+
+static void test_get_sample_rate(comtrade_t* comtrade, size_t index, comtrade_sample_rate_t* rate)
+{
+    (void) comtrade; (void) index;
+
+    rate->samp = IQ15(1600);
+    rate->endsamp = TEST_SAMPLES;
+}
+
+static int16_t test_analog_value(comtrade_t* comtrade, size_t index, size_t sample)
+{
+    (void) comtrade;
+    return test_raw(index, sample);
+}
+
+//! Значение в единицах канала: x / 2048.
+static iq15_t test_analog_real_value(comtrade_t* comtrade, size_t index, size_t sample)
+{
+    (void) comtrade;
+    return (iq15_t)test_raw(index, sample) * 16;
+}
+
+static bool test_digital_value(comtrade_t* comtrade, size_t index, size_t sample)
+{
+    (void) comtrade;
+    return (((sample * 2654435761u) >> 7) >> index) & 0x1;
+}
+
+/**
+ * Копирует файл с диска в памяти во временный каталог.
+ * @param name Имя файла.
+ * @return Флаг успеха.
+ */
+static bool test_copy(const char* name)
+{
+    static uint8_t buf[4096];
+    char path[64];
+    FIL f;
+    UINT read;
+
+    snprintf(path, sizeof(path), "%s/%s", test_dir, name);
+
+    if(f_open(&f, name, FA_READ) != FR_OK) return false;
+
+    FILE* out = fopen(path, "wb");
+    if(out == NULL){
+        f_close(&f);
+        return false;
+    }
+
+    bool ok = true;
+
+    for(;;){
+        if(f_read(&f, buf, sizeof(buf), &read) != FR_OK){
+            ok = false;
+            break;
+        }
+        if(read == 0) break;
+        if(fwrite(buf, 1, read, out) != read){
+            ok = false;
+            break;
+        }
+    }
+
+    f_close(&f);
+
+    return (fclose(out) == 0) && ok;
+}
+
+/**
+ * Записывает файлы COMTRADE на диск в памяти.
+ * @param comtrade Комтрейд.
+ * @param name Имя файлов без расширения.
+ * @return Флаг успеха.
+ */
+static bool test_write(comtrade_t* comtrade, const char* name)
+{
+    static uint8_t buf[COMTRADE_DAT_SECTOR_SIZE];
+    char file_name[40];
+    FIL f;
+
+    if(!comtrade->cff){
+        snprintf(file_name, sizeof(file_name), "%s.cfg", name);
+
+        if(f_open(&f, file_name, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return false;
+        err_t err = comtrade_write_cfg(&f, comtrade);
+        if(f_close(&f) != FR_OK || err != E_NO_ERROR) return false;
+        if(!test_copy(file_name)) return false;
+    }
+
+    snprintf(file_name, sizeof(file_name), "%s.%s", name, comtrade->cff ? "cff" : "dat");
+
+    if(f_open(&f, file_name, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return false;
+
+    if(comtrade->cff && comtrade_write_cff_head(&f, comtrade, TEST_SAMPLES) != E_NO_ERROR){
+        f_close(&f);
+        return false;
+    }
+
+    size_t n, count;
+    for(n = 0; n < TEST_SAMPLES; n += count){
+        count = (TEST_SAMPLES - n < TEST_RUN) ? TEST_SAMPLES - n : TEST_RUN;
+
+        if(comtrade_append_dat_samples(&f, comtrade, buf, sizeof(buf), n, n, count) != E_NO_ERROR){
+            f_close(&f);
+            return false;
+        }
+    }
+
+    if(f_close(&f) != FR_OK) return false;
+
+    return test_copy(file_name);
+}
+
+/**
+ * Читает файлы ctrd и сравнивает с записанными значениями.
+ * @param comtrade Комтрейд.
+ * @param name Имя файлов без расширения.
+ * @return Число ошибок.
+ */
+static size_t test_read(comtrade_t* comtrade, const char* name)
+{
+    char path[64];
+    ctrd_t ctrd;
+    ctrd_check_t check;
+
+    snprintf(path, sizeof(path), "%s/%s.%s", test_dir, name, comtrade->cff ? "cff" : "cfg");
+
+    ctrd_err_t err = ctrd_open(&ctrd, path);
+    if(err != CTRD_E_NO_ERROR){
+        fprintf(stderr, "%s: open: %s\n", name, ctrd_strerror(err));
+        return 1;
+    }
+
+    size_t errors = 0;
+
+    if(ctrd.cff != comtrade->cff || (int)ctrd.dat_type != (int)comtrade->dat_type ||
+       ctrd.analog_channels != comtrade->analog_channels ||
+       ctrd.digital_channels != comtrade->digital_channels ||
+       ctrd.endsamp != TEST_SAMPLES ||
+       ctrd.record_size != comtrade_dat_record_size(comtrade)){
+        fprintf(stderr, "%s: configuration mismatch\n", name);
+        errors ++;
+    }
+
+    err = ctrd_check(&ctrd, &check);
+    if(err != CTRD_E_NO_ERROR || !ctrd_check_ok(&check) || check.records != TEST_SAMPLES){
+        fprintf(stderr, "%s: check: %s\n", name, ctrd_strerror(err));
+        errors ++;
+    }
+
+    uint64_t i;
+    size_t ch;
+    for(i = 0; i < ctrd_records(&ctrd) && errors == 0; i ++){
+        const uint8_t* rec = ctrd_record(&ctrd, i);
+
+        if(ctrd_record_number(rec) != i + 1 || ctrd_record_timestamp(rec) != i){
+            fprintf(stderr, "%s: sample %lu: number or timestamp mismatch\n", name, (unsigned long)i);
+            errors ++;
+        }
+
+        for(ch = 0; ch < ctrd.analog_channels; ch ++){
+            double value = ctrd_record_analog(&ctrd, rec, ch);
+            double expected = (comtrade->dat_type == COMTRADE_DAT_BINARY) ?
+                              (double)test_raw(ch, i) : (double)test_raw(ch, i) / 2048.0;
+            double eps = (comtrade->dat_type == COMTRADE_DAT_FLOAT32) ? TEST_FLOAT32_EPS : 1e-9;
+
+            if(!(fabs(value - expected) <= eps)){
+                fprintf(stderr, "%s: sample %lu: analog %zu: %f != %f\n", name, (unsigned long)i, ch,
+                        value, expected);
+                errors ++;
+            }
+        }
+
+        for(ch = 0; ch < ctrd.digital_channels; ch ++){
+            if(ctrd_record_digital(&ctrd, rec, ch) != test_digital_value(comtrade, ch, i)){
+                fprintf(stderr, "%s: sample %lu: digital %zu mismatch\n", name, (unsigned long)i, ch);
+                errors ++;
+            }
+        }
+    }
+
+    ctrd_close(&ctrd);
+
+    return errors;
+}
+
+int main(void)
+{
+    static FATFS fs;
+
+    if(mkdtemp(test_dir) == NULL){
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    if(!ramdisk_init(TEST_DISK_SECTORS, 1) || f_mount(&fs, "", 1) != FR_OK){
+        fprintf(stderr, "ramdisk mount failed\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t files = 0;
+
+    int cff;
+    comtrade_dat_type_t dat_type;
+    for(cff = 0; cff <= 1; cff ++){
+        for(dat_type = COMTRADE_DAT_BINARY; dat_type <= COMTRADE_DAT_FLOAT32; dat_type ++){
+            comtrade_t comtrade;
+            char name[32];
+
+            memset(&comtrade, 0x0, sizeof(comtrade));
+            comtrade.station_name = "test";
+            comtrade.rec_dev_id = "ctrd";
+            comtrade.analog_channels = TEST_ANALOG;
+            comtrade.get_analog_channel = test_get_analog_channel;
+            comtrade.digital_channels = TEST_DIGITAL;
+            comtrade.get_digital_channel = test_get_digital_channel;
+            comtrade.lf = IQ15(50);
+            comtrade.nrates = 1;
+            comtrade.get_sample_rate = test_get_sample_rate;
+            comtrade.data_time.tv_sec = 1500000000;
+            comtrade.trigger_time.tv_sec = 1500000000;
+            comtrade.dat_type = dat_type;
+            comtrade.cff = cff != 0;
+            comtrade.timemult = 1;
+            comtrade.get_analog_channel_value = test_analog_value;
+            comtrade.get_analog_channel_real_value = test_analog_real_value;
+            comtrade.get_digital_channel_value = test_digital_value;
+
+            snprintf(name, sizeof(name), "%s_%s", test_dat_type_names[dat_type], cff ? "cff" : "dat");
+
+            if(!test_write(&comtrade, name)){
+                fprintf(stderr, "%s: write failed\n", name);
+                test_errors ++;
+                continue;
+            }
+
+            test_errors += test_read(&comtrade, name);
+            files ++;
+        }
+    }
+
+    f_mount(NULL, "", 0);
+    ramdisk_deinit();
+
+    // Временные файлы.
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", test_dir);
+    if(system(cmd) != 0) fprintf(stderr, "%s not removed\n", test_dir);
+
+    printf("files=%zu samples=%d errors=%zu\n", files, TEST_SAMPLES, test_errors);
+
+    return (test_errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file bench.h Замер времени для проверок на компьютере.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+/**
+ * Получает монотонное время.
+ * @return Время, с.
+ */
+static inline double bench_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Получает счётчик тактов процессора компьютера.
+ * @return Число тактов, 0 если счётчика нет.
+ */
+static inline uint64_t bench_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,141 @@
+/**
+ * @file bench_ain.c Производительность обработки кадров АЦП
+ * в зависимости от числа каналов.
+ * Собирается для каждого числа каналов AIN_CHANNELS_COUNT,
+ * способа обработки AIN_SOA и способа вычисления
+ * действующих значений AIN_EFF_CALC, кадры подаются блоками
+ * AIN_ADC_BLOCK_FRAMES через ain_replay_adc_data(),
+ * действующие значения читаются раз в миллисекунду,
+ * как при проверке триггеров.
+ * Выводит строку CSV с лучшим из нескольких прогонов.
+ */
+
+#include "ain.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "bench.h"
+
+
+#if !defined(AIN_SOA) || !defined(AIN_EFF_CALC)
+#error AIN_SOA and AIN_EFF_CALC must be defined by the Makefile
+#endif
+
+//! Имена способов вычисления действующих значений по AIN_EFF_CALC.
+static const char* bench_eff_names[] = {"sample", "lazy", "period"};
+
+//! Длительность данных, с.
+#define BENCH_TIME 2
+//! Число прогонов.
+#define BENCH_RUNS 15
+
+//! Средняя точка АЦП.
+#define BENCH_OFFSET 2048
+//! Амплитуда, отсчётов АЦП.
+#define BENCH_AMP 1400.0
+
+
+// Данные осциллограмм и трендов не записываются.
+void oscs_append(void)
+{
+}
+
+void trends_append(void)
+{
+}
+
+/**
+ * Заполняет кадры синусоидами со сдвигом фаз по каналам.
+ * @param frames Кадры.
+ * @param count Число кадров.
+ * @param freq Частота кадров, Гц.
+ */
+static void bench_fill(uint16_t* frames, size_t count, uint32_t freq)
+{
+    size_t n, i;
+    for(n = 0; n < count; n ++){
+        double phase = 2.0 * M_PI * AIN_POWER_FREQ_DEFAULT * n / freq;
+
+        for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+            frames[n * AIN_CHANNELS_COUNT + i] = (uint16_t)lround(BENCH_OFFSET +
+                                                 BENCH_AMP * sin(phase - 2.0 * M_PI * i / AIN_CHANNELS_COUNT));
+        }
+    }
+}
+
+/**
+ * Обрабатывает кадры.
+ * @param frames Кадры.
+ * @param count Число кадров.
+ * @param freq Частота кадров, Гц.
+ * @return Сумма действующих значений.
+ */
+static uint32_t bench_run(const uint16_t* frames, size_t count, uint32_t freq)
+{
+    // Кадров между чтениями действующих значений.
+    size_t tick_frames = freq / 1000;
+    size_t next_tick = tick_frames;
+    uint32_t sum = 0;
+    size_t pos, i;
+
+    for(pos = 0; pos < count; pos += AIN_ADC_BLOCK_FRAMES){
+        ain_replay_adc_data(&frames[pos * AIN_CHANNELS_COUNT], AIN_ADC_BLOCK_FRAMES);
+
+        if(pos + AIN_ADC_BLOCK_FRAMES >= next_tick){
+            next_tick += tick_frames;
+
+            for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+                sum += (uint16_t)ain_value(i);
+            }
+        }
+    }
+
+    return sum;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc > 1 && strcmp(argv[1], "-H") == 0){
+        printf("engine,eff,channels,frames,ns_per_frame,ns_per_channel_frame,ns_per_sample\n");
+        return 0;
+    }
+
+    ain_init();
+    ain_set_rate(AIN_SAMPLE_FREQ_DEFAULT, AIN_POWER_FREQ_DEFAULT);
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        ain_init_channel(i, AIN_AC, AIN_RMS, BENCH_OFFSET, q15_sat(IQ15(1.0)), IQ15(1.0));
+        ain_channel_set_enabled(i, true);
+    }
+
+    uint32_t freq = ain_oversample_freq();
+    size_t count = (size_t)freq * BENCH_TIME;
+    static uint16_t frames[(size_t)AIN_SAMPLE_FREQ_DEFAULT * AIN_OVERSAMPLE_RATE_MAX * BENCH_TIME * AIN_CHANNELS_COUNT];
+
+    bench_fill(frames, count, freq);
+
+    ain_set_enabled(true);
+
+    double best = 0.0;
+    volatile uint32_t sum = 0;
+
+    size_t run;
+    for(run = 0; run < BENCH_RUNS; run ++){
+        double time = bench_time();
+
+        sum += bench_run(frames, count, freq);
+
+        time = bench_time() - time;
+
+        if(run == 0 || time < best) best = time;
+    }
+
+    double ns_per_frame = best * 1e9 / count;
+
+    printf("%s,%s,%u,%zu,%.1f,%.2f,%.1f\n", AIN_SOA ? "soa" : "aos", bench_eff_names[AIN_EFF_CALC],
+           (unsigned int)AIN_CHANNELS_COUNT, count, ns_per_frame, ns_per_frame / AIN_CHANNELS_COUNT,
+           ns_per_frame * ain_oversample_rate());
+
+    return 0;
+}
@@ -0,0 +1,509 @@
+/**
+ * @file bench_card.c Заполнение карты памяти файлами трендов и событий
+ * с резервированием непрерывного места comtrade_dat_reserve() и без него.
+ * Файлы пишутся функциями comtrade.c в той же последовательности
+ * вызовов FatFs, что и в задачах трендов и событий:
+ * тренд - поток записей с синхронизацией файла данных и обновлением
+ * числа семплов в .cfg каждые sync секунд, файл на limit секунд;
+ * событие - файл данных точного размера и .cfg между записями тренда.
+ * Запись продолжается до заполнения диска.
+ * Время обращений оценивается моделью карты по статистике
+ * диска в памяти: RAMDISK_SECTOR_US на сектор, CARD_WRITE_SEEK_MS
+ * на запись и CARD_READ_SEEK_MS на чтение не с сектора после
+ * предыдущего обращения.
+ * Диск размечается чистым или фрагментированным: заполняется
+ * файлами случайного размера 1..32 кластера, часть которых удаляется.
+ * Выводит CSV: скорость записи тренда по модели, задержку
+ * записи буфера тренда и число фрагментов на файл данных тренда.
+ */
+
+#include "comtrade.h"
+#include "ramdisk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+//! Размер диска, секторов (160 Мб).
+#define CARD_SECTORS (160 * 1024 * 2)
+//! Размер кластера, секторов (2 Кб).
+#define CARD_CLUSTER_SECTORS 4
+
+//! Время записи или чтения сектора, мкс.
+#define CARD_SECTOR_US 50.0
+//! Время перехода записи на другой участок, мс.
+#define CARD_WRITE_SEEK_MS 1.5
+//! Время перехода чтения на другой участок, мс.
+#define CARD_READ_SEEK_MS 0.2
+
+//! Частота семплов тренда, Гц.
+#define TREND_RATE 100
+//! Число семплов буфера тренда, записываемого за раз.
+#define TREND_BUF_SAMPLES TREND_RATE
+//! Длительность файла тренда, с.
+#define TREND_LIMIT 60
+//! Число аналоговых каналов тренда.
+#define TREND_ANALOG 6
+//! Число цифровых каналов тренда.
+#define TREND_DIGITAL 4
+
+//! Период событий, с.
+#define EVENT_PERIOD 30
+//! Число семплов события.
+#define EVENT_SAMPLES 2880
+//! Число аналоговых каналов события.
+#define EVENT_ANALOG 12
+//! Число цифровых каналов события.
+#define EVENT_DIGITAL 4
+
+//! Наибольшее число записей буфера тренда.
+#define CARD_WRITES_MAX (CARD_SECTORS / 4)
+//! Размер таблицы связей кластеров для подсчёта фрагментов.
+#define CARD_FRAG_TABLE_SIZE 8192
+
+
+//! Случай замера.
+typedef struct _Card_Case {
+    unsigned int frag; //!< Доля удалённых файлов при фрагментации, %, 0 - чистый диск.
+    unsigned int sync; //!< Период синхронизации, с, 0 - на каждой записи.
+    bool reserve; //!< Резервирование места.
+} card_case_t;
+
+//! Случаи замера.
+static const card_case_t card_cases[] = {
+    { 0,  0, false}, { 0,  0, true},
+    { 0, 10, false}, { 0, 10, true},
+    {50,  0, false}, {50,  0, true},
+    {50, 10, false}, {50, 10, true},
+};
+
+//! Число случаев.
+#define CARD_CASES_COUNT (sizeof(card_cases) / sizeof(card_cases[0]))
+
+
+//! Файл COMTRADE.
+typedef struct _Card_File {
+    comtrade_t comtrade; //!< Комтрейд.
+    FIL dat; //!< Файл данных.
+    comtrade_dat_stream_t stream; //!< Поток записи данных.
+    uint8_t buf[COMTRADE_DAT_SECTOR_SIZE]; //!< Буфер потока.
+    DWORD clmt[COMTRADE_DAT_CLMT_SIZE]; //!< Таблица связей кластеров.
+    char name[32]; //!< Имя без расширения.
+    uint32_t samples; //!< Число записанных семплов.
+    bool opened; //!< Флаг открытого файла.
+} card_file_t;
+
+//! Состояние замера.
+typedef struct _Card {
+    card_file_t trend; //!< Тренд.
+    card_file_t event; //!< Событие.
+    size_t trend_files; //!< Число файлов тренда.
+    size_t events; //!< Число событий.
+    size_t fallbacks; //!< Число файлов без зарезервированного места.
+    uint32_t sync_last; //!< Время последней синхронизации, с.
+    double latency[CARD_WRITES_MAX]; //!< Задержки записи буферов тренда, мс.
+    size_t writes; //!< Число записей буферов тренда.
+    uint64_t trend_bytes; //!< Размер данных трендов.
+} card_t;
+
+static card_t card;
+
+static uint32_t card_rnd = 1;
+
+
+//! Получает случайное число.
+static uint32_t card_random(uint32_t n)
+{
+    card_rnd = card_rnd * 1103515245 + 12345;
+    return (card_rnd >> 8) % n;
+}
+
+//! Оценивает время обращений к карте по статистике, мс.
+static double card_cost_ms(const ramdisk_stats_t* from, const ramdisk_stats_t* to)
+{
+    return (double)((to->read_sectors - from->read_sectors) + (to->write_sectors - from->write_sectors)) *
+           CARD_SECTOR_US / 1000.0 +
+           (double)(to->write_seeks - from->write_seeks) * CARD_WRITE_SEEK_MS +
+           (double)(to->read_seeks - from->read_seeks) * CARD_READ_SEEK_MS;
+}
+
+static void card_get_analog_channel(comtrade_t* comtrade, size_t index, comtrade_analog_channel_t* channel)
+{
+    (void) comtrade; (void) index;
+
+    channel->ch_id = "U";
+    channel->uu = "V";
+    channel->a = IQ15(1);
+    channel->min = INT16_MIN;
+    channel->max = INT16_MAX;
+    channel->primary = IQ15(1);
+    channel->secondary = IQ15(1);
+    channel->ps = COMTRADE_PS_PRIMARY;
+}
+
+static void card_get_digital_channel(comtrade_t* comtrade, size_t index, comtrade_digital_channel_t* channel)
+{
+    (void) comtrade; (void) index;
+
+    channel->ch_id = "DI";
+}
+
+static void card_get_sample_rate(comtrade_t* comtrade, size_t index, comtrade_sample_rate_t* rate)
+{
+    (void) index;
+
+    card_file_t* file = (card_file_t*)comtrade->user_data;
+
+    rate->samp = (file == &card.trend) ? IQ15(TREND_RATE) : IQ15(1600);
+    rate->endsamp = file->samples;
+}
+
+static int16_t card_analog_value(comtrade_t* comtrade, size_t index, size_t sample)
+{
+    (void) comtrade;
+    return (int16_t)(sample * 31 + index * 977);
+}
+
+static bool card_digital_value(comtrade_t* comtrade, size_t index, size_t sample)
+{
+    (void) comtrade;
+    return ((sample >> index) & 0x1) != 0;
+}
+
+/**
+ * Инициализирует файл.
+ * @param file Файл.
+ * @param analog Число аналоговых каналов.
+ * @param digital Число цифровых каналов.
+ */
+static void card_file_init(card_file_t* file, size_t analog, size_t digital)
+{
+    memset(file, 0x0, sizeof(card_file_t));
+
+    comtrade_t* comtrade = &file->comtrade;
+
+    comtrade->station_name = "sim";
+    comtrade->rec_dev_id = "card";
+    comtrade->analog_channels = analog;
+    comtrade->get_analog_channel = card_get_analog_channel;
+    comtrade->digital_channels = digital;
+    comtrade->get_digital_channel = card_get_digital_channel;
+    comtrade->lf = IQ15(50);
+    comtrade->nrates = 1;
+    comtrade->get_sample_rate = card_get_sample_rate;
+    comtrade->data_time.tv_sec = 1500000000;
+    comtrade->trigger_time.tv_sec = 1500000000;
+    comtrade->dat_type = COMTRADE_DAT_BINARY;
+    comtrade->timemult = 1;
+    comtrade->user_data = file;
+    comtrade->get_analog_channel_value = card_analog_value;
+    comtrade->get_digital_channel_value = card_digital_value;
+    comtrade->endsamp_fixed = true;
+}
+
+/**
+ * Записывает файл конфигурации.
+ * @param file Файл.
+ * @param update Обновление числа семплов записанного файла.
+ * @return Флаг успеха.
+ */
+static bool card_file_write_cfg(card_file_t* file, bool update)
+{
+    char name[40];
+    FIL cfg;
+
+    snprintf(name, sizeof(name), "%s.cfg", file->name);
+
+    if(f_open(&cfg, name, FA_WRITE | (update ? FA_OPEN_EXISTING : FA_CREATE_ALWAYS)) != FR_OK) return false;
+
+    err_t err = update ? comtrade_update_cfg_endsamp(&cfg, &file->comtrade, file->samples) :
+                         comtrade_write_cfg(&cfg, &file->comtrade);
+
+    return f_close(&cfg) == FR_OK && err == E_NO_ERROR;
+}
+
+/**
+ * Открывает файл данных и резервирует место.
+ * @param file Файл.
+ * @param samples Число семплов файла.
+ * @param reserve Резервирование места.
+ * @return Флаг успеха.
+ */
+static bool card_file_open(card_file_t* file, size_t samples, bool reserve)
+{
+    char name[40];
+
+    snprintf(name, sizeof(name), "%s.dat", file->name);
+
+    if(f_open(&file->dat, name, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return false;
+
+    file->opened = true;
+    file->samples = 0;
+
+    if(reserve){
+        err_t err = comtrade_dat_reserve(&file->dat, &file->comtrade, samples, file->clmt);
+
+        if(err == E_IO_ERROR) return false;
+        if(err != E_NO_ERROR) card.fallbacks ++;
+    }
+
+    return comtrade_dat_stream_init(&file->stream, &file->dat, file->buf, sizeof(file->buf)) == E_NO_ERROR;
+}
+
+/**
+ * Закрывает файл данных, освобождая неиспользованное место.
+ * @param file Файл.
+ * @return Флаг успеха.
+ */
+static bool card_file_close(card_file_t* file)
+{
+    if(!file->opened) return true;
+
+    file->opened = false;
+
+    bool ok = f_truncate(&file->dat) == FR_OK;
+
+    return f_close(&file->dat) == FR_OK && ok;
+}
+
+/**
+ * Синхронизирует файл тренда.
+ * @return Флаг успеха.
+ */
+static bool card_trend_sync(void)
+{
+    card_file_t* trend = &card.trend;
+
+    if(comtrade_dat_stream_flush(&trend->stream) != E_NO_ERROR) return false;
+    if(f_sync(&trend->dat) != FR_OK) return false;
+
+    return card_file_write_cfg(trend, true);
+}
+
+/**
+ * Записывает буфер тренда, как задача трендов.
+ * @param time Время, с.
+ * @param sync Период синхронизации, с.
+ * @param reserve Резервирование места.
+ * @return Флаг успеха.
+ */
+static bool card_trend_write(uint32_t time, unsigned int sync, bool reserve)
+{
+    card_file_t* trend = &card.trend;
+
+    if(!trend->opened){
+        snprintf(trend->name, sizeof(trend->name), "trends/t%05u", (unsigned int)card.trend_files);
+
+        if(!card_file_open(trend, TREND_LIMIT * TREND_RATE, reserve)) return false;
+        if(!card_file_write_cfg(trend, false)) return false;
+
+        card.trend_files ++;
+    }
+
+    if(comtrade_dat_stream_append(&trend->stream, &trend->comtrade, trend->samples, trend->samples,
+                                  TREND_BUF_SAMPLES) != E_NO_ERROR) return false;
+
+    trend->samples += TREND_BUF_SAMPLES;
+    card.trend_bytes += TREND_BUF_SAMPLES * comtrade_dat_record_size(&trend->comtrade);
+
+    if(sync == 0 || time - card.sync_last >= sync){
+        if(!card_trend_sync()) return false;
+        card.sync_last = time;
+    }
+
+    // Файл заполнен.
+    if(trend->samples >= TREND_LIMIT * TREND_RATE){
+        if(!card_trend_sync()) return false;
+        if(!card_file_close(trend)) return false;
+    }
+
+    return true;
+}
+
+/**
+ * Записывает событие, как задача событий.
+ * @param reserve Резервирование места.
+ * @return Флаг успеха.
+ */
+static bool card_event_write(bool reserve)
+{
+    card_file_t* event = &card.event;
+
+    snprintf(event->name, sizeof(event->name), "events/e%05u", (unsigned int)card.events);
+
+    if(!card_file_open(event, EVENT_SAMPLES, reserve)) return false;
+
+    if(comtrade_dat_stream_append(&event->stream, &event->comtrade, 0, 0, EVENT_SAMPLES) != E_NO_ERROR ||
+       comtrade_dat_stream_flush(&event->stream) != E_NO_ERROR){
+        card_file_close(event);
+        return false;
+    }
+    event->samples = EVENT_SAMPLES;
+
+    if(!card_file_close(event)) return false;
+    if(!card_file_write_cfg(event, false)) return false;
+
+    card.events ++;
+
+    return true;
+}
+
+/**
+ * Фрагментирует диск.
+ * @param frag Доля удаляемых файлов, %.
+ */
+static void card_fragment(unsigned int frag)
+{
+    static uint8_t cluster[CARD_CLUSTER_SECTORS * RAMDISK_SECTOR_SIZE];
+    char name[32];
+    FIL f;
+    UINT bw;
+    size_t count;
+    bool full = false;
+
+    for(count = 0; !full; count ++){
+        snprintf(name, sizeof(name), "junk/%05u.bin", (unsigned int)count);
+        if(f_open(&f, name, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) break;
+
+        uint32_t size = 1 + card_random(32);
+
+        uint32_t i;
+        for(i = 0; i < size && !full; i ++){
+            if(f_write(&f, cluster, sizeof(cluster), &bw) != FR_OK || bw != sizeof(cluster)) full = true;
+        }
+        f_close(&f);
+    }
+
+    size_t i;
+    for(i = 0; i < count; i ++){
+        if(card_random(100) < frag){
+            snprintf(name, sizeof(name), "junk/%05u.bin", (unsigned int)i);
+            f_unlink(name);
+        }
+    }
+}
+
+/**
+ * Получает число фрагментов файла.
+ * @param name Имя файла.
+ * @return Число фрагментов, 0 при ошибке.
+ */
+static size_t card_fragments(const char* name)
+{
+    static DWORD table[CARD_FRAG_TABLE_SIZE];
+    FIL f;
+
+    if(f_open(&f, name, FA_READ) != FR_OK) return 0;
+
+    table[0] = CARD_FRAG_TABLE_SIZE;
+    f.cltbl = table;
+
+    size_t fragments = (f_lseek(&f, CREATE_LINKMAP) == FR_OK) ? (table[0] - 2) / 2 : 0;
+
+    f_close(&f);
+
+    return fragments;
+}
+
+//! Сравнивает задержки.
+static int card_cmp_latency(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Заполняет диск.
+ * @param cc Случай.
+ * @return Флаг успеха.
+ */
+static bool card_run(const card_case_t* cc)
+{
+    static FATFS fs;
+
+    memset(&card, 0x0, sizeof(card));
+    card_rnd = 1;
+
+    card_file_init(&card.trend, TREND_ANALOG, TREND_DIGITAL);
+    card_file_init(&card.event, EVENT_ANALOG, EVENT_DIGITAL);
+
+    if(!ramdisk_init(CARD_SECTORS, CARD_CLUSTER_SECTORS) || f_mount(&fs, "", 1) != FR_OK) return false;
+
+    f_mkdir("junk");
+    f_mkdir("trends");
+    f_mkdir("events");
+
+    if(cc->frag != 0) card_fragment(cc->frag);
+
+    double busy = 0.0;
+    ramdisk_stats_t before, after;
+
+    uint32_t time;
+    for(time = 1; card.writes < CARD_WRITES_MAX; time ++){
+        before = ramdisk_stats;
+
+        bool ok = card_trend_write(time, cc->sync, cc->reserve);
+
+        after = ramdisk_stats;
+
+        if(!ok) break;
+
+        card.latency[card.writes ++] = card_cost_ms(&before, &after);
+        busy += card_cost_ms(&before, &after);
+
+        // Событие записывается между записями тренда.
+        if(time % EVENT_PERIOD == 0 && !card_event_write(cc->reserve)) break;
+    }
+
+    card_file_close(&card.trend);
+
+    // Фрагменты файлов данных трендов.
+    size_t fragments = 0;
+    size_t i;
+    for(i = 0; i < card.trend_files; i ++){
+        char name[40];
+        snprintf(name, sizeof(name), "trends/t%05u.dat", (unsigned int)i);
+        fragments += card_fragments(name);
+    }
+
+    // Статистика задержек.
+    double sum = 0.0, sq = 0.0;
+    for(i = 0; i < card.writes; i ++){
+        sum += card.latency[i];
+        sq += card.latency[i] * card.latency[i];
+    }
+    double mean = sum / card.writes;
+    double sd = sqrt(sq / card.writes - mean * mean);
+
+    qsort(card.latency, card.writes, sizeof(double), card_cmp_latency);
+
+    printf("%u,%u,%s,%zu,%zu,%.1f,%.2f,%zu,%.0f,%.2f,%.2f,%.2f,%.2f\n", cc->frag, cc->sync,
+           cc->reserve ? "yes" : "no", card.trend_files, card.events, card.trend_bytes / 1048576.0,
+           card.trend_files ? (double)fragments / card.trend_files : 0.0, card.fallbacks,
+           card.trend_bytes / 1024.0 / (busy / 1000.0), mean, sd,
+           card.latency[card.writes * 99 / 100], card.latency[card.writes - 1]);
+
+    f_mount(NULL, "", 0);
+    ramdisk_deinit();
+
+    return true;
+}
+
+int main(void)
+{
+    printf("frag,sync,reserve,trend_files,events,trend_mb,fragments_per_file,fallbacks,"
+           "kb_per_s,mean_ms,sd_ms,p99_ms,max_ms\n");
+
+    size_t n;
+    for(n = 0; n < CARD_CASES_COUNT; n ++){
+        if(!card_run(&card_cases[n])){
+            fprintf(stderr, "ramdisk mount failed\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
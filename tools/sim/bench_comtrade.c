@@ -0,0 +1,233 @@
+/**
+ * @file bench_comtrade.c Производительность записи DAT файлов COMTRADE
+ * на диск FatFs в памяти: по записи comtrade_append_dat()
+ * и последовательностями семплов comtrade_append_dat_samples()
+ * с буфером в один и несколько секторов.
+ * Файлы, записанные обоими способами, сравниваются побайтно.
+ * Вызовы f_write() считаются обёрткой компоновщика (--wrap=f_write).
+ * Выводит CSV, при несовпадении файлов завершается с ошибкой.
+ */
+
+#include "comtrade.h"
+#include "ramdisk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//! Число семплов события.
+#define BENCH_SAMPLES 8192
+//! Число событий в файле.
+#define BENCH_REPEATS 10
+//! Число прогонов.
+#define BENCH_RUNS 5
+
+//! Наибольшее число аналоговых каналов.
+#define BENCH_ANALOG_MAX 16
+//! Наибольший буфер, секторов.
+#define BENCH_BUF_SECTORS_MAX 8
+
+//! Размер диска, секторов (64 Мб).
+#define BENCH_DISK_SECTORS (64 * 1024 * 2)
+
+
+//! Случай замера.
+typedef struct _Bench_Case {
+    size_t analog; //!< Число аналоговых каналов.
+    size_t digital; //!< Число цифровых каналов.
+    size_t buf_sectors; //!< Размер буфера, секторов.
+    size_t run; //!< Число семплов за вызов, 0 - событие целиком.
+} bench_case_t;
+
+//! Случаи замера: набор каналов события, размер буфера и запись трендов порциями.
+static const bench_case_t bench_cases[] = {
+    {12, 4, 1, 0},
+    {16, 0, 1, 0},
+    { 8, 8, 1, 0},
+    {12, 4, 2, 0},
+    {12, 4, 8, 0},
+    {12, 4, 1, 37},
+};
+
+//! Число случаев.
+#define BENCH_CASES_COUNT (sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+
+static int16_t bench_analog[BENCH_SAMPLES][BENCH_ANALOG_MAX];
+static uint16_t bench_digital[BENCH_SAMPLES];
+static uint8_t bench_buf[BENCH_BUF_SECTORS_MAX * COMTRADE_DAT_SECTOR_SIZE];
+
+//! Число вызовов f_write().
+static uint32_t bench_f_writes = 0;
+
+
+extern FRESULT __real_f_write(FIL* fp, const void* buff, UINT btw, UINT* bw);
+
+FRESULT __wrap_f_write(FIL* fp, const void* buff, UINT btw, UINT* bw)
+{
+    bench_f_writes ++;
+
+    return __real_f_write(fp, buff, btw, bw);
+}
+
+static int16_t bench_analog_value(comtrade_t* comtrade, size_t index, size_t sample)
+{
+    (void) comtrade;
+    return bench_analog[sample % BENCH_SAMPLES][index];
+}
+
+static bool bench_digital_value(comtrade_t* comtrade, size_t index, size_t sample)
+{
+    (void) comtrade;
+    return (bench_digital[sample % BENCH_SAMPLES] >> index) & 0x1;
+}
+
+//! Результат записи файла.
+typedef struct _Bench_Result {
+    double time; //!< Лучшее время, с.
+    uint32_t f_writes; //!< Число вызовов f_write().
+    uint32_t disk_writes; //!< Число записей на диск.
+} bench_result_t;
+
+/**
+ * Записывает DAT файл.
+ * @param name Имя файла.
+ * @param comtrade Комтрейд.
+ * @param bc Случай, NULL - запись по одной записи.
+ * @param res Результат.
+ * @return Флаг успеха.
+ */
+static bool bench_write(const char* name, comtrade_t* comtrade, const bench_case_t* bc, bench_result_t* res)
+{
+    FIL f;
+
+    size_t run;
+    for(run = 0; run < BENCH_RUNS; run ++){
+        if(f_open(&f, name, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return false;
+
+        bench_f_writes = 0;
+        ramdisk_stats_reset();
+
+        double time = bench_time();
+
+        uint32_t n = 0;
+        size_t r, count;
+        for(r = 0; r < BENCH_REPEATS; r ++){
+            size_t end = (r + 1) * BENCH_SAMPLES;
+
+            if(bc == NULL){
+                for(; n < end; n ++){
+                    if(comtrade_append_dat(&f, comtrade, n, n) != E_NO_ERROR) return false;
+                }
+            }else{
+                for(; n < end; n += count){
+                    count = (bc->run == 0 || end - n < bc->run) ? end - n : bc->run;
+
+                    if(comtrade_append_dat_samples(&f, comtrade, bench_buf, bc->buf_sectors * COMTRADE_DAT_SECTOR_SIZE,
+                                                   n, n, count) != E_NO_ERROR) return false;
+                }
+            }
+        }
+
+        if(f_close(&f) != FR_OK) return false;
+
+        time = bench_time() - time;
+
+        if(run == 0 || time < res->time) res->time = time;
+        res->f_writes = bench_f_writes;
+        res->disk_writes = ramdisk_stats.writes;
+    }
+
+    return true;
+}
+
+/**
+ * Сравнивает файлы.
+ * @return Флаг совпадения.
+ */
+static bool bench_compare(const char* name_a, const char* name_b)
+{
+    static uint8_t buf_a[4096], buf_b[4096];
+    FIL a, b;
+    UINT read_a, read_b;
+    bool same = true;
+
+    if(f_open(&a, name_a, FA_READ) != FR_OK) return false;
+    if(f_open(&b, name_b, FA_READ) != FR_OK) return false;
+
+    if(f_size(&a) != f_size(&b)) same = false;
+
+    while(same){
+        if(f_read(&a, buf_a, sizeof(buf_a), &read_a) != FR_OK) same = false;
+        if(f_read(&b, buf_b, sizeof(buf_b), &read_b) != FR_OK) same = false;
+        if(!same || read_a != read_b || memcmp(buf_a, buf_b, read_a) != 0) same = false;
+        if(read_a == 0) break;
+    }
+
+    f_close(&a);
+    f_close(&b);
+
+    return same;
+}
+
+int main(void)
+{
+    size_t s, i;
+    for(s = 0; s < BENCH_SAMPLES; s ++){
+        for(i = 0; i < BENCH_ANALOG_MAX; i ++){
+            bench_analog[s][i] = (int16_t)(s * 31 + i * 977);
+        }
+        bench_digital[s] = (uint16_t)((s * 2654435761u) >> 7);
+    }
+
+    static FATFS fs;
+
+    if(!ramdisk_init(BENCH_DISK_SECTORS, 1) || f_mount(&fs, "", 1) != FR_OK){
+        fprintf(stderr, "ramdisk mount failed\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("analog,digital,record_size,buf_sectors,run,records,"
+           "record_rec_per_s,samples_rec_per_s,record_f_writes,samples_f_writes,"
+           "record_disk_writes,samples_disk_writes,identical\n");
+
+    bool ok = true;
+
+    size_t n;
+    for(n = 0; n < BENCH_CASES_COUNT; n ++){
+        const bench_case_t* bc = &bench_cases[n];
+        comtrade_t comtrade;
+        bench_result_t old_res, new_res;
+
+        memset(&comtrade, 0x0, sizeof(comtrade));
+        comtrade.analog_channels = bc->analog;
+        comtrade.digital_channels = bc->digital;
+        comtrade.dat_type = COMTRADE_DAT_BINARY;
+        comtrade.get_analog_channel_value = bench_analog_value;
+        comtrade.get_digital_channel_value = bench_digital_value;
+
+        if(!bench_write("record.dat", &comtrade, NULL, &old_res) ||
+           !bench_write("samples.dat", &comtrade, bc, &new_res)){
+            fprintf(stderr, "write failed\n");
+            return EXIT_FAILURE;
+        }
+
+        bool same = bench_compare("record.dat", "samples.dat");
+        double records = (double)BENCH_SAMPLES * BENCH_REPEATS;
+
+        printf("%zu,%zu,%zu,%zu,%zu,%.0f,%.0f,%.0f,%u,%u,%u,%u,%s\n", bc->analog, bc->digital,
+               comtrade_dat_record_size(&comtrade), bc->buf_sectors, bc->run, records,
+               records / old_res.time, records / new_res.time,
+               (unsigned int)old_res.f_writes, (unsigned int)new_res.f_writes,
+               (unsigned int)old_res.disk_writes, (unsigned int)new_res.disk_writes,
+               same ? "yes" : "no");
+
+        if(!same) ok = false;
+    }
+
+    f_mount(NULL, "", 0);
+    ramdisk_deinit();
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,301 @@
+/**
+ * @file bench_dsp.c Производительность отдельных примитивов обработки
+ * при размерах, с которыми их вызывает прошивка:
+ * КИХ-фильтр децимации аналоговых входов, окно действующего
+ * значения за период сети, прореживание, усреднение и мажоритарная
+ * выборка осциллограмм (rate = 2) и трендов (rate = 4), детектор
+ * фронтов и операции Q15.
+ * Выводит CSV с лучшим из нескольких прогонов на операцию.
+ */
+
+// Коэффициенты и порядок КИХ-фильтров объявлены в ain.c.
+#include "../../ain.c"
+#include "dsp/decim.h"
+#include "dsp/avg.h"
+#include "dsp/maj.h"
+#include "dsp/edge_detect.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+//! Число операций в прогоне.
+#define BENCH_OPS 1000000
+//! Число прогонов.
+#define BENCH_RUNS 5
+
+//! Размер входных данных, степень двойки.
+#define BENCH_INPUT_SIZE 4096
+//! Маска индекса входных данных.
+#define BENCH_INPUT_MASK (BENCH_INPUT_SIZE - 1)
+
+//! Предделитель осциллограмм (config_example.ini).
+#define BENCH_OSC_RATE 2
+//! Предделитель трендов (config_example.ini).
+#define BENCH_TREND_RATE 4
+
+//! Кратность децимации аналоговых входов по-умолчанию.
+#define BENCH_AIN_DECIM 8
+//! Размер окна действующего значения по-умолчанию.
+#define BENCH_MWIN_SIZE (AIN_SAMPLE_FREQ_DEFAULT / AIN_POWER_FREQ_DEFAULT)
+
+
+//! Замер.
+typedef struct _Bench {
+    const char* name; //!< Примитив.
+    const char* op; //!< Операция, на которую приводится время.
+    size_t size; //!< Размер.
+    int32_t (*run)(size_t size, size_t ops); //!< Выполнение ops операций.
+} bench_t;
+
+
+static q15_t bench_input[BENCH_INPUT_SIZE];
+
+
+// Данные осциллограмм и трендов не записываются.
+void oscs_append(void)
+{
+}
+
+void trends_append(void)
+{
+}
+
+static int32_t bench_fir_decim(size_t size, size_t ops)
+{
+    static q15_t data[FIR_DECIM_DATA_SIZE(AIN_FIR_N)];
+    fir_decim_t fir;
+    int32_t sum = 0;
+
+    fir_decim_init(&fir, fir_coefs_r8, data, AIN_FIR_N);
+
+    size_t i;
+    for(i = 0; i < ops; i ++){
+        fir_decim_put(&fir, &bench_input[(i * size) & BENCH_INPUT_MASK], size);
+        sum += fir_decim_calc(&fir);
+    }
+
+    return sum;
+}
+
+static int32_t bench_mwin(size_t size, size_t ops)
+{
+    static q15_t data[AIN_MWIN_EFF_SIZE_MAX];
+    mwin_t mwin;
+    int32_t sum = 0;
+
+    mwin_init(&mwin, data, size);
+
+    size_t i;
+    for(i = 0; i < ops; i ++){
+        mwin_put(&mwin, bench_input[i & BENCH_INPUT_MASK]);
+        sum += mwin_sum(&mwin);
+    }
+
+    return sum;
+}
+
+static int32_t bench_decim(size_t size, size_t ops)
+{
+    decim_t decim;
+    int32_t sum = 0;
+
+    decim_init(&decim, size);
+
+    size_t i;
+    for(i = 0; i < ops; i ++){
+        decim_put(&decim, bench_input[i & BENCH_INPUT_MASK]);
+        if(decim_ready(&decim)) sum += decim_data(&decim);
+    }
+
+    return sum;
+}
+
+static int32_t bench_avg(size_t size, size_t ops)
+{
+    avg_t avg;
+    int32_t sum = 0;
+
+    avg_init(&avg);
+
+    size_t i, j;
+    for(i = 0; i < ops; i ++){
+        for(j = 0; j < size; j ++){
+            avg_put(&avg, bench_input[(i * size + j) & BENCH_INPUT_MASK]);
+        }
+        sum += avg_calc(&avg);
+        avg_reset(&avg);
+    }
+
+    return sum;
+}
+
+static int32_t bench_maj(size_t size, size_t ops)
+{
+    maj_t maj;
+    int32_t sum = 0;
+
+    maj_init(&maj);
+
+    size_t i, j;
+    for(i = 0; i < ops; i ++){
+        for(j = 0; j < size; j ++){
+            maj_put(&maj, bench_input[(i * size + j) & BENCH_INPUT_MASK] > 0);
+        }
+        sum += maj_calc(&maj);
+        maj_reset(&maj);
+    }
+
+    return sum;
+}
+
+static int32_t bench_edge_detect(size_t size, size_t ops)
+{
+    (void) size;
+
+    edge_detect_t ed;
+    int32_t sum = 0;
+
+    edge_detect_init(&ed);
+
+    size_t i;
+    for(i = 0; i < ops; i ++){
+        edge_detect_put(&ed, bench_input[i & BENCH_INPUT_MASK] > 0);
+        sum += edge_detect_state(&ed);
+    }
+
+    return sum;
+}
+
+static int32_t bench_q15_mul(size_t size, size_t ops)
+{
+    (void) size;
+
+    int32_t sum = 0;
+
+    size_t i;
+    for(i = 0; i < ops; i ++){
+        sum += q15_mul(bench_input[i & BENCH_INPUT_MASK], bench_input[(i + 1) & BENCH_INPUT_MASK]);
+    }
+
+    return sum;
+}
+
+static int32_t bench_q15_add_sat(size_t size, size_t ops)
+{
+    (void) size;
+
+    int32_t sum = 0;
+
+    size_t i;
+    for(i = 0; i < ops; i ++){
+        sum += q15_add_sat(bench_input[i & BENCH_INPUT_MASK], bench_input[(i + 1) & BENCH_INPUT_MASK]);
+    }
+
+    return sum;
+}
+
+static int32_t bench_iq15_sat(size_t size, size_t ops)
+{
+    (void) size;
+
+    int32_t sum = 0;
+
+    size_t i;
+    for(i = 0; i < ops; i ++){
+        sum += iq15_sat((int32_t)bench_input[i & BENCH_INPUT_MASK] * 3);
+    }
+
+    return sum;
+}
+
+static int32_t bench_iq15_mull(size_t size, size_t ops)
+{
+    (void) size;
+
+    int32_t sum = 0;
+
+    size_t i;
+    for(i = 0; i < ops; i ++){
+        sum += iq15_mull((iq15_t)bench_input[i & BENCH_INPUT_MASK], IQ15(967.5));
+    }
+
+    return sum;
+}
+
+static int32_t bench_iq15_divl(size_t size, size_t ops)
+{
+    (void) size;
+
+    int32_t sum = 0;
+
+    size_t i;
+    for(i = 0; i < ops; i ++){
+        sum += iq15_divl(IQ15(230) + bench_input[i & BENCH_INPUT_MASK], IQ15(967.5));
+    }
+
+    return sum;
+}
+
+//! Замеры.
+static const bench_t benches[] = {
+    {"fir_decim", "output", BENCH_AIN_DECIM, bench_fir_decim},
+    {"mwin", "sample", BENCH_MWIN_SIZE, bench_mwin},
+    {"decim", "sample", BENCH_OSC_RATE, bench_decim},
+    {"decim", "sample", BENCH_TREND_RATE, bench_decim},
+    {"avg", "output", BENCH_OSC_RATE, bench_avg},
+    {"avg", "output", BENCH_TREND_RATE, bench_avg},
+    {"maj", "output", BENCH_OSC_RATE, bench_maj},
+    {"maj", "output", BENCH_TREND_RATE, bench_maj},
+    {"edge_detect", "sample", 1, bench_edge_detect},
+    {"q15_mul", "op", 1, bench_q15_mul},
+    {"q15_add_sat", "op", 1, bench_q15_add_sat},
+    {"iq15_sat", "op", 1, bench_iq15_sat},
+    {"iq15_mull", "op", 1, bench_iq15_mull},
+    {"iq15_divl", "op", 1, bench_iq15_divl},
+};
+
+//! Число замеров.
+#define BENCHES_COUNT (sizeof(benches) / sizeof(benches[0]))
+
+int main(int argc, char* argv[])
+{
+    (void) argc; (void) argv;
+
+    uint32_t rnd = 1;
+
+    size_t i;
+    for(i = 0; i < BENCH_INPUT_SIZE; i ++){
+        rnd = rnd * 1103515245 + 12345;
+        bench_input[i] = (q15_t)(rnd >> 16);
+    }
+
+    volatile int32_t sink = 0;
+
+    printf("primitive,op,size,ops,ns_per_op,ticks_per_op\n");
+
+    size_t n, run;
+    for(n = 0; n < BENCHES_COUNT; n ++){
+        const bench_t* bench = &benches[n];
+        double best_time = 0.0;
+        uint64_t best_ticks = 0;
+
+        for(run = 0; run < BENCH_RUNS; run ++){
+            double time = bench_time();
+            uint64_t ticks = bench_ticks();
+
+            sink += bench->run(bench->size, BENCH_OPS);
+
+            ticks = bench_ticks() - ticks;
+            time = bench_time() - time;
+
+            if(run == 0 || time < best_time) best_time = time;
+            if(run == 0 || ticks < best_ticks) best_ticks = ticks;
+        }
+
+        printf("%s,%s,%zu,%u,%.2f,%.1f\n", bench->name, bench->op, bench->size, BENCH_OPS,
+               best_time * 1e9 / BENCH_OPS, (double)best_ticks / BENCH_OPS);
+    }
+
+    return 0;
+}
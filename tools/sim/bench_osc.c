@@ -0,0 +1,264 @@
+/**
+ * @file bench_osc.c Производительность и результат записи
+ * семплов осциллограммы osc_append().
+ * Замер: время на семпл для 4, 8 и 16 разрешённых каналов
+ * (половина - мгновенные значения аналоговых входов,
+ * четверть - действующие значения, четверть - цифровые входы)
+ * при предделителе 1 и 2.
+ * С ключом -c выводит контрольную сумму буферов для случайных
+ * наборов каналов, кадры подаются через обработку аналоговых входов.
+ * Собирается с исходниками осциллограмм рабочего дерева
+ * или выбранной ревизии (BENCH_REV) для сравнения.
+ */
+
+#include "ain.h"
+#include "osc.h"
+#include "din.h"
+#include "din_sim.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+//! Ревизия исходников осциллограмм.
+#ifndef BENCH_REV
+#define BENCH_REV "tree"
+#endif
+
+//! Число семплов замера.
+#define BENCH_SAMPLES 1000000
+//! Число прогонов.
+#define BENCH_RUNS 5
+
+//! Число случайных наборов каналов.
+#define CHECK_CONFIGS 300
+//! Число кадров каждого набора.
+#define CHECK_FRAMES 20000
+
+//! Размер данных осциллограммы.
+#define BENCH_OSC_DATA_SIZE 16384
+//! Число буферов осциллограммы.
+#define BENCH_OSC_BUFFERS 2
+//! Число каналов осциллограммы.
+#define BENCH_OSC_CHANNELS 16
+
+//! Средняя точка АЦП.
+#define BENCH_OFFSET 2048
+
+
+static osc_value_t bench_osc_data[BENCH_OSC_DATA_SIZE];
+static osc_buffer_t bench_osc_buffers[BENCH_OSC_BUFFERS];
+static osc_channel_t bench_osc_channels[BENCH_OSC_CHANNELS];
+#ifdef OSC_PLAN_KINDS
+static osc_plan_item_t bench_osc_plan[BENCH_OSC_CHANNELS];
+#endif
+static osc_t bench_osc;
+
+static uint32_t bench_rnd = 1;
+static size_t bench_din_sample = 0;
+
+
+// Осциллограмма пишется напрямую, тренды не пишутся.
+void oscs_append(void)
+{
+    // Цифровые входы переключаются с разными периодами.
+    sim_din_state = 0;
+
+    size_t i;
+    for(i = 0; i < DIN_COUNT; i ++){
+        if(((bench_din_sample >> (3 + i)) & 0x1) != 0) sim_din_state |= 1 << i;
+    }
+    bench_din_sample ++;
+
+    osc_append(&bench_osc);
+}
+
+void trends_append(void)
+{
+}
+
+//! Получает случайное число.
+static uint32_t bench_random(uint32_t n)
+{
+    bench_rnd = bench_rnd * 1103515245 + 12345;
+    return (bench_rnd >> 16) % n;
+}
+
+//! Инициализирует осциллограмму без каналов.
+static void bench_osc_init(void)
+{
+#ifdef OSC_PLAN_KINDS
+    osc_init(&bench_osc, bench_osc_data, BENCH_OSC_DATA_SIZE, bench_osc_buffers, BENCH_OSC_BUFFERS,
+             bench_osc_channels, bench_osc_plan, BENCH_OSC_CHANNELS);
+#else
+    osc_init(&bench_osc, bench_osc_data, BENCH_OSC_DATA_SIZE, bench_osc_buffers, BENCH_OSC_BUFFERS,
+             bench_osc_channels, BENCH_OSC_CHANNELS);
+#endif
+    osc_set_buffer_mode(&bench_osc, OSC_RING_IN_BUFFER);
+}
+
+/**
+ * Подаёт кадры синусоид со сдвигом фаз по каналам.
+ * @param count Число кадров.
+ */
+static void bench_put_frames(size_t count)
+{
+    static uint16_t frames[AIN_ADC_BLOCK_FRAMES * AIN_CHANNELS_COUNT];
+    static size_t frame = 0;
+
+    uint32_t freq = ain_oversample_freq();
+
+    size_t pos, n, i;
+    for(pos = 0; pos < count; pos += AIN_ADC_BLOCK_FRAMES){
+        for(n = 0; n < AIN_ADC_BLOCK_FRAMES; n ++, frame ++){
+            double phase = 2.0 * M_PI * AIN_POWER_FREQ_DEFAULT * (double)frame / freq;
+
+            for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+                frames[n * AIN_CHANNELS_COUNT + i] = (uint16_t)lround(BENCH_OFFSET +
+                                                     (200.0 + 250.0 * i) * sin(phase - 2.0 * M_PI * i / 3.0));
+            }
+        }
+        ain_replay_adc_data(frames, AIN_ADC_BLOCK_FRAMES);
+    }
+}
+
+/**
+ * Замеряет время записи семпла.
+ * @param channels Число каналов.
+ * @param rate Предделитель.
+ */
+static void bench_case(size_t channels, size_t rate)
+{
+    ain_set_enabled(false);
+    bench_osc_init();
+
+    size_t i;
+    for(i = 0; i < channels; i ++){
+        if(i < channels / 2){
+            osc_channel_init(&bench_osc, i, OSC_AIN, OSC_VAL, OSC_INST, i % AIN_CHANNELS_COUNT);
+        }else if(i < channels * 3 / 4){
+            osc_channel_init(&bench_osc, i, OSC_AIN, OSC_VAL, OSC_EFF, i % AIN_CHANNELS_COUNT);
+        }else{
+            osc_channel_init(&bench_osc, i, OSC_DIN, OSC_BIT, OSC_INST, i % DIN_COUNT);
+        }
+        osc_channel_set_enabled(&bench_osc, i, true);
+    }
+
+    osc_init_channels(&bench_osc, rate);
+    osc_set_enabled(&bench_osc, true);
+
+    ain_set_enabled(true);
+    bench_put_frames(ain_oversample_freq() / 10);
+
+    double best = 0.0;
+
+    size_t run;
+    for(run = 0; run < BENCH_RUNS; run ++){
+        double time = bench_time();
+
+        for(i = 0; i < BENCH_SAMPLES; i ++){
+            oscs_append();
+        }
+
+        time = bench_time() - time;
+
+        if(run == 0 || time < best) best = time;
+    }
+
+    printf("%s,%zu,%zu,%zu,%.1f\n", BENCH_REV, channels, rate, osc_samples_count(&bench_osc),
+           best * 1e9 / BENCH_SAMPLES);
+}
+
+/**
+ * Записывает кадры в случайный набор каналов.
+ * @return Контрольная сумма FNV-1a значений буфера.
+ */
+static uint32_t check_config(void)
+{
+    ain_set_enabled(false);
+    ain_reset();
+    bench_osc_init();
+    bench_din_sample = 0;
+
+    size_t count = 1 + bench_random(BENCH_OSC_CHANNELS);
+    size_t rate = 1 + bench_random(4);
+
+    size_t i;
+    for(i = 0; i < count; i ++){
+        osc_src_t src = (osc_src_t)bench_random(2);
+        osc_src_type_t src_type = (osc_src_type_t)bench_random(2);
+        // Номер AIN_CHANNELS_COUNT - канал вне АЦП, записывается нулём.
+        size_t src_channel = bench_random(src == OSC_AIN ? AIN_CHANNELS_COUNT + 1 : DIN_COUNT);
+
+        osc_channel_init(&bench_osc, i, src, (src == OSC_AIN) ? OSC_VAL : OSC_BIT, src_type, src_channel);
+        osc_channel_set_enabled(&bench_osc, i, bench_random(4) != 0);
+    }
+
+    osc_init_channels(&bench_osc, rate);
+    osc_set_enabled(&bench_osc, true);
+
+    ain_set_enabled(true);
+    bench_put_frames(CHECK_FRAMES);
+
+    uint32_t hash = 2166136261u;
+    size_t buf = osc_current_buffer(&bench_osc);
+    size_t samples = osc_buffer_samples_count(&bench_osc, buf);
+
+    size_t n, s;
+    for(n = 0; n < count; n ++){
+        if(!osc_channel_enabled(&bench_osc, n)) continue;
+
+        for(s = 0; s < samples; s ++){
+            size_t index = osc_buffer_sample_number_index(&bench_osc, buf, s);
+            uint16_t value = (uint16_t)osc_buffer_channel_value(&bench_osc, buf, n, index);
+
+            hash = (hash ^ (value & 0xff)) * 16777619u;
+            hash = (hash ^ (value >> 8)) * 16777619u;
+        }
+    }
+
+    return hash;
+}
+
+int main(int argc, char* argv[])
+{
+    ain_init();
+    ain_set_rate(AIN_SAMPLE_FREQ_DEFAULT, AIN_POWER_FREQ_DEFAULT);
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        ain_init_channel(i, AIN_AC, AIN_RMS, BENCH_OFFSET, q15_sat(IQ15(1.0)), IQ15(1.0));
+        ain_channel_set_enabled(i, true);
+    }
+
+    if(argc > 1 && strcmp(argv[1], "-H") == 0){
+        printf("rev,channels,rate,samples_count,ns_per_sample\n");
+        return 0;
+    }
+
+    if(argc > 1 && strcmp(argv[1], "-c") == 0){
+        uint32_t hash = 2166136261u;
+
+        for(i = 0; i < CHECK_CONFIGS; i ++){
+            hash = (hash ^ check_config()) * 16777619u;
+        }
+
+        printf("osc buffers: %u configs, checksum=%08x\n", CHECK_CONFIGS, (unsigned int)hash);
+
+        return 0;
+    }
+
+    static const size_t channels[] = {4, 8, 16};
+    static const size_t rates[] = {1, 2};
+
+    size_t c, r;
+    for(r = 0; r < sizeof(rates) / sizeof(rates[0]); r ++){
+        for(c = 0; c < sizeof(channels) / sizeof(channels[0]); c ++){
+            bench_case(channels[c], rates[r]);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,353 @@
+/**
+ * @file bench_osc_read.c Проверка и производительность чтения
+ * данных каналов осциллограммы участками osc_buffer_channel_spans()
+ * в сравнении с чтением по значению osc_buffer_channel_value().
+ * Проверка: для случайных наборов каналов, в том числе с кольцом
+ * буфера, перешедшим через начало, значения случайных диапазонов
+ * семплов, прочитанные участками, должны совпасть со значениями,
+ * прочитанными по одному.
+ * С ключом -b выводит CSV со временем чтения всего буфера
+ * 12 аналоговых и 4 цифровых каналов обоими способами.
+ */
+
+#include "ain.h"
+#include "osc.h"
+#include "din.h"
+#include "din_sim.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+//! Число случайных наборов каналов.
+#define CHECK_CONFIGS 300
+//! Число случайных диапазонов каждого набора.
+#define CHECK_RANGES 16
+//! Размер данных осциллограммы проверки.
+#define CHECK_OSC_DATA_SIZE 4096
+//! Число буферов осциллограммы проверки.
+#define CHECK_OSC_BUFFERS 2
+
+//! Число аналоговых каналов замера.
+#define BENCH_ANALOG 12
+//! Число цифровых каналов замера.
+#define BENCH_DIGITAL 4
+//! Число семплов буфера замера.
+#define BENCH_SAMPLES 8192
+//! Размер данных осциллограммы замера.
+#define BENCH_OSC_DATA_SIZE (BENCH_ANALOG * BENCH_SAMPLES + BENCH_DIGITAL * BENCH_SAMPLES / OSC_BITS_PER_SAMPLE)
+//! Число прогонов замера.
+#define BENCH_RUNS 50
+
+//! Число каналов осциллограммы.
+#define OSC_CHANNELS 16
+
+//! Средняя точка АЦП.
+#define BENCH_OFFSET 2048
+
+
+static osc_value_t osc_data[BENCH_OSC_DATA_SIZE];
+static osc_buffer_t osc_buffers[CHECK_OSC_BUFFERS];
+static osc_channel_t osc_channels[OSC_CHANNELS];
+static osc_plan_item_t osc_plan[OSC_CHANNELS];
+static osc_t bench_osc;
+
+static uint32_t bench_rnd = 1;
+static size_t bench_din_sample = 0;
+
+//! Состояние проверки.
+typedef struct _Check {
+    size_t ranges; //!< Число проверенных диапазонов.
+    size_t wrapped; //!< Число диапазонов из двух участков.
+    size_t refused; //!< Число отказов для каналов пониженной частоты.
+    size_t errors; //!< Число ошибок.
+} check_t;
+
+static check_t check;
+
+
+// Осциллограмма пишется напрямую, тренды не пишутся.
+void oscs_append(void)
+{
+    // Цифровые входы переключаются с разными периодами.
+    sim_din_state = 0;
+
+    size_t i;
+    for(i = 0; i < DIN_COUNT; i ++){
+        if(((bench_din_sample >> (1 + i)) & 0x1) != 0) sim_din_state |= 1 << i;
+    }
+    bench_din_sample ++;
+
+    osc_append(&bench_osc);
+}
+
+void trends_append(void)
+{
+}
+
+//! Получает случайное число.
+static uint32_t bench_random(uint32_t n)
+{
+    bench_rnd = bench_rnd * 1103515245 + 12345;
+    return (bench_rnd >> 8) % n;
+}
+
+/**
+ * Подаёт кадры синусоид со сдвигом фаз по каналам.
+ * @param count Число кадров.
+ */
+static void bench_put_frames(size_t count)
+{
+    static uint16_t frames[AIN_ADC_BLOCK_FRAMES * AIN_CHANNELS_COUNT];
+    static size_t frame = 0;
+
+    uint32_t freq = ain_oversample_freq();
+
+    size_t pos, n, i;
+    for(pos = 0; pos < count; pos += AIN_ADC_BLOCK_FRAMES){
+        for(n = 0; n < AIN_ADC_BLOCK_FRAMES; n ++, frame ++){
+            double phase = 2.0 * M_PI * AIN_POWER_FREQ_DEFAULT * (double)frame / freq;
+
+            for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+                frames[n * AIN_CHANNELS_COUNT + i] = (uint16_t)lround(BENCH_OFFSET +
+                                                     (200.0 + 250.0 * i) * sin(phase - 2.0 * M_PI * i / 3.0));
+            }
+        }
+        ain_replay_adc_data(frames, AIN_ADC_BLOCK_FRAMES);
+    }
+}
+
+/**
+ * Инициализирует осциллограмму.
+ * @param data_size Размер данных.
+ * @param buffers_count Число буферов.
+ */
+static void bench_osc_init(size_t data_size, size_t buffers_count)
+{
+    osc_init(&bench_osc, osc_data, data_size, osc_buffers, buffers_count,
+             osc_channels, osc_plan, OSC_CHANNELS);
+    osc_set_buffer_mode(&bench_osc, OSC_RING_IN_BUFFER);
+}
+
+/**
+ * Получает значение семпла участка.
+ * @param span Участок.
+ * @param type Тип значения канала.
+ * @param i Номер семпла участка.
+ * @return Значение.
+ */
+static osc_value_t span_value(const osc_span_t* span, osc_type_t type, size_t i)
+{
+    if(type == OSC_VAL) return span->data[i];
+
+    size_t bit = span->bit + i;
+
+    return (span->data[bit / OSC_BITS_PER_SAMPLE] >> (bit % OSC_BITS_PER_SAMPLE)) & 0x1;
+}
+
+/**
+ * Сравнивает чтение участками и по значению
+ * для случайных диапазонов текущего буфера.
+ * @param channels Число каналов.
+ */
+static void check_ranges(size_t channels)
+{
+    size_t buf = osc_current_buffer(&bench_osc);
+    size_t samples = osc_buffer_samples_count(&bench_osc, buf);
+    osc_span_t spans[OSC_SPANS_MAX];
+    size_t spans_count;
+
+    size_t r, n, s, i;
+    for(r = 0; r < CHECK_RANGES; r ++){
+        // Первый диапазон - весь буфер.
+        size_t sample = (r == 0) ? 0 : bench_random(samples + 1);
+        size_t count = (r == 0) ? samples : bench_random(samples - sample + 1);
+
+        for(n = 0; n < channels; n ++){
+            if(!osc_channel_enabled(&bench_osc, n)) continue;
+
+            err_t err = osc_buffer_channel_spans(&bench_osc, buf, n, sample, count, spans, &spans_count);
+
+            if(osc_channel_rate(&bench_osc, n) != 1){
+                if(err != E_STATE) check.errors ++;
+                check.refused ++;
+                continue;
+            }
+            if(err != E_NO_ERROR){
+                check.errors ++;
+                continue;
+            }
+
+            check.ranges ++;
+            if(spans_count == 2) check.wrapped ++;
+
+            size_t total = 0;
+            for(i = 0; i < spans_count; i ++) total += spans[i].count;
+            if(total != count) check.errors ++;
+
+            i = 0;
+            size_t k = 0;
+            for(s = 0; s < count && k < spans_count; s ++){
+                size_t index = osc_buffer_sample_number_index(&bench_osc, buf, sample + s);
+                osc_value_t value = osc_buffer_channel_value(&bench_osc, buf, n, index);
+                osc_value_t span = span_value(&spans[k], osc_channel_type(&bench_osc, n), i);
+
+                if(value != span){
+                    if(check.errors < 10){
+                        fprintf(stderr, "channel %zu sample %zu of %zu..+%zu: value %d, span %d\n",
+                                n, sample + s, sample, count, value, span);
+                    }
+                    check.errors ++;
+                }
+
+                if(++ i >= spans[k].count){
+                    i = 0;
+                    k ++;
+                }
+            }
+        }
+    }
+}
+
+//! Проверяет случайный набор каналов.
+static void check_config(void)
+{
+    ain_set_enabled(false);
+    ain_reset();
+    bench_osc_init(CHECK_OSC_DATA_SIZE, CHECK_OSC_BUFFERS);
+    bench_din_sample = 0;
+
+    size_t count = 1 + bench_random(OSC_CHANNELS);
+
+    size_t i;
+    for(i = 0; i < count; i ++){
+        osc_src_t src = (osc_src_t)bench_random(2);
+        osc_src_type_t src_type = (osc_src_type_t)bench_random(2);
+        size_t src_channel = bench_random(src == OSC_AIN ? AIN_CHANNELS_COUNT : DIN_COUNT);
+
+        osc_channel_init(&bench_osc, i, src, (src == OSC_AIN) ? OSC_VAL : OSC_BIT, src_type, src_channel);
+        osc_channel_set_enabled(&bench_osc, i, bench_random(4) != 0);
+        osc_channel_set_rate(&bench_osc, i, (bench_random(4) == 0) ? 2 : 1);
+    }
+
+    osc_init_channels(&bench_osc, 1);
+    osc_set_enabled(&bench_osc, true);
+
+    ain_set_enabled(true);
+
+    // От половины до трёх буферов семплов,
+    // кольцо буфера переходит через начало в большинстве наборов.
+    size_t samples = osc_samples_count(&bench_osc);
+    bench_put_frames((samples / 2 + bench_random(samples * 5 / 2)) * ain_oversample_rate());
+
+    check_ranges(count);
+}
+
+/**
+ * Замеряет время чтения всего буфера.
+ */
+static void bench_read(void)
+{
+    ain_set_enabled(false);
+    bench_osc_init(BENCH_OSC_DATA_SIZE, 1);
+
+    size_t i;
+    for(i = 0; i < BENCH_ANALOG + BENCH_DIGITAL; i ++){
+        if(i < BENCH_ANALOG){
+            osc_channel_init(&bench_osc, i, OSC_AIN, OSC_VAL, OSC_INST, i % AIN_CHANNELS_COUNT);
+        }else{
+            osc_channel_init(&bench_osc, i, OSC_DIN, OSC_BIT, OSC_INST, i % DIN_COUNT);
+        }
+        osc_channel_set_enabled(&bench_osc, i, true);
+    }
+
+    osc_init_channels(&bench_osc, 1);
+    osc_set_enabled(&bench_osc, true);
+
+    ain_set_enabled(true);
+
+    size_t samples = osc_samples_count(&bench_osc);
+    // Кольцо буфера переходит через начало.
+    bench_put_frames((samples + samples / 3) * ain_oversample_rate());
+
+    size_t buf = osc_current_buffer(&bench_osc);
+    size_t count = osc_buffer_samples_count(&bench_osc, buf);
+    osc_span_t spans[OSC_SPANS_MAX];
+    size_t spans_count;
+    double value_best = 0.0, span_best = 0.0;
+    uint32_t value_sum = 0, span_sum = 0;
+
+    size_t run, n, s, k;
+    for(run = 0; run < BENCH_RUNS; run ++){
+        value_sum = 0;
+        double time = bench_time();
+
+        for(n = 0; n < BENCH_ANALOG + BENCH_DIGITAL; n ++){
+            for(s = 0; s < count; s ++){
+                size_t index = osc_buffer_sample_number_index(&bench_osc, buf, s);
+                value_sum += (uint16_t)osc_buffer_channel_value(&bench_osc, buf, n, index);
+            }
+        }
+
+        time = bench_time() - time;
+        if(run == 0 || time < value_best) value_best = time;
+
+        span_sum = 0;
+        time = bench_time();
+
+        for(n = 0; n < BENCH_ANALOG + BENCH_DIGITAL; n ++){
+            osc_buffer_channel_spans(&bench_osc, buf, n, 0, count, spans, &spans_count);
+
+            for(k = 0; k < spans_count; k ++){
+                const osc_value_t* data = spans[k].data;
+
+                if(n < BENCH_ANALOG){
+                    for(s = 0; s < spans[k].count; s ++) span_sum += (uint16_t)data[s];
+                }else{
+                    size_t bit = spans[k].bit;
+                    for(s = 0; s < spans[k].count; s ++, bit ++){
+                        span_sum += (data[bit / OSC_BITS_PER_SAMPLE] >> (bit % OSC_BITS_PER_SAMPLE)) & 0x1;
+                    }
+                }
+            }
+        }
+
+        time = bench_time() - time;
+        if(run == 0 || time < span_best) span_best = time;
+    }
+
+    printf("analog,digital,samples,value_us,spans_us,ns_per_value,ns_per_span_value,identical\n");
+    printf("%u,%u,%zu,%.1f,%.1f,%.2f,%.2f,%s\n", BENCH_ANALOG, BENCH_DIGITAL, count,
+           value_best * 1e6, span_best * 1e6,
+           value_best * 1e9 / (count * (BENCH_ANALOG + BENCH_DIGITAL)),
+           span_best * 1e9 / (count * (BENCH_ANALOG + BENCH_DIGITAL)),
+           (value_sum == span_sum) ? "yes" : "no");
+}
+
+int main(int argc, char* argv[])
+{
+    ain_init();
+    ain_set_rate(AIN_SAMPLE_FREQ_DEFAULT, AIN_POWER_FREQ_DEFAULT);
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        ain_init_channel(i, AIN_AC, AIN_RMS, BENCH_OFFSET, q15_sat(IQ15(1.0)), IQ15(1.0));
+        ain_channel_set_enabled(i, true);
+    }
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0){
+        bench_read();
+        return 0;
+    }
+
+    for(i = 0; i < CHECK_CONFIGS; i ++){
+        check_config();
+    }
+
+    printf("osc spans: %u configs, %zu ranges, %zu wrapped, %zu refused, %zu errors\n",
+           CHECK_CONFIGS, check.ranges, check.wrapped, check.refused, check.errors);
+
+    return (check.errors == 0 && check.wrapped != 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
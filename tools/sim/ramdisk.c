@@ -0,0 +1,192 @@
+/**
+ * @file ramdisk.c Диск FatFs в памяти для проверок на компьютере.
+ */
+
+#include "ramdisk.h"
+#include "fatfs/ff.h"
+#include "fatfs/diskio.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+//! Число резервных секторов.
+#define RAMDISK_RESERVED_SECTORS 32
+//! Сектор FSInfo.
+#define RAMDISK_FSINFO_SECTOR 1
+//! Кластер корневого каталога.
+#define RAMDISK_ROOT_CLUSTER 2
+//! Наименьшее число кластеров FAT32.
+#define RAMDISK_FAT32_CLUSTERS_MIN 65526
+
+
+//! Диск.
+typedef struct _Ramdisk {
+    uint8_t* data; //!< Данные.
+    size_t sectors; //!< Размер в секторах.
+    DWORD next_read; //!< Сектор после предыдущего чтения.
+    DWORD next_write; //!< Сектор после предыдущей записи.
+} ramdisk_t;
+
+static ramdisk_t ramdisk;
+
+ramdisk_stats_t ramdisk_stats;
+
+
+//! Записывает 16 бит.
+static void ramdisk_put16(uint8_t* p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+//! Записывает 32 бита.
+static void ramdisk_put32(uint8_t* p, uint32_t value)
+{
+    ramdisk_put16(p, (uint16_t)value);
+    ramdisk_put16(p + 2, (uint16_t)(value >> 16));
+}
+
+bool ramdisk_init(size_t sectors, size_t cluster_sectors)
+{
+    if(cluster_sectors == 0 || (cluster_sectors & (cluster_sectors - 1)) || cluster_sectors > 128) return false;
+
+    // Размер FAT с запасом на служебные элементы.
+    size_t clusters = (sectors - RAMDISK_RESERVED_SECTORS) / cluster_sectors;
+    size_t fat_sectors = ((clusters + 2) * 4 + RAMDISK_SECTOR_SIZE - 1) / RAMDISK_SECTOR_SIZE;
+    clusters = (sectors - RAMDISK_RESERVED_SECTORS - fat_sectors) / cluster_sectors;
+
+    if(clusters < RAMDISK_FAT32_CLUSTERS_MIN) return false;
+
+    ramdisk_deinit();
+
+    ramdisk.data = calloc(sectors, RAMDISK_SECTOR_SIZE);
+    if(ramdisk.data == NULL) return false;
+    ramdisk.sectors = sectors;
+
+    // Загрузочный сектор.
+    uint8_t* bs = ramdisk.data;
+
+    memcpy(bs, "\xEB\x58\x90" "MSWIN4.1", 11);
+    ramdisk_put16(&bs[11], RAMDISK_SECTOR_SIZE);
+    bs[13] = (uint8_t)cluster_sectors;
+    ramdisk_put16(&bs[14], RAMDISK_RESERVED_SECTORS);
+    bs[16] = 1; // Число FAT.
+    bs[21] = 0xF8; // Жёсткий диск.
+    ramdisk_put32(&bs[32], (uint32_t)sectors);
+    ramdisk_put32(&bs[36], (uint32_t)fat_sectors);
+    ramdisk_put32(&bs[44], RAMDISK_ROOT_CLUSTER);
+    ramdisk_put16(&bs[48], RAMDISK_FSINFO_SECTOR);
+    bs[66] = 0x29; // Расширенная сигнатура.
+    memcpy(&bs[71], "RAMDISK    ", 11);
+    memcpy(&bs[82], "FAT32   ", 8);
+    ramdisk_put16(&bs[510], 0xAA55);
+
+    // FSInfo без сведений о свободных кластерах.
+    uint8_t* fsi = &ramdisk.data[RAMDISK_FSINFO_SECTOR * RAMDISK_SECTOR_SIZE];
+
+    ramdisk_put32(&fsi[0], 0x41615252);
+    ramdisk_put32(&fsi[484], 0x61417272);
+    ramdisk_put32(&fsi[488], 0xFFFFFFFF);
+    ramdisk_put32(&fsi[492], 0xFFFFFFFF);
+    ramdisk_put16(&fsi[510], 0xAA55);
+
+    // Служебные элементы FAT и конец цепочки корневого каталога.
+    uint8_t* fat = &ramdisk.data[RAMDISK_RESERVED_SECTORS * RAMDISK_SECTOR_SIZE];
+
+    ramdisk_put32(&fat[0], 0x0FFFFFF8);
+    ramdisk_put32(&fat[4], 0x0FFFFFFF);
+    ramdisk_put32(&fat[RAMDISK_ROOT_CLUSTER * 4], 0x0FFFFFFF);
+
+    ramdisk_stats_reset();
+
+    return true;
+}
+
+void ramdisk_deinit(void)
+{
+    free(ramdisk.data);
+
+    ramdisk.data = NULL;
+    ramdisk.sectors = 0;
+}
+
+void ramdisk_stats_reset(void)
+{
+    memset(&ramdisk_stats, 0x0, sizeof(ramdisk_stats));
+
+    ramdisk.next_read = 0;
+    ramdisk.next_write = 0;
+}
+
+
+DSTATUS disk_status(BYTE pdrv)
+{
+    if(pdrv != 0 || ramdisk.data == NULL) return STA_NOINIT;
+
+    return 0;
+}
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+    return disk_status(pdrv);
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+    if(disk_status(pdrv) != 0) return RES_NOTRDY;
+    if(sector + count > ramdisk.sectors) return RES_PARERR;
+
+    ramdisk_stats.reads ++;
+    ramdisk_stats.read_sectors += count;
+    if(sector != ramdisk.next_read) ramdisk_stats.read_seeks ++;
+    ramdisk.next_read = sector + count;
+
+    memcpy(buff, &ramdisk.data[(size_t)sector * RAMDISK_SECTOR_SIZE], (size_t)count * RAMDISK_SECTOR_SIZE);
+
+    return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+    if(disk_status(pdrv) != 0) return RES_NOTRDY;
+    if(sector + count > ramdisk.sectors) return RES_PARERR;
+
+    ramdisk_stats.writes ++;
+    ramdisk_stats.write_sectors += count;
+    if(sector != ramdisk.next_write) ramdisk_stats.write_seeks ++;
+    ramdisk.next_write = sector + count;
+
+    memcpy(&ramdisk.data[(size_t)sector * RAMDISK_SECTOR_SIZE], buff, (size_t)count * RAMDISK_SECTOR_SIZE);
+
+    return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff)
+{
+    if(disk_status(pdrv) != 0) return RES_NOTRDY;
+
+    switch(cmd){
+    case CTRL_SYNC:
+        return RES_OK;
+    case GET_SECTOR_COUNT:
+        *(DWORD*)buff = (DWORD)ramdisk.sectors;
+        return RES_OK;
+    case GET_SECTOR_SIZE:
+        *(WORD*)buff = RAMDISK_SECTOR_SIZE;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *(DWORD*)buff = 1;
+        return RES_OK;
+    default:
+        break;
+    }
+
+    return RES_PARERR;
+}
+
+DWORD get_fattime(void)
+{
+    // 2017-07-14 02:40:00.
+    return ((DWORD)(2017 - 1980) << 25) | ((DWORD)7 << 21) | ((DWORD)14 << 16) |
+           ((DWORD)2 << 11) | ((DWORD)40 << 5);
+}
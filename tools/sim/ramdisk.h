@@ -0,0 +1,50 @@
+/**
+ * @file ramdisk.h Диск FatFs в памяти для проверок на компьютере.
+ * Размечается в FAT32 без f_mkfs(), которая в прошивке отключена,
+ * и считает обращения для модели времени карты памяти.
+ */
+
+#ifndef SIM_RAMDISK_H_
+#define SIM_RAMDISK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+
+//! Размер сектора.
+#define RAMDISK_SECTOR_SIZE 512
+
+//! Статистика обращений к диску.
+typedef struct _Ramdisk_Stats {
+    uint32_t reads; //!< Число чтений.
+    uint32_t read_sectors; //!< Число прочитанных секторов.
+    uint32_t read_seeks; //!< Число чтений не с сектора после предыдущего чтения.
+    uint32_t writes; //!< Число записей.
+    uint32_t write_sectors; //!< Число записанных секторов.
+    uint32_t write_seeks; //!< Число записей не с сектора после предыдущей записи.
+} ramdisk_stats_t;
+
+//! Статистика обращений к диску.
+extern ramdisk_stats_t ramdisk_stats;
+
+/**
+ * Создаёт и размечает в FAT32 пустой диск.
+ * Число кластеров должно быть не меньше 65526.
+ * @param sectors Размер диска в секторах.
+ * @param cluster_sectors Размер кластера в секторах, степень двойки.
+ * @return Флаг успеха.
+ */
+extern bool ramdisk_init(size_t sectors, size_t cluster_sectors);
+
+/**
+ * Освобождает диск.
+ */
+extern void ramdisk_deinit(void);
+
+/**
+ * Сбрасывает статистику обращений.
+ */
+extern void ramdisk_stats_reset(void);
+
+#endif /* SIM_RAMDISK_H_ */
@@ -0,0 +1,241 @@
+/**
+ * @file shim.c Заглушки FreeRTOS, таймера и цифровых входов
+ * для сборки конвейера обработки на компьютере.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include <arm_math.h>
+#include <stm32f10x.h>
+#include "hires_timer.h"
+#include "din.h"
+#include "din_sim.h"
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+#include <math.h>
+
+
+//! Максимальное число очередей.
+#define SIM_QUEUES_MAX 4
+
+//! Максимальное число задач.
+#define SIM_TASKS_MAX 4
+
+
+//! Очередь.
+typedef struct _Sim_Queue {
+    uint8_t* storage; //!< Данные.
+    size_t item_size; //!< Размер элемента.
+    size_t length; //!< Число элементов.
+    size_t head; //!< Индекс первого элемента.
+    size_t count; //!< Число элементов в очереди.
+} sim_queue_t;
+
+//! Задача.
+typedef struct _Sim_Task {
+    TaskFunction_t proc; //!< Функция задачи.
+    void* arg; //!< Аргумент.
+} sim_task_t;
+
+//! Планировщик.
+typedef struct _Sim {
+    sim_queue_t queues[SIM_QUEUES_MAX]; //!< Очереди.
+    size_t queues_count; //!< Число очередей.
+    sim_task_t tasks[SIM_TASKS_MAX]; //!< Задачи.
+    size_t tasks_count; //!< Число задач.
+    jmp_buf idle; //!< Возврат из задачи при ожидании.
+    bool running; //!< Флаг выполнения задачи.
+} sim_t;
+
+static sim_t sim;
+
+DWT_Type sim_dwt;
+
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t proc, const char* name, uint32_t stack_size,
+                               void* arg, UBaseType_t priority,
+                               StackType_t* stack, StaticTask_t* task_buffer)
+{
+    (void) name; (void) stack_size; (void) priority; (void) stack; (void) task_buffer;
+
+    if(sim.tasks_count >= SIM_TASKS_MAX) return NULL;
+
+    sim_task_t* task = &sim.tasks[sim.tasks_count ++];
+
+    task->proc = proc;
+    task->arg = arg;
+
+    return task;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (TickType_t)((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+void sim_tasks_run(void)
+{
+    size_t i;
+    for(i = 0; i < sim.tasks_count; i ++){
+        // Задача выполняется с начала и возвращается
+        // сюда, когда больше нечего обрабатывать.
+        if(setjmp(sim.idle) == 0){
+            sim.running = true;
+            sim.tasks[i].proc(sim.tasks[i].arg);
+        }
+        sim.running = false;
+    }
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size,
+                                 uint8_t* storage, StaticQueue_t* queue_buffer)
+{
+    (void) queue_buffer;
+
+    if(sim.queues_count >= SIM_QUEUES_MAX) return NULL;
+
+    sim_queue_t* queue = &sim.queues[sim.queues_count ++];
+
+    queue->storage = storage;
+    queue->item_size = item_size;
+    queue->length = length;
+    queue->head = 0;
+    queue->count = 0;
+
+    return queue;
+}
+
+void vQueueAddToRegistry(QueueHandle_t queue, const char* name)
+{
+    (void) queue; (void) name;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+    (void) ticks;
+
+    sim_queue_t* q = queue;
+
+    if(q->count >= q->length) return pdFALSE;
+
+    size_t index = (q->head + q->count) % q->length;
+
+    memcpy(&q->storage[index * q->item_size], item, q->item_size);
+    q->count ++;
+
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBackFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken)
+{
+    if(woken) *woken = pdTRUE;
+
+    return xQueueSendToBack(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks)
+{
+    sim_queue_t* q = queue;
+
+    if(q->count == 0){
+        if(ticks != 0 && sim.running) longjmp(sim.idle, 1);
+        return pdFALSE;
+    }
+
+    memcpy(item, &q->storage[q->head * q->item_size], q->item_size);
+
+    if(++ q->head >= q->length) q->head = 0;
+    q->count --;
+
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    sim_queue_t* q = queue;
+
+    return q->count;
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t queue)
+{
+    return uxQueueMessagesWaiting(queue);
+}
+
+BaseType_t xQueueIsQueueFullFromISR(QueueHandle_t queue)
+{
+    sim_queue_t* q = queue;
+
+    return (q->count >= q->length) ? pdTRUE : pdFALSE;
+}
+
+void hires_timer_value(struct timeval* tv)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    tv->tv_sec = ts.tv_sec;
+    tv->tv_usec = ts.tv_nsec / 1000;
+}
+
+arm_status arm_sqrt_q15(q15_t in, q15_t* out)
+{
+    if(in <= 0){
+        *out = 0;
+        return (in == 0) ? ARM_MATH_SUCCESS : ARM_MATH_ARGUMENT_ERROR;
+    }
+
+    // Целая часть корня из in * 2^15.
+    uint32_t x = (uint32_t)in << Q15_FRACT_BITS;
+    uint32_t res = 0;
+    uint32_t bit = 1UL << 30;
+
+    while(bit > x) bit >>= 2;
+
+    while(bit != 0){
+        if(x >= res + bit){
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        }else{
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    *out = (q15_t)res;
+
+    return ARM_MATH_SUCCESS;
+}
+
+q15_t arm_cos_q15(q15_t x)
+{
+    double value = cos(2.0 * M_PI * (double)(uint16_t)x / 65536.0 * 2.0);
+
+    return q15_sat((int32_t)lround(value * 32768.0));
+}
+
+// Состояния цифровых входов задаются вызывающим кодом.
+uint32_t sim_din_state = 0;
+
+din_state_t din_state(size_t n)
+{
+    return ((sim_din_state >> n) & 0x1) ? DIN_ON : DIN_OFF;
+}
+
+din_state_t din_state_inst(size_t n)
+{
+    return din_state(n);
+}
+
+const char* din_name(size_t n)
+{
+    (void) n;
+    return "";
+}
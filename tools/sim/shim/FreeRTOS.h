@@ -0,0 +1,33 @@
+/**
+ * @file FreeRTOS.h Заглушка FreeRTOS для сборки на компьютере.
+ */
+
+#ifndef SIM_FREERTOS_H_
+#define SIM_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+typedef struct _StaticTask { int dummy; } StaticTask_t;
+typedef struct _StaticQueue { int dummy; } StaticQueue_t;
+
+typedef void* TaskHandle_t;
+typedef void* QueueHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define portMAX_DELAY ((TickType_t)0xffffffff)
+
+#define configMINIMAL_STACK_SIZE 128
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif /* SIM_FREERTOS_H_ */
@@ -0,0 +1,42 @@
+/**
+ * @file arm_math.h Заглушка CMSIS DSP.
+ * Корень вычисляется целочисленно и может отличаться
+ * от arm_sqrt_q15() младшим разрядом, поэтому контрольные
+ * суммы действующих значений на компьютере и МК различаются.
+ */
+
+#ifndef SIM_ARM_MATH_H_
+#define SIM_ARM_MATH_H_
+
+#include <stdint.h>
+#include "q15/q15.h"
+#include "stm32f10x.h"
+
+typedef enum _Arm_Status {
+    ARM_MATH_SUCCESS = 0,
+    ARM_MATH_ARGUMENT_ERROR = -1
+} arm_status;
+
+extern arm_status arm_sqrt_q15(q15_t in, q15_t* out);
+
+/**
+ * Косинус, аргумент [0, 1) соответствует [0, 2pi).
+ * Вычисляется через cos() и может отличаться
+ * от табличного arm_cos_q15() младшим разрядом.
+ */
+extern q15_t arm_cos_q15(q15_t x);
+
+/**
+ * Двойное 16-битное умножение-накопление
+ * как инструкция SMLAD ядер с расширением DSP,
+ * сумма переполняется по модулю 2^32.
+ */
+static inline uint32_t __SMLAD(uint32_t x, uint32_t y, uint32_t sum)
+{
+    int32_t lo = (int32_t)(int16_t)x * (int16_t)y;
+    int32_t hi = (int32_t)(int16_t)(x >> 16) * (int16_t)(y >> 16);
+
+    return sum + (uint32_t)lo + (uint32_t)hi;
+}
+
+#endif /* SIM_ARM_MATH_H_ */
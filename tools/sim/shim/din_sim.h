@@ -0,0 +1,13 @@
+/**
+ * @file din_sim.h Моделирование цифровых входов.
+ */
+
+#ifndef SIM_DIN_SIM_H_
+#define SIM_DIN_SIM_H_
+
+#include <stdint.h>
+
+//! Состояния цифровых входов, бит n - вход n.
+extern uint32_t sim_din_state;
+
+#endif /* SIM_DIN_SIM_H_ */
@@ -0,0 +1,12 @@
+/**
+ * @file gpio.h Заглушка портов ввода-вывода.
+ */
+
+#ifndef SIM_GPIO_H_
+#define SIM_GPIO_H_
+
+#include "stm32f10x.h"
+
+typedef uint16_t gpio_pin_t;
+
+#endif /* SIM_GPIO_H_ */
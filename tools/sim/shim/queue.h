@@ -0,0 +1,29 @@
+/**
+ * @file queue.h Заглушка очередей FreeRTOS.
+ * Чтение пустой очереди задачей с ожиданием
+ * возвращает управление в sim_tasks_run().
+ */
+
+#ifndef SIM_QUEUE_H_
+#define SIM_QUEUE_H_
+
+#include "FreeRTOS.h"
+
+extern QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size,
+                                        uint8_t* storage, StaticQueue_t* queue_buffer);
+
+extern void vQueueAddToRegistry(QueueHandle_t queue, const char* name);
+
+extern BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks);
+
+extern BaseType_t xQueueSendToBackFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken);
+
+extern BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+
+extern UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+extern UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t queue);
+
+extern BaseType_t xQueueIsQueueFullFromISR(QueueHandle_t queue);
+
+#endif /* SIM_QUEUE_H_ */
@@ -0,0 +1,33 @@
+/**
+ * @file semphr.h Заглушка семафоров FreeRTOS (нужна для ffconf.h и ffsystem.c).
+ * Задачи не вытесняют друг друга, мьютексы всегда свободны.
+ */
+
+#ifndef SIM_SEMPHR_H_
+#define SIM_SEMPHR_H_
+
+#include "FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+
+typedef struct _StaticSemaphore { int dummy; } StaticSemaphore_t;
+
+#define xSemaphoreCreateMutexStatic(buffer) ((SemaphoreHandle_t)(buffer))
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    (void) sem; (void) ticks;
+    return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    (void) sem;
+    return pdTRUE;
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    (void) sem;
+}
+
+#endif /* SIM_SEMPHR_H_ */
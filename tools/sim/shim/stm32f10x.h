@@ -0,0 +1,20 @@
+/**
+ * @file stm32f10x.h Заглушка периферии STM32F10x.
+ */
+
+#ifndef SIM_STM32F10X_H_
+#define SIM_STM32F10X_H_
+
+#include <stdint.h>
+
+typedef struct _TIM_TypeDef { volatile uint32_t CNT; } TIM_TypeDef;
+typedef struct _GPIO_TypeDef { volatile uint32_t IDR; volatile uint32_t ODR; } GPIO_TypeDef;
+
+//! Счётчик тактов, на компьютере не считает.
+typedef struct _DWT_Type { volatile uint32_t CTRL; volatile uint32_t CYCCNT; } DWT_Type;
+
+extern DWT_Type sim_dwt;
+
+#define DWT (&sim_dwt)
+
+#endif /* SIM_STM32F10X_H_ */
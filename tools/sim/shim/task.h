@@ -0,0 +1,29 @@
+/**
+ * @file task.h Заглушка задач FreeRTOS.
+ * Задачи выполняются вызывающим кодом через sim_tasks_run().
+ */
+
+#ifndef SIM_TASK_H_
+#define SIM_TASK_H_
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+
+extern TaskHandle_t xTaskCreateStatic(TaskFunction_t proc, const char* name, uint32_t stack_size,
+                                      void* arg, UBaseType_t priority,
+                                      StackType_t* stack, StaticTask_t* task_buffer);
+
+extern TickType_t xTaskGetTickCount(void);
+
+// Задачи и прерывания не вытесняют друг друга.
+#define taskENTER_CRITICAL() do{}while(0)
+#define taskEXIT_CRITICAL() do{}while(0)
+
+/**
+ * Выполняет созданные задачи, пока каждая
+ * из них не станет ждать пустую очередь.
+ */
+extern void sim_tasks_run(void);
+
+#endif /* SIM_TASK_H_ */
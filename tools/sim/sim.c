@@ -0,0 +1,629 @@
+/**
+ * @file sim.c Воспроизведение кадров АЦП через конвейер
+ * обработки логгера на компьютере.
+ * Кадры из файла CSV проходят через аналоговые входа,
+ * осциллограммы и триггеры так же, как на МК: задача
+ * аналоговых входов вычисляет семплы и пишет осциллограммы,
+ * триггеры проверяются раз в миллисекунду, срабатывание
+ * занимает буфер осциллограммы под событие.
+ * Результаты (срабатывания, события и контрольные суммы)
+ * выводятся в stdout и не зависят от способа подачи кадров,
+ * производительность - в stderr.
+ */
+
+#include "ain.h"
+#include "osc.h"
+#include "oscs.h"
+#include "trig.h"
+#include "task.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+
+//! Коды возврата.
+//! Успех.
+#define SIM_EXIT_OK 0
+//! Ошибка аргументов или ввода.
+#define SIM_EXIT_ERROR 2
+
+//! Размер строки CSV.
+#define SIM_LINE_LEN 256
+
+//! Число кадров в порции обработки.
+#define SIM_CHUNK_FRAMES AIN_ADC_BLOCK_FRAMES
+
+//! Период проверки триггеров, мс (как в задаче логгера).
+#define SIM_TRIG_PERIOD_MS 1
+//! Период проверки триггеров, доли секунды.
+#define SIM_TRIG_DT (Q15(1.0 * SIM_TRIG_PERIOD_MS / 1000))
+
+//! Доля осциллограммы после срабатывания.
+#define SIM_OSC_RATIO IQ15(0.75)
+
+//! Время начала данных (привязка кадра 0), с.
+#define SIM_TIME_START 1500000000
+
+//! Начальное значение контрольной суммы.
+#define SIM_FNV_BASIS 0x811c9dc5
+//! Множитель контрольной суммы.
+#define SIM_FNV_PRIME 0x01000193
+
+// Синтетические данные.
+//! Средняя точка АЦП.
+#define SIM_GEN_OFFSET 2048
+//! Амплитуда напряжения, отсчётов АЦП (~230 В при real_k = 967.5).
+#define SIM_GEN_AMP 1400.0
+//! Амплитуда шума, отсчётов АЦП.
+#define SIM_GEN_NOISE 4
+//! Период повторения возмущений, с.
+#define SIM_GEN_PERIOD 3.0
+
+
+//! Способ подачи кадров.
+typedef enum _Sim_Mode {
+    SIM_MODE_FRAME = 0, //!< По кадру из прерывания через очередь.
+    SIM_MODE_BLOCK, //!< Блоками буфера ПДП из прерывания через очередь.
+    SIM_MODE_REPLAY //!< Синхронно через ain_replay_adc_data().
+} sim_mode_t;
+
+//! Параметры.
+typedef struct _Sim_Opts {
+    sim_mode_t mode; //!< Способ подачи кадров.
+    uint32_t sample_freq; //!< Частота семплирования, Гц.
+    uint32_t power_freq; //!< Частота сети, Гц.
+    size_t max_frames; //!< Ограничение числа кадров, 0 - без ограничения.
+    size_t queue_depth; //!< Число кадров в очереди до запуска задачи.
+    double gen_time; //!< Длительность синтезируемых данных, с.
+} sim_opts_t;
+
+//! Размер буфера ПДП.
+#define SIM_DMA_BUFFER_SIZE (AIN_ADC_BLOCKS * AIN_ADC_BLOCK_FRAMES * AIN_CHANNELS_COUNT)
+
+//! Буфер ПДП.
+static uint16_t sim_dma_buffer[SIM_DMA_BUFFER_SIZE];
+
+//! Номер заполняемого блока буфера ПДП.
+static size_t sim_dma_block;
+
+//! Кадры АЦП.
+typedef struct _Sim_Frames {
+    uint16_t* data; //!< Данные по AIN_CHANNELS_COUNT значений.
+    size_t count; //!< Число кадров.
+    size_t capacity; //!< Ёмкость.
+} sim_frames_t;
+
+//! Состояние воспроизведения.
+typedef struct _Sim_State {
+    uint64_t ticks; //!< Число проверок триггеров.
+    size_t trigs; //!< Число срабатываний.
+    size_t events; //!< Число записанных событий.
+    size_t dropped; //!< Число отброшенных событий.
+    uint64_t event_frame; //!< Кадр срабатывания ожидающего события.
+    size_t event_trig; //!< Триггер ожидающего события.
+    bool event_pending; //!< Флаг ожидания окончания записи события.
+    uint32_t eff_checksum; //!< Контрольная сумма действующих значений при проверках.
+    double trig_time; //!< Время проверки триггеров, с.
+} sim_state_t;
+
+
+/**
+ * Добавляет 16 бит в контрольную сумму (FNV-1a).
+ * @param checksum Контрольная сумма.
+ * @param value Значение.
+ * @return Контрольная сумма.
+ */
+static uint32_t sim_checksum_put(uint32_t checksum, uint16_t value)
+{
+    checksum = (checksum ^ (value & 0xff)) * SIM_FNV_PRIME;
+    checksum = (checksum ^ (value >> 8)) * SIM_FNV_PRIME;
+
+    return checksum;
+}
+
+static double sim_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Читает кадры из файла CSV.
+ * Строка - кадр из AIN_CHANNELS_COUNT 12-битных отсчётов
+ * через запятую, точку с запятой или пробел, недостающие
+ * значения нулевые. Строки, начинающиеся не с цифры
+ * (заголовок, комментарии), пропускаются.
+ * @param frames Кадры.
+ * @param f Файл.
+ * @param max_frames Ограничение числа кадров, 0 - без ограничения.
+ * @return Флаг успеха.
+ */
+static bool sim_read_csv(sim_frames_t* frames, FILE* f, size_t max_frames)
+{
+    char line[SIM_LINE_LEN];
+    size_t line_number = 0;
+
+    while(fgets(line, SIM_LINE_LEN, f) != NULL){
+        line_number ++;
+
+        if(line[0] < '0' || line[0] > '9') continue;
+
+        if(max_frames != 0 && frames->count >= max_frames) break;
+
+        if(frames->count >= frames->capacity){
+            size_t capacity = frames->capacity ? frames->capacity * 2 : 65536;
+            uint16_t* data = realloc(frames->data, capacity * AIN_CHANNELS_COUNT * sizeof(uint16_t));
+            if(data == NULL){
+                fprintf(stderr, "out of memory\n");
+                return false;
+            }
+            frames->data = data;
+            frames->capacity = capacity;
+        }
+
+        uint16_t* frame = &frames->data[frames->count * AIN_CHANNELS_COUNT];
+        char* ptr = line;
+        size_t i;
+
+        for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+            char* end = ptr;
+            unsigned long value = strtoul(ptr, &end, 10);
+
+            if(end == ptr){
+                value = 0;
+            }else if(value > 0xfff){
+                fprintf(stderr, "line %zu: value %lu is out of 12-bit range\n", line_number, value);
+                return false;
+            }
+
+            frame[i] = (uint16_t)value;
+
+            ptr = end;
+            while(*ptr == ',' || *ptr == ';' || *ptr == ' ' || *ptr == '\t') ptr ++;
+        }
+
+        frames->count ++;
+    }
+
+    return !ferror(f);
+}
+
+/**
+ * Выводит синтетические кадры в формате CSV.
+ * Три фазы сети с шумом, каждые SIM_GEN_PERIOD секунд
+ * провал напряжения фаз A и B до половины на 0.2 с
+ * и перенапряжение фазы C на 60 мс.
+ * @param opts Параметры.
+ */
+static void sim_generate(const sim_opts_t* opts)
+{
+    uint32_t freq = opts->sample_freq * (uint32_t)ain_oversample_rate();
+    uint64_t count = (uint64_t)(opts->gen_time * freq);
+    uint32_t rnd = 1;
+
+    printf("# Ua,Ub,Uc,Udc,In0 @ %u Hz\n", (unsigned int)freq);
+
+    uint64_t n;
+    for(n = 0; n < count; n ++){
+        double t = (double)n / freq;
+        double phase = 2.0 * M_PI * opts->power_freq * t;
+        double tp = fmod(t, SIM_GEN_PERIOD);
+
+        double amp_ab = (tp >= 1.0 && tp < 1.2) ? 0.5 : 1.0;
+        double amp_c = (tp >= 2.5 && tp < 2.56) ? 1.35 : 1.0;
+
+        double values[AIN_CHANNELS_COUNT] = {
+            amp_ab * SIM_GEN_AMP * sin(phase),
+            amp_ab * SIM_GEN_AMP * sin(phase - 2.0 * M_PI / 3.0),
+            amp_c * SIM_GEN_AMP * sin(phase + 2.0 * M_PI / 3.0),
+            0.6 * SIM_GEN_AMP,
+            0.0
+        };
+
+        size_t i;
+        for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+            rnd = rnd * 1103515245 + 12345;
+            int noise = (int)((rnd >> 16) % (2 * SIM_GEN_NOISE + 1)) - SIM_GEN_NOISE;
+
+            long value = lround(SIM_GEN_OFFSET + values[i]) + noise;
+            if(value < 0) value = 0;
+            if(value > 0xfff) value = 0xfff;
+
+            printf((i == 0) ? "%ld" : ",%ld", value);
+        }
+        printf("\n");
+    }
+}
+
+/**
+ * Настраивает аналоговые входа, осциллограммы и триггеры
+ * как в config_example.ini.
+ * @param opts Параметры.
+ * @return Флаг успеха.
+ */
+static bool sim_setup(const sim_opts_t* opts)
+{
+    static const char* names[AIN_CHANNELS_COUNT] = {"Ua", "Ub", "Uc", "Udc", "In0"};
+
+    if(ain_init() != E_NO_ERROR) return false;
+
+    if(ain_set_rate(opts->sample_freq, opts->power_freq) != E_NO_ERROR){
+        fprintf(stderr, "unsupported rate %u/%u Hz\n", (unsigned int)opts->sample_freq, (unsigned int)opts->power_freq);
+        return false;
+    }
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        ain_init_channel(i, AIN_AC, AIN_RMS, SIM_GEN_OFFSET, q15_sat(IQ15(1.0)), IQ15(1.0));
+        ain_channel_set_real_k(i, IQ15(967.5));
+        ain_channel_set_name(i, names[i]);
+        ain_channel_set_unit(i, "V");
+        ain_channel_set_enabled(i, i != AIN_0);
+    }
+
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        ain_channel_set_adc_buffer(i, &sim_dma_buffer[i], AIN_CHANNELS_COUNT);
+    }
+
+    ain_reset();
+
+    // Время кадров отсчитывается от кадра 0.
+    ain_time_anchor_isr(SIM_TIME_START, 0, 1);
+
+    trig_init();
+
+    trig_init_t trig_init = {
+        .src = TRIG_AIN, .src_channel = AIN_Ua, .src_type = TRIG_EFF,
+        .type = TRIG_UDF, .time = Q15(0.02), .ref = IQ15(180), .name = "Ua_udf"
+    };
+    trig_channel_init(0, &trig_init);
+    trig_channel_set_enabled(0, true);
+
+    trig_init.src_channel = AIN_Uc;
+    trig_init.src_type = TRIG_INST;
+    trig_init.type = TRIG_OVF;
+    trig_init.time = 0;
+    trig_init.ref = IQ15(400);
+    trig_init.name = "Uc_ovf";
+    trig_channel_init(1, &trig_init);
+    trig_channel_set_enabled(1, true);
+
+    trig_init.src_channel = AIN_Udc;
+    trig_init.src_type = TRIG_EFF;
+    trig_init.type = TRIG_UDF;
+    trig_init.time = Q15(0.01);
+    trig_init.ref = IQ15(100);
+    trig_init.name = "Udc_udf";
+    trig_channel_init(2, &trig_init);
+    trig_channel_set_enabled(2, true);
+
+    trig_set_enabled(true);
+
+    if(oscs_init() != E_NO_ERROR) return false;
+
+    osc_t* osc = oscs_get_osc();
+
+    for(i = 0; i < AIN_Udc + 1; i ++){
+        osc_channel_init(osc, i, OSC_AIN, OSC_VAL, OSC_INST, i);
+        osc_channel_set_enabled(osc, i, true);
+    }
+    for(i = 0; i < AIN_Udc + 1; i ++){
+        osc_channel_init(osc, AIN_Udc + 1 + i, OSC_AIN, OSC_VAL, OSC_EFF, i);
+        osc_channel_set_enabled(osc, AIN_Udc + 1 + i, true);
+    }
+
+    if(osc_init_channels(osc, 2) != E_NO_ERROR) return false;
+
+    oscs_set_enabled(true);
+    oscs_start();
+
+    ain_set_enabled(true);
+
+    return true;
+}
+
+/**
+ * Получает номер сработавшего триггера как логгер.
+ * @return Номер триггера.
+ */
+static size_t sim_activated_trig(void)
+{
+    size_t trig_index = 0;
+
+    size_t i;
+    for(i = 0; i < TRIG_COUNT_MAX; i ++){
+        if(trig_channel_activated(i)) trig_index = i;
+    }
+
+    return trig_index;
+}
+
+/**
+ * Выводит номер кадра и его время.
+ * @param frame Номер кадра.
+ */
+static void sim_print_frame(uint64_t frame)
+{
+    struct timeval tv;
+
+    ain_frame_time(frame, &tv);
+
+    printf(" frame=%llu time=%ld.%06ld", (unsigned long long)frame, (long)tv.tv_sec, (long)tv.tv_usec);
+}
+
+/**
+ * Проверяет триггеры и занимает буфер
+ * осциллограммы при срабатывании.
+ * @param state Состояние.
+ */
+static void sim_check_trigs(sim_state_t* state)
+{
+    double time = sim_time();
+
+    bool activated = trig_check(SIM_TRIG_DT);
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        if(ain_channel_enabled(i)) state->eff_checksum = sim_checksum_put(state->eff_checksum, (uint16_t)ain_value(i));
+    }
+
+    state->trig_time += sim_time() - time;
+    state->ticks ++;
+
+    if(!activated) return;
+
+    uint64_t frame = ain_sample_frame();
+    size_t trig_index = sim_activated_trig();
+
+    state->trigs ++;
+
+    printf("trig %zu %s", trig_index, trig_channel_name(trig_index));
+    sim_print_frame(frame);
+    printf("\n");
+
+    if(state->event_pending || oscs_capture(iq15_mull(oscs_time(), SIM_OSC_RATIO)) != E_NO_ERROR){
+        state->dropped ++;
+        return;
+    }
+
+    state->event_pending = true;
+    state->event_frame = frame;
+    state->event_trig = trig_index;
+}
+
+/**
+ * Выводит событие после окончания записи
+ * его осциллограммы и освобождает буфер.
+ * @param state Состояние.
+ */
+static void sim_write_event(sim_state_t* state)
+{
+    if(!state->event_pending || !oscs_paused()) return;
+
+    osc_t* osc = oscs_get_osc();
+    size_t buf = osc_current_buffer(osc);
+    size_t samples = osc_buffer_samples_count(osc, buf);
+    osc_value_t analog[OSCS_CHANNELS];
+    uint32_t digital;
+    uint32_t checksum = SIM_FNV_BASIS;
+    struct timeval start;
+
+    size_t i, j;
+    for(i = 0; i < samples; i ++){
+        osc_buffer_sample_values(osc, buf, i, analog, &digital);
+
+        for(j = 0; j < osc_analog_channels(osc); j ++){
+            checksum = sim_checksum_put(checksum, (uint16_t)analog[j]);
+        }
+        checksum = sim_checksum_put(checksum, (uint16_t)digital);
+    }
+
+    osc_buffer_start_time(osc, buf, &start);
+
+    printf("event %zu trig=%zu", state->events, state->event_trig);
+    sim_print_frame(state->event_frame);
+    printf(" samples=%zu start=%ld.%06ld checksum=%08x\n", samples,
+           (long)start.tv_sec, (long)start.tv_usec, (unsigned int)checksum);
+
+    state->events ++;
+    state->event_pending = false;
+
+    oscs_resume();
+}
+
+/**
+ * Подаёт кадры на обработку.
+ * @param opts Параметры.
+ * @param frames Кадры.
+ * @param count Число кадров.
+ */
+static void sim_put_frames(const sim_opts_t* opts, const uint16_t* frames, size_t count)
+{
+    size_t i;
+
+    switch(opts->mode){
+    case SIM_MODE_BLOCK:
+        // Неполный блок в конце данных подаётся по кадрам.
+        if(count == AIN_ADC_BLOCK_FRAMES){
+            memcpy(&sim_dma_buffer[sim_dma_block * AIN_ADC_BLOCK_FRAMES * AIN_CHANNELS_COUNT], frames,
+                   sizeof(uint16_t) * AIN_ADC_BLOCK_FRAMES * AIN_CHANNELS_COUNT);
+
+            ain_process_adc_block_isr(sim_dma_block, NULL);
+            sim_tasks_run();
+
+            if(++ sim_dma_block >= AIN_ADC_BLOCKS) sim_dma_block = 0;
+            break;
+        }
+        /* FALLTHROUGH */
+    case SIM_MODE_FRAME:
+        for(i = 0; i < count; i ++){
+            ain_process_adc_data_isr((uint16_t*)&frames[i * AIN_CHANNELS_COUNT], NULL);
+            if((i + 1) % opts->queue_depth == 0 || i + 1 == count) sim_tasks_run();
+        }
+        break;
+    case SIM_MODE_REPLAY:
+        ain_replay_adc_data(frames, count);
+        break;
+    }
+}
+
+/**
+ * Воспроизводит кадры.
+ * @param opts Параметры.
+ * @param frames Кадры.
+ */
+static void sim_run(const sim_opts_t* opts, const sim_frames_t* frames)
+{
+    sim_state_t state;
+    memset(&state, 0x0, sizeof(sim_state_t));
+    state.eff_checksum = SIM_FNV_BASIS;
+
+    uint32_t freq = ain_oversample_freq();
+    size_t chunk;
+    size_t pos;
+
+    double time = sim_time();
+
+    for(pos = 0; pos < frames->count; pos += chunk){
+        chunk = frames->count - pos;
+        if(chunk > SIM_CHUNK_FRAMES) chunk = SIM_CHUNK_FRAMES;
+
+        sim_put_frames(opts, &frames->data[pos * AIN_CHANNELS_COUNT], chunk);
+
+        // Проверки триггеров, прошедшие за порцию.
+        uint64_t ticks = (uint64_t)(pos + chunk) * 1000 / (freq * SIM_TRIG_PERIOD_MS);
+        while(state.ticks < ticks){
+            sim_check_trigs(&state);
+        }
+
+        sim_write_event(&state);
+    }
+
+    time = sim_time() - time;
+
+    ain_stats_t stats;
+    ain_stats(&stats);
+
+    printf("frames=%llu samples=%u trigs=%zu events=%zu dropped=%zu checksum=%08x eff_checksum=%08x\n",
+           (unsigned long long)frames->count, (unsigned int)stats.samples, state.trigs, state.events,
+           state.dropped, (unsigned int)stats.checksum, (unsigned int)state.eff_checksum);
+
+    double samples = stats.samples ? (double)stats.samples : 1.0;
+
+    fprintf(stderr, "%.3f s, %.0f frames/s (%.1fx real time), per sample: calc %.0f ns, oscs %.0f ns,"
+                    " trends %.0f ns, trig check %.0f ns per ms, adc queue drops %u\n",
+            time, frames->count / time, frames->count / (double)freq / time,
+            stats.calc_time * 1000.0 / samples, stats.oscs_time * 1000.0 / samples,
+            stats.trends_time * 1000.0 / samples,
+            state.ticks ? state.trig_time * 1e9 / state.ticks : 0.0,
+            (unsigned int)stats.dropped_frames);
+}
+
+// Тренды пишутся в файлы задачей трендов и не моделируются.
+void trends_append(void)
+{
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] frames.csv\n"
+            "       %s -g seconds [options] > frames.csv\n"
+            "Options:\n"
+            "  -m mode   frame - per-frame ADC interrupt and ain task,\n"
+            "            block - DMA half/full block interrupt and ain task,\n"
+            "            replay - synchronous ain_replay_adc_data() (default)\n"
+            "  -s freq   sample frequency, Hz (default %u)\n"
+            "  -p freq   power frequency, Hz (default %u)\n"
+            "  -n count  stop after count frames\n"
+            "  -q depth  frames queued before the ain task runs (default 1)\n"
+            "  -g time   write synthetic frames of the given duration, s\n",
+            name, name, AIN_SAMPLE_FREQ_DEFAULT, AIN_POWER_FREQ_DEFAULT);
+}
+
+int main(int argc, char* argv[])
+{
+    sim_opts_t opts;
+
+    memset(&opts, 0x0, sizeof(sim_opts_t));
+    opts.mode = SIM_MODE_REPLAY;
+    opts.sample_freq = AIN_SAMPLE_FREQ_DEFAULT;
+    opts.power_freq = AIN_POWER_FREQ_DEFAULT;
+    opts.queue_depth = 1;
+
+    int c;
+    while((c = getopt(argc, argv, "m:s:p:n:q:g:h")) != -1){
+        switch(c){
+        case 'm':
+            if(strcmp(optarg, "frame") == 0) opts.mode = SIM_MODE_FRAME;
+            else if(strcmp(optarg, "block") == 0) opts.mode = SIM_MODE_BLOCK;
+            else if(strcmp(optarg, "replay") == 0) opts.mode = SIM_MODE_REPLAY;
+            else{
+                usage(argv[0]);
+                return SIM_EXIT_ERROR;
+            }
+            break;
+        case 's':
+            opts.sample_freq = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            opts.power_freq = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            opts.max_frames = (size_t)strtoull(optarg, NULL, 10);
+            break;
+        case 'q':
+            opts.queue_depth = (size_t)strtoull(optarg, NULL, 10);
+            if(opts.queue_depth == 0) opts.queue_depth = 1;
+            break;
+        case 'g':
+            opts.gen_time = strtod(optarg, NULL);
+            break;
+        default:
+            usage(argv[0]);
+            return SIM_EXIT_ERROR;
+        }
+    }
+
+    if(!sim_setup(&opts)) return SIM_EXIT_ERROR;
+
+    if(opts.gen_time > 0){
+        sim_generate(&opts);
+        return SIM_EXIT_OK;
+    }
+
+    if(optind != argc - 1){
+        usage(argv[0]);
+        return SIM_EXIT_ERROR;
+    }
+
+    FILE* f = (strcmp(argv[optind], "-") == 0) ? stdin : fopen(argv[optind], "r");
+    if(f == NULL){
+        perror(argv[optind]);
+        return SIM_EXIT_ERROR;
+    }
+
+    sim_frames_t frames;
+    memset(&frames, 0x0, sizeof(sim_frames_t));
+
+    bool ok = sim_read_csv(&frames, f, opts.max_frames);
+
+    if(f != stdin) fclose(f);
+
+    if(!ok){
+        fprintf(stderr, "%s: read error\n", argv[optind]);
+        return SIM_EXIT_ERROR;
+    }
+
+    sim_run(&opts, &frames);
+
+    free(frames.data);
+
+    return SIM_EXIT_OK;
+}
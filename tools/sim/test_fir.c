@@ -0,0 +1,202 @@
+/**
+ * @file test_fir.c Проверка децимирующего КИХ-фильтра fir_decim
+ * на совпадение с прямой формой fir_put()/fir_calc()
+ * для коэффициентов всех профилей частот дискретизации.
+ * Собирается дважды: со свёрткой сложенных симметричных
+ * коэффициентов и с __ARM_FEATURE_DSP == 1 для пути SMLAD.
+ * С ключом -b выводит время на входной отсчёт в CSV.
+ */
+
+// Профили частот и коэффициенты фильтров объявлены в ain.c.
+#include "../../ain.c"
+#include "dsp/fir.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+
+
+//! Число отсчётов проверки каждого профиля.
+#define TEST_SAMPLES 200000
+
+//! Число отсчётов замера каждого профиля.
+#define BENCH_SAMPLES 4000000
+
+//! Путь вычисления свёртки.
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#define TEST_PATH "smlad"
+#else
+#define TEST_PATH "folded"
+#endif
+
+
+// Данные осциллограмм и трендов не записываются.
+void oscs_append(void)
+{
+}
+
+void trends_append(void)
+{
+}
+
+static uint32_t test_rnd = 1;
+
+/**
+ * Получает очередной отсчёт.
+ * Чередуются участки случайных значений во всём
+ * диапазоне, предельных значений с наихудшими для
+ * переполнения знаками и синусоиды.
+ * @param n Номер отсчёта.
+ * @return Отсчёт.
+ */
+static q15_t test_sample(size_t n)
+{
+    test_rnd = test_rnd * 1103515245 + 12345;
+
+    switch((n / 1000) % 3){
+    default:
+    case 0:
+        return (q15_t)(test_rnd >> 16);
+    case 1:
+        return (test_rnd & 0x10000) ? Q15(-1.0) : (q15_t)0x7fff;
+    case 2:
+        return (q15_t)(20000.0 * sin(2.0 * M_PI * n / 37.0));
+    }
+}
+
+/**
+ * Проверяет фильтр профиля.
+ * Отсчёты помещаются порциями разного размера,
+ * выход сравнивается на каждом отсчёте.
+ * @param rate Профиль.
+ * @return Число несовпадений.
+ */
+static size_t test_rate(const ain_rate_t* rate)
+{
+    static q15_t input[TEST_SAMPLES];
+    q15_t fir_data[AIN_FIR_N];
+    q15_t decim_data[FIR_DECIM_DATA_SIZE(AIN_FIR_N)];
+    fir_t fir;
+    fir_decim_t decim;
+
+    fir_init(&fir, (q15_t*)rate->fir_coefs, fir_data, AIN_FIR_N);
+    fir_decim_init(&decim, rate->fir_coefs, decim_data, AIN_FIR_N);
+
+    size_t i;
+    for(i = 0; i < TEST_SAMPLES; i ++){
+        input[i] = test_sample(i);
+    }
+
+    size_t errors = 0;
+    size_t pos = 0;
+    size_t chunk = 1;
+
+    while(pos < TEST_SAMPLES){
+        if(chunk > TEST_SAMPLES - pos) chunk = TEST_SAMPLES - pos;
+
+        fir_decim_put(&decim, &input[pos], chunk);
+
+        for(i = 0; i < chunk; i ++){
+            fir_put(&fir, input[pos + i]);
+        }
+
+        pos += chunk;
+
+        q15_t ref = fir_calc(&fir);
+        q15_t res = fir_decim_calc(&decim);
+
+        if(ref != res){
+            if(errors == 0){
+                fprintf(stderr, "%u/%u Hz: sample %zu: fir_calc %d, fir_decim_calc %d\n",
+                        rate->sample_freq, rate->power_freq, pos, ref, res);
+            }
+            errors ++;
+        }
+
+        // Порции 1..2 * AIN_ADC_BLOCK_FRAMES, в том числе кратности оверсемплинга.
+        chunk = (chunk % (2 * AIN_ADC_BLOCK_FRAMES)) + 1;
+    }
+
+    return errors;
+}
+
+/**
+ * Замеряет время на входной отсчёт при децимации профиля:
+ * прямая форма помещает каждый отсчёт и вычисляет свёртку
+ * раз в кратность оверсемплинга, fir_decim помещает
+ * блоки по кратности оверсемплинга.
+ * @param rate Профиль.
+ */
+static void bench_rate(const ain_rate_t* rate)
+{
+    static q15_t input[BENCH_SAMPLES];
+    q15_t fir_data[AIN_FIR_N];
+    q15_t decim_data[FIR_DECIM_DATA_SIZE(AIN_FIR_N)];
+    fir_t fir;
+    fir_decim_t decim;
+    volatile int32_t sink = 0;
+    size_t rate_n = rate->oversample_rate;
+    size_t count = BENCH_SAMPLES - BENCH_SAMPLES % rate_n;
+
+    fir_init(&fir, (q15_t*)rate->fir_coefs, fir_data, AIN_FIR_N);
+    fir_decim_init(&decim, rate->fir_coefs, decim_data, AIN_FIR_N);
+
+    size_t i, j;
+    for(i = 0; i < count; i ++){
+        input[i] = test_sample(i);
+    }
+
+    double time = bench_time();
+    uint64_t ticks = bench_ticks();
+
+    for(i = 0; i < count; i += rate_n){
+        for(j = 0; j < rate_n; j ++){
+            fir_put(&fir, input[i + j]);
+        }
+        sink += fir_calc(&fir);
+    }
+
+    double direct_time = bench_time() - time;
+    uint64_t direct_ticks = bench_ticks() - ticks;
+
+    time = bench_time();
+    ticks = bench_ticks();
+
+    for(i = 0; i < count; i += rate_n){
+        fir_decim_put(&decim, &input[i], rate_n);
+        sink += fir_decim_calc(&decim);
+    }
+
+    double decim_time = bench_time() - time;
+    uint64_t decim_ticks = bench_ticks() - ticks;
+
+    printf("%s,%u,%u,%u,%.2f,%.2f,%.1f,%.1f\n", TEST_PATH, rate->sample_freq, rate->power_freq,
+           rate->oversample_rate, direct_time * 1e9 / count, decim_time * 1e9 / count,
+           (double)direct_ticks / count, (double)decim_ticks / count);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t i;
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0){
+        if(argc > 2 && strcmp(argv[2], "-H") == 0){
+            printf("path,sample_freq,power_freq,decim,direct_ns_per_sample,decim_ns_per_sample,"
+                   "direct_ticks_per_sample,decim_ticks_per_sample\n");
+        }
+        for(i = 0; i < AIN_RATES_COUNT; i ++){
+            bench_rate(&ain_rates[i]);
+        }
+        return 0;
+    }
+
+    size_t errors = 0;
+
+    for(i = 0; i < AIN_RATES_COUNT; i ++){
+        errors += test_rate(&ain_rates[i]);
+    }
+
+    printf("fir_decim %s: %zu rates, %zu mismatches\n", TEST_PATH, (size_t)AIN_RATES_COUNT, errors);
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,460 @@
+/**
+ * @file test_osc_pack.c Проверка сжатия блоков семплов осциллограмм.
+ * Для каждого набора сигналов блоки сжимаются с ключевыми блоками
+ * каждые OSC_PACK_KEY_BLOCKS блоков, как в буфере осциллограммы,
+ * и распаковываются последовательно и с ближайшего ключевого блока,
+ * распакованные семплы должны совпасть побитно.
+ * Сигналы подобраны так, чтобы в неключевых блоках
+ * преобладал каждый из предсказателей, наихудший набор
+ * должен занимать ровно OSC_PACK_BLOCK_WORDS_MAX слов на блок.
+ * Выводит степень сжатия и распределение предсказателей,
+ * с ключом -b - CSV со временем сжатия и распаковки.
+ */
+
+// Предсказатели и выбор предсказателя объявлены в osc_pack.c.
+#include "../../osc_pack.c"
+#include "osc.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+
+//! Число аналоговых каналов (config_example.ini).
+#define TEST_ANALOG 7
+//! Число цифровых каналов (config_example.ini).
+#define TEST_DIGITAL 9
+
+//! Число блоков каждого набора.
+#define TEST_BLOCKS 1024
+//! Каждый TEST_PARTIAL_DIV блок неполный.
+#define TEST_PARTIAL_DIV 7
+
+//! Частота сети относительно частоты семплов, Q15:
+//! период 32.77 семпла, предсказатель по периоду
+//! не повторяет синусоиду точно.
+#define TEST_FREQ 1000
+
+//! Число прогонов замера.
+#define BENCH_RUNS 15
+
+//! Наибольший размер сжатого блока.
+#define TEST_BLOCK_WORDS OSC_PACK_BLOCK_WORDS_MAX(TEST_ANALOG, TEST_DIGITAL)
+
+
+//! Наборы сигналов.
+typedef enum _Test_Sig {
+    TEST_SIG_WALK = 0, //!< Случайное блуждание с малым шагом.
+    TEST_SIG_RAMP, //!< Пила с малым наклоном.
+    TEST_SIG_SINE, //!< Синусоида частоты сети.
+    TEST_SIG_PERIODIC, //!< Случайная форма с периодом сети.
+    TEST_SIG_NOISE, //!< Шум во всём диапазоне.
+    TEST_SIG_POWER, //!< Три фазы с гармониками, шумом и аварией.
+    TEST_SIG_WORST, //!< Чередование предельных значений.
+} test_sig_t;
+
+//! Набор сигналов.
+typedef struct _Test_Case {
+    const char* name; //!< Имя.
+    test_sig_t sig; //!< Сигналы.
+    int pred; //!< Преобладающий предсказатель, -1 - не проверяется.
+} test_case_t;
+
+//! Наборы сигналов.
+static const test_case_t test_cases[] = {
+    {"walk", TEST_SIG_WALK, OSC_PACK_PRED_DELTA},
+    {"ramp", TEST_SIG_RAMP, OSC_PACK_PRED_LINEAR},
+    {"sine", TEST_SIG_SINE, OSC_PACK_PRED_RESONANT},
+    {"periodic", TEST_SIG_PERIODIC, OSC_PACK_PRED_CYCLE},
+    {"noise", TEST_SIG_NOISE, OSC_PACK_PRED_RAW},
+    {"power", TEST_SIG_POWER, -1},
+    {"worst", TEST_SIG_WORST, OSC_PACK_PRED_RAW},
+};
+
+//! Число наборов.
+#define TEST_CASES_COUNT (sizeof(test_cases) / sizeof(test_cases[0]))
+
+//! Имена предсказателей.
+static const char* test_pred_names[OSC_PACK_PREDS] = {"delta", "linear", "resonant", "cycle", "raw"};
+
+
+//! Сжатые блоки набора.
+typedef struct _Test_Stream {
+    int16_t data[TEST_BLOCKS * TEST_BLOCK_WORDS]; //!< Сжатые данные.
+    size_t offset[TEST_BLOCKS]; //!< Смещения блоков.
+    size_t count[TEST_BLOCKS]; //!< Число семплов блоков.
+    int16_t values[TEST_BLOCKS][OSC_PACK_BLOCK_SAMPLES][TEST_ANALOG]; //!< Исходные значения.
+    uint16_t digital[TEST_BLOCKS][TEST_DIGITAL]; //!< Исходные биты цифровых каналов.
+    size_t words; //!< Размер сжатых данных.
+    size_t samples; //!< Число семплов.
+    size_t preds[OSC_PACK_PREDS]; //!< Число выборов предсказателей в неключевых блоках.
+} test_stream_t;
+
+static test_stream_t test_stream;
+
+static osc_pack_t test_pack;
+static int16_t test_put_data[TEST_ANALOG * (OSC_PACK_HISTORY_MAX + OSC_PACK_BLOCK_SAMPLES) + TEST_DIGITAL];
+static int16_t test_get_data[TEST_ANALOG * (OSC_PACK_HISTORY_MAX + OSC_PACK_BLOCK_SAMPLES) + TEST_DIGITAL];
+static osc_pack_seq_t test_put;
+static osc_pack_seq_t test_get;
+
+static size_t test_errors;
+
+
+static uint32_t test_rnd = 1;
+
+//! Получает случайное число.
+static uint32_t test_random(void)
+{
+    test_rnd = test_rnd * 1103515245 + 12345;
+    return test_rnd >> 16;
+}
+
+//! Ограничивает значение диапазоном int16_t.
+static int16_t test_sat(double value)
+{
+    long v = lround(value);
+
+    if(v > INT16_MAX) return INT16_MAX;
+    if(v < INT16_MIN) return INT16_MIN;
+
+    return (int16_t)v;
+}
+
+/**
+ * Получает значение аналогового канала.
+ * @param sig Сигналы.
+ * @param n Номер семпла.
+ * @param c Номер канала.
+ * @return Значение.
+ */
+static int16_t test_analog(test_sig_t sig, size_t n, size_t c)
+{
+    static int16_t walk[TEST_ANALOG];
+    static int16_t cycle[TEST_ANALOG][OSC_PACK_HISTORY_MAX];
+
+    double w = 2.0 * M_PI * TEST_FREQ / 32768.0;
+    double phase = 2.0 * M_PI * (double)c / 3.0;
+
+    switch(sig){
+    default:
+    case TEST_SIG_WALK:
+        if(n == 0) walk[c] = 0;
+        walk[c] = test_sat(walk[c] + (int)(test_random() % 7) - 3);
+        return walk[c];
+    case TEST_SIG_RAMP:
+        return (int16_t)(((n * (37 + c) + c * 1000) % 60000) - 30000);
+    case TEST_SIG_SINE:
+        return test_sat(20000.0 * sin(w * (double)n + phase));
+    case TEST_SIG_PERIODIC:
+        if(n == 0){
+            size_t i;
+            for(i = 0; i < test_pack.period; i ++) cycle[c][i] = (int16_t)(test_random() % 4001) - 2000;
+        }
+        return cycle[c][n % test_pack.period];
+    case TEST_SIG_NOISE:
+        return (int16_t)test_random();
+    case TEST_SIG_POWER:{
+        // Авария с апериодической составляющей во второй четверти.
+        double amp = (n >= TEST_BLOCKS * 4 && n < TEST_BLOCKS * 8) ? 24000.0 : 6000.0;
+        double dc = (n >= TEST_BLOCKS * 4 && n < TEST_BLOCKS * 8) ?
+                    6000.0 * exp(-(double)(n - TEST_BLOCKS * 4) / 200.0) : 0.0;
+        return test_sat(amp * sin(w * (double)n + phase) + 0.05 * amp * sin(3.0 * w * (double)n + phase) +
+                        dc + (double)((int)(test_random() % 9) - 4));
+    }
+    case TEST_SIG_WORST:
+        return ((n + c) & 0x1) ? INT16_MAX : INT16_MIN;
+    }
+}
+
+/**
+ * Получает биты блока цифрового канала.
+ * @param sig Сигналы.
+ * @param n Номер первого семпла блока.
+ * @param c Номер канала.
+ * @return Биты семплов блока.
+ */
+static uint16_t test_digital(test_sig_t sig, size_t n, size_t c)
+{
+    if(sig == TEST_SIG_WORST) return (c & 0x1) ? 0x5555 : 0xaaaa;
+
+    uint16_t bits = 0;
+
+    size_t i;
+    switch(c % 3){
+    default:
+    case 0:
+        return (c & 0x4) ? 0xffff : 0x0;
+    case 1:
+        // Переключение каждые 40 семплов.
+        for(i = 0; i < OSC_PACK_BLOCK_SAMPLES; i ++){
+            if(((n + i) / 40) & 0x1) bits |= (uint16_t)(1 << i);
+        }
+        return bits;
+    case 2:
+        return (uint16_t)test_random();
+    }
+}
+
+/**
+ * Сжимает набор сигналов.
+ * @param sig Сигналы.
+ */
+static void test_encode(test_sig_t sig)
+{
+    test_stream_t* s = &test_stream;
+
+    memset(s->preds, 0, sizeof(s->preds));
+    s->words = 0;
+    s->samples = 0;
+
+    osc_pack_seq_reset(&test_put);
+
+    size_t b, i, c;
+    for(b = 0; b < TEST_BLOCKS; b ++){
+        size_t count = (b % TEST_PARTIAL_DIV == TEST_PARTIAL_DIV - 1) ?
+                       1 + b % (OSC_PACK_BLOCK_SAMPLES - 1) : OSC_PACK_BLOCK_SAMPLES;
+        bool key = (b % OSC_PACK_KEY_BLOCKS) == 0;
+
+        for(i = 0; i < count; i ++){
+            for(c = 0; c < TEST_ANALOG; c ++){
+                int16_t value = test_analog(sig, s->samples + i, c);
+                test_put_data[osc_pack_analog_offset(&test_pack, c) + i] = value;
+                s->values[b][i][c] = value;
+            }
+        }
+        for(c = 0; c < TEST_DIGITAL; c ++){
+            uint16_t bits = test_digital(sig, s->samples, c) & osc_pack_mask(count);
+            test_put_data[osc_pack_digital_offset(&test_pack, c)] = (int16_t)bits;
+            s->digital[b][c] = bits;
+        }
+        test_put.count = count;
+
+        if(!key){
+            size_t width;
+            for(c = 0; c < TEST_ANALOG; c ++){
+                s->preds[osc_pack_analyze(&test_pack, &test_put_data[osc_pack_analog_offset(&test_pack, c)],
+                                          count, test_put.valid, &width)] ++;
+            }
+        }
+
+        size_t expected = osc_pack_block_words(&test_pack, &test_put, key);
+        size_t words = osc_pack_encode(&test_pack, &test_put, &s->data[s->words], key);
+
+        if(words != expected || words > TEST_BLOCK_WORDS){
+            if(test_errors < 10){
+                fprintf(stderr, "block %zu: %zu words, estimated %zu, max %zu\n",
+                        b, words, expected, (size_t)TEST_BLOCK_WORDS);
+            }
+            test_errors ++;
+        }
+        if(sig == TEST_SIG_WORST && count == OSC_PACK_BLOCK_SAMPLES && words != TEST_BLOCK_WORDS){
+            if(test_errors < 10){
+                fprintf(stderr, "worst block %zu: %zu words, max %zu\n", b, words, (size_t)TEST_BLOCK_WORDS);
+            }
+            test_errors ++;
+        }
+        if(osc_pack_block_key(&s->data[s->words]) != key ||
+           osc_pack_block_samples(&s->data[s->words]) != count){
+            if(test_errors < 10) fprintf(stderr, "block %zu: header mismatch\n", b);
+            test_errors ++;
+        }
+
+        s->offset[b] = s->words;
+        s->count[b] = count;
+        s->words += words;
+        s->samples += count;
+    }
+}
+
+/**
+ * Сравнивает распакованный блок с исходным.
+ * @param b Номер блока.
+ * @param how Способ распаковки.
+ */
+static void test_compare(size_t b, const char* how)
+{
+    test_stream_t* s = &test_stream;
+    size_t count = s->count[b];
+
+    if(test_get.count != count){
+        if(test_errors < 10) fprintf(stderr, "%s block %zu: %zu samples, expected %zu\n", how, b, test_get.count, count);
+        test_errors ++;
+        return;
+    }
+
+    size_t i, c;
+    for(c = 0; c < TEST_ANALOG; c ++){
+        for(i = 0; i < count; i ++){
+            int16_t value = test_get_data[osc_pack_analog_offset(&test_pack, c) + i];
+            if(value != s->values[b][i][c]){
+                if(test_errors < 10){
+                    fprintf(stderr, "%s block %zu channel %zu sample %zu: %d, expected %d\n",
+                            how, b, c, i, value, s->values[b][i][c]);
+                }
+                test_errors ++;
+            }
+        }
+    }
+    for(c = 0; c < TEST_DIGITAL; c ++){
+        uint16_t bits = (uint16_t)test_get_data[osc_pack_digital_offset(&test_pack, c)] & osc_pack_mask(count);
+        if(bits != s->digital[b][c]){
+            if(test_errors < 10){
+                fprintf(stderr, "%s block %zu digital %zu: %04x, expected %04x\n", how, b, c, bits, s->digital[b][c]);
+            }
+            test_errors ++;
+        }
+    }
+}
+
+/**
+ * Распаковывает набор последовательно
+ * и каждый блок с ближайшего ключевого блока.
+ */
+static void test_decode(void)
+{
+    test_stream_t* s = &test_stream;
+
+    osc_pack_seq_reset(&test_get);
+
+    size_t b, k;
+    for(b = 0; b < TEST_BLOCKS; b ++){
+        osc_pack_decode(&test_pack, &test_get, &s->data[s->offset[b]]);
+        test_compare(b, "sequential");
+    }
+
+    for(b = 0; b < TEST_BLOCKS; b ++){
+        k = b;
+        while(k != 0 && !osc_pack_block_key(&s->data[s->offset[k]])) k --;
+
+        osc_pack_seq_reset(&test_get);
+        for(; k <= b; k ++){
+            osc_pack_decode(&test_pack, &test_get, &s->data[s->offset[k]]);
+        }
+        test_compare(b, "seek");
+    }
+}
+
+//! Получает степень сжатия набора.
+static double test_ratio(void)
+{
+    return (double)(test_stream.samples * TEST_ANALOG + TEST_BLOCKS * TEST_DIGITAL) / (double)test_stream.words;
+}
+
+/**
+ * Замеряет время сжатия и распаковки набора.
+ * @param tc Набор.
+ */
+static void bench_case(const test_case_t* tc)
+{
+    test_stream_t* s = &test_stream;
+    static int16_t dst[TEST_BLOCKS * TEST_BLOCK_WORDS];
+    double best_encode = 0.0, best_decode = 0.0;
+    uint64_t best_encode_ticks = 0, best_decode_ticks = 0;
+    volatile size_t sink = 0;
+
+    size_t run, b, c;
+    for(run = 0; run < BENCH_RUNS; run ++){
+        size_t words = 0;
+
+        osc_pack_seq_reset(&test_put);
+
+        double time = bench_time();
+        uint64_t ticks = bench_ticks();
+
+        // Значения уже в исходных данных, копирование - как osc_plan_put().
+        for(b = 0; b < TEST_BLOCKS; b ++){
+            for(c = 0; c < TEST_ANALOG; c ++){
+                size_t i;
+                for(i = 0; i < s->count[b]; i ++){
+                    test_put_data[osc_pack_analog_offset(&test_pack, c) + i] = s->values[b][i][c];
+                }
+            }
+            for(c = 0; c < TEST_DIGITAL; c ++){
+                test_put_data[osc_pack_digital_offset(&test_pack, c)] = (int16_t)s->digital[b][c];
+            }
+            test_put.count = s->count[b];
+
+            words += osc_pack_encode(&test_pack, &test_put, &dst[words], (b % OSC_PACK_KEY_BLOCKS) == 0);
+        }
+
+        ticks = bench_ticks() - ticks;
+        time = bench_time() - time;
+
+        if(run == 0 || time < best_encode) best_encode = time;
+        if(run == 0 || ticks < best_encode_ticks) best_encode_ticks = ticks;
+
+        osc_pack_seq_reset(&test_get);
+
+        time = bench_time();
+        ticks = bench_ticks();
+
+        for(b = 0; b < TEST_BLOCKS; b ++){
+            sink += osc_pack_decode(&test_pack, &test_get, &s->data[s->offset[b]]);
+        }
+
+        ticks = bench_ticks() - ticks;
+        time = bench_time() - time;
+
+        if(run == 0 || time < best_decode) best_decode = time;
+        if(run == 0 || ticks < best_decode_ticks) best_decode_ticks = ticks;
+
+        sink += words;
+    }
+
+    printf("%s,%u,%u,%zu,%zu,%.2f,%.1f,%.1f,%.0f,%.0f\n", tc->name, TEST_ANALOG, TEST_DIGITAL,
+           (size_t)TEST_BLOCKS, s->samples, test_ratio(),
+           best_encode * 1e9 / s->samples, best_decode * 1e9 / s->samples,
+           (double)best_encode_ticks / TEST_BLOCKS, (double)best_decode_ticks / TEST_BLOCKS);
+}
+
+int main(int argc, char* argv[])
+{
+    bool bench = argc > 1 && strcmp(argv[1], "-b") == 0;
+
+    osc_pack_init(&test_pack, TEST_ANALOG, TEST_DIGITAL, TEST_FREQ);
+    osc_pack_seq_init(&test_put, test_put_data);
+    osc_pack_seq_init(&test_get, test_get_data);
+
+    if(bench){
+        printf("signal,analog,digital,blocks,samples,ratio,encode_ns_per_sample,decode_ns_per_sample,"
+               "encode_ticks_per_block,decode_ticks_per_block\n");
+    }
+
+    size_t n, p;
+    for(n = 0; n < TEST_CASES_COUNT; n ++){
+        const test_case_t* tc = &test_cases[n];
+
+        test_encode(tc->sig);
+        test_decode();
+
+        if(bench){
+            bench_case(tc);
+            continue;
+        }
+
+        size_t best = 0;
+        for(p = 1; p < OSC_PACK_PREDS; p ++){
+            if(test_stream.preds[p] > test_stream.preds[best]) best = p;
+        }
+
+        if(tc->pred >= 0 && (size_t)tc->pred != best){
+            fprintf(stderr, "%s: %s predictor prevails, expected %s\n",
+                    tc->name, test_pred_names[best], test_pred_names[tc->pred]);
+            test_errors ++;
+        }
+
+        printf("osc_pack %s: ratio %.2f, predictors", tc->name, test_ratio());
+        for(p = 0; p < OSC_PACK_PREDS; p ++){
+            printf(" %s %zu", test_pred_names[p], test_stream.preds[p]);
+        }
+        printf("\n");
+    }
+
+    if(!bench){
+        printf("osc_pack: %zu signals, %zu words max per block, %zu errors\n",
+               (size_t)TEST_CASES_COUNT, (size_t)TEST_BLOCK_WORDS, test_errors);
+    }
+
+    return test_errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,310 @@
+/**
+ * @file test_osc_time.c Проверка времени семплов буферов
+ * осциллограмм, запись которых переходит через границу секунды.
+ * Кадры подаются через прерывание АЦП и задачу аналоговых
+ * входов, часы привязываются к кадрам в начале каждой секунды.
+ * Для каждого профиля частот и предделителя осциллограммы
+ * буферы, захваченные до и после границ секунд (в том числе
+ * после переполнения кольца буфера), сравниваются со временем
+ * кадров, вычисленным по последней привязке.
+ * Также проверяется период семпла в нс длиннее 2^32 нс.
+ */
+
+#include "ain.h"
+#include "osc.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//! Время первой привязки, с.
+#define TEST_SEC 1500000000
+//! Длительность каждого случая, с.
+#define TEST_TIME 4
+//! Длительность буфера осциллограммы, доли секунды.
+#define TEST_BUFFER_TIME 0.4
+//! Отступ захвата от границы секунды, кадров на секунду.
+#define TEST_CAPTURE_DIV 20
+
+//! Размер данных осциллограммы.
+#define TEST_OSC_DATA_SIZE 16384
+//! Число буферов осциллограммы.
+#define TEST_OSC_BUFFERS 2
+//! Число каналов осциллограммы.
+#define TEST_OSC_CHANNELS 2
+
+//! Частоты профилей.
+static const uint32_t test_rates[][2] = {
+    { 800, 50}, {1600, 50}, {3200, 50}, {6400, 50},
+    { 960, 60}, {1920, 60}, {3840, 60}, {7680, 60},
+};
+
+//! Предделители осциллограммы.
+static const size_t test_osc_rates[] = {1, 2, 4};
+
+//! Уход часов, кадров за секунду.
+static const int test_drifts[] = {0, 3, -3};
+
+
+static osc_value_t test_osc_data[TEST_OSC_DATA_SIZE];
+static osc_buffer_t test_osc_buffers[TEST_OSC_BUFFERS];
+static osc_channel_t test_osc_channels[TEST_OSC_CHANNELS];
+static osc_plan_item_t test_osc_plan[TEST_OSC_CHANNELS];
+static osc_t test_osc;
+
+//! Состояние проверки.
+typedef struct _Test {
+    uint64_t frame; //!< Число поданных кадров.
+    time_t anchor_sec; //!< Время последней привязки.
+    uint64_t anchor_frame; //!< Кадр последней привязки.
+    size_t checked; //!< Число проверенных буферов.
+    size_t straddled; //!< Число буферов через границу секунды.
+    size_t errors; //!< Число ошибок.
+} test_t;
+
+static test_t test;
+
+
+// Осциллограмма пишется напрямую, тренды не пишутся.
+void oscs_append(void)
+{
+    osc_append(&test_osc);
+}
+
+void trends_append(void)
+{
+}
+
+/**
+ * Вычисляет время кадра по последней привязке
+ * с округлением до микросекунды половин вверх.
+ * @param frame Номер кадра.
+ * @return Время, мкс.
+ */
+static uint64_t test_frame_time_us(uint64_t frame)
+{
+    int64_t freq = (int64_t)ain_oversample_freq();
+    int64_t num = (int64_t)(frame - test.anchor_frame) * 1000000 + freq / 2;
+    int64_t q = num / freq;
+
+    if(num % freq != 0 && num < 0) q --;
+
+    return (uint64_t)test.anchor_sec * 1000000 + (uint64_t)q;
+}
+
+static void test_error(const char* what, size_t sample, uint64_t time, uint64_t expected)
+{
+    if(test.errors < 10){
+        fprintf(stderr, "%u/%u Hz osc rate %zu: %s sample %zu: %llu us, expected %llu us\n",
+                (unsigned int)ain_sample_freq(), (unsigned int)ain_power_freq(), osc_rate(&test_osc), what,
+                sample, (unsigned long long)time, (unsigned long long)expected);
+    }
+    test.errors ++;
+}
+
+/**
+ * Подаёт кадр и привязывает часы в начале секунды.
+ * @param start Кадр начала случая.
+ * @param drift Уход часов, кадров за секунду.
+ */
+static void test_put_frame(uint64_t start, int drift)
+{
+    static uint16_t adc_data[AIN_CHANNELS_COUNT] = {2048, 2048, 2048, 2048, 2048};
+
+    uint64_t period = (uint64_t)((int64_t)ain_oversample_freq() + drift);
+    uint64_t frames = test.frame - start;
+
+    if(frames % period == 0){
+        test.anchor_sec = TEST_SEC + (time_t)(frames / period);
+        test.anchor_frame = test.frame;
+
+        ain_time_anchor_isr(test.anchor_sec, 0, 1);
+    }
+
+    adc_data[AIN_Ua] = (uint16_t)(2048 + (test.frame % 64) * 8);
+
+    ain_process_adc_data_isr(adc_data, NULL);
+    sim_tasks_run();
+
+    test.frame ++;
+}
+
+/**
+ * Проверяет время семплов остановленного буфера.
+ * Пауза обнаруживается при записи семпла после последнего,
+ * поэтому последний семпл буфера - один из последних
+ * 2 * osc_rate() семплов аналоговых входов.
+ */
+static void test_check_buffer(void)
+{
+    size_t buf = osc_current_buffer(&test_osc);
+    size_t count = osc_buffer_samples_count(&test_osc, buf);
+    uint64_t step = (uint64_t)osc_rate(&test_osc) * ain_oversample_rate();
+    uint64_t sample_frame = ain_sample_frame();
+    struct timeval tv;
+
+    osc_buffer_end_time(&test_osc, buf, &tv);
+    uint64_t end = (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+
+    if(tv.tv_usec < 0 || tv.tv_usec >= 1000000) test_error("end timeval", count - 1, end, end);
+
+    // Кадр последнего семпла.
+    uint64_t end_frame = 0;
+    bool found = false;
+
+    size_t k;
+    for(k = 0; k < 2 * osc_rate(&test_osc) && !found; k ++){
+        end_frame = sample_frame - k * ain_oversample_rate();
+        found = (test_frame_time_us(end_frame) == end);
+    }
+
+    if(!found){
+        test_error("end", count - 1, end, test_frame_time_us(sample_frame));
+        return;
+    }
+
+    osc_buffer_start_time(&test_osc, buf, &tv);
+    uint64_t start = (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+
+    uint64_t expected = test_frame_time_us(end_frame - (count - 1) * step);
+    if(start != expected) test_error("start", 0, start, expected);
+
+    uint64_t prev = 0;
+
+    // Семплы буфера и один после его конца.
+    size_t i;
+    for(i = 0; i <= count; i ++){
+        uint64_t time = 0;
+
+        osc_buffer_sample_time_us(&test_osc, buf, i, &time);
+
+        expected = test_frame_time_us(end_frame - (count - 1) * step + i * step);
+
+        if(time != expected) test_error("sample", i, time, expected);
+        if(i != 0 && time <= prev) test_error("order", i, time, prev + 1);
+
+        prev = time;
+    }
+
+    if(start / 1000000 != end / 1000000) test.straddled ++;
+
+    test.checked ++;
+}
+
+/**
+ * Проверяет профиль частот и предделитель.
+ * @param sample_freq Частота семплирования.
+ * @param power_freq Частота сети.
+ * @param osc_rate Предделитель осциллограммы.
+ * @param drift Уход часов, кадров за секунду.
+ */
+static void test_case(uint32_t sample_freq, uint32_t power_freq, size_t osc_rate, int drift)
+{
+    ain_set_enabled(false);
+    ain_set_rate(sample_freq, power_freq);
+    ain_reset();
+
+    // Буфер на TEST_BUFFER_TIME секунды.
+    size_t samples = (size_t)(sample_freq * TEST_BUFFER_TIME) / osc_rate;
+    size_t data_size = samples * TEST_OSC_BUFFERS * TEST_OSC_CHANNELS;
+    if(data_size > TEST_OSC_DATA_SIZE) data_size = TEST_OSC_DATA_SIZE;
+
+    osc_init(&test_osc, test_osc_data, data_size, test_osc_buffers, TEST_OSC_BUFFERS,
+             test_osc_channels, test_osc_plan, TEST_OSC_CHANNELS);
+    osc_set_buffers_count(&test_osc, TEST_OSC_BUFFERS);
+    osc_set_buffer_mode(&test_osc, OSC_RING_IN_BUFFER);
+
+    osc_channel_init(&test_osc, 0, OSC_AIN, OSC_VAL, OSC_INST, AIN_Ua);
+    osc_channel_set_enabled(&test_osc, 0, true);
+    osc_channel_init(&test_osc, 1, OSC_AIN, OSC_VAL, OSC_EFF, AIN_Ua);
+    osc_channel_set_enabled(&test_osc, 1, true);
+
+    osc_init_channels(&test_osc, osc_rate);
+    osc_set_enabled(&test_osc, true);
+
+    ain_set_enabled(true);
+
+    uint32_t freq = ain_oversample_freq();
+    uint64_t start = test.frame;
+    uint64_t end = start + (uint64_t)freq * TEST_TIME;
+    iq15_t pause_time = osc_time(&test_osc) / 2;
+    bool pending = false;
+
+    while(test.frame < end){
+        uint64_t frames = test.frame - start;
+
+        // Захват незадолго до границы каждой секунды после первой,
+        // когда кольцо буфера уже переполнено.
+        if(!pending && frames > freq && frames % freq == freq - freq / TEST_CAPTURE_DIV){
+            osc_pause(&test_osc, pause_time);
+            pending = true;
+        }
+
+        test_put_frame(start, drift);
+
+        if(pending && osc_buffer_paused(&test_osc, osc_current_buffer(&test_osc))){
+            test_check_buffer();
+
+            osc_buffer_resume(&test_osc, osc_current_buffer(&test_osc));
+            osc_next_buffer(&test_osc);
+            pending = false;
+        }
+    }
+}
+
+/**
+ * Проверяет период семпла в нс медленных трендов,
+ * период которых превышает 2^32 нс.
+ */
+static void test_period(void)
+{
+    static const size_t rates[] = {1, 6871, 6872, 16000};
+
+    ain_set_enabled(false);
+    ain_set_rate(1600, 50);
+    ain_reset();
+
+    size_t i;
+    for(i = 0; i < sizeof(rates) / sizeof(rates[0]); i ++){
+        osc_init(&test_osc, test_osc_data, TEST_OSC_DATA_SIZE, test_osc_buffers, TEST_OSC_BUFFERS,
+                 test_osc_channels, test_osc_plan, TEST_OSC_CHANNELS);
+        osc_init_channels(&test_osc, rates[i]);
+
+        uint64_t expected = (uint64_t)rates[i] * 1000000000 / 1600;
+        uint64_t period = osc_sample_period_ns(&test_osc);
+
+        if(period != expected){
+            fprintf(stderr, "osc rate %zu: period %llu ns, expected %llu ns\n", rates[i],
+                    (unsigned long long)period, (unsigned long long)expected);
+            test.errors ++;
+        }
+    }
+}
+
+int main(void)
+{
+    ain_init();
+
+    size_t i;
+    for(i = 0; i < AIN_CHANNELS_COUNT; i ++){
+        ain_init_channel(i, AIN_AC, AIN_RMS, 2048, q15_sat(IQ15(1.0)), IQ15(1.0));
+        ain_channel_set_enabled(i, true);
+    }
+
+    size_t r, o, d;
+    for(d = 0; d < sizeof(test_drifts) / sizeof(test_drifts[0]); d ++){
+        for(r = 0; r < sizeof(test_rates) / sizeof(test_rates[0]); r ++){
+            for(o = 0; o < sizeof(test_osc_rates) / sizeof(test_osc_rates[0]); o ++){
+                test_case(test_rates[r][0], test_rates[r][1], test_osc_rates[o], test_drifts[d]);
+            }
+        }
+    }
+
+    test_period();
+
+    printf("osc time: %zu buffers, %zu across a second boundary, %zu errors\n",
+           test.checked, test.straddled, test.errors);
+
+    return (test.errors == 0 && test.straddled != 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -17,6 +17,7 @@
 #include <time.h>
 #include "fattime.h"
 #include "storage.h"
+#include "arena.h"
 
 
 //! Число попыток записи тренда.
@@ -36,9 +37,15 @@
 //! Размер буфера для записи файла.
 #define TRENDS_BUF_SIZE 32
 
+//! Размер буфера записи данных COMTRADE.
+#define TRENDS_DAT_BUF_SIZE (COMTRADE_DAT_SECTOR_SIZE)
+
 //! Размер имени файла.
 #define TRENDS_FILENAME_LEN 32
 
+//! Размер идентификатора канала COMTRADE.
+#define TRENDS_CH_ID_LEN 32
+
 //! Минимальное число семплов в файле.
 #define TRENDS_LIMIT_SAMPLES_MIN 10
 
@@ -75,6 +82,10 @@ typedef struct _Trends_Osc_Data {
     size_t buf; //!< Буфер.
     size_t start; //!< Начальный индекс.
     size_t count; //!< Количество.
+    size_t sample; //!< Номер прочитанного семпла буфера.
+    osc_value_t analog[TRENDS_CHANNELS]; //!< Значения аналоговых каналов семпла.
+    uint32_t digital; //!< Упакованные значения цифровых каналов семпла.
+    char ch_id[TRENDS_CH_ID_LEN]; //!< Идентификатор канала.
 } trends_osc_data_t;
 
 //! Структура трендов.
@@ -91,9 +102,9 @@ typedef struct _Trends {
     StaticTimer_t timer_buffer; //!< Буфер таймера.
     TimerHandle_t timer_handle; //!< Идентификатор таймера.
     // Данные.
-    osc_value_t data[TRENDS_SAMPLES]; //!< Данные трендов.
     osc_buffer_t buffers[TRENDS_BUFFERS]; //!< Буферы трендов.
     osc_channel_t channels[TRENDS_CHANNELS]; //!< Каналы трендов.
+    osc_plan_item_t plan[TRENDS_CHANNELS]; //!< План записи каналов.
     osc_t osc; //!< Осциллограмма.
     trends_state_t state; //!< Состояние.
     edge_detect_t ed_buf_fill; //!< Детектор момента заполнения буфера.
@@ -103,12 +114,22 @@ typedef struct _Trends {
     size_t limit; //!< Лимит в секундах.
     // Обмен с задачей.
     size_t limit_samples; //!< Лимит тренда в одном файле в семплах.
+    size_t sync_period; //!< Период синхронизации файла тренда в секундах.
+    comtrade_dat_type_t dat_type; //!< Тип данных COMTRADE.
+    bool cff; //!< Запись единым файлом CFF.
     // Данные задачи.
-    FIL file; //!< Файл.
+    FIL file; //!< Файл данных, открыт до смены файла тренда.
+    FIL cfg_file; //!< Файл конфигурации.
+    DWORD clmt[COMTRADE_DAT_CLMT_SIZE]; //!< Таблица связей кластеров файла данных.
+    bool file_opened; //!< Флаг открытого файла данных.
+    TickType_t sync_last; //!< Время последней синхронизации файла.
     comtrade_t comtrade; //!< Комтрейд.
     trends_osc_data_t osc_data; //!< Данные комтрейд.
+    comtrade_dat_stream_t dat_stream; //!< Поток записи данных комтрейд.
+    uint8_t dat_buf[TRENDS_DAT_BUF_SIZE]; //!< Буфер записи данных комтрейд.
     char file_base_name[TRENDS_FILENAME_LEN]; //!< Имя файла.
     size_t samples; //!< Число семплов в текущем тренде.
+    size_t synced_samples; //!< Число семплов в файле на момент последней синхронизации.
     size_t timestamp; //!< Отметка времени последнего семпла в тренде.
     //struct timeval data_time; //!< Время первых данных в файле.
     // Данные таймера.
@@ -181,15 +202,19 @@ static err_t trends_init_task(void)
 err_t trends_init(void)
 {
     err_t err = E_NO_ERROR;
+    osc_value_t* data = NULL;
 
     memset(&trends, 0x0, sizeof(trends_t));
 
     err = trends_init_task();
     if(err != E_NO_ERROR) return err;
 
-    err = osc_init(&trends.osc, trends.data, TRENDS_SAMPLES,
+    err = arena_alloc(TRENDS_SAMPLES, &data);
+    if(err != E_NO_ERROR) return err;
+
+    err = osc_init(&trends.osc, data, TRENDS_SAMPLES,
                    trends.buffers, TRENDS_BUFFERS,
-                   trends.channels, TRENDS_CHANNELS);
+                   trends.channels, trends.plan, TRENDS_CHANNELS);
     if(err != E_NO_ERROR) return err;
 
     osc_set_buffer_mode(&trends.osc, OSC_BUFFER_IN_RING);
@@ -204,6 +229,22 @@ osc_t* trends_get_osc(void)
     return &trends.osc;
 }
 
+err_t trends_set_samples(size_t samples)
+{
+    err_t err = E_NO_ERROR;
+    osc_value_t* data = NULL;
+
+    err = arena_alloc(samples, &data);
+    if(err != E_NO_ERROR) return err;
+
+    return osc_set_data(&trends.osc, data, samples);
+}
+
+size_t trends_samples(void)
+{
+    return osc_data_size(&trends.osc);
+}
+
 void trends_append(void)
 {
     if(trends.state != TRENDS_STATE_RUN){
@@ -253,6 +294,16 @@ size_t trends_limit(void)
     return trends.limit;
 }
 
+size_t trends_sync_period(void)
+{
+    return trends.sync_period;
+}
+
+void trends_set_sync_period(size_t period)
+{
+    trends.sync_period = period;
+}
+
 void trends_set_limit(size_t limit)
 {
     trends.limit = limit;
@@ -291,6 +342,37 @@ void trends_set_outdate_interval(size_t interval)
     trends.outdate_interval = interval;
 }
 
+comtrade_dat_type_t trends_dat_type(void)
+{
+    return trends.dat_type;
+}
+
+err_t trends_set_dat_type(comtrade_dat_type_t dat_type)
+{
+    switch(dat_type){
+    case COMTRADE_DAT_BINARY:
+    case COMTRADE_DAT_BINARY32:
+    case COMTRADE_DAT_FLOAT32:
+        break;
+    default:
+        return E_INVALID_VALUE;
+    }
+
+    trends.dat_type = dat_type;
+
+    return E_NO_ERROR;
+}
+
+bool trends_cff(void)
+{
+    return trends.cff;
+}
+
+void trends_set_cff(bool cff)
+{
+    trends.cff = cff;
+}
+
 bool trends_enabled(void)
 {
     return osc_enabled(&trends.osc);
@@ -308,6 +390,9 @@ void trends_reset(void)
     trends.need_sync = false;
     trends.limit = 0;
     trends.limit_samples = 0;
+    trends.sync_period = 0;
+    trends.dat_type = COMTRADE_DAT_BINARY;
+    trends.cff = false;
     trends.outdate = 0;
     trends.outdate_interval = 0;
     trends.outdate_counter = 0;
@@ -372,6 +457,29 @@ static void trends_assert(bool value)
 }*/
 
 
+/**
+ * Получает идентификатор канала COMTRADE -
+ * имя канала с типом прореживания.
+ * Идентификатор с прореживанием собирается в общем буфере
+ * данных осциллограммы и действителен до следующего вызова.
+ * @param osc_data Данные осциллограммы комтрейд.
+ * @param n Номер канала.
+ * @return Идентификатор канала.
+ */
+static const char* comtrade_channel_id(trends_osc_data_t* osc_data, size_t n)
+{
+    osc_t* osc = osc_data->osc;
+
+    const char* name = osc_channel_name(osc, n);
+    const char* decim = osc_decim_name(osc_channel_decim(osc, n));
+
+    if(decim == NULL) return name;
+
+    snprintf(osc_data->ch_id, TRENDS_CH_ID_LEN, "%s_%s", name ? name : "", decim);
+
+    return osc_data->ch_id;
+}
+
 /**
  * Получает данные об аналоговом канале.
  * @param index Индекс аналогового канала.
@@ -385,7 +493,7 @@ static void comtrade_get_analog_channel(comtrade_t* comtrade, size_t index, comt
     size_t ch_index = osc_analog_channel_index(osc, index);
     if(ch_index == OSC_INDEX_INVALID) return;
 
-    channel->ch_id = osc_channel_name(osc, ch_index);
+    channel->ch_id = comtrade_channel_id(osc_data, ch_index);
     channel->ph = NULL;
     channel->ccbm = NULL;
     channel->uu = osc_channel_unit(osc, ch_index);
@@ -412,7 +520,7 @@ static void comtrade_get_digital_channel(comtrade_t* comtrade, size_t index, com
     size_t ch_index = osc_digital_channel_index(osc, index);
     if(ch_index == OSC_INDEX_INVALID) return;
 
-    channel->ch_id = osc_channel_name(osc, ch_index);
+    channel->ch_id = comtrade_channel_id(osc_data, ch_index);
     channel->ph = NULL;
     channel->ccbm = NULL;
     channel->y = false;
@@ -428,21 +536,22 @@ static void comtrade_get_sample_rate(comtrade_t* comtrade, size_t index, comtrad
     trends_osc_data_t* osc_data = (trends_osc_data_t*)comtrade->osc_data;
     trends_t* trends = osc_data->trends;
     osc_t* osc = osc_data->osc;
-    size_t count = osc_data->count;
 
     (void) index;
 
-    rate->samp = IQ15(AIN_SAMPLE_FREQ) / osc_rate(osc);
-    rate->endsamp = trends->samples + count;
+    // Семплы, записанные в файл данных.
+    rate->samp = osc_sample_freq(osc);
+    rate->endsamp = trends->samples;
 }
 
 /**
- * Получает значение аналогового канала.
- * @param index Индекс канала.
- * @param sample Номер семпла канала.
- * @return Значение канала.
+ * Получает данные семпла осциллограммы.
+ * Значения всех каналов семпла читаются
+ * однократно при смене номера семпла.
+ * @param sample Номер семпла.
+ * @return Данные семпла, либо NULL.
  */
-static int16_t comtrade_get_analog_channel_value(comtrade_t* comtrade, size_t index, size_t sample)
+static trends_osc_data_t* comtrade_get_sample(comtrade_t* comtrade, size_t sample)
 {
     trends_osc_data_t* osc_data = (trends_osc_data_t*)comtrade->osc_data;
     trends_t* trends = osc_data->trends;
@@ -450,20 +559,36 @@ static int16_t comtrade_get_analog_channel_value(comtrade_t* comtrade, size_t in
     size_t buf = osc_data->buf;
     size_t start = osc_data->start;
 
-    //trends_assert(index < osc_analog_channels(osc));
     //trends_assert(buf != OSC_INDEX_INVALID);
 
-    if(buf == OSC_INDEX_INVALID) return COMTRADE_UNKNOWN_VALUE;
-
-    size_t ch_index = osc_analog_channel_index(osc, index);
-    if(ch_index == OSC_INDEX_INVALID) return COMTRADE_UNKNOWN_VALUE;
+    if(buf == OSC_INDEX_INVALID) return NULL;
 
     size_t sample_index = sample - trends->samples + start;
 
-    //if(index == 1) return (int16_t)(sample_index);
+    if(osc_data->sample != sample_index){
+        osc_buffer_sample_values(osc, buf, sample_index, osc_data->analog, &osc_data->digital);
+        osc_data->sample = sample_index;
+    }
 
-    osc_value_t value = osc_buffer_channel_value(osc, buf, ch_index,
-                            osc_buffer_sample_number_index(osc, buf, sample_index));
+    return osc_data;
+}
+
+/**
+ * Получает значение аналогового канала.
+ * @param index Индекс канала.
+ * @param sample Номер семпла канала.
+ * @return Значение канала.
+ */
+static int16_t comtrade_get_analog_channel_value(comtrade_t* comtrade, size_t index, size_t sample)
+{
+    trends_osc_data_t* osc_data = comtrade_get_sample(comtrade, sample);
+    if(osc_data == NULL) return COMTRADE_UNKNOWN_VALUE;
+
+    //trends_assert(index < osc_analog_channels(osc));
+
+    if(index >= osc_analog_channels(osc_data->osc)) return COMTRADE_UNKNOWN_VALUE;
+
+    osc_value_t value = osc_data->analog[index];
 
     if(value == COMTRADE_UNKNOWN_VALUE) value = COMTRADE_DAT_MIN;
 
@@ -471,33 +596,38 @@ static int16_t comtrade_get_analog_channel_value(comtrade_t* comtrade, size_t in
 }
 
 /**
- * Получает значение цифрового канала.
+ * Получает значение аналогового канала в единицах измерения канала.
  * @param index Индекс канала.
  * @param sample Номер семпла канала.
  * @return Значение канала.
  */
-static bool comtrade_get_digital_channel_value(comtrade_t* comtrade, size_t index, size_t sample)
+static iq15_t comtrade_get_analog_channel_real_value(comtrade_t* comtrade, size_t index, size_t sample)
 {
     trends_osc_data_t* osc_data = (trends_osc_data_t*)comtrade->osc_data;
-    trends_t* trends = osc_data->trends;
     osc_t* osc = osc_data->osc;
-    size_t buf = osc_data->buf;
-    size_t start = osc_data->start;
 
-    //trends_assert(index < osc_analog_channels(osc));
-    //trends_assert(buf != OSC_INDEX_INVALID);
+    size_t ch_index = osc_analog_channel_index(osc, index);
+    if(ch_index == OSC_INDEX_INVALID) return 0;
 
-    if(buf == OSC_INDEX_INVALID) return COMTRADE_UNKNOWN_VALUE;
+    osc_value_t value = comtrade_get_analog_channel_value(comtrade, index, sample);
 
-    size_t ch_index = osc_digital_channel_index(osc, index);
-    if(ch_index == OSC_INDEX_INVALID) return COMTRADE_UNKNOWN_VALUE;
+    return iq15_mull(value, osc_channel_scale(osc, ch_index));
+}
 
-    size_t sample_index = sample - trends->samples + start;
+/**
+ * Получает значение цифрового канала.
+ * @param index Индекс канала.
+ * @param sample Номер семпла канала.
+ * @return Значение канала.
+ */
+static bool comtrade_get_digital_channel_value(comtrade_t* comtrade, size_t index, size_t sample)
+{
+    trends_osc_data_t* osc_data = comtrade_get_sample(comtrade, sample);
+    if(osc_data == NULL) return COMTRADE_UNKNOWN_VALUE;
 
-    osc_value_t value = osc_buffer_channel_value(osc, buf, ch_index,
-                            osc_buffer_sample_number_index(osc, buf, sample_index));
+    if(index >= osc_digital_channels(osc_data->osc) || index >= OSC_SAMPLE_DIGITAL_BITS) return COMTRADE_UNKNOWN_VALUE;
 
-    return value != 0;
+    return (osc_data->digital >> index) & 0x1;
 }
 
 static void trends_task_init_comtrade(void)
@@ -506,9 +636,7 @@ static void trends_task_init_comtrade(void)
 
     osc_t* osc = &trends.osc;
 
-    struct timeval period_tv;
-
-    osc_sample_period(osc, &period_tv);
+    uint64_t period_ns = osc_sample_period_ns(osc);
 
     comtrade->station_name = logger_station_name();
     comtrade->rec_dev_id = logger_dev_id();
@@ -516,7 +644,7 @@ static void trends_task_init_comtrade(void)
     comtrade->get_analog_channel = comtrade_get_analog_channel;
     comtrade->digital_channels = osc_digital_channels(osc);
     comtrade->get_digital_channel = comtrade_get_digital_channel;
-    comtrade->lf = IQ15(AIN_POWER_FREQ);
+    comtrade->lf = IQ15((int32_t)ain_power_freq());
     comtrade->nrates = 1;
     comtrade->get_sample_rate = comtrade_get_sample_rate;
 
@@ -526,17 +654,23 @@ static void trends_task_init_comtrade(void)
     comtrade->data_time.tv_sec = 0;
     comtrade->data_time.tv_usec = 0;
 
-    comtrade->timemult = period_tv.tv_sec * 1000000 + period_tv.tv_usec;
+    comtrade->timemult = (uint32_t)(period_ns / 1000);
+    comtrade->timemult_frac = (uint32_t)(period_ns % 1000);
 
     //comtrade.get_sample_timestamp = NULL;
     comtrade->get_analog_channel_value = comtrade_get_analog_channel_value;
     comtrade->get_digital_channel_value = comtrade_get_digital_channel_value;
+    comtrade->get_analog_channel_real_value = comtrade_get_analog_channel_real_value;
+    comtrade->endsamp_fixed = true;
+    comtrade->dat_type = trends.dat_type;
+    comtrade->cff = trends.cff;
 
     trends.osc_data.trends = &trends;
     trends.osc_data.osc = &trends.osc;
     trends.osc_data.buf = 0;
     trends.osc_data.start = 0;
     trends.osc_data.count = 0;
+    trends.osc_data.sample = OSC_INDEX_INVALID;
 
     comtrade->osc_data = (comtrade_osc_data_t)&trends.osc_data;
     comtrade->user_data = (void*)0;
@@ -555,18 +689,19 @@ static err_t trends_task_ctrd_write_cfg(comtrade_t* comtrade)
     res = snprintf(filename, TRENDS_FILENAME_LEN, "%s.cfg", trends->file_base_name);
     if(res <= 0) return E_INVALID_VALUE;
 
-    memset(&trends->file, 0x0, sizeof(FIL));
-    fr = f_open(&trends->file, filename, FA_WRITE | FA_CREATE_ALWAYS);
+    memset(&trends->cfg_file, 0x0, sizeof(FIL));
+    fr = f_open(&trends->cfg_file, filename, FA_WRITE | FA_CREATE_ALWAYS);
     if(fr != FR_OK) return E_IO_ERROR;
 
-    err = comtrade_write_cfg(&trends->file, comtrade);
+    err = comtrade_write_cfg(&trends->cfg_file, comtrade);
 
-    f_close(&trends->file);
+    fr = f_close(&trends->cfg_file);
+    if(err == E_NO_ERROR && fr != FR_OK) err = E_IO_ERROR;
 
     return err;
 }
 
-static err_t trends_task_ctrd_write_dat(comtrade_t* comtrade)
+static err_t trends_task_ctrd_update_cfg(comtrade_t* comtrade)
 {
     err_t err = E_NO_ERROR;
     FRESULT fr = FR_OK;
@@ -576,41 +711,225 @@ static err_t trends_task_ctrd_write_dat(comtrade_t* comtrade)
     trends_t* trends = osc_data->trends;
 
     char filename[TRENDS_FILENAME_LEN];
-    res = snprintf(filename, TRENDS_FILENAME_LEN, "%s.dat", trends->file_base_name);
+    res = snprintf(filename, TRENDS_FILENAME_LEN, "%s.cfg", trends->file_base_name);
+    if(res <= 0) return E_INVALID_VALUE;
+
+    memset(&trends->cfg_file, 0x0, sizeof(FIL));
+    fr = f_open(&trends->cfg_file, filename, FA_WRITE | FA_OPEN_EXISTING);
+    if(fr != FR_OK) return E_IO_ERROR;
+
+    err = comtrade_update_cfg_endsamp(&trends->cfg_file, comtrade, trends->samples);
+
+    fr = f_close(&trends->cfg_file);
+    if(err == E_NO_ERROR && fr != FR_OK) err = E_IO_ERROR;
+
+    return err;
+}
+
+/**
+ * Открывает файл данных тренда для потоковой записи.
+ * Файл конфигурации (начало файла CFF) записывается
+ * полностью только при открытии нового файла тренда.
+ * При ограничении размера тренда место под весь файл
+ * резервируется заранее, поэтому после сбоя питания
+ * файл данных может быть длиннее, чем указано в конфигурации.
+ * @param comtrade Комтрейд.
+ * @return Код ошибки.
+ */
+static err_t trends_task_file_open(comtrade_t* comtrade)
+{
+    if(trends.file_opened) return E_NO_ERROR;
+
+    err_t err = E_NO_ERROR;
+    FRESULT fr = FR_OK;
+    int res = 0;
+
+    char filename[TRENDS_FILENAME_LEN];
+    res = snprintf(filename, TRENDS_FILENAME_LEN, "%s.%s", trends.file_base_name, comtrade->cff ? "cff" : "dat");
     if(res <= 0) return E_INVALID_VALUE;
 
-    memset(&trends->file, 0x0, sizeof(FIL));
-    fr = f_open(&trends->file, filename, FA_WRITE | FA_OPEN_ALWAYS); //FA_OPEN_APPEND
+    // При повторном открытии после ошибки данные после
+    // последней синхронизации могли не попасть в файл.
+    if(trends.synced_samples < trends.samples) trends.samples = trends.synced_samples;
+
+    memset(&trends.file, 0x0, sizeof(FIL));
+    fr = f_open(&trends.file, filename, FA_WRITE | ((trends.samples == 0) ? FA_CREATE_ALWAYS : FA_OPEN_ALWAYS));
     if(fr != FR_OK) return E_IO_ERROR;
 
+    // Начало данных в файле CFF известно после записи его начала,
+    // при продолжении записи оно уже записано.
+    FSIZE_t data_pos = comtrade->cff ? comtrade->dat_pos : 0;
     size_t record_size = comtrade_dat_record_size(comtrade);
-    size_t records_size = record_size * trends->samples;
+    size_t file_samples = 0;
+    if(f_size(&trends.file) > data_pos){
+        file_samples = (size_t)((f_size(&trends.file) - data_pos) / record_size);
+    }
+    if(file_samples < trends.samples) trends.samples = file_samples;
+
+    // Зарезервируем место под весь файл тренда,
+    // без непрерывного места файл пишется как обычно.
+    if(trends.limit_samples != TRENDS_LIMIT_SAMPLES_UNLIMIT){
+        err = comtrade_dat_reserve(&trends.file, comtrade, trends.limit_samples, trends.clmt);
+        if(err == E_IO_ERROR){
+            f_close(&trends.file);
+            return err;
+        }
+        err = E_NO_ERROR;
+    }
+
+    // Файл конфигурации нового файла тренда,
+    // при продолжении записи он уже записан.
+    if(trends.samples == 0){
+        if(comtrade->cff){
+            err = comtrade_write_cff_head(&trends.file, comtrade, 0);
+            data_pos = comtrade->dat_pos;
+        }else{
+            err = trends_task_ctrd_write_cfg(comtrade);
+        }
+    }
+
     // Перейдём на нужную позицию в файле.
-    fr = f_lseek(&trends->file, records_size);
-    if(fr != FR_OK) return E_IO_ERROR;
+    if(err == E_NO_ERROR){
+        fr = f_lseek(&trends.file, data_pos + (FSIZE_t)record_size * trends.samples);
+        if(fr == FR_OK){
+            err = comtrade_dat_stream_init(&trends.dat_stream, &trends.file, trends.dat_buf, TRENDS_DAT_BUF_SIZE);
+        }else{
+            err = E_IO_ERROR;
+        }
+    }
 
-    //size_t start = osc_data->start;
-    size_t count = osc_data->count;
-    size_t samples = trends->samples;
-    size_t time = trends->timestamp;
+    if(err != E_NO_ERROR){
+        f_close(&trends.file);
+        return err;
+    }
 
-    size_t timestamp;
-    size_t nsample;
-    size_t sample_index = 0;
-    for(nsample = 0; nsample < count; nsample ++){
+    trends.file_opened = true;
+    trends.sync_last = xTaskGetTickCount();
 
-        sample_index = /*start +*/ nsample + samples;
-        timestamp = nsample + time;
+    return E_NO_ERROR;
+}
 
-        err = comtrade_append_dat(&trends->file, comtrade, sample_index, timestamp);
-        if(err != E_NO_ERROR) break;
+/**
+ * Закрывает файл данных тренда без записи буфера
+ * после ошибки записи.
+ */
+static void trends_task_file_drop(void)
+{
+    if(!trends.file_opened) return;
+
+    f_close(&trends.file);
+
+    trends.file_opened = false;
+}
+
+/**
+ * Записывает буфер потока и синхронизирует файл данных,
+ * после чего обновляет число семплов в файле конфигурации.
+ * В файле CFF число семплов обновляется до синхронизации.
+ * @param comtrade Комтрейд.
+ * @return Код ошибки.
+ */
+static err_t trends_task_file_sync(comtrade_t* comtrade)
+{
+    if(!trends.file_opened) return E_NO_ERROR;
+
+    err_t err = E_NO_ERROR;
+
+    err = comtrade_dat_stream_flush(&trends.dat_stream);
+    if(err != E_NO_ERROR) return err;
+
+    if(comtrade->cff){
+        // Число семплов и размер данных обновляются
+        // в начале файла до синхронизации.
+        err = comtrade_update_cfg_endsamp(&trends.file, comtrade, trends.samples);
+        if(err != E_NO_ERROR) return err;
+
+        if(f_sync(&trends.file) != FR_OK) return E_IO_ERROR;
+
+        trends.synced_samples = trends.samples;
+    }else{
+        if(f_sync(&trends.file) != FR_OK) return E_IO_ERROR;
+
+        trends.synced_samples = trends.samples;
+
+        err = trends_task_ctrd_update_cfg(comtrade);
+        if(err != E_NO_ERROR) return err;
     }
 
-    f_close(&trends->file);
+    trends.sync_last = xTaskGetTickCount();
+
+    return E_NO_ERROR;
+}
+
+/**
+ * Получает необходимость периодической синхронизации файла.
+ * @return Флаг необходимости синхронизации.
+ */
+static bool trends_task_file_sync_needed(void)
+{
+    if(trends.sync_period == 0) return true;
+
+    TickType_t period = pdMS_TO_TICKS(trends.sync_period * 1000);
+
+    return (xTaskGetTickCount() - trends.sync_last) >= period;
+}
+
+/**
+ * Синхронизирует и закрывает файл данных тренда.
+ * @param comtrade Комтрейд.
+ * @return Код ошибки.
+ */
+static err_t trends_task_file_close(comtrade_t* comtrade)
+{
+    if(!trends.file_opened) return E_NO_ERROR;
+
+    err_t err = E_NO_ERROR;
+    FRESULT fr = FR_OK;
+
+    err = trends_task_file_sync(comtrade);
+
+    // Данные после ошибочной записи
+    // и неиспользованное зарезервированное место.
+    if(err == E_NO_ERROR){
+        fr = f_truncate(&trends.file);
+        if(fr != FR_OK) err = E_IO_ERROR;
+    }
+
+    fr = f_close(&trends.file);
+    if(err == E_NO_ERROR && fr != FR_OK) err = E_IO_ERROR;
+
+    trends.file_opened = false;
 
     return err;
 }
 
+/**
+ * Добавляет семплы буфера в файл данных тренда.
+ * @param comtrade Комтрейд.
+ * @return Код ошибки.
+ */
+static err_t trends_task_file_append(comtrade_t* comtrade)
+{
+    err_t err = E_NO_ERROR;
+
+    trends_osc_data_t* osc_data = (trends_osc_data_t*)comtrade->osc_data;
+
+    err = trends_task_file_open(comtrade);
+    if(err != E_NO_ERROR) return err;
+
+    // Повторная запись читает семплы заново.
+    osc_data->sample = OSC_INDEX_INVALID;
+
+    err = comtrade_dat_stream_append(&trends.dat_stream, comtrade,
+                                     trends.samples, trends.timestamp, osc_data->count);
+    if(err != E_NO_ERROR){
+        trends_task_file_drop();
+        return err;
+    }
+
+    return E_NO_ERROR;
+}
+
 static err_t trends_task_write_osc_buf_part(osc_t* osc, size_t buf, size_t start, size_t count)
 {
     /*printf("samples %d write buf %d start %d count %d\r\n",
@@ -645,19 +964,23 @@ static err_t trends_task_write_osc_buf_part(osc_t* osc, size_t buf, size_t start
     int retry = 0;
 
     for(retry = 0; retry < TRENDS_WRITE_RETRIES; retry ++){
-        err = trends_task_ctrd_write_cfg(comtrade);
-        if(err == E_NO_ERROR) break;
-    }
-    if(err != E_NO_ERROR) return err;
-
-    for(retry = 0; retry < TRENDS_WRITE_RETRIES; retry ++){
-        err = trends_task_ctrd_write_dat(comtrade);
+        err = trends_task_file_append(comtrade);
         if(err == E_NO_ERROR) break;
     }
     if(err != E_NO_ERROR) return err;
 
     trends.samples += count;
 
+    // После повторной записи убедимся, что данные попали в файл,
+    // иначе ошибка скрывается в буфере потока до следующей попытки.
+    if(retry != 0 || trends_task_file_sync_needed()){
+        err = trends_task_file_sync(comtrade);
+        if(err != E_NO_ERROR){
+            trends_task_file_drop();
+            return err;
+        }
+    }
+
     return E_NO_ERROR;
 }
 
@@ -722,6 +1045,7 @@ static void trends_task_make_file_base_name(void)
 static void trends_task_reset_data(void)
 {
     trends.samples = 0;
+    trends.synced_samples = 0;
     memset(&trends.file_base_name, 0x0, TRENDS_FILENAME_LEN);
     memset(&trends.file, 0x0, sizeof(FIL));
     memset(&trends.comtrade, 0x0, sizeof(comtrade_t));
@@ -729,6 +1053,11 @@ static void trends_task_reset_data(void)
 
 static void trends_task_new_file(void)
 {
+    err_t err = trends_task_file_close(&trends.comtrade);
+    if(err != E_NO_ERROR){
+        printf("close file error %d\r\n", (int)err);
+    }
+
     trends_task_reset_data();
     trends_task_init_comtrade();
     trends_task_make_file_base_name();
@@ -741,6 +1070,10 @@ static void trends_task_on_start(void)
 
 static void trends_task_on_stop(void)
 {
+    err_t err = trends_task_file_close(&trends.comtrade);
+    if(err != E_NO_ERROR){
+        printf("close file error %d\r\n", (int)err);
+    }
 }
 
 static void trends_task_wait_if_pause(osc_t* osc, size_t buf)
@@ -777,6 +1110,12 @@ static err_t trends_task_on_sync(void)
         buf = osc_next_buffer(osc);
     }
 
+    // Синхронизация после останова завершает запись файла.
+    if(trends.state != TRENDS_STATE_RUN){
+        err = trends_task_file_close(&trends.comtrade);
+        if(err != E_NO_ERROR) res_err = err;
+    }
+
     return res_err;
 }
 
@@ -888,6 +1227,13 @@ err_t trends_remove_outdated(DIR* dir_var, FILINFO* fno_var)
 
         if(trends.state != TRENDS_STATE_RUN) break;
 
+        // Текущий тренд открыт на запись.
+        if(trends.file_base_name[0] != '\0' &&
+           strncmp(fno->fname, trends.file_base_name, strlen(trends.file_base_name)) == 0){
+            fr = f_findnext(dir, fno);
+            continue;
+        }
+
         fdatetime = ((DWORD)fno->fdate << 16) | fno->ftime;
         file_time = fattime_to_time(fdatetime, NULL);
 
@@ -6,6 +6,7 @@
 #define TRENDS_H_
 
 #include "osc.h"
+#include "comtrade.h"
 #include "errors/errors.h"
 #include "future/future.h"
 #include "q15/q15.h"
@@ -13,7 +14,7 @@
 #include "fatfs/ff.h"
 
 
-//! Число семплов трендов.
+//! Число семплов трендов в общей памяти по-умолчанию.
 #define TRENDS_SAMPLES 4096
 
 //! Число буферов трендов.
@@ -37,6 +38,20 @@ extern err_t trends_init(void);
  */
 extern osc_t* trends_get_osc(void);
 
+/**
+ * Выделяет трендам память семплов из общей памяти.
+ * Должно вызываться после arena_reset() до osc_init_channels().
+ * @param samples Число семплов.
+ * @return Код ошибки.
+ */
+extern err_t trends_set_samples(size_t samples);
+
+/**
+ * Получает размер памяти семплов трендов.
+ * @return Число семплов.
+ */
+extern size_t trends_samples(void);
+
 /**
  * Добавляет текущие значения в тренды.
  */
@@ -66,6 +81,21 @@ extern void trends_resume(void);
  */
 extern iq15_t trends_time(void);
 
+/**
+ * Получает период синхронизации файла тренда.
+ * @return Период в секундах.
+ */
+extern size_t trends_sync_period(void);
+
+/**
+ * Устанавливает период синхронизации файла тренда.
+ * Файл данных остаётся открытым до смены файла тренда,
+ * при синхронизации на карту записываются буферизованные данные
+ * и обновляется число семплов в файле конфигурации.
+ * @param period Период в секундах, 0 - при каждой записи.
+ */
+extern void trends_set_sync_period(size_t period);
+
 /**
  * Получает лимит тренда в одном файле.
  * @return Лимит.
@@ -102,6 +132,33 @@ extern size_t trends_outdate_interval(void);
  */
 extern void trends_set_outdate_interval(size_t interval);
 
+/**
+ * Получает тип данных COMTRADE трендов.
+ * @return Тип данных.
+ */
+extern comtrade_dat_type_t trends_dat_type(void);
+
+/**
+ * Устанавливает тип данных COMTRADE трендов.
+ * Применяется со следующего файла тренда.
+ * @param dat_type Тип данных.
+ * @return Код ошибки.
+ */
+extern err_t trends_set_dat_type(comtrade_dat_type_t dat_type);
+
+/**
+ * Получает флаг записи трендов единым файлом CFF.
+ * @return Флаг записи файлом CFF.
+ */
+extern bool trends_cff(void);
+
+/**
+ * Устанавливает флаг записи трендов единым файлом CFF.
+ * Применяется со следующего файла тренда.
+ * @param cff Флаг записи файлом CFF.
+ */
+extern void trends_set_cff(bool cff);
+
 /**
  * Получает флаг разрешения записи трендров.
  * @return Флаг разрешения записи трендров.
@@ -146,6 +146,22 @@ bool trig_check(q15_t dt)
 	return activated;
 }
 
+bool trig_active(void)
+{
+	if(!trig.enabled) return false;
+
+	trig_channel_t* channel = NULL;
+
+	size_t i;
+	for(i = 0; i < TRIG_COUNT_MAX; i ++){
+		channel = trig_channel(i);
+
+		if(channel->enabled && channel->active) return true;
+	}
+
+	return false;
+}
+
 err_t trig_channel_reset(size_t n)
 {
 	if(n >= TRIG_COUNT_MAX) return E_OUT_OF_RANGE;
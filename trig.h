@@ -82,6 +82,13 @@ extern bool trig_enabled(void);
  */
 extern bool trig_check(q15_t dt);
 
+/**
+ * Получает флаг активности хотя бы одного триггера
+ * по результатам последней проверки.
+ * @return Флаг активности.
+ */
+extern bool trig_active(void);
+
 /**
  * Сбрасывает канал триггеров.
  * @param n Номер канала.